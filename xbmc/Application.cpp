@@ -173,6 +173,7 @@
 
 #ifdef HAS_PERFORMANCE_SAMPLE
 #include "utils/PerformanceSample.h"
+#include "utils/FrameTracer.h"
 #else
 #define MEASURE_FUNCTION
 #endif
@@ -1912,6 +1913,8 @@ void CApplication::Render()
   if (m_bStop)
     return;
 
+  TRACE_ZONE("CApplication::Render");
+
   bool hasRendered = false;
 
   // Whether externalplayer is playing and we're unfocused
@@ -1925,6 +1928,9 @@ void CApplication::Render()
   if(!g_Windowing.BeginRender())
     return;
 
+  // load the images decoded in the background, before they're needed for this frame
+  g_largeTextureManager.UploadTextures();
+
   CDirtyRegionList dirtyRegions;
 
   // render gui layer
@@ -1961,14 +1967,17 @@ void CApplication::Render()
   // reset our info cache - we do this at the end of Render so that it is
   // fresh for the next process(), or after a windowclose animation (where process()
   // isn't called)
-  g_infoManager.ResetCache();
+  g_infoManager.ResetFrameCache();
 
   if (hasRendered)
   {
     g_infoManager.UpdateFPS();
   }
 
-  g_graphicsContext.Flip(hasRendered, m_pPlayer->IsRenderingVideoLayer());
+  {
+    TRACE_ZONE("Present");
+    g_graphicsContext.Flip(hasRendered, m_pPlayer->IsRenderingVideoLayer());
+  }
 
   CTimeUtils::UpdateFrameTime(hasRendered);
 }
@@ -2725,6 +2734,7 @@ void CApplication::UnlockFrameMoveGuard()
 void CApplication::FrameMove(bool processEvents, bool processGUI)
 {
   MEASURE_FUNCTION;
+  TRACE_ZONE("CApplication::FrameMove");
 
   if (processEvents)
   {
@@ -29,6 +29,7 @@
 #include "Util.h"
 #include "playlists/PlayListFactory.h"
 #include "utils/Crc32.h"
+#include "utils/JobManager.h"
 #include "filesystem/Directory.h"
 #include "filesystem/File.h"
 #include "filesystem/StackDirectory.h"
@@ -1870,25 +1871,143 @@ void CFileItemList::SetFastLookup(bool fastLookup)
   CSingleLock lock(m_lock);
 
   if (fastLookup && !m_fastLookup)
-  { // generate the map
-    m_map.clear();
+  { // generate the index
+    m_index.Clear();
+    m_index.Reserve(m_items.size());
     for (unsigned int i=0; i < m_items.size(); i++)
-    {
-      CFileItemPtr pItem = m_items[i];
-      m_map.insert(MAPFILEITEMSPAIR(m_ignoreURLOptions ? CURL(pItem->GetPath()).GetWithoutOptions() : pItem->GetPath(), pItem));
-    }
+      m_index.Insert(m_items[i], m_ignoreURLOptions);
   }
   if (!fastLookup && m_fastLookup)
-    m_map.clear();
+    m_index.Clear();
   m_fastLookup = fastLookup;
 }
 
+void CFileItemList::CPathIndex::Clear()
+{
+  m_entries.clear();
+  m_size = 0;
+}
+
+void CFileItemList::CPathIndex::Reserve(size_t count)
+{
+  size_t capacity = 16;
+  while (capacity * 3 < count * 4)
+    capacity *= 2;
+
+  if (capacity > m_entries.size())
+    Rehash(capacity);
+}
+
+size_t CFileItemList::CPathIndex::Hash(const std::string &path, bool ignoreURLOptions)
+{
+  if (ignoreURLOptions)
+    return std::hash<std::string>()(CURL(path).GetWithoutOptions());
+
+  return std::hash<std::string>()(path);
+}
+
+void CFileItemList::CPathIndex::Rehash(size_t capacity)
+{
+  std::vector<Entry> entries(capacity);
+  const size_t mask = capacity - 1;
+
+  // start at the end of a run of entries, which keeps items with the same path in insertion order
+  const size_t oldCapacity = m_entries.size();
+  size_t start = 0;
+  while (start < oldCapacity && m_entries[start].item)
+    start++;
+
+  for (size_t n = 0; n < oldCapacity; n++)
+  {
+    Entry &entry = m_entries[(start + n) % oldCapacity];
+    if (!entry.item)
+      continue;
+
+    size_t i = entry.hash & mask;
+    while (entries[i].item)
+      i = (i + 1) & mask;
+    entries[i] = std::move(entry);
+  }
+
+  m_entries.swap(entries);
+}
+
+void CFileItemList::CPathIndex::Insert(const CFileItemPtr &item, bool ignoreURLOptions)
+{
+  if ((m_size + 1) * 4 > m_entries.size() * 3)
+    Reserve(m_size + 1);
+
+  const size_t mask = m_entries.size() - 1;
+  const size_t hash = Hash(item->GetPath(), ignoreURLOptions);
+  size_t i = hash & mask;
+  while (m_entries[i].item)
+    i = (i + 1) & mask;
+
+  m_entries[i].hash = hash;
+  m_entries[i].item = item;
+  m_size++;
+}
+
+void CFileItemList::CPathIndex::Erase(const CFileItem *item, bool ignoreURLOptions)
+{
+  if (m_entries.empty())
+    return;
+
+  const size_t mask = m_entries.size() - 1;
+  size_t i = Hash(item->GetPath(), ignoreURLOptions) & mask;
+  while (m_entries[i].item && m_entries[i].item.get() != item)
+    i = (i + 1) & mask;
+
+  if (!m_entries[i].item)
+  { // the path of the item changed since it was added
+    for (i = 0; i < m_entries.size() && m_entries[i].item.get() != item; i++)
+      ;
+    if (i == m_entries.size())
+      return;
+  }
+
+  // move following entries of the run back into the hole, so lookups need no tombstones
+  size_t hole = i;
+  for (size_t j = (i + 1) & mask; m_entries[j].item; j = (j + 1) & mask)
+  {
+    const size_t home = m_entries[j].hash & mask;
+    if (((j - home) & mask) >= ((j - hole) & mask))
+    {
+      m_entries[hole] = std::move(m_entries[j]);
+      hole = j;
+    }
+  }
+  m_entries[hole].item.reset();
+  m_size--;
+}
+
+CFileItemPtr CFileItemList::CPathIndex::Find(const std::string &path, bool ignoreURLOptions) const
+{
+  if (m_entries.empty())
+    return CFileItemPtr();
+
+  const std::string withoutOptions = ignoreURLOptions ? CURL(path).GetWithoutOptions() : std::string();
+  const std::string &key = ignoreURLOptions ? withoutOptions : path;
+
+  const size_t mask = m_entries.size() - 1;
+  const size_t hash = std::hash<std::string>()(key);
+  for (size_t i = hash & mask; m_entries[i].item; i = (i + 1) & mask)
+  {
+    const Entry &entry = m_entries[i];
+    if (entry.hash == hash &&
+        (ignoreURLOptions ? CURL(entry.item->GetPath()).GetWithoutOptions() == key : entry.item->GetPath() == key))
+      return entry.item;
+  }
+
+  return CFileItemPtr();
+}
+
 bool CFileItemList::Contains(const std::string& fileName) const
 {
   CSingleLock lock(m_lock);
 
   if (m_fastLookup)
-    return m_map.find(m_ignoreURLOptions ? CURL(fileName).GetWithoutOptions() : fileName) != m_map.end();
+    return m_index.Find(fileName, m_ignoreURLOptions) != NULL;
 
   // slow method...
   for (unsigned int i = 0; i < m_items.size(); i++)
@@ -1926,14 +2045,14 @@ void CFileItemList::ClearItems()
     item->FreeMemory();
   }
   m_items.clear();
-  m_map.clear();
+  m_index.Clear();
 }
 
 void CFileItemList::Add(CFileItemPtr pItem)
 {
   CSingleLock lock(m_lock);
   if (m_fastLookup)
-    m_map.insert(MAPFILEITEMSPAIR(m_ignoreURLOptions ? CURL(pItem->GetPath()).GetWithoutOptions() : pItem->GetPath(), pItem));
+    m_index.Insert(pItem, m_ignoreURLOptions);
   m_items.emplace_back(std::move(pItem));
 }
 
@@ -1942,7 +2061,7 @@ void CFileItemList::Add(CFileItem&& item)
   CSingleLock lock(m_lock);
   auto ptr = std::make_shared<CFileItem>(std::move(item));
   if (m_fastLookup)
-    m_map.insert(MAPFILEITEMSPAIR(m_ignoreURLOptions ? CURL(ptr->GetPath()).GetWithoutOptions() : ptr->GetPath(), ptr));
+    m_index.Insert(ptr, m_ignoreURLOptions);
   m_items.emplace_back(std::move(ptr));
 }
 
@@ -1960,7 +2079,7 @@ void CFileItemList::AddFront(const CFileItemPtr &pItem, int itemPosition)
   }
   if (m_fastLookup)
   {
-    m_map.insert(MAPFILEITEMSPAIR(m_ignoreURLOptions ? CURL(pItem->GetPath()).GetWithoutOptions() : pItem->GetPath(), pItem));
+    m_index.Insert(pItem, m_ignoreURLOptions);
   }
 }
 
@@ -1972,11 +2091,11 @@ void CFileItemList::Remove(CFileItem* pItem)
   {
     if (pItem == it->get())
     {
-      m_items.erase(it);
       if (m_fastLookup)
       {
-        m_map.erase(m_ignoreURLOptions ? CURL(pItem->GetPath()).GetWithoutOptions() : pItem->GetPath());
+        m_index.Erase(pItem, m_ignoreURLOptions);
       }
+      m_items.erase(it);
       break;
     }
   }
@@ -1991,7 +2110,7 @@ void CFileItemList::Remove(int iItem)
     CFileItemPtr pItem = *(m_items.begin() + iItem);
     if (m_fastLookup)
     {
-      m_map.erase(m_ignoreURLOptions ? CURL(pItem->GetPath()).GetWithoutOptions() : pItem->GetPath());
+      m_index.Erase(pItem.get(), m_ignoreURLOptions);
     }
     m_items.erase(m_items.begin() + iItem);
   }
@@ -2073,13 +2192,8 @@ CFileItemPtr CFileItemList::Get(const std::string& strPath)
   CSingleLock lock(m_lock);
 
   if (m_fastLookup)
-  {
-    IMAPFILEITEMS it = m_map.find(m_ignoreURLOptions ? CURL(strPath).GetWithoutOptions() : strPath);
-    if (it != m_map.end())
-      return it->second;
+    return m_index.Find(strPath, m_ignoreURLOptions);
 
-    return CFileItemPtr();
-  }
   // slow method...
   for (unsigned int i = 0; i < m_items.size(); i++)
   {
@@ -2096,13 +2210,8 @@ const CFileItemPtr CFileItemList::Get(const std::string& strPath) const
   CSingleLock lock(m_lock);
 
   if (m_fastLookup)
-  {
-    std::map<std::string, CFileItemPtr>::const_iterator it = m_map.find(m_ignoreURLOptions ? CURL(strPath).GetWithoutOptions() : strPath);
-    if (it != m_map.end())
-      return it->second;
+    return m_index.Find(strPath, m_ignoreURLOptions);
 
-    return CFileItemPtr();
-  }
   // slow method...
   for (unsigned int i = 0; i < m_items.size(); i++)
   {
@@ -2130,6 +2239,8 @@ void CFileItemList::Reserve(int iCount)
 {
   CSingleLock lock(m_lock);
   m_items.reserve(iCount);
+  if (m_fastLookup)
+    m_index.Reserve(iCount);
 }
 
 void CFileItemList::Sort(FILEITEMLISTCOMPARISONFUNC func)
@@ -2180,21 +2291,31 @@ void CFileItemList::Sort(SortDescription sortDescription)
   if (m_sortIgnoreFolders)
     sortDescription.sortAttributes = (SortAttribute)((int)sortDescription.sortAttributes | SortAttributeIgnoreFolders);
 
-  const Fields fields = SortUtils::GetFieldsForSorting(sortDescription.sortBy);
-  SortItems sortItems((size_t)Size());
-  for (int index = 0; index < Size(); index++)
-  {
-    sortItems[index] = std::shared_ptr<SortItem>(new SortItem);
-    m_items[index]->ToSortable(*sortItems[index], fields);
-    (*sortItems[index])[FieldId] = index;
-  }
+  CSingleLock lock(m_lock);
+
+  SortItems sortItems(m_items.size());
+  for (size_t index = 0; index < m_items.size(); index++)
+    sortItems[index] = std::make_shared<SortItem>();
+
+  const Fields &fields = SortUtils::GetFieldsForSorting(sortDescription.sortBy);
+  CJobManager::GetInstance().ParallelFor(m_items.size(), 1024, [&](size_t begin, size_t end) {
+    for (size_t index = begin; index < end; index++)
+    {
+      const CFileItem &item = *m_items[index];
+      SortItem &sortable = *sortItems[index];
+      item.ToSortable(sortable, fields);
+      SortUtils::Prepare(sortDescription.sortBy, sortDescription.sortAttributes, sortable);
+      sortable[FieldId] = (int)index;
+    }
+  });
 
   // do the sorting
-  SortUtils::Sort(sortDescription, sortItems);
+  SortUtils::SortPrepared(sortDescription.sortOrder, sortDescription.sortAttributes, sortItems,
+                          sortDescription.limitEnd, sortDescription.limitStart);
 
   // apply the new order to the existing CFileItems
   VECFILEITEMS sortedFileItems;
-  sortedFileItems.reserve(Size());
+  sortedFileItems.reserve(sortItems.size());
   for (SortItems::const_iterator it = sortItems.begin(); it != sortItems.end(); it++)
   {
     CFileItemPtr item = m_items[(int)(*it)->at(FieldId).asInteger()];
@@ -3339,7 +3460,7 @@ bool CFileItemList::UpdateItem(const CFileItem *item)
     if (pItem->IsSamePath(item))
     {
       pItem->UpdateInfo(*item);
-      return true;
+        return true;
     }
   }
   return false;
@@ -3376,6 +3497,7 @@ void CFileItemList::SetReplaceListing(bool replace)
 
 void CFileItemList::ClearSortState()
 {
+  CSingleLock lock(m_lock);
   m_sortDescription.sortBy = SortByNone;
   m_sortDescription.sortOrder = SortOrderNone;
   m_sortDescription.sortAttributes = SortAttributeNone;
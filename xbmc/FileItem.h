@@ -753,6 +753,36 @@ public:
 
   void ClearSortState();
 private:
+  /*!
+   \brief Hash index of the items by path for fast lookups
+   Open addressing with linear probing. Entries refer to the items themselves, so sorting or
+   otherwise reordering the list leaves the index untouched.
+   */
+  class CPathIndex
+  {
+  public:
+    CPathIndex() : m_size(0) {}
+
+    void Clear();
+    void Reserve(size_t count);
+    void Insert(const CFileItemPtr &item, bool ignoreURLOptions);
+    void Erase(const CFileItem *item, bool ignoreURLOptions);
+    CFileItemPtr Find(const std::string &path, bool ignoreURLOptions) const;
+
+  private:
+    struct Entry
+    {
+      size_t hash;
+      CFileItemPtr item; ///< empty for a free slot
+    };
+
+    static size_t Hash(const std::string &path, bool ignoreURLOptions);
+    void Rehash(size_t capacity);
+
+    std::vector<Entry> m_entries; ///< size is zero or a power of two
+    size_t m_size;
+  };
+
   void Sort(FILEITEMLISTCOMPARISONFUNC func);
   void FillSortFields(FILEITEMFILLFUNC func);
   std::string GetDiscFileCache(int windowID) const;
@@ -770,7 +800,7 @@ private:
   void StackFolders();
 
   VECFILEITEMS m_items;
-  MAPFILEITEMS m_map;
+  CPathIndex m_index;
   bool m_ignoreURLOptions;
   bool m_fastLookup;
   SortDescription m_sortDescription;
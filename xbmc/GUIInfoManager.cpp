@@ -41,6 +41,7 @@
 #include "utils/SystemInfo.h"
 #include "guilib/GUITextBox.h"
 #include "guilib/GUIControlGroupList.h"
+#include "guilib/GUIInfoTypes.h"
 #include "pictures/GUIWindowSlideShow.h"
 #include "pictures/PictureInfoTag.h"
 #include "music/tags/MusicInfoTag.h"
@@ -62,6 +63,7 @@
 #include "guilib/StereoscopicsManager.h"
 #include "utils/CharsetConverter.h"
 #include "utils/CPUInfo.h"
+#include "utils/FrameTracer.h"
 #include "utils/SortUtils.h"
 #include "utils/StringUtils.h"
 #include "utils/MathUtils.h"
@@ -153,6 +155,16 @@ CGUIInfoManager::CGUIInfoManager(void) :
   m_playerShowTime = false;
   m_playerShowInfo = false;
   m_fps = 0.0f;
+  m_changedDependencies = INFO_DEPENDS_NONE;
+  m_boolEvaluations = 0;
+  for (unsigned int i = 0; i < INFO_DEPENDS_SOURCES; ++i)
+    m_versions[i] = 0;
+  m_lastBoolEvaluations = 0;
+  m_lastLabelRebuilds = 0;
+  m_frameBoolEvaluations = 0;
+  m_frameLabelRebuilds = 0;
+  m_playerWasPlaying = false;
+  m_lastFrameTime = 0;
   ResetLibraryBools();
 }
 
@@ -6803,14 +6815,6 @@ bool CGUIInfoManager::GetInt(int &value, int info, int contextWindow, const CGUI
   return false;
 }
 
-// functor for comparison InfoPtr's
-struct InfoBoolFinder
-{
-  InfoBoolFinder(const std::string &expression, int context) : m_bool(expression, context) {};
-  bool operator() (const InfoPtr &right) const { return m_bool == *right; };
-  InfoBool m_bool;
-};
-
 INFO::InfoPtr CGUIInfoManager::Register(const std::string &expression, int context)
 {
   std::string condition(CGUIInfoLabel::ReplaceLocalize(expression));
@@ -6819,17 +6823,27 @@ INFO::InfoPtr CGUIInfoManager::Register(const std::string &expression, int conte
   if (condition.empty())
     return INFO::InfoPtr();
 
+  // info bools are compared case insensitively, within their context
+  std::string key(condition);
+  StringUtils::ToLower(key);
+  key += StringUtils::Format("@%i", context);
+
   CSingleLock lock(m_critInfo);
   // do we have the boolean expression already registered?
-  std::vector<InfoPtr>::const_iterator i = std::find_if(m_bools.begin(), m_bools.end(), InfoBoolFinder(condition, context));
-  if (i != m_bools.end())
-    return *i;
+  std::unordered_map<std::string, std::weak_ptr<InfoBool>>::const_iterator i = m_boolLookup.find(key);
+  if (i != m_boolLookup.end())
+  {
+    InfoPtr info = i->second.lock();
+    if (info)
+      return info;
+  }
 
   if (condition.find_first_of("|+[]!") != condition.npos)
     m_bools.push_back(std::make_shared<InfoExpression>(condition, context));
   else
     m_bools.push_back(std::make_shared<InfoSingle>(condition, context));
 
+  m_boolLookup[key] = m_bools.back();
   return m_bools.back();
 }
 
@@ -9438,6 +9452,15 @@ void CGUIInfoManager::Clear()
   // log which ones are used - they should all be gone by now
   for (std::vector<InfoPtr>::const_iterator i = m_bools.begin(); i != m_bools.end(); ++i)
     CLog::Log(LOGDEBUG, "Infobool '%s' still used by %u instances", (*i)->GetExpression().c_str(), (unsigned int) i->use_count());
+
+  // drop the lookups of the erased ones
+  for (std::unordered_map<std::string, std::weak_ptr<InfoBool>>::iterator i = m_boolLookup.begin(); i != m_boolLookup.end();)
+  {
+    if (i->second.expired())
+      i = m_boolLookup.erase(i);
+    else
+      ++i;
+  }
 }
 
 void CGUIInfoManager::UpdateFPS()
@@ -10800,12 +10823,179 @@ void CGUIInfoManager::ResetCache()
 {
   // reset any animation triggers as well
   m_containerMoves.clear();
-  // mark our infobools as dirty
+  // mark our infobools and labels as dirty
+  for (unsigned int i = 0; i < INFO_DEPENDS_SOURCES; ++i)
+    m_versions[i]++;
   CSingleLock lock(m_critInfo);
   for (std::vector<InfoPtr>::iterator i = m_bools.begin(); i != m_bools.end(); ++i)
     (*i)->SetDirty();
 }
 
+void CGUIInfoManager::ResetFrameCache()
+{
+  TRACE_ZONE("CGUIInfoManager::ResetFrameCache");
+  // reset any animation triggers as well
+  m_containerMoves.clear();
+
+  // window and focus state has no single point of change, so is assumed to change every frame
+  unsigned int changed = m_changedDependencies.exchange(INFO_DEPENDS_NONE);
+  changed |= INFO_DEPENDS_WINDOW | INFO_DEPENDS_LISTITEM | INFO_DEPENDS_FRAME;
+
+  // player state changes continuously during playback, and once more when it ends
+  bool playing = g_application.m_pPlayer->IsPlaying();
+  if (playing || m_playerWasPlaying)
+    changed |= INFO_DEPENDS_PLAYER;
+  m_playerWasPlaying = playing;
+
+  time_t now = time(NULL);
+  if (now != m_lastFrameTime)
+    changed |= INFO_DEPENDS_TIME;
+  m_lastFrameTime = now;
+
+  // bump the versions the info labels check against
+  for (unsigned int i = 0; i < INFO_DEPENDS_SOURCES; ++i)
+  {
+    if (changed & (1 << i))
+      m_versions[i]++;
+  }
+
+  unsigned int boolEvaluations = m_boolEvaluations;
+  unsigned int labelRebuilds = CGUIInfoLabel::GetRebuilds();
+  m_frameBoolEvaluations = boolEvaluations - m_lastBoolEvaluations;
+  m_frameLabelRebuilds = labelRebuilds - m_lastLabelRebuilds;
+  m_lastBoolEvaluations = boolEvaluations;
+  m_lastLabelRebuilds = labelRebuilds;
+
+  // mark the infobools reading any of it as dirty
+  CSingleLock lock(m_critInfo);
+  for (std::vector<InfoPtr>::iterator i = m_bools.begin(); i != m_bools.end(); ++i)
+  {
+    if ((*i)->GetDependencies() & changed)
+      (*i)->SetDirty();
+  }
+}
+
+void CGUIInfoManager::InvalidateInfo(unsigned int dependencies)
+{
+  m_changedDependencies |= dependencies;
+}
+
+unsigned int CGUIInfoManager::GetVersion(unsigned int dependencies) const
+{
+  // the versions only ever increase, so their sum changes whenever any of them does
+  unsigned int version = 0;
+  for (unsigned int i = 0; i < INFO_DEPENDS_SOURCES; ++i)
+  {
+    if (dependencies & (1 << i))
+      version += m_versions[i];
+  }
+  return version;
+}
+
+unsigned int CGUIInfoManager::GetDependencies(int condition) const
+{
+  condition = abs(condition);
+  if (condition >= MULTI_INFO_START && condition <= MULTI_INFO_END)
+  {
+    if (condition - MULTI_INFO_START >= static_cast<int>(m_multiInfo.size()))
+      return INFO_DEPENDS_FRAME;
+
+    int info = abs(m_multiInfo[condition - MULTI_INFO_START].m_info);
+    if (info >= LISTITEM_START && info <= LISTITEM_END)
+      return INFO_DEPENDS_LISTITEM | INFO_DEPENDS_WINDOW;
+
+    switch (info)
+    {
+      case SKIN_BOOL:
+      case SKIN_STRING:
+        return INFO_DEPENDS_SKIN;
+      case SYSTEM_TIME:
+      case SYSTEM_DATE:
+        return INFO_DEPENDS_TIME;
+      case LIBRARY_HAS_ROLE:
+        return INFO_DEPENDS_LIBRARY;
+      case WINDOW_IS:
+      case WINDOW_IS_ACTIVE:
+      case WINDOW_IS_TOPMOST:
+      case WINDOW_IS_VISIBLE:
+      case WINDOW_NEXT:
+      case WINDOW_PREVIOUS:
+      case CONTROL_IS_ENABLED:
+      case CONTROL_IS_VISIBLE:
+      case CONTROL_GROUP_HAS_FOCUS:
+      case CONTROL_HAS_FOCUS:
+        return INFO_DEPENDS_WINDOW;
+      default:
+        return INFO_DEPENDS_FRAME;
+    }
+  }
+
+  if (condition >= LISTITEM_START && condition < LISTITEM_END)
+    return INFO_DEPENDS_LISTITEM | INFO_DEPENDS_WINDOW;
+  if (condition >= LIBRARY_HAS_MUSIC && condition <= LIBRARY_HAS_COMPILATIONS)
+    return INFO_DEPENDS_LIBRARY;
+  if (condition >= SYSTEM_PLATFORM_LINUX && condition <= SYSTEM_PLATFORM_LINUX_RASPBERRY_PI)
+    return INFO_DEPENDS_NONE;
+
+  switch (condition)
+  {
+    case SYSTEM_ALWAYS_TRUE:
+    case SYSTEM_ALWAYS_FALSE:
+    case SYSTEM_ETHERNET_LINK_ACTIVE:
+    case SYSTEM_HAS_PVR:
+    case SYSTEM_HAS_ADSP:
+    case SYSTEM_HAS_CMS:
+      return INFO_DEPENDS_NONE;
+    case WINDOW_IS_MEDIA:
+      return INFO_DEPENDS_WINDOW;
+    case SYSTEM_TIME:
+    case SYSTEM_DATE:
+      return INFO_DEPENDS_TIME;
+    // only ever true while playing, see GetBool
+    case PLAYER_HAS_MEDIA:
+    case PLAYER_HAS_AUDIO:
+    case PLAYER_HAS_VIDEO:
+    case PLAYER_HAS_GAME:
+    case PLAYER_PLAYING:
+    case PLAYER_PAUSED:
+    case PLAYER_REWINDING:
+    case PLAYER_REWINDING_2x:
+    case PLAYER_REWINDING_4x:
+    case PLAYER_REWINDING_8x:
+    case PLAYER_REWINDING_16x:
+    case PLAYER_REWINDING_32x:
+    case PLAYER_FORWARDING:
+    case PLAYER_FORWARDING_2x:
+    case PLAYER_FORWARDING_4x:
+    case PLAYER_FORWARDING_8x:
+    case PLAYER_FORWARDING_16x:
+    case PLAYER_FORWARDING_32x:
+    case PLAYER_CAN_RECORD:
+    case PLAYER_RECORDING:
+    case PLAYER_CAN_PAUSE:
+    case PLAYER_CAN_SEEK:
+    case PLAYER_SUPPORTS_TEMPO:
+    case PLAYER_IS_TEMPO:
+    case PLAYER_CACHING:
+    case PLAYER_SEEKING:
+    case PLAYER_SHOWTIME:
+    case PLAYER_HASDURATION:
+    case PLAYER_PASSTHROUGH:
+    case PLAYER_ISINTERNETSTREAM:
+    case PLAYER_DISPLAY_AFTER_SEEK:
+    case MUSICPLAYER_HASPREVIOUS:
+    case MUSICPLAYER_HASNEXT:
+    case MUSICPLAYER_PLAYLISTPLAYING:
+    case VIDEOPLAYER_HASMENU:
+    case VIDEOPLAYER_HASTELETEXT:
+    case VIDEOPLAYER_HASSUBTITLES:
+    case VIDEOPLAYER_SUBTITLESENABLED:
+      return INFO_DEPENDS_PLAYER;
+    default:
+      return INFO_DEPENDS_FRAME;
+  }
+}
+
 std::string CGUIInfoManager::GetPictureLabel(int info)
 {
   if (info == SLIDE_FILE_NAME)
@@ -10973,6 +11163,7 @@ void CGUIInfoManager::SetLibraryBool(int condition, bool value)
     default:
       break;
   }
+  InvalidateInfo(INFO_DEPENDS_LIBRARY);
 }
 
 void CGUIInfoManager::ResetLibraryBools()
@@ -10985,6 +11176,7 @@ void CGUIInfoManager::ResetLibraryBools()
   m_libraryHasSingles = -1;
   m_libraryHasCompilations = -1;
   m_libraryRoleCounts.clear();
+  InvalidateInfo(INFO_DEPENDS_LIBRARY);
 }
 
 bool CGUIInfoManager::GetLibraryBool(int condition)
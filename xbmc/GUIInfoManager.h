@@ -43,6 +43,7 @@
 #include <atomic>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace MUSIC_INFO
@@ -56,6 +57,7 @@ class CDateTime;
 namespace INFO
 {
   class InfoSingle;
+  class InfoExpression;
 }
 
 // forward
@@ -204,7 +206,43 @@ public:
   void SetNextWindow(int windowID) { m_nextWindowID = windowID; };
   void SetPreviousWindow(int windowID) { m_prevWindowID = windowID; };
 
+  /*! \brief Mark all info bools dirty
+   \sa ResetFrameCache
+   */
   void ResetCache();
+
+  /*! \brief Called at the end of every frame
+   Marks dirty the info bools which read state that changed, or may have changed, during the frame.
+   \sa InvalidateInfo
+   */
+  void ResetFrameCache();
+
+  /*! \brief Publish a change of state read by info bools
+   Info bools depending on it are re-evaluated next frame. May be called from any thread.
+   \param dependencies the INFO::InfoDependency flags of the state that changed
+   */
+  void InvalidateInfo(unsigned int dependencies);
+
+  /*! \brief Get the sources of state a condition reads
+   \param condition the condition id as returned from TranslateSingleString
+   \return a combination of INFO::InfoDependency flags
+   */
+  unsigned int GetDependencies(int condition) const;
+
+  /*! \brief Get a version of the state a condition reads
+   The version changes whenever any of the given sources is marked as changed by ResetFrameCache or ResetCache.
+   \param dependencies a combination of INFO::InfoDependency flags, as returned from GetDependencies
+   \return the combined version of the given sources
+   */
+  unsigned int GetVersion(unsigned int dependencies) const;
+
+  /*! \brief Number of info bools evaluated so far, for profiling */
+  unsigned int GetBoolEvaluations() const { return m_boolEvaluations; }
+
+  /*! \brief Number of info bools evaluated and info labels rebuilt during the last frame, for profiling */
+  unsigned int GetFrameBoolEvaluations() const { return m_frameBoolEvaluations; }
+  unsigned int GetFrameLabelRebuilds() const { return m_frameLabelRebuilds; }
+
   bool GetItemInt(int &value, const CGUIListItem *item, int info) const;
   std::string GetItemLabel(const CFileItem *item, int info, std::string *fallback = NULL);
   std::string GetItemImage(const CFileItem *item, int info, std::string *fallback = NULL);
@@ -236,6 +274,7 @@ public:
 
 protected:
   friend class INFO::InfoSingle;
+  friend class INFO::InfoExpression;
   bool GetBool(int condition, int contextWindow = 0, const CGUIListItem *item=NULL);
   int TranslateSingleString(const std::string &strCondition, bool &listItemDependent);
 
@@ -328,6 +367,16 @@ protected:
   int m_prevWindowID;
 
   std::vector<INFO::InfoPtr> m_bools;
+  std::unordered_map<std::string, std::weak_ptr<INFO::InfoBool>> m_boolLookup; ///< registered bools by lowercase expression and context
+  std::atomic<unsigned int> m_changedDependencies; ///< state published as changed since the last frame
+  std::atomic<unsigned int> m_boolEvaluations;
+  unsigned int m_versions[INFO::INFO_DEPENDS_SOURCES]; ///< change counters of each state source
+  unsigned int m_lastBoolEvaluations;
+  unsigned int m_lastLabelRebuilds;
+  unsigned int m_frameBoolEvaluations;
+  unsigned int m_frameLabelRebuilds;
+  bool m_playerWasPlaying;
+  time_t m_lastFrameTime;
   std::vector<INFO::CSkinVariableString> m_skinVariableStrings;
 
   int m_libraryHasMusic;
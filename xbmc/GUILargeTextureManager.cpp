@@ -23,14 +23,18 @@
 #include "settings/Settings.h"
 #include "guilib/Texture.h"
 #include "threads/SingleLock.h"
+#include "utils/FrameTracer.h"
 #include "utils/TimeUtils.h"
 #include "utils/JobManager.h"
 #include "guilib/GraphicContext.h"
 #include "utils/log.h"
 #include "TextureCache.h"
 
+#include <algorithm>
 #include <cassert>
 
+const unsigned int CGUILargeTextureManager::UPLOAD_BUDGET;
+
 CImageLoader::CImageLoader(const std::string &path, const bool useCache):
   m_path(path)
 {
@@ -53,7 +57,7 @@ bool CImageLoader::DoWork()
     return false;
 
   if (m_use_cache)
-    loadPath = CTextureCache::GetInstance().CheckCachedImage(texturePath, needsChecking);
+    loadPath = CTextureCache::GetInstance().CheckCachedImage(texturePath, needsChecking, true);
   else
     loadPath = texturePath;
 
@@ -138,6 +142,10 @@ void CGUILargeTextureManager::CLargeTexture::SetTexture(CBaseTexture* texture)
 
 CGUILargeTextureManager::CGUILargeTextureManager()
 {
+  m_stats.bytes = 0;
+  m_stats.textures = m_stats.pending = m_stats.frames = m_stats.hitches = 0;
+  m_stats.maxFrameTime = 0.0f;
+  m_lastFrame = 0;
 }
 
 CGUILargeTextureManager::~CGUILargeTextureManager()
@@ -176,6 +184,17 @@ bool CGUILargeTextureManager::GetImage(const std::string &path, CTextureArray &t
     }
   }
 
+  for (uploadIterator it = m_uploads.begin(); it != m_uploads.end(); ++it)
+  {
+    if (it->image->GetPath() == path)
+    { // decoded, but not on the GPU yet
+      if (firstRequest)
+        it->image->AddRef();
+      it->requested = true;
+      return true;
+    }
+  }
+
   if (firstRequest)
     QueueImage(path, useCache);
 
@@ -195,6 +214,18 @@ void CGUILargeTextureManager::ReleaseImage(const std::string &path, bool immedia
       return;
     }
   }
+  for (uploadIterator it = m_uploads.begin(); it != m_uploads.end(); ++it)
+  {
+    if (it->image->GetPath() == path)
+    {
+      if (it->image->DecrRef(true))
+      {
+        delete it->texture;
+        m_uploads.erase(it);
+      }
+      return;
+    }
+  }
   for (queueIterator it = m_queued.begin(); it != m_queued.end(); ++it)
   {
     unsigned int id = it->first;
@@ -225,6 +256,14 @@ void CGUILargeTextureManager::QueueImage(const std::string &path, bool useCache)
       return; // already queued
     }
   }
+  for (uploadIterator it = m_uploads.begin(); it != m_uploads.end(); ++it)
+  {
+    if (it->image->GetPath() == path)
+    {
+      it->image->AddRef();
+      return; // already loaded
+    }
+  }
 
   // queue the item
   CLargeTexture *image = new CLargeTexture(path);
@@ -242,11 +281,67 @@ void CGUILargeTextureManager::OnJobComplete(unsigned int jobID, bool success, CJ
     { // found our job
       CImageLoader *loader = (CImageLoader *)job;
       CLargeTexture *image = it->second;
-      image->SetTexture(loader->m_texture);
-      loader->m_texture = NULL; // we want to keep the texture, and jobs are auto-deleted.
       m_queued.erase(it);
-      m_allocated.push_back(image);
+      if (loader->m_texture)
+      { // the texture goes to the GPU in UploadTextures()
+        CUpload upload = { image, loader->m_texture, false };
+        m_uploads.push_back(upload);
+      }
+      else
+        m_allocated.push_back(image);
+      loader->m_texture = NULL; // we want to keep the texture, and jobs are auto-deleted.
       return;
     }
   }
 }
+
+void CGUILargeTextureManager::UploadTextures()
+{
+  int64_t now = CurrentHostCounter();
+  if (m_lastFrame)
+  {
+    float frameTime = 1000.0f * (now - m_lastFrame) / CurrentHostFrequency();
+    float fps = g_graphicsContext.GetFPS();
+    m_stats.frames++;
+    if (fps > 0.0f && frameTime > 2000.0f / fps)
+      m_stats.hitches++;
+    m_stats.maxFrameTime = std::max(m_stats.maxFrameTime, frameTime);
+  }
+  m_lastFrame = now;
+
+  CSingleLock lock(m_listSection);
+  if (m_uploads.empty())
+    return;
+
+  TRACE_ZONE("CGUILargeTextureManager::UploadTextures");
+
+  // images on screen first, the others in the order they were decoded
+  std::stable_partition(m_uploads.begin(), m_uploads.end(), [](const CUpload &upload) { return upload.requested; });
+
+  unsigned int budget = UPLOAD_BUDGET;
+  uploadIterator it = m_uploads.begin();
+  while (it != m_uploads.end() && budget > 0)
+  {
+    if (it->texture->LoadRowsToGPU(budget))
+    {
+      it->image->SetTexture(it->texture);
+      m_allocated.push_back(it->image);
+      m_stats.textures++;
+      it = m_uploads.erase(it);
+    }
+    else
+      ++it;
+  }
+  m_stats.bytes += UPLOAD_BUDGET - budget;
+
+  for (it = m_uploads.begin(); it != m_uploads.end(); ++it)
+    it->requested = false;
+}
+
+CGUILargeTextureManager::UploadStats CGUILargeTextureManager::GetUploadStats() const
+{
+  CSingleLock lock(m_listSection);
+  UploadStats stats = m_stats;
+  stats.pending = m_uploads.size();
+  return stats;
+}
@@ -20,6 +20,7 @@
  *
  */
 
+#include <stdint.h>
 #include <utility>
 #include <vector>
 
@@ -56,13 +57,25 @@ public:
  \brief Background texture loading manager
 
  Used to load textures for the user interface asynchronously, allowing fluid framerates
- while background loading textures.
+ while background loading textures. Decoded images are loaded to the GPU by UploadTextures()
+ within a budget of bytes per frame, so that a large image or many images arriving at once
+ are spread over several frames.
 
  \sa IJobCallback, CGUITexture
  */
 class CGUILargeTextureManager : public IJobCallback
 {
 public:
+  struct UploadStats
+  {
+    uint64_t bytes;              ///< bytes loaded to the GPU
+    unsigned int textures;       ///< textures loaded to the GPU
+    unsigned int pending;        ///< decoded textures waiting to be loaded
+    unsigned int frames;         ///< frames rendered
+    unsigned int hitches;        ///< frames that took more than twice the refresh interval
+    float maxFrameTime;          ///< ms of the longest frame
+  };
+
   CGUILargeTextureManager();
   virtual ~CGUILargeTextureManager();
 
@@ -115,6 +128,21 @@ public:
    */
   void CleanupUnusedImages(bool immediately = false);
 
+  /*!
+   \brief Load decoded images to the GPU. Must be called once per frame from the rendering thread.
+
+   Images that have been requested since the last call, i.e. that are on screen, are loaded first.
+   Loading stops once UPLOAD_BUDGET bytes have been loaded, except that each call makes some progress.
+   */
+  void UploadTextures();
+
+  /*!
+   \brief Statistics of the loading to the GPU and of the frames it happens in.
+   */
+  UploadStats GetUploadStats() const;
+
+  static const unsigned int UPLOAD_BUDGET = 4 * 1024 * 1024;
+
 private:
   class CLargeTexture
   {
@@ -141,12 +169,23 @@ private:
 
   void QueueImage(const std::string &path, bool useCache = true);
 
+  struct CUpload
+  {
+    CLargeTexture *image;
+    CBaseTexture *texture;
+    bool requested;              ///< requested since the last upload
+  };
+
   std::vector< std::pair<unsigned int, CLargeTexture *> > m_queued;
+  std::vector<CUpload> m_uploads;
   std::vector<CLargeTexture *> m_allocated;
   typedef std::vector<CLargeTexture *>::iterator listIterator;
   typedef std::vector< std::pair<unsigned int, CLargeTexture *> >::iterator queueIterator;
+  typedef std::vector<CUpload>::iterator uploadIterator;
 
-  CCriticalSection m_listSection;
+  mutable CCriticalSection m_listSection;
+  UploadStats m_stats;
+  int64_t m_lastFrame;
 };
 
 extern CGUILargeTextureManager g_largeTextureManager;
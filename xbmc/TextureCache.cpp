@@ -24,10 +24,12 @@
 #include "profiles/ProfilesManager.h"
 #include "threads/SingleLock.h"
 #include "utils/Crc32.h"
+#include "utils/CPUInfo.h"
 #include "settings/AdvancedSettings.h"
 #include "utils/log.h"
 #include "utils/URIUtils.h"
 #include "utils/StringUtils.h"
+#include "windowing/WindowingFactory.h"
 #include "URL.h"
 
 using namespace XFILE;
@@ -38,7 +40,8 @@ CTextureCache &CTextureCache::GetInstance()
   return s_cache;
 }
 
-CTextureCache::CTextureCache() : CJobQueue(false, 1, CJob::PRIORITY_LOW_PAUSABLE)
+CTextureCache::CTextureCache() : CJobQueue(false, 1, CJob::PRIORITY_LOW_PAUSABLE),
+  m_pipeline(this, 2, g_cpuInfo.getCPUCount())
 {
 }
 
@@ -56,6 +59,7 @@ void CTextureCache::Initialize()
 void CTextureCache::Deinitialize()
 {
   CancelJobs();
+  m_pipeline.Stop();
   CSingleLock lock(m_databaseSection);
   m_database.Close();
 }
@@ -102,11 +106,13 @@ bool CTextureCache::CanCacheImageURL(const CURL &url)
   return (url.GetUserName().empty() || url.GetUserName() == "music");
 }
 
-std::string CTextureCache::CheckCachedImage(const std::string &url, bool &needsRecaching)
+std::string CTextureCache::CheckCachedImage(const std::string &url, bool &needsRecaching, bool compressed /* = false */)
 {
   CTextureDetails details;
   std::string path(GetCachedImage(url, details, true));
   needsRecaching = !details.hash.empty();
+  if (compressed && !details.compressedFile.empty() && g_advancedSettings.m_useDDSTextures && g_Windowing.SupportsDXT())
+    return GetCachedPath(details.compressedFile);
   if (!path.empty())
     return path;
   return "";
@@ -127,7 +133,12 @@ void CTextureCache::BackgroundCacheImage(const std::string &url)
     return;
 
   // needs (re)caching
+#if defined(HAS_OMXPLAYER)
+  // thumbs are created in one step by the hardware decoder
   AddJob(new CTextureCacheJob(path, details.hash));
+#else
+  m_pipeline.AddJob(new CTextureCacheJob(path, details.hash));
+#endif
 }
 
 std::string CTextureCache::CacheImage(const std::string &image, CBaseTexture **texture /* = NULL */, CTextureDetails *details /* = NULL */)
@@ -262,6 +273,12 @@ std::string CTextureCache::GetCachedPath(const std::string &file)
   return URIUtils::AddFileToFolder(CProfilesManager::GetInstance().GetThumbnailsFolder(), file);
 }
 
+bool CTextureCache::OnCachingStarted(const CTextureCacheJob *job)
+{
+  CSingleLock lock(m_processingSection);
+  return m_processinglist.insert(job->m_url).second;
+}
+
 void CTextureCache::OnCachingComplete(bool success, CTextureCacheJob *job)
 {
   if (success)
@@ -293,17 +310,8 @@ void CTextureCache::OnJobProgress(unsigned int jobID, unsigned int progress, uns
 {
   if (strcmp(job->GetType(), kJobTypeCacheImage) == 0 && !progress)
   { // check our processing list
-    {
-      CSingleLock lock(m_processingSection);
-      const CTextureCacheJob *cacheJob = (CTextureCacheJob *)job;
-      std::set<std::string>::iterator i = m_processinglist.find(cacheJob->m_url);
-      if (i == m_processinglist.end())
-      {
-        m_processinglist.insert(cacheJob->m_url);
-        return;
-      }
-    }
-    CancelJob(job);
+    if (!OnCachingStarted((const CTextureCacheJob *)job))
+      CancelJob(job);
   }
   else
     CJobQueue::OnJobProgress(jobID, progress, total, job);
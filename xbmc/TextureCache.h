@@ -24,6 +24,7 @@
 #include <string>
 #include <vector>
 #include "utils/JobManager.h"
+#include "TextureCachePipeline.h"
 #include "TextureDatabase.h"
 #include "threads/Event.h"
 
@@ -40,7 +41,7 @@ class CBaseTexture;
  unused for a set period of time.
 
  */
-class CTextureCache : public CJobQueue
+class CTextureCache : public CJobQueue, public ITextureCacheCallback
 {
 public:
   /*!
@@ -64,16 +65,17 @@ public:
 
    \param image url of the image to check
    \param needsRecaching [out] whether the image needs recaching.
+   \param compressed return the DXT compressed version of the image if there is one the GPU can use, defaults to false.
    \return cached url of this image
    \sa GetCachedImage
    */ 
-  std::string CheckCachedImage(const std::string &image, bool &needsRecaching);
+  std::string CheckCachedImage(const std::string &image, bool &needsRecaching, bool compressed = false);
 
   /*! \brief Cache image (if required) using a background job
 
    Checks firstly whether an image is already cached, and return URL if so [see CheckCacheImage]
    If the image is not yet in the database, a background job is started to
-   cache the image and add to the database [see CTextureCacheJob]
+   cache the image and add to the database [see CTextureCacheJob, CTextureCachePipeline]
 
    \param image url of the image to cache
    \sa CacheImage
@@ -211,16 +213,24 @@ private:
   virtual void OnJobComplete(unsigned int jobID, bool success, CJob *job);
   virtual void OnJobProgress(unsigned int jobID, unsigned int progress, unsigned int total, const CJob *job);
 
+  /*! \brief Called when a caching job is started.
+   Adds the job to our processing list.
+   \param job the caching job.
+   \return false if the image is already being processed, true otherwise.
+   */
+  virtual bool OnCachingStarted(const CTextureCacheJob *job);
+
   /*! \brief Called when a caching job has completed.
    Removes the job from our processing list, updates the database
    and fires a DDS job if appropriate.
    \param success whether the job was successful.
    \param job the caching job.
    */
-  void OnCachingComplete(bool success, CTextureCacheJob *job);
+  virtual void OnCachingComplete(bool success, CTextureCacheJob *job);
 
   CCriticalSection m_databaseSection;
   CTextureDatabase m_database;
+  CTextureCachePipeline m_pipeline; ///< background caching, see BackgroundCacheImage
   std::set<std::string> m_processinglist; ///< currently processing list to avoid 2 jobs being processed at once
   CCriticalSection     m_processingSection;
   CEvent               m_completeEvent; ///< Set whenever a job has finished
@@ -20,6 +20,7 @@
 
 #include "TextureCacheJob.h"
 #include "TextureCache.h"
+#include "guilib/DDSImage.h"
 #include "guilib/Texture.h"
 #include "settings/AdvancedSettings.h"
 #include "settings/Settings.h"
@@ -28,23 +29,37 @@
 #include "pictures/Picture.h"
 #include "utils/URIUtils.h"
 #include "utils/StringUtils.h"
+#include "utils/Mime.h"
 #include "URL.h"
 #include "FileItem.h"
 #include "music/MusicThumbLoader.h"
 #include "music/tags/MusicInfoTag.h"
+#include "windowing/WindowingFactory.h"
 #if defined(HAS_OMXPLAYER)
 #include "cores/omxplayer/OMXImage.h"
 #endif
 
+extern "C" {
+#include "libswscale/swscale.h"
+}
+
 CTextureCacheJob::CTextureCacheJob(const std::string &url, const std::string &oldHash):
   m_url(url),
   m_oldHash(oldHash),
-  m_cachePath(CTextureCache::GetCacheFile(m_url))
+  m_cachePath(CTextureCache::GetCacheFile(m_url)),
+  m_width(0),
+  m_height(0),
+  m_scalingAlgorithm(CPictureScalingAlgorithm::NoAlgorithm),
+  m_unchanged(false),
+  m_texture(NULL),
+  m_scaled(NULL)
 {
 }
 
 CTextureCacheJob::~CTextureCacheJob()
 {
+  delete[] m_scaled;
+  delete m_texture;
 }
 
 bool CTextureCacheJob::operator==(const CJob* job) const
@@ -66,65 +81,157 @@ bool CTextureCacheJob::DoWork()
     return false;         //       until the second
 
   // check whether we need cache the job anyway
-  bool needsRecaching = false;
-  std::string path(CTextureCache::GetInstance().CheckCachedImage(m_url, needsRecaching));
-  if (!path.empty() && !needsRecaching)
+  if (!NeedsCaching())
     return false;
   return CacheTexture();
 }
 
-bool CTextureCacheJob::CacheTexture(CBaseTexture **out_texture)
+bool CTextureCacheJob::NeedsCaching() const
 {
-  // unwrap the URL as required
-  std::string additional_info;
-  unsigned int width, height;
-  CPictureScalingAlgorithm::Algorithm scalingAlgorithm;
-  std::string image = DecodeImageURL(m_url, width, height, scalingAlgorithm, additional_info);
-
-  m_details.updateable = additional_info != "music" && UpdateableURL(image);
+  bool needsRecaching = false;
+  std::string path(CTextureCache::GetInstance().CheckCachedImage(m_url, needsRecaching));
+  return path.empty() || needsRecaching;
+}
 
-  // generate the hash
-  m_details.hash = GetImageHash(image);
-  if (m_details.hash.empty())
+bool CTextureCacheJob::CacheTexture(CBaseTexture **out_texture)
+{
+  if (!Prepare())
     return false;
-  else if (m_details.hash == m_oldHash)
+  if (m_unchanged)
     return true;
 
 #if defined(HAS_OMXPLAYER)
-  if (COMXImage::CreateThumb(image, width, height, additional_info, CTextureCache::GetCachedPath(m_cachePath + ".jpg")))
+  unsigned int width = m_width, height = m_height;
+  if (COMXImage::CreateThumb(m_image, width, height, m_additionalInfo, CTextureCache::GetCachedPath(m_cachePath + ".jpg")))
   {
     m_details.width = width;
     m_details.height = height;
     m_details.file = m_cachePath + ".jpg";
     if (out_texture)
       *out_texture = LoadImage(CTextureCache::GetCachedPath(m_details.file), width, height, "" /* already flipped */);
-    CLog::Log(LOGDEBUG, "Fast %s image '%s' to '%s': %p", m_oldHash.empty() ? "Caching" : "Recaching", CURL::GetRedacted(image).c_str(), m_details.file.c_str(), out_texture);
+    CLog::Log(LOGDEBUG, "Fast %s image '%s' to '%s': %p", m_oldHash.empty() ? "Caching" : "Recaching", CURL::GetRedacted(m_image).c_str(), m_details.file.c_str(), out_texture);
     return true;
   }
 #endif
-  CBaseTexture *texture = LoadImage(image, width, height, additional_info, true);
-  if (texture)
+  SwsContext *scaler = NULL;
+  bool success = Fetch() && Decode() && Resize(scaler) && Encode();
+  sws_freeContext(scaler);
+
+  if (success && out_texture) // caller wants the texture
   {
-    if (texture->HasAlpha())
-      m_details.file = m_cachePath + ".png";
-    else
-      m_details.file = m_cachePath + ".jpg";
+    *out_texture = m_texture;
+    m_texture = NULL;
+  }
+  return success;
+}
+
+bool CTextureCacheJob::Prepare()
+{
+  // unwrap the URL as required
+  m_image = DecodeImageURL(m_url, m_width, m_height, m_scalingAlgorithm, m_additionalInfo);
 
-    CLog::Log(LOGDEBUG, "%s image '%s' to '%s':", m_oldHash.empty() ? "Caching" : "Recaching", CURL::GetRedacted(image).c_str(), m_details.file.c_str());
+  m_details.updateable = m_additionalInfo != "music" && UpdateableURL(m_image);
 
-    if (CPicture::CacheTexture(texture, width, height, CTextureCache::GetCachedPath(m_details.file), scalingAlgorithm))
+  // generate the hash
+  m_details.hash = GetImageHash(m_image);
+  if (m_details.hash.empty())
+    return false;
+  m_unchanged = m_details.hash == m_oldHash;
+  return true;
+}
+
+bool CTextureCacheJob::Fetch()
+{
+  if (m_additionalInfo == "music")
+  { // special case for embedded music images
+    MUSIC_INFO::EmbeddedArt art;
+    if (CMusicThumbLoader::GetEmbeddedThumb(m_image, art))
     {
-      m_details.width = width;
-      m_details.height = height;
-      if (out_texture) // caller wants the texture
-        *out_texture = texture;
-      else
-        delete texture;
+      m_data.allocate(art.size);
+      memcpy(m_data.get(), &art.data[0], art.size);
+      m_mimeType = art.mime;
       return true;
     }
   }
-  delete texture;
-  return false;
+
+  // Validate file URL to see if it is an image
+  CFileItem file(m_image, false);
+  file.FillInMimeType();
+  if (!(file.IsPicture() && !(file.IsZIP() || file.IsRAR() || file.IsCBR() || file.IsCBZ() ))
+      && !StringUtils::StartsWithNoCase(file.GetMimeType(), "image/") && !StringUtils::EqualsNoCase(file.GetMimeType(), "application/octet-stream")) // ignore non-pictures
+    return false;
+  m_mimeType = file.GetMimeType();
+
+  // these need more than the file contents, so are loaded by Decode()
+  if (URIUtils::HasExtension(m_image, ".dds") ||
+      URIUtils::IsProtocol(m_image, "xbt") || URIUtils::IsProtocol(m_image, "resource"))
+    return true;
+
+  if (m_mimeType.empty())
+  { // same as ImageFactory::CreateLoader() does for the file name
+    CURL url(m_image);
+    m_mimeType = url.GetFileType().empty() ? CMime::GetMimeType(url) : "image/" + url.GetFileType();
+  }
+
+  XFILE::CFile imageFile;
+  return imageFile.LoadFile(m_image, m_data) > 0;
+}
+
+bool CTextureCacheJob::Decode()
+{
+  if (m_data.size())
+  {
+    m_texture = CBaseTexture::LoadFromFileInMemory((unsigned char *)m_data.get(), m_data.size(), m_mimeType, m_width, m_height);
+    m_data.clear();
+  }
+  else
+    m_texture = CBaseTexture::LoadFromFile(m_image, m_width, m_height, true, m_mimeType);
+  if (!m_texture)
+    return false;
+
+  // EXIF bits are interpreted as: <flipXY><flipY*flipX><flipX>
+  // where to undo the operation we apply them in reverse order <flipX>*<flipY*flipX>*<flipXY>
+  // When flipped we have an additional <flipX> on the left, which is equivalent to toggling the last bit
+  if (m_additionalInfo == "flipped")
+    m_texture->SetOrientation(m_texture->GetOrientation() ^ 1);
+  return true;
+}
+
+bool CTextureCacheJob::Resize(SwsContext *&scaler)
+{
+  if (m_texture->HasAlpha())
+    m_details.file = m_cachePath + ".png";
+  else
+    m_details.file = m_cachePath + ".jpg";
+
+  CLog::Log(LOGDEBUG, "%s image '%s' to '%s':", m_oldHash.empty() ? "Caching" : "Recaching", CURL::GetRedacted(m_image).c_str(), m_details.file.c_str());
+
+  return CPicture::ScaleForCache(m_texture->GetPixels(), m_texture->GetWidth(), m_texture->GetHeight(), m_texture->GetPitch(),
+                                 m_texture->GetOrientation(), m_width, m_height, m_scaled, m_scalingAlgorithm, scaler);
+}
+
+bool CTextureCacheJob::Encode()
+{
+  unsigned char *pixels = m_scaled ? (unsigned char *)m_scaled : m_texture->GetPixels();
+  unsigned int pitch = m_scaled ? m_width * 4 : m_texture->GetPitch();
+  bool success = CPicture::CreateThumbnailFromSurface(pixels, m_width, m_height, pitch, CTextureCache::GetCachedPath(m_details.file));
+
+  // the .dds version is uploaded as it is, saving both the decode and 3/4 or more of the texture memory
+  if (success && g_advancedSettings.m_useDDSTextures && g_Windowing.SupportsDXT())
+  {
+    CDDSImage dds;
+    if (dds.Create(CTextureCache::GetCachedPath(m_cachePath + ".dds"), m_width, m_height, pitch, pixels, m_texture->HasAlpha()))
+      m_details.compressedFile = m_cachePath + ".dds";
+  }
+
+  delete[] m_scaled;
+  m_scaled = NULL;
+  if (!success)
+    return false;
+
+  m_details.width = m_width;
+  m_details.height = m_height;
+  return true;
 }
 
 bool CTextureCacheJob::ResizeTexture(const std::string &url, uint8_t* &result, size_t &result_size)
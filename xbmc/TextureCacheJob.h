@@ -25,9 +25,11 @@
 #include <vector>
 
 #include "pictures/PictureScalingAlgorithm.h"
+#include "utils/auto_buffer.h"
 #include "utils/Job.h"
 
 class CBaseTexture;
+struct SwsContext;
 
 /*!
  \ingroup textures
@@ -51,6 +53,7 @@ public:
   int          id;
   std::string  file;
   std::string  hash;
+  std::string  compressedFile; ///< DXT compressed version of file, if any
   unsigned int width;
   unsigned int height;
   bool         updateable;
@@ -60,7 +63,10 @@ public:
  \ingroup textures
  \brief Job class for caching textures
  
- Handles loading and caching of textures.
+ Handles loading and caching of textures. Caching is split into stages: Prepare() and Fetch() are
+ bound by I/O, Decode(), Resize() and Encode() by the CPU. CacheTexture() runs them in order on the
+ calling thread, CTextureCachePipeline runs them on separate I/O and CPU workers.
+ \sa CTextureCachePipeline
  */
 class CTextureCacheJob : public CJob
 {
@@ -79,6 +85,37 @@ public:
    */
   bool CacheTexture(CBaseTexture **texture = NULL);
 
+  /*! \brief Check whether the image is missing from the cache or needs to be checked for updates
+   \return true if the image should be (re)cached, false otherwise
+   */
+  virtual bool NeedsCaching() const;
+
+  /*! \brief Unwrap the URL and generate the hash of the image.
+   \return false if the image can't be found. Images whose hash hasn't changed flag IsUnchanged()
+   and need no further stages.
+   */
+  virtual bool Prepare();
+
+  /*! \brief Read the image file (or the art embedded in a music file) into memory.
+   Images that are loaded directly from disk by the decoder (.dds, xbt) are left to Decode().
+   */
+  virtual bool Fetch();
+
+  /*! \brief Decode the fetched image into a texture, at roughly the target size if the decoder supports it.
+   */
+  virtual bool Decode();
+
+  /*! \brief Scale and orientate the decoded texture to the size it is cached at.
+   \param scaler scaling context kept between images by the calling thread, see CPicture::ScaleForCache
+   */
+  virtual bool Resize(SwsContext *&scaler);
+
+  /*! \brief Write the resized image to the thumbnail folder and fill in m_details.
+   */
+  virtual bool Encode();
+
+  bool IsUnchanged() const { return m_unchanged; };
+
   static bool ResizeTexture(const std::string &url, uint8_t* &result, size_t &result_size);
 
   std::string m_url;
@@ -125,6 +162,17 @@ private:
   static CBaseTexture *LoadImage(const std::string &image, unsigned int width, unsigned int height, const std::string &additional_info, bool requirePixels = false);
 
   std::string    m_cachePath;
+
+  std::string    m_image;            ///< underlying image, unwrapped from m_url
+  std::string    m_additionalInfo;
+  unsigned int   m_width;            ///< maximum size to cache at, replaced with the cached size by Resize()
+  unsigned int   m_height;
+  CPictureScalingAlgorithm::Algorithm m_scalingAlgorithm;
+  bool           m_unchanged;
+  std::string    m_mimeType;
+  XUTILS::auto_buffer m_data;        ///< fetched image file
+  CBaseTexture  *m_texture;          ///< decoded image
+  uint32_t      *m_scaled;           ///< resized image, NULL if the decoded image is cached as it is
 };
 
 /* \brief Job class for storing the use count of textures
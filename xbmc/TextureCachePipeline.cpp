@@ -0,0 +1,314 @@
+/*
+ *      Copyright (C) 2017 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kodi; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "TextureCachePipeline.h"
+
+#include <algorithm>
+#include <inttypes.h>
+
+#include "TextureCacheJob.h"
+#include "URL.h"
+#include "threads/SingleLock.h"
+#include "threads/SystemClock.h"
+#include "threads/Thread.h"
+#include "utils/JobManager.h"
+#include "utils/log.h"
+#include "utils/StringUtils.h"
+#include "utils/TimeUtils.h"
+
+extern "C" {
+#include "libswscale/swscale.h"
+}
+
+#define IDLE_TIMEOUT 10000 // ms a worker waits for new images before exiting
+
+static const char *StageNames[] = { "fetch", "decode", "resize", "encode" };
+
+class CTextureCachePipeline::CWorker : public CThread
+{
+public:
+  CWorker(CTextureCachePipeline &pipeline, bool io)
+    : CThread(io ? "TextureCacheIO" : "TextureCacheCPU"),
+      m_pipeline(pipeline),
+      m_io(io)
+  {
+    Create(true); // start work immediately, and kill ourselves when we're done
+  }
+
+  bool IsIO() const { return m_io; }
+
+protected:
+  virtual void Process()
+  {
+    SetPriority(GetMinPriority());
+    m_pipeline.Process(this);
+  }
+
+private:
+  CTextureCachePipeline &m_pipeline;
+  bool m_io;
+};
+
+CTextureCachePipeline::CTextureCachePipeline(ITextureCacheCallback *callback, unsigned int ioWorkers, unsigned int cpuWorkers)
+  : m_callback(callback),
+    m_maxIOWorkers(std::max(ioWorkers, 1U)),
+    m_maxCPUWorkers(std::max(cpuWorkers, 1U)),
+    m_maxDecodeBacklog(2 * m_maxCPUWorkers),
+    m_ioWorkers(0),
+    m_cpuWorkers(0),
+    m_stopping(false),
+    m_batchStart(0)
+{
+}
+
+CTextureCachePipeline::~CTextureCachePipeline()
+{
+  Stop();
+}
+
+bool CTextureCachePipeline::AddJob(CTextureCacheJob *job)
+{
+  CSingleLock lock(m_section);
+  if (m_stopping || !m_inFlight.insert(job->m_url).second)
+  {
+    delete job;
+    return false;
+  }
+  if (m_inFlight.size() == 1)
+  {
+    m_batchStart = CurrentHostCounter();
+    for (unsigned int i = 0; i < NUM_STAGES; i++)
+      m_batch[i] = StageStats();
+  }
+  m_fetchQueue.push_back(job);
+  StartWorkers();
+  m_wakeup.notifyAll();
+  return true;
+}
+
+void CTextureCachePipeline::Stop()
+{
+  std::deque<CTextureCacheJob*> fetchQueue, decodeQueue;
+  {
+    CSingleLock lock(m_section);
+    m_stopping = true;
+    fetchQueue.swap(m_fetchQueue);
+    decodeQueue.swap(m_decodeQueue);
+  }
+
+  // jobs waiting to be decoded have been started, so their owner needs to know they failed
+  for (std::deque<CTextureCacheJob*>::iterator i = fetchQueue.begin(); i != fetchQueue.end(); ++i)
+    Complete(*i, false, false);
+  for (std::deque<CTextureCacheJob*>::iterator i = decodeQueue.begin(); i != decodeQueue.end(); ++i)
+    Complete(*i, false);
+
+  CSingleLock lock(m_section);
+  m_wakeup.notifyAll();
+  while (m_ioWorkers + m_cpuWorkers)
+    m_wakeup.wait(lock, 100);
+  m_stopping = false;
+}
+
+bool CTextureCachePipeline::IsProcessing() const
+{
+  CSingleLock lock(m_section);
+  return !m_inFlight.empty();
+}
+
+CTextureCachePipeline::Stats CTextureCachePipeline::GetStats() const
+{
+  CSingleLock lock(m_section);
+  Stats stats;
+  for (unsigned int i = 0; i < NUM_STAGES; i++)
+    stats.stages[i] = m_stats[i];
+  stats.pending = m_inFlight.size();
+  stats.ioWorkers = m_ioWorkers;
+  stats.cpuWorkers = m_cpuWorkers;
+  return stats;
+}
+
+void CTextureCachePipeline::Process(CWorker *worker)
+{
+  SwsContext *scaler = NULL;
+  while (CTextureCacheJob *job = GetNextJob(worker->IsIO()))
+  {
+    if (worker->IsIO())
+    {
+      if (!m_callback->OnCachingStarted(job))
+      {
+        Complete(job, false, false);
+        continue;
+      }
+      if (!RunStage(STAGE_FETCH, job, scaler))
+        Complete(job, false);
+      else if (job->IsUnchanged())
+        Complete(job, true);
+      else
+        Decode(job);
+    }
+    else
+    {
+      bool success = RunStage(STAGE_DECODE, job, scaler) &&
+                     RunStage(STAGE_RESIZE, job, scaler) &&
+                     RunStage(STAGE_ENCODE, job, scaler);
+      Complete(job, success);
+    }
+  }
+  sws_freeContext(scaler);
+}
+
+CTextureCacheJob *CTextureCachePipeline::GetNextJob(bool io)
+{
+  CSingleLock lock(m_section);
+  XbmcThreads::EndTime idle(IDLE_TIMEOUT);
+  while (!m_stopping)
+  {
+    std::deque<CTextureCacheJob*> &queue = io ? m_fetchQueue : m_decodeQueue;
+    if (!queue.empty())
+    {
+      // keep waiting for the queue to be runnable rather than exiting while jobs are left
+      idle.Set(IDLE_TIMEOUT);
+      bool runnable = io ? m_decodeQueue.size() < m_maxDecodeBacklog && !CJobManager::GetInstance().IsPaused()
+                         : true;
+      if (runnable)
+      {
+        CTextureCacheJob *job = queue.front();
+        queue.pop_front();
+        if (!io)
+          m_wakeup.notifyAll(); // room in the backlog for the I/O workers
+        return job;
+      }
+    }
+    else if (idle.IsTimePast())
+      break;
+    // paused jobs aren't signalled, so poll
+    m_wakeup.wait(lock, std::min(idle.MillisLeft(), 500U));
+  }
+  if (io)
+    m_ioWorkers--;
+  else
+    m_cpuWorkers--;
+  m_wakeup.notifyAll();
+  return NULL;
+}
+
+bool CTextureCachePipeline::RunStage(Stage stage, CTextureCacheJob *job, SwsContext *&scaler)
+{
+  int64_t start = CurrentHostCounter();
+  bool success = false;
+  try
+  {
+    switch (stage)
+    {
+    case STAGE_FETCH:
+      success = job->NeedsCaching() && job->Prepare() && (job->IsUnchanged() || job->Fetch());
+      break;
+    case STAGE_DECODE:
+      success = job->Decode();
+      break;
+    case STAGE_RESIZE:
+      success = job->Resize(scaler);
+      break;
+    case STAGE_ENCODE:
+      success = job->Encode();
+      break;
+    default:
+      break;
+    }
+  }
+  catch (...)
+  {
+    CLog::Log(LOGERROR, "%s error in %s stage of '%s'", __FUNCTION__, StageNames[stage], CURL::GetRedacted(job->m_url).c_str());
+  }
+  double seconds = (double)(CurrentHostCounter() - start) / CurrentHostFrequency();
+
+  CSingleLock lock(m_section);
+  StageStats *stats[] = { &m_stats[stage], &m_batch[stage] };
+  for (unsigned int i = 0; i < 2; i++)
+  {
+    if (success)
+      stats[i]->images++;
+    else
+      stats[i]->failed++;
+    stats[i]->seconds += seconds;
+  }
+  return success;
+}
+
+void CTextureCachePipeline::Decode(CTextureCacheJob *job)
+{
+  CSingleLock lock(m_section);
+  if (m_stopping)
+  {
+    lock.Leave();
+    Complete(job, false);
+    return;
+  }
+  m_decodeQueue.push_back(job);
+  StartWorkers();
+  m_wakeup.notifyAll();
+}
+
+void CTextureCachePipeline::Complete(CTextureCacheJob *job, bool success, bool started /* = true */)
+{
+  if (started)
+    m_callback->OnCachingComplete(success, job);
+
+  CSingleLock lock(m_section);
+  m_inFlight.erase(job->m_url);
+  delete job;
+  if (m_inFlight.empty())
+    LogStats();
+}
+
+void CTextureCachePipeline::StartWorkers()
+{
+  if (m_stopping)
+    return;
+  while (m_ioWorkers < m_maxIOWorkers && m_ioWorkers < m_fetchQueue.size())
+  {
+    new CWorker(*this, true);
+    m_ioWorkers++;
+  }
+  while (m_cpuWorkers < m_maxCPUWorkers && m_cpuWorkers < m_decodeQueue.size())
+  {
+    new CWorker(*this, false);
+    m_cpuWorkers++;
+  }
+}
+
+void CTextureCachePipeline::LogStats() const
+{
+  uint64_t images = m_batch[STAGE_FETCH].images + m_batch[STAGE_FETCH].failed;
+  if (!images)
+    return;
+
+  double elapsed = (double)(CurrentHostCounter() - m_batchStart) / CurrentHostFrequency();
+  std::string stages;
+  for (unsigned int i = 0; i < NUM_STAGES; i++)
+  {
+    const StageStats &stats = m_batch[i];
+    uint64_t count = stats.images + stats.failed;
+    stages += StringUtils::Format(" %s: %" PRIu64" (%" PRIu64" failed) %.1f/s", StageNames[i], count, stats.failed,
+                                  stats.seconds > 0 ? count / stats.seconds : 0.0);
+  }
+  CLog::Log(LOGDEBUG, "CTextureCachePipeline: processed %" PRIu64" images in %.1fs (%.1f/s), per worker -%s",
+            images, elapsed, elapsed > 0 ? images / elapsed : 0.0, stages.c_str());
+}
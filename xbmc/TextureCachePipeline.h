@@ -0,0 +1,150 @@
+/*
+ *      Copyright (C) 2017 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kodi; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <deque>
+#include <set>
+#include <stdint.h>
+#include <string>
+
+#include "threads/Condition.h"
+#include "threads/CriticalSection.h"
+
+class CTextureCacheJob;
+struct SwsContext;
+
+/*!
+ \ingroup textures
+ \brief Interface for the owner of a CTextureCachePipeline
+ */
+class ITextureCacheCallback
+{
+public:
+  virtual ~ITextureCacheCallback() {}
+
+  /*! \brief Called on a worker before a job is fetched.
+   \param job the caching job.
+   \return false to drop the job, e.g. as the same image is being cached elsewhere.
+   */
+  virtual bool OnCachingStarted(const CTextureCacheJob *job) = 0;
+
+  /*! \brief Called on a worker once a job has finished. The job is deleted afterwards.
+   \param success whether the image was cached.
+   \param job the caching job.
+   */
+  virtual void OnCachingComplete(bool success, CTextureCacheJob *job) = 0;
+};
+
+/*!
+ \ingroup textures
+ \brief Caches images in the background on separate pools of I/O and CPU workers
+
+ I/O workers run CTextureCacheJob::Prepare() and Fetch(), and hand the fetched file to the
+ CPU workers, which run Decode(), Resize() and Encode(). A slow share or disk therefore doesn't
+ stop the cores from decoding, and the number of fetched files waiting to be decoded is bounded
+ to keep the memory use in check. Each CPU worker keeps its scaling context between images.
+
+ Workers are started as jobs arrive and exit once idle. While CJobManager has paused the
+ low priority jobs (e.g. during playback) no new jobs are started.
+ */
+class CTextureCachePipeline
+{
+public:
+  enum Stage
+  {
+    STAGE_FETCH = 0,
+    STAGE_DECODE,
+    STAGE_RESIZE,
+    STAGE_ENCODE,
+    NUM_STAGES
+  };
+
+  struct StageStats
+  {
+    StageStats() : images(0), failed(0), seconds(0) {}
+    uint64_t images;  ///< images that made it through the stage
+    uint64_t failed;  ///< images that failed in the stage
+    double   seconds; ///< time spent in the stage, summed over all workers
+  };
+
+  struct Stats
+  {
+    StageStats   stages[NUM_STAGES];
+    unsigned int pending;   ///< jobs queued or being processed
+    unsigned int ioWorkers;
+    unsigned int cpuWorkers;
+  };
+
+  /*! \brief Create the pipeline
+   \param callback the owner, told when jobs start and complete.
+   \param ioWorkers maximum number of workers fetching images.
+   \param cpuWorkers maximum number of workers decoding, resizing and encoding images.
+   */
+  CTextureCachePipeline(ITextureCacheCallback *callback, unsigned int ioWorkers, unsigned int cpuWorkers);
+  ~CTextureCachePipeline();
+
+  /*! \brief Queue a job, taking ownership of it.
+   \return false if the same image is already queued or being cached, in which case the job is deleted.
+   */
+  bool AddJob(CTextureCacheJob *job);
+
+  /*! \brief Drop all queued jobs and wait for the workers to finish their current ones.
+   The pipeline may be used again afterwards.
+   */
+  void Stop();
+
+  /*! \brief Whether any jobs are queued or being processed
+   */
+  bool IsProcessing() const;
+
+  /*! \brief Totals of all the jobs processed since the pipeline was created
+   */
+  Stats GetStats() const;
+
+private:
+  class CWorker;
+
+  void Process(CWorker *worker);
+  CTextureCacheJob *GetNextJob(bool io);
+  bool RunStage(Stage stage, CTextureCacheJob *job, SwsContext *&scaler);
+  void Decode(CTextureCacheJob *job);
+  void Complete(CTextureCacheJob *job, bool success, bool started = true);
+  void StartWorkers();
+  void LogStats() const;
+
+  ITextureCacheCallback *m_callback;
+  unsigned int m_maxIOWorkers;
+  unsigned int m_maxCPUWorkers;
+  unsigned int m_maxDecodeBacklog; ///< fetched files allowed to wait for a CPU worker
+
+  mutable CCriticalSection m_section;
+  XbmcThreads::ConditionVariable m_wakeup;
+  std::deque<CTextureCacheJob*> m_fetchQueue;
+  std::deque<CTextureCacheJob*> m_decodeQueue;
+  std::set<std::string> m_inFlight; ///< urls of all jobs queued or being processed
+  unsigned int m_ioWorkers;
+  unsigned int m_cpuWorkers;
+  bool         m_stopping;
+
+  StageStats   m_stats[NUM_STAGES];
+  StageStats   m_batch[NUM_STAGES];   ///< stats since the pipeline last ran empty
+  int64_t      m_batchStart;
+};
@@ -168,7 +168,7 @@ bool CTextureDatabase::Open()
 void CTextureDatabase::CreateTables()
 {
   CLog::Log(LOGINFO, "create texture table");
-  m_pDS->exec("CREATE TABLE texture (id integer primary key, url text, cachedurl text, imagehash text, lasthashcheck text)");
+  m_pDS->exec("CREATE TABLE texture (id integer primary key, url text, cachedurl text, compressedurl text, imagehash text, lasthashcheck text)");
 
   CLog::Log(LOGINFO, "create sizes table, index,  and trigger");
   m_pDS->exec("CREATE TABLE sizes (idtexture integer, size integer, width integer, height integer, usecount integer, lastusetime text)");
@@ -243,6 +243,10 @@ void CTextureDatabase::UpdateTables(int version)
     m_pDS->exec("CREATE TABLE texture (id integer primary key, url text, cachedurl text, imagehash text, lasthashcheck text)");
     m_pDS->exec("CREATE TABLE sizes (idtexture integer, size integer, width integer, height integer, usecount integer, lastusetime text)");
   }
+  if (version < 14)
+  { // add the compressed version of the cached image
+    m_pDS->exec("ALTER TABLE texture ADD compressedurl text");
+  }
 }
 
 bool CTextureDatabase::IncrementUseCount(const CTextureDetails &details)
@@ -258,7 +262,7 @@ bool CTextureDatabase::GetCachedTexture(const std::string &url, CTextureDetails
     if (NULL == m_pDB.get()) return false;
     if (NULL == m_pDS.get()) return false;
 
-    std::string sql = PrepareSQL("SELECT id, cachedurl, lasthashcheck, imagehash, width, height FROM texture JOIN sizes ON (texture.id=sizes.idtexture AND sizes.size=1) WHERE url='%s'", url.c_str());
+    std::string sql = PrepareSQL("SELECT id, cachedurl, lasthashcheck, imagehash, width, height, compressedurl FROM texture JOIN sizes ON (texture.id=sizes.idtexture AND sizes.size=1) WHERE url='%s'", url.c_str());
     m_pDS->query(sql);
     if (!m_pDS->eof())
     { // have some information
@@ -270,6 +274,7 @@ bool CTextureDatabase::GetCachedTexture(const std::string &url, CTextureDetails
         details.hash = m_pDS->fv(3).get_asString();
       details.width = m_pDS->fv(4).get_asInt();
       details.height = m_pDS->fv(5).get_asInt();
+      details.compressedFile = m_pDS->fv(6).get_asString();
       m_pDS->close();
       return true;
     }
@@ -346,7 +351,7 @@ bool CTextureDatabase::AddCachedTexture(const std::string &url, const CTextureDe
     m_pDS->exec(sql);
 
     std::string date = details.updateable ? CDateTime::GetCurrentDateTime().GetAsDBDateTime() : "";
-    sql = PrepareSQL("INSERT INTO texture (id, url, cachedurl, imagehash, lasthashcheck) VALUES(NULL, '%s', '%s', '%s', '%s')", url.c_str(), details.file.c_str(), details.hash.c_str(), date.c_str());
+    sql = PrepareSQL("INSERT INTO texture (id, url, cachedurl, compressedurl, imagehash, lasthashcheck) VALUES(NULL, '%s', '%s', '%s', '%s', '%s')", url.c_str(), details.file.c_str(), details.compressedFile.c_str(), details.hash.c_str(), date.c_str());
     m_pDS->exec(sql);
     int textureID = (int)m_pDS->lastinsertid();
 
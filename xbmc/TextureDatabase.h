@@ -132,6 +132,6 @@ protected:
   virtual void CreateTables();
   virtual void CreateAnalytics();
   virtual void UpdateTables(int version);
-  virtual int GetSchemaVersion() const { return 13; };
+  virtual int GetSchemaVersion() const { return 14; };
   const char *GetBaseDBName() const { return "Textures"; };
 };
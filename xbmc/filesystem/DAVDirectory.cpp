@@ -25,6 +25,7 @@
 #include "URL.h"
 #include "CurlFile.h"
 #include "FileItem.h"
+#include "settings/AdvancedSettings.h"
 #include "utils/StringUtils.h"
 #include "utils/log.h"
 #include "utils/URIUtils.h"
@@ -189,6 +190,11 @@ bool CDAVDirectory::GetDirectory(const CURL& url, CFileItemList &items)
   return true;
 }
 
+unsigned int CDAVDirectory::GetCacheTTL(const CURL& url) const
+{
+  return g_advancedSettings.m_networkDirectoryCacheTTL;
+}
+
 bool CDAVDirectory::Create(const CURL& url)
 {
   CDAVFile dav;
@@ -35,6 +35,7 @@ namespace XFILE
       virtual bool Exists(const CURL& url);
       virtual bool Remove(const CURL& url);
       virtual DIR_CACHE_TYPE GetCacheType(const CURL& url) const { return DIR_CACHE_ONCE; };
+      virtual unsigned int GetCacheTTL(const CURL& url) const;
     private:
       void ParseResponse(const TiXmlElement *pElement, CFileItem &item);
   };
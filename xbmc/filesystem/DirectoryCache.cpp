@@ -19,8 +19,11 @@
  */
 
 #include "DirectoryCache.h"
+#include "DirectoryFactory.h"
 #include "FileItem.h"
 #include "threads/SingleLock.h"
+#include "threads/SystemClock.h"
+#include "utils/JobManager.h"
 #include "utils/log.h"
 #include "utils/URIUtils.h"
 #include "utils/StringUtils.h"
@@ -28,16 +31,65 @@
 #include "climits"
 
 #include <algorithm>
+#include <memory>
 
 // Maximum number of directories to keep in our cache
 #define MAX_CACHED_DIRS 50
+// Longest time to live of a listing in seconds, so that it can't overflow in ms
+#define MAX_CACHE_TTL 86400U
 
 using namespace XFILE;
 
-CDirectoryCache::CDir::CDir(DIR_CACHE_TYPE cacheType)
+namespace
+{
+/*!
+ \brief Refreshes a stale listing in the background
+ */
+class CDirectoryRevalidateJob : public CJob
+{
+public:
+  CDirectoryRevalidateJob(const std::string& strPath) : m_strPath(strPath) {}
+
+  virtual bool DoWork() override
+  {
+    CURL url(m_strPath);
+    std::unique_ptr<IDirectory> directory(CDirectoryFactory::Create(url));
+    if (!directory)
+      return false;
+
+    CFileItemList items;
+    items.SetURL(url);
+    if (!directory->GetDirectory(url, items))
+      return false;
+
+    g_directoryCache.SetDirectory(m_strPath, items, directory->GetCacheType(url), directory->GetCacheTTL(url));
+    return true;
+  }
+
+  virtual const char *GetType() const override { return "directoryrevalidate"; }
+
+  virtual bool operator==(const CJob* job) const override
+  {
+    if (strcmp(job->GetType(), GetType()) == 0)
+      return static_cast<const CDirectoryRevalidateJob*>(job)->m_strPath == m_strPath;
+    return false;
+  }
+
+  const std::string& GetPath() const { return m_strPath; }
+
+private:
+  std::string m_strPath;
+};
+}
+
+CDirectoryCache::CDir::CDir(DIR_CACHE_TYPE cacheType, unsigned int ttl)
+  : m_cacheType(cacheType)
+  , m_ttl(std::min(ttl, MAX_CACHE_TTL) * 1000)
+  , m_created(XbmcThreads::SystemClockMillis())
+  , m_revalidating(false)
+  , m_counters(NULL)
+  , m_lastAccess(0)
 {
-  m_cacheType = cacheType;
-  m_lastAccess = 0;
   m_Items = new CFileItemList;
   m_Items->SetIgnoreURLOptions(true);
   m_Items->SetFastLookup(true);
@@ -48,18 +100,14 @@ CDirectoryCache::CDir::~CDir()
   delete m_Items;
 }
 
-void CDirectoryCache::CDir::SetLastAccess(unsigned int &accessCounter)
+void CDirectoryCache::CDir::SetLastAccess(std::atomic<unsigned int> &accessCounter)
 {
   m_lastAccess = accessCounter++;
 }
 
 CDirectoryCache::CDirectoryCache(void)
+  : m_accessCounter(0)
 {
-  m_accessCounter = 0;
-#ifdef _DEBUG
-  m_cacheHits = 0;
-  m_cacheMisses = 0;
-#endif
 }
 
 CDirectoryCache::~CDirectoryCache(void)
@@ -68,31 +116,34 @@ CDirectoryCache::~CDirectoryCache(void)
 
 bool CDirectoryCache::GetDirectory(const std::string& strPath, CFileItemList &items, bool retrieveAll)
 {
-  CSingleLock lock (m_cs);
-
   // Get rid of any URL options, else the compare may be wrong
-  std::string storedPath = CURL(strPath).GetWithoutOptions();
-  URIUtils::RemoveSlashAtEnd(storedPath);
+  std::string storedPath = GetStoredPath(strPath);
 
+  CSharedLock lock(m_cs);
   ciCache i = m_cache.find(storedPath);
   if (i != m_cache.end())
   {
     CDir* dir = i->second;
-    if (dir->m_cacheType == XFILE::DIR_CACHE_ALWAYS ||
-       (dir->m_cacheType == XFILE::DIR_CACHE_ONCE && retrieveAll))
+    Freshness freshness = GetFreshness(dir);
+    if ((dir->m_ttl > 0 && freshness != EXPIRED) ||
+        (dir->m_ttl == 0 && (dir->m_cacheType == XFILE::DIR_CACHE_ALWAYS ||
+                            (dir->m_cacheType == XFILE::DIR_CACHE_ONCE && retrieveAll))))
     {
       items.Copy(*dir->m_Items);
       dir->SetLastAccess(m_accessCounter);
-#ifdef _DEBUG
-      m_cacheHits+=items.Size();
-#endif
+      if (freshness == STALE)
+        Revalidate(dir);
+      UpdateStats(dir->m_counters, true, freshness == STALE);
       return true;
     }
   }
+  lock.Leave();
+
+  UpdateStats(GetCounters(GetProtocol(storedPath)), false, false);
   return false;
 }
 
-void CDirectoryCache::SetDirectory(const std::string& strPath, const CFileItemList &items, DIR_CACHE_TYPE cacheType)
+void CDirectoryCache::SetDirectory(const std::string& strPath, const CFileItemList &items, DIR_CACHE_TYPE cacheType, unsigned int ttl /* = 0 */)
 {
   if (cacheType == DIR_CACHE_NEVER)
     return; // nothing to do
@@ -108,18 +159,23 @@ void CDirectoryCache::SetDirectory(const std::string& strPath, const CFileItemLi
   // IDEALLY, any further processing on the item would actually create a new item
   // instead of altering it, but we can't really enforce that in an easy way, so
   // this is the best solution for now.
-  CSingleLock lock (m_cs);
 
   // Get rid of any URL options, else the compare may be wrong
-  std::string storedPath = CURL(strPath).GetWithoutOptions();
-  URIUtils::RemoveSlashAtEnd(storedPath);
+  std::string storedPath = GetStoredPath(strPath);
 
-  ClearDirectory(storedPath);
+  // copy outside of the lock, so that lookups aren't blocked meanwhile
+  CDir* dir = new CDir(cacheType, ttl);
+  dir->m_Items->Copy(items);
+  dir->m_url = strPath;
+  dir->m_counters = GetCounters(GetProtocol(storedPath));
+
+  CExclusiveLock lock(m_cs);
+  iCache i = m_cache.find(storedPath);
+  if (i != m_cache.end())
+    Delete(i);
 
   CheckIfFull();
 
-  CDir* dir = new CDir(cacheType);
-  dir->m_Items->Copy(items);
   dir->SetLastAccess(m_accessCounter);
   m_cache.insert(std::pair<std::string, CDir*>(storedPath, dir));
 }
@@ -134,12 +190,10 @@ void CDirectoryCache::ClearFile(const std::string& strFile)
 
 void CDirectoryCache::ClearDirectory(const std::string& strPath)
 {
-  CSingleLock lock (m_cs);
-
   // Get rid of any URL options, else the compare may be wrong
-  std::string storedPath = CURL(strPath).GetWithoutOptions();
-  URIUtils::RemoveSlashAtEnd(storedPath);
+  std::string storedPath = GetStoredPath(strPath);
 
+  CExclusiveLock lock(m_cs);
   iCache i = m_cache.find(storedPath);
   if (i != m_cache.end())
     Delete(i);
@@ -147,11 +201,10 @@ void CDirectoryCache::ClearDirectory(const std::string& strPath)
 
 void CDirectoryCache::ClearSubPaths(const std::string& strPath)
 {
-  CSingleLock lock (m_cs);
-
   // Get rid of any URL options, else the compare may be wrong
   std::string storedPath = CURL(strPath).GetWithoutOptions();
 
+  CExclusiveLock lock(m_cs);
   iCache i = m_cache.begin();
   while (i != m_cache.end())
   {
@@ -164,12 +217,11 @@ void CDirectoryCache::ClearSubPaths(const std::string& strPath)
 
 void CDirectoryCache::AddFile(const std::string& strFile)
 {
-  CSingleLock lock (m_cs);
-
   // Get rid of any URL options, else the compare may be wrong
   std::string strPath = URIUtils::GetDirectory(CURL(strFile).GetWithoutOptions());
   URIUtils::RemoveSlashAtEnd(strPath);
 
+  CExclusiveLock lock(m_cs);
   ciCache i = m_cache.find(strPath);
   if (i != m_cache.end())
   {
@@ -182,7 +234,6 @@ void CDirectoryCache::AddFile(const std::string& strFile)
 
 bool CDirectoryCache::FileExists(const std::string& strFile, bool& bInCache)
 {
-  CSingleLock lock (m_cs);
   bInCache = false;
 
   // Get rid of any URL options, else the compare may be wrong
@@ -191,33 +242,77 @@ bool CDirectoryCache::FileExists(const std::string& strFile, bool& bInCache)
   std::string storedPath = URIUtils::GetDirectory(strPath);
   URIUtils::RemoveSlashAtEnd(storedPath);
 
+  CSharedLock lock(m_cs);
   ciCache i = m_cache.find(storedPath);
-  if (i != m_cache.end())
+  if (i != m_cache.end() && GetFreshness(i->second) != EXPIRED)
   {
     bInCache = true;
     CDir *dir = i->second;
     dir->SetLastAccess(m_accessCounter);
-#ifdef _DEBUG
-    m_cacheHits++;
-#endif
-    return (URIUtils::PathEquals(strPath, storedPath) || dir->m_Items->Contains(strFile));
+    bool exists = (URIUtils::PathEquals(strPath, storedPath) || dir->m_Items->Contains(strFile));
+    UpdateStats(dir->m_counters, true, false);
+    return exists;
   }
-#ifdef _DEBUG
-  m_cacheMisses++;
-#endif
+  lock.Leave();
+
+  UpdateStats(GetCounters(GetProtocol(storedPath)), false, false);
   return false;
 }
 
 void CDirectoryCache::Clear()
 {
   // this routine clears everything
-  CSingleLock lock (m_cs);
+  CExclusiveLock lock(m_cs);
 
   iCache i = m_cache.begin();
   while (i != m_cache.end() )
     Delete(i++);
 }
 
+std::map<std::string, CDirectoryCache::Stats> CDirectoryCache::GetStats() const
+{
+  std::map<std::string, Stats> stats;
+  CSharedLock lock(m_statsSection);
+  for (std::map<std::string, std::unique_ptr<Counters>>::const_iterator it = m_stats.begin(); it != m_stats.end(); ++it)
+  {
+    Stats& protocolStats = stats[it->first];
+    protocolStats.hits = it->second->hits;
+    protocolStats.staleHits = it->second->staleHits;
+    protocolStats.misses = it->second->misses;
+    protocolStats.revalidations = it->second->revalidations;
+  }
+  return stats;
+}
+
+void CDirectoryCache::ResetStats()
+{
+  CSharedLock lock(m_statsSection);
+  for (std::map<std::string, std::unique_ptr<Counters>>::iterator it = m_stats.begin(); it != m_stats.end(); ++it)
+  {
+    it->second->hits = 0;
+    it->second->staleHits = 0;
+    it->second->misses = 0;
+    it->second->revalidations = 0;
+  }
+}
+
+void CDirectoryCache::OnJobComplete(unsigned int jobID, bool success, CJob *job)
+{
+  const std::string& strPath = static_cast<CDirectoryRevalidateJob*>(job)->GetPath();
+  if (success)
+  {
+    GetCounters(GetProtocol(strPath))->revalidations++;
+    return;
+  }
+
+  // keep serving the stale listing, the next lookup retries
+  CLog::Log(LOGDEBUG, "%s - unable to refresh %s", __FUNCTION__, CURL::GetRedacted(strPath).c_str());
+  CSharedLock lock(m_cs);
+  ciCache i = m_cache.find(GetStoredPath(strPath));
+  if (i != m_cache.end())
+    i->second->m_revalidating = false;
+}
+
 void CDirectoryCache::InitCache(std::set<std::string>& dirs)
 {
   std::set<std::string>::iterator it;
@@ -232,6 +327,7 @@ void CDirectoryCache::InitCache(std::set<std::string>& dirs)
 
 void CDirectoryCache::ClearCache(std::set<std::string>& dirs)
 {
+  CExclusiveLock lock(m_cs);
   iCache i = m_cache.begin();
   while (i != m_cache.end())
   {
@@ -244,8 +340,7 @@ void CDirectoryCache::ClearCache(std::set<std::string>& dirs)
 
 void CDirectoryCache::CheckIfFull()
 {
-  CSingleLock lock (m_cs);
-
+  // called with m_cs locked exclusively
   // find the last accessed folder, and remove if the number of cached folders is too many
   iCache lastAccessed = m_cache.end();
   unsigned int numCached = 0;
@@ -263,6 +358,73 @@ void CDirectoryCache::CheckIfFull()
     Delete(lastAccessed);
 }
 
+CDirectoryCache::Freshness CDirectoryCache::GetFreshness(const CDir* dir)
+{
+  if (dir->m_ttl == 0)
+    return FRESH;
+
+  unsigned int age = XbmcThreads::SystemClockMillis() - dir->m_created;
+  if (age < dir->m_ttl)
+    return FRESH;
+  if (age < 2 * dir->m_ttl)
+    return STALE;
+  return EXPIRED;
+}
+
+std::string CDirectoryCache::GetStoredPath(const std::string& strPath)
+{
+  std::string storedPath = CURL(strPath).GetWithoutOptions();
+  URIUtils::RemoveSlashAtEnd(storedPath);
+  return storedPath;
+}
+
+void CDirectoryCache::Revalidate(CDir* dir)
+{
+  // only one refresh at a time, the flag is reset if it fails
+  bool expected = false;
+  if (dir->m_revalidating.compare_exchange_strong(expected, true))
+    CJobManager::GetInstance().AddJob(new CDirectoryRevalidateJob(dir->m_url), this);
+}
+
+std::string CDirectoryCache::GetProtocol(const std::string& storedPath)
+{
+  // cheaper than parsing the whole url, as every miss looks it up
+  std::string protocol;
+  size_t pos = storedPath.find("://");
+  if (pos != std::string::npos)
+  {
+    protocol = storedPath.substr(0, pos);
+    StringUtils::ToLower(protocol);
+  }
+  return protocol;
+}
+
+CDirectoryCache::Counters* CDirectoryCache::GetCounters(const std::string& protocol)
+{
+  {
+    CSharedLock lock(m_statsSection);
+    std::map<std::string, std::unique_ptr<Counters>>::const_iterator it = m_stats.find(protocol);
+    if (it != m_stats.end())
+      return it->second.get();
+  }
+
+  CExclusiveLock lock(m_statsSection);
+  std::unique_ptr<Counters>& counters = m_stats[protocol];
+  if (!counters)
+    counters.reset(new Counters);
+  return counters.get();
+}
+
+void CDirectoryCache::UpdateStats(Counters* counters, bool hit, bool stale)
+{
+  if (hit)
+    counters->hits++;
+  else
+    counters->misses++;
+  if (stale)
+    counters->staleHits++;
+}
+
 void CDirectoryCache::Delete(iCache it)
 {
   CDir* dir = it->second;
@@ -273,8 +435,12 @@ void CDirectoryCache::Delete(iCache it)
 #ifdef _DEBUG
 void CDirectoryCache::PrintStats() const
 {
-  CSingleLock lock (m_cs);
-  CLog::Log(LOGDEBUG, "%s - total of %u cache hits, and %u cache misses", __FUNCTION__, m_cacheHits, m_cacheMisses);
+  std::map<std::string, Stats> stats = GetStats();
+  for (std::map<std::string, Stats>::const_iterator it = stats.begin(); it != stats.end(); ++it)
+    CLog::Log(LOGDEBUG, "%s - %s: %u cache hits (%u stale), %u cache misses, %u refreshed", __FUNCTION__,
+              it->first.c_str(), it->second.hits, it->second.staleHits, it->second.misses, it->second.revalidations);
+
+  CSharedLock lock(m_cs);
   // run through and find the oldest and the number of items cached
   unsigned int oldest = UINT_MAX;
   unsigned int numItems = 0;
@@ -286,6 +452,6 @@ void CDirectoryCache::PrintStats() const
     numItems += dir->m_Items->Size();
     numDirs++;
   }
-  CLog::Log(LOGDEBUG, "%s - %u folders cached, with %u items total.  Oldest is %u, current is %u", __FUNCTION__, numDirs, numItems, oldest, m_accessCounter);
+  CLog::Log(LOGDEBUG, "%s - %u folders cached, with %u items total.  Oldest is %u, current is %u", __FUNCTION__, numDirs, numItems, oldest, (unsigned int)m_accessCounter);
 }
 #endif
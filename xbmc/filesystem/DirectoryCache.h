@@ -22,41 +22,83 @@
 #include "IDirectory.h"
 #include "Directory.h"
 #include "threads/CriticalSection.h"
+#include "threads/SharedSection.h"
+#include "utils/Job.h"
 
+#include <atomic>
 #include <map>
+#include <memory>
 #include <set>
 
 class CFileItem;
 
 namespace XFILE
 {
-  class CDirectoryCache
+  /*!
+   \brief Caches directory listings.
+
+   Listings of directories with a time to live (see IDirectory::GetCacheTTL)
+   are returned for every fetch while fresh. Once stale they are returned
+   for as long again, while a background job refreshes them. Lookups take
+   the cache lock shared, so they don't block each other.
+   */
+  class CDirectoryCache : public IJobCallback
   {
+    struct Counters
+    {
+      Counters() : hits(0), staleHits(0), misses(0), revalidations(0) {}
+      std::atomic<unsigned int> hits;
+      std::atomic<unsigned int> staleHits;
+      std::atomic<unsigned int> misses;
+      std::atomic<unsigned int> revalidations;
+    };
+
     class CDir
     {
     public:
-      CDir(DIR_CACHE_TYPE cacheType);
+      CDir(DIR_CACHE_TYPE cacheType, unsigned int ttl);
       virtual ~CDir();
 
-      void SetLastAccess(unsigned int &accessCounter);
+      void SetLastAccess(std::atomic<unsigned int> &accessCounter);
       unsigned int GetLastAccess() const { return m_lastAccess; };
 
       CFileItemList* m_Items;
       DIR_CACHE_TYPE m_cacheType;
+      std::string m_url;                   ///< unmodified path for refreshing the listing
+      unsigned int m_ttl;                  ///< time to live in ms, at most a day, 0 if the listing doesn't expire
+      unsigned int m_created;              ///< time the listing was fetched
+      std::atomic<bool> m_revalidating;    ///< a refresh is scheduled
+      Counters* m_counters;                ///< statistics of the protocol of the listing
     private:
-      unsigned int m_lastAccess;
+      std::atomic<unsigned int> m_lastAccess;
     };
   public:
+    struct Stats
+    {
+      unsigned int hits = 0;
+      unsigned int staleHits = 0;          ///< hits on stale listings, included in hits
+      unsigned int misses = 0;
+      unsigned int revalidations = 0;      ///< listings refreshed in the background
+    };
+
     CDirectoryCache(void);
     virtual ~CDirectoryCache(void);
     bool GetDirectory(const std::string& strPath, CFileItemList &items, bool retrieveAll = false);
-    void SetDirectory(const std::string& strPath, const CFileItemList &items, DIR_CACHE_TYPE cacheType);
+    void SetDirectory(const std::string& strPath, const CFileItemList &items, DIR_CACHE_TYPE cacheType, unsigned int ttl = 0);
     void ClearDirectory(const std::string& strPath);
     void ClearFile(const std::string& strFile);
     void ClearSubPaths(const std::string& strPath);
     void Clear();
     void AddFile(const std::string& strFile);
     bool FileExists(const std::string& strPath, bool& bInCache);
+
+    /*! \brief Cache statistics by protocol */
+    std::map<std::string, Stats> GetStats() const;
+    void ResetStats();
+
+    // IJobCallback
+    virtual void OnJobComplete(unsigned int jobID, bool success, CJob *job) override;
+
 #ifdef _DEBUG
     void PrintStats() const;
 #endif
@@ -65,19 +107,31 @@ namespace XFILE
     void ClearCache(std::set<std::string>& dirs);
     void CheckIfFull();
 
+    enum Freshness
+    {
+      FRESH,
+      STALE,
+      EXPIRED
+    };
+    static Freshness GetFreshness(const CDir* dir);
+    static std::string GetStoredPath(const std::string& strPath);
+    void Revalidate(CDir* dir);
+    static std::string GetProtocol(const std::string& storedPath);
+    Counters* GetCounters(const std::string& protocol);
+    static void UpdateStats(Counters* counters, bool hit, bool stale);
+
     std::map<std::string, CDir*> m_cache;
     typedef std::map<std::string, CDir*>::iterator iCache;
     typedef std::map<std::string, CDir*>::const_iterator ciCache;
     void Delete(iCache i);
 
-    CCriticalSection m_cs;
+    mutable CSharedSection m_cs;
 
-    unsigned int m_accessCounter;
+    std::atomic<unsigned int> m_accessCounter;
 
-#ifdef _DEBUG
-    unsigned int m_cacheHits;
-    unsigned int m_cacheMisses;
-#endif
+    // counters are kept until destruction, listings point to them
+    mutable CSharedSection m_statsSection;
+    std::map<std::string, std::unique_ptr<Counters>> m_stats;
   };
 }
 extern XFILE::CDirectoryCache g_directoryCache;
@@ -0,0 +1,274 @@
+/*
+ *      Copyright (C) 2017 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kodi; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "DiskBlockCache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "Directory.h"
+#include "File.h"
+#include "FileItem.h"
+#include "threads/SingleLock.h"
+#include "utils/log.h"
+#include "utils/md5.h"
+#include "utils/StringUtils.h"
+#include "utils/URIUtils.h"
+
+using namespace XFILE;
+
+#define DISK_BLOCK_EXTENSION ".blk"
+#define DISK_BLOCK_TEMP_EXTENSION ".tmp"
+
+CDiskBlockCache::CDiskBlockCache()
+  : m_maxSize(0)
+{
+}
+
+CDiskBlockCache& CDiskBlockCache::GetInstance()
+{
+  static CDiskBlockCache diskBlockCache;
+  return diskBlockCache;
+}
+
+bool CDiskBlockCache::Initialize(const std::string& path, uint64_t maxSize)
+{
+  CSingleLock lock(m_critSection);
+  if (m_path == path && m_maxSize == maxSize)
+    return true;
+
+  m_lru.clear();
+  m_blocks.clear();
+  m_stats.size = 0;
+  m_stats.blocks = 0;
+  m_path = path;
+  m_maxSize = maxSize;
+  if (m_maxSize == 0)
+    return true;
+
+  if (!CDirectory::Exists(m_path) && !CDirectory::Create(m_path))
+  {
+    CLog::Log(LOGERROR, "CDiskBlockCache - unable to create cache directory %s", m_path.c_str());
+    m_maxSize = 0;
+    return false;
+  }
+
+  // pick up the blocks of a previous session, oldest first
+  CFileItemList items;
+  CDirectory::GetDirectory(m_path, items, "", DIR_FLAG_NO_FILE_DIRS | DIR_FLAG_BYPASS_CACHE);
+  std::vector<CFileItemPtr> blocks;
+  for (int i = 0; i < items.Size(); i++)
+  {
+    const CFileItemPtr& item = items[i];
+    if (item->m_bIsFolder)
+      continue;
+
+    const std::string name = URIUtils::GetFileName(item->GetPath());
+    if (StringUtils::EndsWith(name, DISK_BLOCK_TEMP_EXTENSION))
+      CFile::Delete(item->GetPath()); // left behind by an interrupted write
+    else if (StringUtils::EndsWith(name, DISK_BLOCK_EXTENSION) && name.find('-') != std::string::npos)
+      blocks.push_back(item);
+  }
+  std::sort(blocks.begin(), blocks.end(), [](const CFileItemPtr& a, const CFileItemPtr& b)
+  {
+    return a->m_dateTime < b->m_dateTime;
+  });
+
+  for (const auto& item : blocks)
+  {
+    const std::string name = URIUtils::GetFileName(item->GetPath());
+    const size_t separator = name.find('-');
+    const BlockId id(name.substr(0, separator), strtoll(name.c_str() + separator + 1, NULL, 10));
+    Insert(id, item->m_dwSize);
+  }
+  Evict();
+
+  CLog::Log(LOGDEBUG, "CDiskBlockCache - using %s, %u blocks with %" PRIu64" bytes cached",
+            m_path.c_str(), m_stats.blocks, m_stats.size);
+  return true;
+}
+
+void CDiskBlockCache::Deinitialize()
+{
+  Initialize("", 0);
+}
+
+bool CDiskBlockCache::IsEnabled() const
+{
+  CSingleLock lock(m_critSection);
+  return m_maxSize > 0;
+}
+
+std::string CDiskBlockCache::GetKey(const std::string& url, int64_t size, time_t mtime)
+{
+  std::string key = XBMC::XBMC_MD5::GetMD5(StringUtils::Format("%s|%" PRId64"|%" PRId64, url.c_str(), size, (int64_t)mtime));
+  StringUtils::ToLower(key);
+  return key;
+}
+
+ssize_t CDiskBlockCache::Read(const std::string& key, int64_t position, char* buffer, size_t size)
+{
+  const BlockId id(key, position / DISK_BLOCK_SIZE);
+  const int64_t offset = position % DISK_BLOCK_SIZE;
+  std::string path;
+  size_t length;
+  {
+    CSingleLock lock(m_critSection);
+    auto it = m_blocks.find(id);
+    if (it == m_blocks.end() || offset >= static_cast<int64_t>(it->second->size))
+    {
+      m_stats.misses++;
+      return 0;
+    }
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+    length = std::min(size, static_cast<size_t>(it->second->size - offset));
+    path = GetBlockPath(id);
+  }
+
+  // the file is read unlocked, should it be evicted meanwhile the read
+  // fails and is handled like a miss
+  CFile file;
+  ssize_t read = -1;
+  if (file.Open(path) && file.Seek(offset, SEEK_SET) == offset)
+    read = file.Read(buffer, length);
+  file.Close();
+
+  CSingleLock lock(m_critSection);
+  if (read != static_cast<ssize_t>(length))
+  {
+    CLog::Log(LOGWARNING, "CDiskBlockCache - unable to read block %s", path.c_str());
+    auto it = m_blocks.find(id);
+    if (it != m_blocks.end())
+      Remove(it);
+    m_stats.misses++;
+    return 0;
+  }
+
+  m_stats.hits++;
+  m_stats.bytesRead += read;
+  return read;
+}
+
+bool CDiskBlockCache::Write(const std::string& key, int64_t index, const char* data, size_t size)
+{
+  const BlockId id(key, index);
+  std::string path;
+  {
+    CSingleLock lock(m_critSection);
+    if (m_maxSize == 0 || size > DISK_BLOCK_SIZE)
+      return false;
+
+    auto it = m_blocks.find(id);
+    if (it != m_blocks.end())
+    {
+      m_lru.splice(m_lru.begin(), m_lru, it->second);
+      return true;
+    }
+    path = GetBlockPath(id);
+  }
+
+  // write to a temporary file first, so that a block never shows up partially
+  static std::atomic<unsigned int> tempCounter(0);
+  const std::string tempPath = StringUtils::Format("%s.%u" DISK_BLOCK_TEMP_EXTENSION, path.c_str(), ++tempCounter);
+  CFile file;
+  bool written = file.OpenForWrite(tempPath, true) && file.Write(data, size) == static_cast<ssize_t>(size);
+  file.Close();
+  if (!written || !CFile::Rename(tempPath, path))
+  {
+    CLog::Log(LOGERROR, "CDiskBlockCache - unable to write block %s", path.c_str());
+    CFile::Delete(tempPath);
+    return false;
+  }
+
+  CSingleLock lock(m_critSection);
+  if (m_blocks.find(id) == m_blocks.end())
+  {
+    Insert(id, size);
+    m_stats.bytesWritten += size;
+  }
+  Evict();
+  return true;
+}
+
+bool CDiskBlockCache::Contains(const std::string& key, int64_t index) const
+{
+  CSingleLock lock(m_critSection);
+  return m_blocks.find(BlockId(key, index)) != m_blocks.end();
+}
+
+void CDiskBlockCache::Clear()
+{
+  CSingleLock lock(m_critSection);
+  while (!m_blocks.empty())
+    Remove(m_blocks.begin());
+}
+
+CDiskBlockCache::Stats CDiskBlockCache::GetStats() const
+{
+  CSingleLock lock(m_critSection);
+  return m_stats;
+}
+
+void CDiskBlockCache::ResetStats()
+{
+  CSingleLock lock(m_critSection);
+  Stats stats;
+  stats.size = m_stats.size;
+  stats.blocks = m_stats.blocks;
+  m_stats = stats;
+}
+
+std::string CDiskBlockCache::GetBlockPath(const BlockId& id) const
+{
+  return URIUtils::AddFileToFolder(m_path, StringUtils::Format("%s-%" PRId64 DISK_BLOCK_EXTENSION,
+                                                               id.first.c_str(), id.second));
+}
+
+void CDiskBlockCache::Insert(const BlockId& id, uint64_t size)
+{
+  Block block;
+  block.id = id;
+  block.size = size;
+  m_lru.push_front(block);
+  m_blocks[id] = m_lru.begin();
+  m_stats.size += size;
+  m_stats.blocks++;
+}
+
+void CDiskBlockCache::Remove(std::map<BlockId, BlockList::iterator>::iterator it)
+{
+  CFile::Delete(GetBlockPath(it->first));
+  m_stats.size -= it->second->size;
+  m_stats.blocks--;
+  m_lru.erase(it->second);
+  m_blocks.erase(it);
+}
+
+void CDiskBlockCache::Evict()
+{
+  while (m_stats.size > m_maxSize && !m_lru.empty())
+  {
+    Remove(m_blocks.find(m_lru.back().id));
+    m_stats.evictions++;
+  }
+}
@@ -0,0 +1,121 @@
+#pragma once
+/*
+ *      Copyright (C) 2017 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kodi; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <list>
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <sys/types.h>
+#include <time.h>
+#include <utility>
+
+#include "threads/CriticalSection.h"
+
+#define DISK_BLOCK_SIZE (1024 * 1024)
+
+namespace XFILE
+{
+
+/*!
+ \brief Persistent block cache for remote files.
+
+ Files read through CFileCache are stored in blocks of DISK_BLOCK_SIZE bytes
+ below the cache directory, one file per block. Blocks are keyed by the URL,
+ size and modification time of the source, so a changed source never matches
+ blocks of an older version. The total size is capped and the least recently
+ used blocks are evicted first. The recency order of blocks stored by an
+ earlier session is taken from their modification time. Thread safe.
+ */
+class CDiskBlockCache
+{
+public:
+  struct Stats
+  {
+    uint64_t hits = 0;         /**< lookups served from disk */
+    uint64_t misses = 0;       /**< lookups of blocks that are not cached */
+    uint64_t bytesRead = 0;    /**< bytes served from disk */
+    uint64_t bytesWritten = 0; /**< bytes stored to disk */
+    uint64_t evictions = 0;    /**< blocks removed to stay below the size limit */
+    uint64_t size = 0;         /**< current size of all stored blocks */
+    unsigned int blocks = 0;   /**< current number of stored blocks */
+  };
+
+  static CDiskBlockCache& GetInstance();
+
+  /*!
+   \brief Set the cache directory and size limit
+   Blocks stored by a previous session in the same directory are picked up
+   again. A size limit of 0 disables the cache.
+   */
+  bool Initialize(const std::string& path, uint64_t maxSize);
+  void Deinitialize();
+  bool IsEnabled() const;
+
+  static std::string GetKey(const std::string& url, int64_t size, time_t mtime);
+
+  /*!
+   \brief Copy cached data at the given file position
+   At most the data up to the end of the block holding position is copied.
+   \return number of bytes copied, 0 if the block is not cached
+   */
+  ssize_t Read(const std::string& key, int64_t position, char* buffer, size_t size);
+
+  /*!
+   \brief Store a complete block, only the last block of a file may be shorter
+   than DISK_BLOCK_SIZE
+   */
+  bool Write(const std::string& key, int64_t index, const char* data, size_t size);
+
+  bool Contains(const std::string& key, int64_t index) const;
+
+  /*! \brief Remove all stored blocks */
+  void Clear();
+
+  Stats GetStats() const;
+  void ResetStats();
+
+private:
+  CDiskBlockCache();
+  CDiskBlockCache(const CDiskBlockCache&);
+  CDiskBlockCache& operator=(const CDiskBlockCache&);
+
+  typedef std::pair<std::string, int64_t> BlockId;
+  struct Block
+  {
+    BlockId id;
+    uint64_t size;
+  };
+  typedef std::list<Block> BlockList;
+
+  std::string GetBlockPath(const BlockId& id) const;
+  void Insert(const BlockId& id, uint64_t size);
+  void Remove(std::map<BlockId, BlockList::iterator>::iterator it);
+  void Evict();
+
+  mutable CCriticalSection m_critSection;
+  std::string m_path;
+  uint64_t m_maxSize;
+  BlockList m_lru; // most recently used first
+  std::map<BlockId, BlockList::iterator> m_blocks;
+  Stats m_stats;
+};
+
+}
@@ -85,6 +85,10 @@ public:
   virtual int nfs_pread(struct nfs_context *nfs,     struct nfsfh *nfsfh,  uint64_t offset, uint64_t count, char *buf)=0;
   virtual int nfs_pwrite(struct nfs_context *nfs,    struct nfsfh *nfsfh,  uint64_t offset, uint64_t count, char *buf)=0;
   virtual int nfs_lseek(struct nfs_context *nfs,     struct nfsfh *nfsfh,  uint64_t offset, int whence,   uint64_t *current_offset)=0;
+  virtual int nfs_pread_async(struct nfs_context *nfs, struct nfsfh *nfsfh, uint64_t offset, uint64_t count, nfs_cb cb, void *private_data)=0;
+  virtual int nfs_service(struct nfs_context *nfs,   int revents)=0;
+  virtual int nfs_get_fd(struct nfs_context *nfs)=0;
+  virtual int nfs_which_events(struct nfs_context *nfs)=0;
 };
 
 class DllLibNfs : public DllDynamic, DllLibNfsInterface
@@ -131,6 +135,10 @@ class DllLibNfs : public DllDynamic, DllLibNfsInterface
   DEFINE_METHOD5(int, nfs_pread,     (struct nfs_context *p1, struct nfsfh *p2,  uint64_t p3,   uint64_t p4,  char *p5))
   DEFINE_METHOD5(int, nfs_pwrite,    (struct nfs_context *p1, struct nfsfh *p2,  uint64_t p3,   uint64_t p4,  char *p5))
   DEFINE_METHOD5(int, nfs_lseek,     (struct nfs_context *p1, struct nfsfh *p2,  uint64_t p3,   int p4,     uint64_t *p5))
+  DEFINE_METHOD6(int, nfs_pread_async, (struct nfs_context *p1, struct nfsfh *p2, uint64_t p3, uint64_t p4, nfs_cb p5, void *p6))
+  DEFINE_METHOD2(int, nfs_service,   (struct nfs_context *p1, int p2))
+  DEFINE_METHOD1(int, nfs_get_fd,    (struct nfs_context *p1))
+  DEFINE_METHOD1(int, nfs_which_events, (struct nfs_context *p1))
 
 
 
@@ -176,6 +184,10 @@ class DllLibNfs : public DllDynamic, DllLibNfsInterface
     RESOLVE_METHOD_RENAME(nfs_symlink,   nfs_symlink)
     RESOLVE_METHOD_RENAME(nfs_rename,    nfs_rename)
     RESOLVE_METHOD_RENAME(nfs_link,      nfs_link)      
+    RESOLVE_METHOD_RENAME(nfs_pread_async, nfs_pread_async)
+    RESOLVE_METHOD_RENAME(nfs_service,   nfs_service)
+    RESOLVE_METHOD_RENAME(nfs_get_fd,    nfs_get_fd)
+    RESOLVE_METHOD_RENAME(nfs_which_events, nfs_which_events)
   END_METHOD_RESOLVE()
 };
 
@@ -25,8 +25,12 @@
 #include "URL.h"
 
 #include "CircularCache.h"
+#include "DiskBlockCache.h"
+#include "RangeReader.h"
+#include "ReadAheadController.h"
 #include "threads/SingleLock.h"
 #include "utils/log.h"
+#include "utils/URIUtils.h"
 #include "settings/AdvancedSettings.h"
 
 #if !defined(TARGET_WINDOWS)
@@ -44,6 +48,7 @@
 using namespace XFILE;
 
 #define READ_CACHE_CHUNK_SIZE (64*1024)
+#define READ_CACHE_MAX_CHUNK_SIZE (4*1024*1024)
 
 class CWriteRate
 {
@@ -106,6 +111,13 @@ CFileCache::CFileCache(const unsigned int flags)
   , m_forwardCacheSize(0)
   , m_fileSize(0)
   , m_flags(flags)
+  , m_readCount(0)
+  , m_readHits(0)
+  , m_stallTime(0)
+  , m_diskBlockPos(0)
+  , m_diskBlockFill(0)
+  , m_diskBytes(0)
+  , m_sourceBytes(0)
 {
 }
 
@@ -116,6 +128,13 @@ CFileCache::CFileCache(CCacheStrategy *pCache, bool bDeleteCache /* = true */)
   , m_writeRate(0)
   , m_writeRateActual(0)
   , m_forwardCacheSize(0)
+  , m_readCount(0)
+  , m_readHits(0)
+  , m_stallTime(0)
+  , m_diskBlockPos(0)
+  , m_diskBlockFill(0)
+  , m_diskBytes(0)
+  , m_sourceBytes(0)
 {
   m_pCache = pCache;
   m_bDeleteCache = bDeleteCache;
@@ -225,11 +244,56 @@ bool CFileCache::Open(const CURL& url)
     Close();
     return false;
   }
-  
+
+  // read-ahead follows the bandwidth-delay product of the source, but stays
+  // below a quarter of the forward cache so that there is always room to write
+  int64_t maxChunkSize = READ_CACHE_MAX_CHUNK_SIZE;
+  if (m_forwardCacheSize > 0)
+    maxChunkSize = std::min(maxChunkSize, m_forwardCacheSize / 4);
+  m_readAhead.reset(new CReadAheadController(m_chunkSize, static_cast<unsigned int>(maxChunkSize)));
+
+  // remote files are also kept in the persistent disk cache, so that they
+  // can be read again without refetching them
+  CDiskBlockCache& diskCache = CDiskBlockCache::GetInstance();
+  if (g_advancedSettings.m_cacheDiskSize > 0)
+    diskCache.Initialize(URIUtils::AddFileToFolder(g_advancedSettings.m_cachePath, "blockcache/"),
+                         static_cast<uint64_t>(g_advancedSettings.m_cacheDiskSize) * 1024 * 1024);
+  else
+    diskCache.Deinitialize();
+
+  m_diskKey.clear();
+  if (diskCache.IsEnabled() && m_seekPossible > 0 && m_fileSize > 0 && !URIUtils::IsHD(m_sourcePath))
+  {
+    struct __stat64 st;
+    time_t mtime = (CFile::Stat(url, &st) == 0) ? st.st_mtime : 0;
+    m_diskKey = CDiskBlockCache::GetKey(m_sourcePath, m_fileSize, mtime);
+    m_diskBlock.reset(new char[DISK_BLOCK_SIZE]);
+  }
+
+  // fetch byte ranges over several connections to get around the throughput
+  // limit of a single stream on high latency links
+  if (g_advancedSettings.m_cacheParallelRanges > 1 && m_seekPossible > 0 && m_fileSize > 0 &&
+      (URIUtils::IsHTTP(m_sourcePath) || URIUtils::IsDAV(m_sourcePath)))
+  {
+    m_rangeReader.reset(new CRangeReader(m_sourcePath, m_fileSize, g_advancedSettings.m_cacheParallelRanges, *m_readAhead));
+    if (!m_rangeReader->Open())
+    {
+      CLog::Log(LOGWARNING, "CFileCache::Open - unable to open parallel connections, using a single one");
+      m_rangeReader.reset();
+    }
+  }
+
   m_readPos = 0;
   m_writePos = 0;
   m_writeRate = 1024 * 1024;
   m_writeRateActual = 0;
+  m_readCount = 0;
+  m_readHits = 0;
+  m_stallTime = 0;
+  m_diskBlockPos = 0;
+  m_diskBlockFill = 0;
+  m_diskBytes = 0;
+  m_sourceBytes = 0;
   m_seekEvent.Reset();
   m_seekEnded.Reset();
 
@@ -246,8 +310,8 @@ void CFileCache::Process()
     return;
   }
 
-  // create our read buffer
-  std::unique_ptr<char[]> buffer(new char[m_chunkSize]);
+  // create our read buffer, large enough for the biggest read-ahead
+  std::unique_ptr<char[]> buffer(new char[m_readAhead->GetMaxChunkSize()]);
   if (buffer.get() == NULL)
   {
     CLog::Log(LOGERROR, "%s - failed to allocate read buffer", __FUNCTION__);
@@ -257,6 +321,8 @@ void CFileCache::Process()
   CWriteRate limiter;
   CWriteRate average;
   bool cacheReachEOF = false;
+  bool newRequest = true;
+  bool sourceBehind = false; // the source lags behind data served from the disk cache
 
   while (!m_bStop)
   {
@@ -270,8 +336,24 @@ void CFileCache::Process()
       int64_t cacheMaxPos = m_pCache->CachedDataEndPosIfSeekTo(m_seekPos);
       cacheReachEOF = (cacheMaxPos == m_fileSize);
       bool sourceSeekFailed = false;
-      if (!cacheReachEOF)
+      if (!cacheReachEOF && !m_diskKey.empty() &&
+          CDiskBlockCache::GetInstance().Contains(m_diskKey, cacheMaxPos / DISK_BLOCK_SIZE))
       {
+        // continue from disk, the source is repositioned once it's needed again
+        if (m_rangeReader)
+          m_rangeReader->Seek(m_fileSize);
+        sourceBehind = true;
+      }
+      else if (!cacheReachEOF && m_rangeReader)
+      {
+        m_rangeReader->Seek(cacheMaxPos);
+        m_nSeekResult = cacheMaxPos;
+        sourceBehind = false;
+      }
+      else if (!cacheReachEOF)
+      {
+        newRequest = true;
+        sourceBehind = false;
         m_nSeekResult = m_source.Seek(cacheMaxPos, SEEK_SET);
         if (m_nSeekResult != cacheMaxPos)
         {
@@ -313,7 +395,7 @@ void CFileCache::Process()
       }
     }
 
-    size_t maxWrite = m_pCache->GetMaxWriteSize(m_chunkSize);
+    size_t maxWrite = m_pCache->GetMaxWriteSize(m_readAhead->GetChunkSize());
 
     /* Only read from source if there's enough write space in the cache
      * else we may keep disposing data and seeking back on (slow) source
@@ -325,8 +407,53 @@ void CFileCache::Process()
     }
 
     ssize_t iRead = 0;
-    if (!cacheReachEOF)
+    bool fromDisk = false;
+    if (!cacheReachEOF && !m_diskKey.empty())
+    {
+      iRead = CDiskBlockCache::GetInstance().Read(m_diskKey, m_writePos, buffer.get(), maxWrite);
+      fromDisk = (iRead > 0);
+    }
+
+    bool readSource = !cacheReachEOF && !fromDisk;
+    if (fromDisk)
+    {
+      // stop the connections from fetching what's on disk already
+      if (m_rangeReader && !sourceBehind)
+        m_rangeReader->Seek(m_fileSize);
+      sourceBehind = true;
+      m_diskBytes += iRead;
+    }
+    else if (readSource && sourceBehind)
+    {
+      // continue from the source where the disk cache ends
+      sourceBehind = false;
+      newRequest = true;
+      if (m_rangeReader)
+        m_rangeReader->Seek(m_writePos);
+      else if (m_source.Seek(m_writePos, SEEK_SET) != m_writePos)
+      {
+        CLog::Log(LOGERROR, "CFileCache::Process - unable to seek source to %" PRId64" after disk cache", m_writePos);
+        readSource = false;
+        iRead = -1;
+      }
+    }
+
+    if (readSource && m_rangeReader)
+    {
+      iRead = m_rangeReader->Read(buffer.get(), maxWrite, 100);
+      if (iRead == CACHE_RC_WOULD_BLOCK)
+        continue; // nothing arrived yet, look for seeks and try again
+    }
+    else if (readSource)
+    {
+      unsigned int readStart = XbmcThreads::SystemClockMillis();
       iRead = m_source.Read(buffer.get(), maxWrite);
+      if (iRead > 0)
+      {
+        m_readAhead->Update(iRead, XbmcThreads::SystemClockMillis() - readStart, newRequest);
+        newRequest = false;
+      }
+    }
     if (iRead == 0)
     {
       // Check for actual EOF and retry as long as we still have data in our cache
@@ -376,6 +503,13 @@ void CFileCache::Process()
       break; // while (!m_bStop)
     }
 
+    if (readSource)
+    {
+      m_sourceBytes += iRead;
+      if (!m_diskKey.empty())
+        CacheToDisk(m_writePos, buffer.get(), iRead);
+    }
+
     int iTotalWrite = 0;
     while (!m_bStop && (iTotalWrite < iRead))
     {
@@ -414,6 +548,39 @@ void CFileCache::Process()
   }
 }
 
+void CFileCache::CacheToDisk(int64_t pos, const char* data, size_t size)
+{
+  while (size > 0)
+  {
+    if (m_diskBlockPos + static_cast<int64_t>(m_diskBlockFill) != pos)
+    {
+      // only complete blocks are stored, start over at the next block boundary
+      int64_t next = (pos + DISK_BLOCK_SIZE - 1) / DISK_BLOCK_SIZE * DISK_BLOCK_SIZE;
+      m_diskBlockPos = next;
+      m_diskBlockFill = 0;
+      if (next - pos >= static_cast<int64_t>(size))
+        return;
+      data += next - pos;
+      size -= next - pos;
+      pos = next;
+    }
+
+    size_t copy = std::min(size, DISK_BLOCK_SIZE - m_diskBlockFill);
+    memcpy(m_diskBlock.get() + m_diskBlockFill, data, copy);
+    m_diskBlockFill += copy;
+    data += copy;
+    size -= copy;
+    pos += copy;
+
+    if (m_diskBlockFill == DISK_BLOCK_SIZE || m_diskBlockPos + static_cast<int64_t>(m_diskBlockFill) == m_fileSize)
+    {
+      CDiskBlockCache::GetInstance().Write(m_diskKey, m_diskBlockPos / DISK_BLOCK_SIZE, m_diskBlock.get(), m_diskBlockFill);
+      m_diskBlockPos += m_diskBlockFill;
+      m_diskBlockFill = 0;
+    }
+  }
+}
+
 void CFileCache::OnExit()
 {
   m_bStop = true;
@@ -449,25 +616,34 @@ ssize_t CFileCache::Read(void* lpBuf, size_t uiBufSize)
   if (uiBufSize > SSIZE_MAX)
     uiBufSize = SSIZE_MAX;
 
+  bool stalled = false;
+
 retry:
   // attempt to read
   iRc = m_pCache->ReadFromCache((char *)lpBuf, (size_t)uiBufSize);
   if (iRc > 0)
   {
     m_readPos += iRc;
+    m_readCount++;
+    if (!stalled)
+      m_readHits++;
     return (int)iRc;
   }
 
   if (iRc == CACHE_RC_WOULD_BLOCK)
   {
     // just wait for some data to show up
+    unsigned int waitStart = XbmcThreads::SystemClockMillis();
     iRc = m_pCache->WaitForData(1, 10000);
+    m_stallTime += XbmcThreads::SystemClockMillis() - waitStart;
+    stalled = true;
     if (iRc > 0)
       goto retry;
   }
 
   if (iRc == CACHE_RC_TIMEOUT)
   {
+    m_readCount++;
     CLog::Log(LOGWARNING, "%s - timeout waiting for data", __FUNCTION__);
     return -1;
   }
@@ -510,8 +686,12 @@ int64_t CFileCache::Seek(int64_t iFilePosition, int iWhence)
     /* never request closer to end than 2k, speeds up tag reading */
     m_seekPos = std::min(iTarget, std::max((int64_t)0, m_fileSize - m_chunkSize));
 
+    // time spent waiting for the source counts as a stall
+    unsigned int stallStart = XbmcThreads::SystemClockMillis();
     m_seekEvent.Set();
-    if (!m_seekEnded.Wait())
+    bool seekEnded = m_seekEnded.Wait();
+    m_stallTime += XbmcThreads::SystemClockMillis() - stallStart;
+    if (!seekEnded)
     {
       CLog::Log(LOGWARNING,"%s - seek to %" PRId64" failed.", __FUNCTION__, m_seekPos);
       return -1;
@@ -521,7 +701,10 @@ int64_t CFileCache::Seek(int64_t iFilePosition, int iWhence)
     if(m_seekPos < iTarget)
     {
       CLog::Log(LOGDEBUG,"%s - waiting for position %" PRId64".", __FUNCTION__, iTarget);
-      if(m_pCache->WaitForData((unsigned)(iTarget - m_seekPos), 10000) < iTarget - m_seekPos)
+      stallStart = XbmcThreads::SystemClockMillis();
+      int64_t available = m_pCache->WaitForData((unsigned)(iTarget - m_seekPos), 10000);
+      m_stallTime += XbmcThreads::SystemClockMillis() - stallStart;
+      if(available < iTarget - m_seekPos)
       {
         CLog::Log(LOGWARNING,"%s - failed to get remaining data", __FUNCTION__);
         return -1;
@@ -540,6 +723,7 @@ int64_t CFileCache::Seek(int64_t iFilePosition, int iWhence)
 void CFileCache::Close()
 {
   StopThread();
+  m_rangeReader.reset();
 
   CSingleLock lock(m_sync);
   if (m_pCache)
@@ -592,6 +776,11 @@ int CFileCache::IoControl(EIoControl request, void* param)
     status->level   = (m_forwardCacheSize == 0) ? 0.0 : (float) status->forward / m_forwardCacheSize;
     status->maxrate = m_writeRate;
     status->currate = m_writeRateActual;
+    status->readahead = m_readAhead ? m_readAhead->GetChunkSize() : m_chunkSize;
+    status->hitratio = (m_readCount == 0) ? 0.0f : (float) m_readHits / m_readCount;
+    status->stalltime = m_stallTime;
+    uint64_t fetched = m_diskBytes + m_sourceBytes;
+    status->diskhitratio = (fetched == 0) ? 0.0f : (float) m_diskBytes / fetched;
     return 0;
   }
 
@@ -25,9 +25,12 @@
 #include "File.h"
 #include "threads/Thread.h"
 #include <atomic>
+#include <memory>
 
 namespace XFILE
 {
+  class CRangeReader;
+  class CReadAheadController;
 
   class CFileCache : public IFile, public CThread
   {
@@ -63,6 +66,9 @@ namespace XFILE
     virtual std::string GetContentCharset(void);
 
   private:
+    /*! \brief Collect data read from the source into blocks for the disk cache */
+    void CacheToDisk(int64_t pos, const char* data, size_t size);
+
     CCacheStrategy *m_pCache;
     bool      m_bDeleteCache;
     int        m_seekPossible;
@@ -81,6 +87,17 @@ namespace XFILE
     std::atomic<int64_t> m_fileSize;
     unsigned int m_flags;
     CCriticalSection m_sync;
+    std::unique_ptr<CReadAheadController> m_readAhead;
+    std::unique_ptr<CRangeReader> m_rangeReader;
+    std::atomic<unsigned int> m_readCount;
+    std::atomic<unsigned int> m_readHits;
+    std::atomic<unsigned int> m_stallTime;
+    std::string  m_diskKey; // empty if the file isn't kept in the disk cache
+    std::unique_ptr<char[]> m_diskBlock;
+    int64_t      m_diskBlockPos;
+    size_t       m_diskBlockFill;
+    std::atomic<uint64_t> m_diskBytes;
+    std::atomic<uint64_t> m_sourceBytes;
   };
 
 }
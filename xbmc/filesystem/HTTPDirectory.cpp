@@ -33,7 +33,10 @@
 
 using namespace XFILE;
 
-CHTTPDirectory::CHTTPDirectory(void){}
+CHTTPDirectory::CHTTPDirectory(void)
+  : m_cacheTTL(g_advancedSettings.m_networkDirectoryCacheTTL)
+{
+}
 CHTTPDirectory::~CHTTPDirectory(void){}
 
 bool CHTTPDirectory::GetDirectory(const CURL& url, CFileItemList &items)
@@ -49,6 +52,8 @@ bool CHTTPDirectory::GetDirectory(const CURL& url, CFileItemList &items)
     return false;
   }
 
+  m_cacheTTL = ParseCacheControl(http.GetHttpHeader().GetValue("cache-control"));
+
   CRegExp reItem(true); // HTML is case-insensitive
   reItem.RegComp("<a href=\"(.*)\">(.*)</a>");
 
@@ -245,6 +250,30 @@ bool CHTTPDirectory::GetDirectory(const CURL& url, CFileItemList &items)
   return true;
 }
 
+unsigned int CHTTPDirectory::ParseCacheControl(const std::string& cacheControl)
+{
+  if (cacheControl.empty())
+    return g_advancedSettings.m_networkDirectoryCacheTTL;
+
+  std::vector<std::string> directives = StringUtils::Split(cacheControl, ",");
+  for (std::vector<std::string>::iterator it = directives.begin(); it != directives.end(); ++it)
+  {
+    std::string directive = StringUtils::Trim(*it);
+    StringUtils::ToLower(directive);
+    if (directive == "no-cache" || directive == "no-store")
+      return NO_CACHE_TTL;
+    if (StringUtils::StartsWith(directive, "max-age="))
+    {
+      // saturate rather than truncate, which could turn a long max-age into 0
+      unsigned long maxAge = strtoul(directive.c_str() + 8, NULL, 10);
+      if (maxAge == 0)
+        return NO_CACHE_TTL; // stale right away
+      return maxAge >= NO_CACHE_TTL ? NO_CACHE_TTL - 1 : static_cast<unsigned int>(maxAge);
+    }
+  }
+  return g_advancedSettings.m_networkDirectoryCacheTTL;
+}
+
 bool CHTTPDirectory::Exists(const CURL &url)
 {
   CCurlFile http;
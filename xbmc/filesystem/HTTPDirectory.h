@@ -21,6 +21,9 @@
 
 #include "IDirectory.h"
 
+#include <climits>
+#include <string>
+
 namespace XFILE
 {
   class CHTTPDirectory : public IDirectory
@@ -30,7 +33,17 @@ namespace XFILE
       virtual ~CHTTPDirectory(void);
       virtual bool GetDirectory(const CURL& url, CFileItemList &items);
       virtual bool Exists(const CURL& url);
-      virtual DIR_CACHE_TYPE GetCacheType(const CURL& url) const { return DIR_CACHE_ONCE; };
+      virtual DIR_CACHE_TYPE GetCacheType(const CURL& url) const { return m_cacheTTL == NO_CACHE_TTL ? DIR_CACHE_NEVER : DIR_CACHE_ONCE; };
+      virtual unsigned int GetCacheTTL(const CURL& url) const { return m_cacheTTL == NO_CACHE_TTL ? 0 : m_cacheTTL; };
     private:
+      /*! \brief Time to live of a listing the server doesn't want to be cached, 0 would mean it doesn't expire */
+      static const unsigned int NO_CACHE_TTL = UINT_MAX;
+
+      /*! \brief Time to live from a Cache-Control header, the default one if it doesn't say
+       \return NO_CACHE_TTL for no-cache, no-store or max-age=0
+       */
+      static unsigned int ParseCacheControl(const std::string& cacheControl);
+
+      unsigned int m_cacheTTL;
   };
 }
@@ -127,6 +127,14 @@ public:
   */
   virtual DIR_CACHE_TYPE GetCacheType(const CURL& url) const { return DIR_CACHE_ONCE; };
 
+  /*!
+  \brief How long a cached listing of this directory stays fresh
+  \param url Directory at hand.
+  \return Returns the time to live in seconds, 0 if the listing doesn't expire.
+  The cache keeps a listing fresh for a day at most.
+  */
+  virtual unsigned int GetCacheTTL(const CURL& url) const { return 0; };
+
   void SetMask(const std::string& strMask);
   void SetFlags(int flags);
 
@@ -64,6 +64,10 @@ struct SCacheStatus
   unsigned maxrate;  /**< maximum number of bytes per second cache is allowed to fill */
   unsigned currate;  /**< average read rate from source file since last position change */
   float    level;    /**< cache level (0.0 - 1.0) */
+  unsigned readahead = 0;  /**< current size in bytes of the reads filling the cache */
+  float    hitratio = 0.0f; /**< ratio of reads served without waiting for the source (0.0 - 1.0) */
+  unsigned stalltime = 0;  /**< total time in milliseconds readers had to wait for the source */
+  float    diskhitratio = 0.0f; /**< ratio of the cached data that was read from the disk cache (0.0 - 1.0) */
 };
 
 typedef enum {
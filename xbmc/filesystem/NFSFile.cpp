@@ -31,12 +31,18 @@
 #include "utils/URIUtils.h"
 #include "network/DNSNameCache.h"
 #include "threads/SystemClock.h"
+#include "settings/AdvancedSettings.h"
 
+#include <algorithm>
 #include <nfsc/libnfs-raw-mount.h>
 
 #ifdef TARGET_WINDOWS
 #include <fcntl.h>
 #include <sys\stat.h>
+#include <winsock2.h>
+#define poll WSAPoll
+#else
+#include <poll.h>
 #endif
 
 //KEEP_ALIVE_TIMEOUT is decremented every half a second
@@ -48,6 +54,12 @@
 //6 mins (360s) cached context timeout
 #define CONTEXT_TIMEOUT 360000
 
+//read size of pipelined reads if the server doesn't tell
+#define PIPELINE_DEFAULT_CHUNK_SIZE (128 * 1024)
+
+//max time to wait for the reply of a pipelined read
+#define PIPELINE_READ_TIMEOUT 30000
+
 //return codes for getContextForExport
 #define CONTEXT_INVALID  0    //getcontext failed
 #define CONTEXT_NEW      1    //new context created
@@ -506,6 +518,10 @@ CNFSFile::CNFSFile()
 : m_fileSize(0)
 , m_pFileHandle(NULL)
 , m_pNfsContext(NULL)
+, m_pipelineDepth(0)
+, m_pipelineChunkSize(PIPELINE_DEFAULT_CHUNK_SIZE)
+, m_readPos(0)
+, m_fetchPos(0)
 {
   gNfsConnection.AddActiveConnection();
 }
@@ -523,6 +539,9 @@ int64_t CNFSFile::GetPosition()
   CSingleLock lock(gNfsConnection);
   
   if (gNfsConnection.GetNfsContext() == NULL || m_pFileHandle == NULL) return 0;
+
+  if (m_pipelineDepth > 1)
+    return m_readPos;
   
   ret = (int)gNfsConnection.GetImpl()->nfs_lseek(gNfsConnection.GetNfsContext(), m_pFileHandle, 0, SEEK_CUR, &offset);
   
@@ -584,6 +603,13 @@ bool CNFSFile::Open(const CURL& url)
   }
   
   m_fileSize = tmpBuffer.st_size;//cache the size of this file
+
+  m_pipelineDepth = g_advancedSettings.m_nfsPipelineDepth;
+  m_pipelineChunkSize = gNfsConnection.GetMaxReadChunkSize();
+  if (m_pipelineChunkSize == 0)
+    m_pipelineChunkSize = PIPELINE_DEFAULT_CHUNK_SIZE;
+  m_readPos = 0;
+  m_fetchPos = 0;
   // We've successfully opened the file!
   return true;
 }
@@ -656,7 +682,10 @@ ssize_t CNFSFile::Read(void *lpBuf, size_t uiBufSize)
   if (m_pFileHandle == NULL || m_pNfsContext == NULL )
     return -1;
 
-  numberOfBytesRead = gNfsConnection.GetImpl()->nfs_read(m_pNfsContext, m_pFileHandle, uiBufSize, (char *)lpBuf);  
+  if (m_pipelineDepth > 1)
+    numberOfBytesRead = ReadPipelined((char *)lpBuf, uiBufSize);
+  else
+    numberOfBytesRead = gNfsConnection.GetImpl()->nfs_read(m_pNfsContext, m_pFileHandle, uiBufSize, (char *)lpBuf);
 
   lock.Leave();//no need to keep the connection lock after that
   
@@ -676,7 +705,25 @@ int64_t CNFSFile::Seek(int64_t iFilePosition, int iWhence)
 
   CSingleLock lock(gNfsConnection);  
   if (m_pFileHandle == NULL || m_pNfsContext == NULL) return -1;
-  
+
+  if (m_pipelineDepth > 1)
+  {
+    //the file handle position isn't used by pipelined reads, the
+    //pipeline follows the new position on the next read
+    int64_t target = iFilePosition;
+    if (iWhence == SEEK_CUR)
+      target += m_readPos;
+    else if (iWhence == SEEK_END)
+      target += m_fileSize;
+    else if (iWhence != SEEK_SET)
+      return -1;
+
+    if (target < 0)
+      return -1;
+
+    m_readPos = target;
+    return target;
+  }
  
   ret = (int)gNfsConnection.GetImpl()->nfs_lseek(m_pNfsContext, m_pFileHandle, iFilePosition, iWhence, &offset);
   if (ret < 0) 
@@ -715,6 +762,23 @@ void CNFSFile::Close()
     // remove it from keep alive list before closing
     // so keep alive code doens't process it anymore
     gNfsConnection.removeFromKeepAliveList(m_pFileHandle);
+
+    //replies of outstanding reads refer to the file handle, let them arrive first
+    ClearPipeline();
+    for (std::vector<ReadRequest*>::iterator it = m_abandoned.begin(); it != m_abandoned.end(); ++it)
+    {
+      if (!WaitForRequest(*it, PIPELINE_READ_TIMEOUT))
+        break;
+    }
+    for (std::vector<ReadRequest*>::iterator it = m_abandoned.begin(); it != m_abandoned.end(); ++it)
+    {
+      if ((*it)->done)
+        delete *it;
+      else
+        (*it)->orphaned = true;
+    }
+    m_abandoned.clear();
+
     ret = gNfsConnection.GetImpl()->nfs_close(m_pNfsContext, m_pFileHandle);
         
 	  if (ret < 0) 
@@ -725,7 +789,161 @@ void CNFSFile::Close()
     m_pNfsContext = NULL;    
     m_fileSize = 0;
     m_exportPath.clear();
+    m_pipelineDepth = 0;
+  }
+}
+
+ssize_t CNFSFile::ReadPipelined(char *buffer, size_t size)
+{
+  size_t total = 0;
+  while (total < size && m_readPos < (uint64_t)m_fileSize)
+  {
+    //drop what lies before the read position, e.g. after a seek
+    while (!m_pipeline.empty() && m_pipeline.front()->offset + m_pipeline.front()->size <= m_readPos)
+    {
+      AbandonRequest(m_pipeline.front());
+      m_pipeline.pop_front();
+    }
+    if (!m_pipeline.empty() && m_pipeline.front()->offset > m_readPos)
+      ClearPipeline();
+
+    FillPipeline();
+    if (m_pipeline.empty())
+      return total > 0 ? total : -1;
+
+    ReadRequest *request = m_pipeline.front();
+    if (!request->done)
+    {
+      //hand out what we have rather than waiting for more
+      if (total > 0)
+        break;
+
+      if (!WaitForRequest(request, PIPELINE_READ_TIMEOUT))
+      {
+        CLog::Log(LOGERROR, "NFS: timeout waiting for read at %" PRIu64, request->offset);
+        ClearPipeline();
+        return -1;
+      }
+    }
+
+    if (request->status < 0)
+    {
+      CLog::Log(LOGERROR, "NFS: pipelined read at %" PRIu64" failed (%d)", request->offset, request->status);
+      ClearPipeline();
+      return total > 0 ? total : -1;
+    }
+
+    uint64_t offset = m_readPos - request->offset;
+    if (offset >= request->data.size())
+    {
+      //end of file or a short read, continue with new requests after it
+      bool eof = (request->status == 0);
+      ClearPipeline();
+      if (eof)
+        break;
+      continue;
+    }
+
+    size_t copy = std::min(size - total, (size_t)(request->data.size() - offset));
+    memcpy(buffer + total, request->data.data() + offset, copy);
+    total += copy;
+    m_readPos += copy;
   }
+
+  return total;
+}
+
+void CNFSFile::FillPipeline()
+{
+  if (m_pipeline.empty())
+    m_fetchPos = m_readPos;
+
+  while (m_pipeline.size() < m_pipelineDepth && m_fetchPos < (uint64_t)m_fileSize)
+  {
+    ReadRequest *request = new ReadRequest;
+    request->offset = m_fetchPos;
+    request->size = std::min(m_pipelineChunkSize, m_fileSize - m_fetchPos);
+    request->status = 0;
+    request->done = false;
+    request->orphaned = false;
+
+    if (gNfsConnection.GetImpl()->nfs_pread_async(m_pNfsContext, m_pFileHandle, request->offset, request->size, ReadCallback, request) != 0)
+    {
+      CLog::Log(LOGERROR, "NFS: failed to queue read at %" PRIu64" (%s)", request->offset, gNfsConnection.GetImpl()->nfs_get_error(m_pNfsContext));
+      delete request;
+      break;
+    }
+    m_pipeline.push_back(request);
+    m_fetchPos += request->size;
+  }
+}
+
+void CNFSFile::ClearPipeline()
+{
+  for (std::deque<ReadRequest*>::iterator it = m_pipeline.begin(); it != m_pipeline.end(); ++it)
+    AbandonRequest(*it);
+  m_pipeline.clear();
+  m_fetchPos = m_readPos;
+
+  //forget about the dropped requests whose reply arrived meanwhile
+  std::vector<ReadRequest*> pending;
+  for (std::vector<ReadRequest*>::iterator it = m_abandoned.begin(); it != m_abandoned.end(); ++it)
+  {
+    if ((*it)->done)
+      delete *it;
+    else
+      pending.push_back(*it);
+  }
+  m_abandoned.swap(pending);
+}
+
+void CNFSFile::AbandonRequest(ReadRequest *request)
+{
+  if (request->done)
+    delete request;
+  else
+    m_abandoned.push_back(request);
+}
+
+bool CNFSFile::WaitForRequest(const ReadRequest *request, unsigned int timeoutMs)
+{
+  XbmcThreads::EndTime timeout(timeoutMs);
+  while (!request->done)
+  {
+    if (timeout.IsTimePast())
+      return false;
+
+    struct pollfd pfd;
+    pfd.fd = gNfsConnection.GetImpl()->nfs_get_fd(m_pNfsContext);
+    pfd.events = gNfsConnection.GetImpl()->nfs_which_events(m_pNfsContext);
+    pfd.revents = 0;
+    if (poll(&pfd, 1, std::min(timeout.MillisLeft(), 100u)) < 0 && errno != EINTR)
+      return false;
+
+    //replies of all requests on this context are dispatched from here
+    if (gNfsConnection.GetImpl()->nfs_service(m_pNfsContext, pfd.revents) < 0)
+    {
+      CLog::Log(LOGERROR, "NFS: failed to service context (%s)", gNfsConnection.GetImpl()->nfs_get_error(m_pNfsContext));
+      return false;
+    }
+  }
+  return true;
+}
+
+void CNFSFile::ReadCallback(int status, struct nfs_context *nfs, void *data, void *private_data)
+{
+  //called from within libnfs while gNfsConnection is locked
+  ReadRequest *request = static_cast<ReadRequest*>(private_data);
+  if (request->orphaned)
+  {
+    delete request;
+    return;
+  }
+
+  request->status = status;
+  if (status > 0)
+    request->data.assign(static_cast<const char*>(data), status);
+  request->done = true;
 }
 
 //this was a bitch!
@@ -25,8 +25,11 @@
 #include "IFile.h"
 #include "URL.h"
 #include "threads/CriticalSection.h"
+#include <deque>
 #include <list>
 #include <map>
+#include <string>
+#include <vector>
 #include "DllLibNfs.h" // for define NFSSTAT
 
 #ifdef TARGET_WINDOWS
@@ -153,12 +156,38 @@ namespace XFILE
     virtual bool Delete(const CURL& url);
     virtual bool Rename(const CURL& url, const CURL& urlnew);    
   protected:
+    //an asynchronous read request of the read pipeline
+    struct ReadRequest
+    {
+      uint64_t offset;
+      uint64_t size;
+      std::string data;
+      int status;
+      bool done;
+      bool orphaned;//file closed while the reply was outstanding, the callback frees it
+    };
+
     CURL m_url;
     bool IsValidFile(const std::string& strFileName);
+    //pipelined reads keep several read requests in flight, the pipeline
+    //holds them in file order and so serves as reorder buffer for the replies
+    //all of them need to be called with gNfsConnection locked
+    ssize_t ReadPipelined(char *buffer, size_t size);
+    void FillPipeline();
+    void ClearPipeline();
+    void AbandonRequest(ReadRequest *request);
+    bool WaitForRequest(const ReadRequest *request, unsigned int timeoutMs);
+    static void ReadCallback(int status, struct nfs_context *nfs, void *data, void *private_data);
     int64_t m_fileSize;
     struct nfsfh  *m_pFileHandle;
     struct nfs_context *m_pNfsContext;//current nfs context
     std::string m_exportPath;
+    unsigned int m_pipelineDepth;//max number of outstanding reads, pipelining is off if < 2
+    uint64_t m_pipelineChunkSize;
+    std::deque<ReadRequest*> m_pipeline;
+    std::vector<ReadRequest*> m_abandoned;//requests dropped by a seek with the reply still outstanding
+    uint64_t m_readPos;
+    uint64_t m_fetchPos;
   };
 }
 #endif // FILENFS_H_
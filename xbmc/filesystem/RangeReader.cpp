@@ -0,0 +1,296 @@
+/*
+ *      Copyright (C) 2017 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kodi; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "RangeReader.h"
+
+#include <algorithm>
+#include <string.h>
+
+#include "CacheStrategy.h"
+#include "File.h"
+#include "ReadAheadController.h"
+#include "threads/SingleLock.h"
+#include "threads/SystemClock.h"
+#include "threads/Thread.h"
+#include "utils/log.h"
+
+using namespace XFILE;
+
+// size of the reads a worker does while fetching a range
+#define RANGE_READ_SIZE (64*1024)
+
+namespace XFILE
+{
+
+class CRangeReaderWorker : public CThread
+{
+public:
+  explicit CRangeReaderWorker(CRangeReader& reader)
+    : CThread("RangeReader")
+    , m_reader(reader)
+  {
+  }
+
+  bool Open()
+  {
+    return m_file.Open(m_reader.m_path, READ_NO_CACHE | READ_TRUNCATED | READ_CHUNKED);
+  }
+
+  void Close()
+  {
+    m_file.Close();
+  }
+
+protected:
+  void Process() override
+  {
+    std::unique_ptr<char[]> buffer(new char[RANGE_READ_SIZE]);
+
+    while (!m_bStop)
+    {
+      unsigned int generation;
+      std::shared_ptr<CRangeReader::Range> range = m_reader.NextRange(generation);
+      if (!range)
+      {
+        m_reader.m_workEvent.WaitMSec(100);
+        continue;
+      }
+
+      bool success = Fetch(range, generation, buffer.get());
+      if (!success && !m_bStop)
+      {
+        // connection might have been closed by the server, give it another go
+        CLog::Log(LOGDEBUG, "CRangeReader - retrying range at %" PRId64, range->start);
+        m_file.Close();
+        success = Open() && Fetch(range, generation, buffer.get());
+      }
+      m_reader.Finish(range, !success);
+    }
+  }
+
+private:
+  bool Fetch(const std::shared_ptr<CRangeReader::Range>& range, unsigned int generation, char* buffer)
+  {
+    unsigned int start = XbmcThreads::SystemClockMillis();
+    size_t total = m_reader.Received(range);
+    int64_t position = range->start + total;
+    bool newRequest = false;
+
+    if (m_file.GetPosition() != position)
+    {
+      if (m_file.Seek(position, SEEK_SET) != position)
+        return false;
+      newRequest = true;
+    }
+
+    size_t fetched = 0;
+    while (total < range->size)
+    {
+      // result would be dropped anyway
+      if (m_bStop || !m_reader.IsCurrent(generation))
+        return true;
+
+      ssize_t read = m_file.Read(buffer, std::min(static_cast<size_t>(RANGE_READ_SIZE), range->size - total));
+      if (read <= 0)
+        return false;
+
+      m_reader.Append(range, buffer, read);
+      total += read;
+      fetched += read;
+    }
+
+    m_reader.m_controller.Update(fetched, XbmcThreads::SystemClockMillis() - start, newRequest);
+    return true;
+  }
+
+  CRangeReader& m_reader;
+  CFile m_file;
+};
+
+}
+
+CRangeReader::CRangeReader(const std::string& path, int64_t fileSize, unsigned int connections,
+                           CReadAheadController& controller)
+  : m_path(path)
+  , m_fileSize(fileSize)
+  , m_connections(std::max(connections, 1u))
+  , m_controller(controller)
+  , m_readPos(0)
+  , m_fetchPos(0)
+  , m_generation(0)
+{
+}
+
+CRangeReader::~CRangeReader()
+{
+  Close();
+}
+
+bool CRangeReader::Open()
+{
+  Close();
+
+  for (unsigned int i = 0; i < m_connections; i++)
+  {
+    std::unique_ptr<CRangeReaderWorker> worker(new CRangeReaderWorker(*this));
+    if (!worker->Open())
+    {
+      CLog::Log(LOGERROR, "CRangeReader - failed to open connection %u", i);
+      Close();
+      return false;
+    }
+    m_workers.push_back(std::move(worker));
+  }
+
+  for (auto& worker : m_workers)
+    worker->Create();
+
+  return true;
+}
+
+void CRangeReader::Close()
+{
+  // signal all workers before waiting for any of them
+  for (auto& worker : m_workers)
+    worker->StopThread(false);
+  for (auto& worker : m_workers)
+  {
+    worker->StopThread(true);
+    worker->Close();
+  }
+  m_workers.clear();
+
+  CSingleLock lock(m_critSection);
+  m_ranges.clear();
+}
+
+void CRangeReader::Seek(int64_t position)
+{
+  CSingleLock lock(m_critSection);
+  m_ranges.clear();
+  m_readPos = position;
+  m_fetchPos = position;
+  m_generation++;
+  m_workEvent.Set();
+}
+
+int CRangeReader::Read(char* buffer, size_t size, unsigned int timeoutMs)
+{
+  CSingleLock lock(m_critSection);
+
+  bool waited = false;
+  while (true)
+  {
+    if (m_readPos >= m_fileSize)
+      return 0;
+
+    // ranges are assigned contiguously from the read position, so the
+    // first pending range is always the one holding the next data
+    auto it = m_ranges.begin();
+    if (it != m_ranges.end())
+    {
+      Range& range = *it->second;
+      size_t offset = static_cast<size_t>(m_readPos - range.start);
+      if (offset < range.data.size())
+      {
+        size_t length = std::min(size, range.data.size() - offset);
+        memcpy(buffer, range.data.data() + offset, length);
+        m_readPos += length;
+        if (range.done && offset + length == range.size)
+        {
+          m_ranges.erase(it);
+          m_workEvent.Set();
+        }
+        return static_cast<int>(length);
+      }
+
+      if (range.failed)
+      {
+        CLog::Log(LOGERROR, "CRangeReader - failed to fetch range at %" PRId64, range.start);
+        return CACHE_RC_ERROR;
+      }
+
+      if (range.done)
+      {
+        m_ranges.erase(it);
+        m_workEvent.Set();
+        continue;
+      }
+    }
+
+    if (waited)
+      return CACHE_RC_WOULD_BLOCK;
+
+    CSingleExit exit(m_critSection);
+    m_dataEvent.WaitMSec(timeoutMs);
+    waited = true;
+  }
+}
+
+int64_t CRangeReader::GetPosition() const
+{
+  CSingleLock lock(m_critSection);
+  return m_readPos;
+}
+
+std::shared_ptr<CRangeReader::Range> CRangeReader::NextRange(unsigned int& generation)
+{
+  CSingleLock lock(m_critSection);
+
+  // keep at most two ranges per connection in memory
+  if (m_fetchPos >= m_fileSize || m_ranges.size() >= 2 * m_connections)
+    return std::shared_ptr<Range>();
+
+  std::shared_ptr<Range> range = std::make_shared<Range>();
+  range->start = m_fetchPos;
+  range->size = static_cast<size_t>(std::min(static_cast<int64_t>(m_controller.GetChunkSize()), m_fileSize - m_fetchPos));
+  range->data.reserve(range->size);
+  m_fetchPos += range->size;
+  m_ranges[range->start] = range;
+  generation = m_generation;
+  return range;
+}
+
+bool CRangeReader::IsCurrent(unsigned int generation) const
+{
+  CSingleLock lock(m_critSection);
+  return generation == m_generation;
+}
+
+size_t CRangeReader::Received(const std::shared_ptr<Range>& range) const
+{
+  CSingleLock lock(m_critSection);
+  return range->data.size();
+}
+
+void CRangeReader::Append(const std::shared_ptr<Range>& range, const char* data, size_t size)
+{
+  CSingleLock lock(m_critSection);
+  range->data.append(data, size);
+  m_dataEvent.Set();
+}
+
+void CRangeReader::Finish(const std::shared_ptr<Range>& range, bool failed)
+{
+  CSingleLock lock(m_critSection);
+  range->done = true;
+  range->failed = failed;
+  m_dataEvent.Set();
+}
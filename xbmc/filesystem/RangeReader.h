@@ -0,0 +1,105 @@
+#pragma once
+
+/*
+ *      Copyright (C) 2017 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kodi; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "threads/CriticalSection.h"
+#include "threads/Event.h"
+
+namespace XFILE
+{
+
+class CReadAheadController;
+class CRangeReaderWorker;
+
+/*!
+ \brief Reads a file through several connections at once.
+
+ The file is split into consecutive byte ranges ahead of the read position,
+ which are fetched in parallel by one worker per connection, each with its
+ own seekable source file. Read() hands the data out in file order, so for
+ the caller it behaves like a single sequential stream. Used by CFileCache
+ to fill its cache from high latency HTTP sources, where a single TCP stream
+ can't use the available bandwidth.
+ */
+class CRangeReader
+{
+public:
+  CRangeReader(const std::string& path, int64_t fileSize, unsigned int connections,
+               CReadAheadController& controller);
+  ~CRangeReader();
+
+  bool Open();
+  void Close();
+
+  /*!
+   \brief Drop all pending ranges and continue reading at the given position
+   */
+  void Seek(int64_t position);
+
+  /*!
+   \brief Read the next data in file order
+   \return number of bytes read, 0 at end of file, CACHE_RC_ERROR on failure
+           or CACHE_RC_WOULD_BLOCK if no data arrived within timeoutMs
+   */
+  int Read(char* buffer, size_t size, unsigned int timeoutMs);
+
+  int64_t GetPosition() const;
+
+private:
+  friend class CRangeReaderWorker;
+
+  struct Range
+  {
+    int64_t start = 0;
+    size_t size = 0;
+    std::string data;
+    bool done = false;
+    bool failed = false;
+  };
+
+  /*! \brief Assign the next range to a worker, NULL if enough ranges are pending */
+  std::shared_ptr<Range> NextRange(unsigned int& generation);
+  bool IsCurrent(unsigned int generation) const;
+  size_t Received(const std::shared_ptr<Range>& range) const;
+  void Append(const std::shared_ptr<Range>& range, const char* data, size_t size);
+  void Finish(const std::shared_ptr<Range>& range, bool failed);
+
+  std::string m_path;
+  int64_t m_fileSize;
+  unsigned int m_connections;
+  CReadAheadController& m_controller;
+  std::vector<std::unique_ptr<CRangeReaderWorker>> m_workers;
+
+  mutable CCriticalSection m_critSection;
+  std::map<int64_t, std::shared_ptr<Range>> m_ranges; // pending ranges by start position
+  int64_t m_readPos;
+  int64_t m_fetchPos;
+  unsigned int m_generation;
+  CEvent m_dataEvent;
+  CEvent m_workEvent;
+};
+
+}
@@ -0,0 +1,100 @@
+/*
+ *      Copyright (C) 2017 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kodi; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ReadAheadController.h"
+
+#include <algorithm>
+
+#include "threads/SingleLock.h"
+
+using namespace XFILE;
+
+// weight of a new sample in the moving averages
+#define READAHEAD_SMOOTHING 0.25
+// chunks hold twice the bandwidth-delay product, so that at most half of
+// the time of a request is spent waiting for it to get going
+#define READAHEAD_BDP_FACTOR 2
+
+CReadAheadController::CReadAheadController(unsigned int minChunkSize, unsigned int maxChunkSize)
+  : m_minChunkSize(std::max(minChunkSize, 1u))
+  , m_maxChunkSize(std::max(maxChunkSize, m_minChunkSize))
+  , m_chunkSize(m_minChunkSize)
+  , m_bandwidth(0.0)
+  , m_latency(0.0)
+{
+}
+
+void CReadAheadController::Update(size_t bytes, unsigned int elapsedMs, bool newRequest)
+{
+  if (bytes == 0)
+    return;
+
+  CSingleLock lock(m_critSection);
+
+  double transferMs = std::max(elapsedMs, 1u);
+  if (newRequest && m_bandwidth > 0.0)
+  {
+    // the part of the read that can't be explained by the transfer itself
+    // is the cost of issuing the request
+    double latency = std::max(0.0, elapsedMs - bytes / m_bandwidth);
+    m_latency += READAHEAD_SMOOTHING * (latency - m_latency);
+    transferMs = std::max(transferMs - latency, 1.0);
+  }
+
+  double bandwidth = bytes / transferMs;
+  if (m_bandwidth == 0.0)
+    m_bandwidth = bandwidth;
+  else
+    m_bandwidth += READAHEAD_SMOOTHING * (bandwidth - m_bandwidth);
+
+  UpdateChunkSize();
+}
+
+void CReadAheadController::UpdateChunkSize()
+{
+  double target = m_bandwidth * m_latency * READAHEAD_BDP_FACTOR;
+  if (target >= m_maxChunkSize)
+  {
+    m_chunkSize = m_maxChunkSize;
+    return;
+  }
+
+  // whole multiples of the minimum size, sources usually prefer aligned reads
+  unsigned int chunks = static_cast<unsigned int>(target / m_minChunkSize) + 1;
+  m_chunkSize = std::min(chunks * m_minChunkSize, m_maxChunkSize);
+}
+
+unsigned int CReadAheadController::GetChunkSize() const
+{
+  CSingleLock lock(m_critSection);
+  return m_chunkSize;
+}
+
+unsigned int CReadAheadController::GetBandwidth() const
+{
+  CSingleLock lock(m_critSection);
+  return static_cast<unsigned int>(m_bandwidth * 1000.0);
+}
+
+unsigned int CReadAheadController::GetLatency() const
+{
+  CSingleLock lock(m_critSection);
+  return static_cast<unsigned int>(m_latency);
+}
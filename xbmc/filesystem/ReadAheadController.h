@@ -0,0 +1,71 @@
+#pragma once
+
+/*
+ *      Copyright (C) 2017 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kodi; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stddef.h>
+
+#include "threads/CriticalSection.h"
+
+namespace XFILE
+{
+
+/*!
+ \brief Sizes the reads that fill a file cache.
+
+ Bandwidth and request latency of the source are measured from completed
+ reads. The chunk size follows the bandwidth-delay product, so that every
+ request to a high latency source moves enough data to hide its round trip,
+ while fast local sources keep using small chunks. Thread safe.
+ */
+class CReadAheadController
+{
+public:
+  CReadAheadController(unsigned int minChunkSize, unsigned int maxChunkSize);
+
+  /*!
+   \brief Account a completed read from the source
+   \param bytes number of bytes read
+   \param elapsedMs time the read took
+   \param newRequest true if the read had to issue a new request (e.g. after a seek)
+   */
+  void Update(size_t bytes, unsigned int elapsedMs, bool newRequest);
+
+  unsigned int GetChunkSize() const;
+  unsigned int GetMaxChunkSize() const { return m_maxChunkSize; }
+
+  /*! \brief Measured bandwidth of the source in bytes per second */
+  unsigned int GetBandwidth() const;
+
+  /*! \brief Measured latency of a new request in milliseconds */
+  unsigned int GetLatency() const;
+
+private:
+  void UpdateChunkSize();
+
+  mutable CCriticalSection m_critSection;
+  unsigned int m_minChunkSize;
+  unsigned int m_maxChunkSize;
+  unsigned int m_chunkSize;
+  double m_bandwidth; // bytes per millisecond
+  double m_latency;   // milliseconds
+};
+
+}
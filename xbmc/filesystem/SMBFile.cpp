@@ -511,8 +511,17 @@ ssize_t CSMBFile::Read(void *lpBuf, size_t uiBufSize)
   /* also worse, a request of exactly 64k will return */
   /* as if eof, client has a workaround for windows */
   /* thou it seems other servers are affected too */
-  if( uiBufSize >= 64*1024-2 )
-    uiBufSize = 64*1024-2;
+  /* larger reads can be enabled in advancedsettings, */
+  /* libsmbclient then splits them into several */
+  /* requests which are in flight at the same time */
+  const size_t maxReadSize = g_advancedSettings.m_sambareadsize * 1024;
+  if (maxReadSize <= 64*1024)
+  {
+    if( uiBufSize >= 64*1024-2 )
+      uiBufSize = 64*1024-2;
+  }
+  else if (uiBufSize > maxReadSize)
+    uiBufSize = maxReadSize;
 
   ssize_t bytesRead = smbc_read(m_fd, lpBuf, (int)uiBufSize);
 
@@ -545,6 +554,14 @@ int64_t CSMBFile::Seek(int64_t iFilePosition, int iWhence)
   return (int64_t)pos;
 }
 
+int CSMBFile::GetChunkSize()
+{
+  // let the file cache request the full read size
+  if (g_advancedSettings.m_sambareadsize > 64)
+    return g_advancedSettings.m_sambareadsize * 1024;
+  return 1;
+}
+
 void CSMBFile::Close()
 {
   if (m_fd != -1)
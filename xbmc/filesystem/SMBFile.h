@@ -89,7 +89,7 @@ public:
   virtual bool OpenForWrite(const CURL& url, bool bOverWrite = false);
   virtual bool Delete(const CURL& url);
   virtual bool Rename(const CURL& url, const CURL& urlnew);
-  virtual int GetChunkSize() { return 1; }
+  virtual int GetChunkSize();
   virtual int IoControl(EIoControl request, void* param);
 
 protected:
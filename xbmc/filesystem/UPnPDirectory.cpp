@@ -30,6 +30,7 @@
 #include "network/upnp/UPnP.h"
 #include "network/upnp/UPnPInternal.h"
 #include "FileItem.h"
+#include "settings/AdvancedSettings.h"
 #include "utils/log.h"
 #include "utils/URIUtils.h"
 #include "utils/StringUtils.h"
@@ -367,4 +368,13 @@ cleanup:
 failure:
     return false;
 }
+
+/*----------------------------------------------------------------------
+|   CUPnPDirectory::GetCacheTTL
++---------------------------------------------------------------------*/
+unsigned int
+CUPnPDirectory::GetCacheTTL(const CURL& url) const
+{
+    return g_advancedSettings.m_networkDirectoryCacheTTL;
+}
 }
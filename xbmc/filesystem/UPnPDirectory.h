@@ -40,6 +40,7 @@ public:
     // IDirectory methods
     virtual bool GetDirectory(const CURL& url, CFileItemList &items);
     virtual bool AllowAll() const { return true; }
+    virtual unsigned int GetCacheTTL(const CURL& url) const;
 
     // class methods
     static const char* GetFriendlyName(const CURL& url);
@@ -24,12 +24,12 @@
 #include "utils/auto_buffer.h"
 #include "utils/log.h"
 
+#include <algorithm>
 #include <sys/stat.h>
 
 #if defined (TARGET_WINDOWS)
 #pragma comment(lib, "zlib.lib")
 #endif
-#define ZIP_CACHE_LIMIT 4*1024*1024
 
 using namespace XFILE;
 
@@ -38,8 +38,8 @@ CZipFile::CZipFile()
   m_szStringBuffer = NULL;
   m_szStartOfStringBuffer = NULL;
   m_iDataInStringBuffer = 0;
-  m_bCached = false;
   m_iRead = -1;
+  m_iWindowPos = 0;
 }
 
 CZipFile::~CZipFile()
@@ -50,7 +50,6 @@ CZipFile::~CZipFile()
 
 bool CZipFile::Open(const CURL&url)
 {
-  std::string strOpts = url.GetOptions();
   CURL url2(url);
   url2.SetOptions("");
   if (!g_ZipManager.GetZipEntry(url2,mZipItem))
@@ -68,26 +67,24 @@ bool CZipFile::Open(const CURL&url)
     return false;
   }
 
-  if (mZipItem.method != 0 && mZipItem.usize > ZIP_CACHE_LIMIT && strOpts != "?cache=no")
-  {
-    if (!CFile::Exists("special://temp/" + URIUtils::GetFileName(url2)))
-    {
-      url2.SetOptions("?cache=no");
-      const CURL pathToUrl("special://temp/" + URIUtils::GetFileName(url2));
-      if (!CFile::Copy(url2, pathToUrl))
-        return false;
-    }
-    m_bCached = true;
-    return mFile.Open("special://temp/" + URIUtils::GetFileName(url2));
-  }
-
   if (!mFile.Open(url.GetHostName())) // this is the zip-file, always open binary
   {
     CLog::Log(LOGERROR,"FileZip: unable to open zip file %s!",url.GetHostName().c_str());
     return false;
   }
   mFile.Seek(mZipItem.offset,SEEK_SET);
-  return InitDecompress();
+  if (!InitDecompress())
+    return false;
+
+  // large deflated entries get seek points so that seeking doesn't have to
+  // inflate from the start of the entry again
+  m_seekIndex = g_ZipManager.GetSeekIndex(url2, mZipItem);
+  if (m_seekIndex)
+  {
+    m_window.assign(ZIP_SEEK_WINDOW, 0);
+    m_iWindowPos = 0;
+  }
+  return true;
 }
 
 bool CZipFile::InitDecompress()
@@ -122,16 +119,11 @@ int64_t CZipFile::GetLength()
 
 int64_t CZipFile::GetPosition()
 {
-  if (m_bCached)
-    return mFile.GetPosition();
-
   return m_iFilePos;
 }
 
 int64_t CZipFile::Seek(int64_t iFilePosition, int iWhence)
 {
-  if (m_bCached)
-    return mFile.Seek(iFilePosition,iWhence);
   if (mZipItem.method == 0) // this is easy
   {
     int64_t iResult;
@@ -171,71 +163,44 @@ int64_t CZipFile::Seek(int64_t iFilePosition, int iWhence)
   // here goes the stupid part..
   if (mZipItem.method == 8)
   {
-    static const int blockSize = 128 * 1024;
-    XUTILS::auto_buffer buf(blockSize);
     switch (iWhence)
     {
     case SEEK_SET:
-      if (iFilePosition == m_iFilePos)
-        return m_iFilePos; // mp3reader does this lots-of-times
-      if (iFilePosition > mZipItem.usize || iFilePosition < 0)
-        return -1;
-      // read until position in 128k blocks.. only way to do it due to format.
-      // can't start in the middle of data since then we'd have no clue where
-      // we are in uncompressed data..
-      if (iFilePosition < m_iFilePos)
-      {
-        m_iFilePos = 0;
-        m_iZipFilePos = 0;
-        inflateEnd(&m_ZStream);
-        inflateInit2(&m_ZStream,-MAX_WBITS); // simply restart zlib
-        mFile.Seek(mZipItem.offset,SEEK_SET);
-        m_ZStream.next_in = (Bytef*)m_szBuffer;
-        m_ZStream.avail_in = 0;
-        m_ZStream.total_out = 0;
-        while (m_iFilePos < iFilePosition)
-        {
-          unsigned int iToRead = (iFilePosition - m_iFilePos)>blockSize ? blockSize : (int)(iFilePosition - m_iFilePos);
-          if (Read(buf.get(),iToRead) != iToRead)
-            return -1;
-        }
-        return m_iFilePos;
-      }
-      else // seek forward
-        return Seek(iFilePosition-m_iFilePos,SEEK_CUR);
       break;
-
     case SEEK_CUR:
-      if (iFilePosition < 0)
-        return Seek(m_iFilePos+iFilePosition,SEEK_SET); // can't rewind stream
-      // read until requested position, drop data
-      if (m_iFilePos+iFilePosition > mZipItem.usize)
-        return -1;
       iFilePosition += m_iFilePos;
-      while (m_iFilePos < iFilePosition)
-      {
-        unsigned int iToRead = (iFilePosition - m_iFilePos)>blockSize ? blockSize : (int)(iFilePosition - m_iFilePos);
-        if (Read(buf.get(), iToRead) != iToRead)
-          return -1;
-      }
-      return m_iFilePos;
       break;
-
     case SEEK_END:
-      // now this is a nasty bastard, possibly takes lotsoftime
-      // uncompress, minding m_ZStream.total_out
-
-      while( (int)m_ZStream.total_out < mZipItem.usize+iFilePosition)
-      {
-        unsigned int iToRead = (mZipItem.usize + iFilePosition - m_ZStream.total_out > blockSize) ? blockSize : (int)(mZipItem.usize + iFilePosition - m_ZStream.total_out);
-        if (Read(buf.get(), iToRead) != iToRead)
-          return -1;
-      }
-      return m_iFilePos;
+      iFilePosition += mZipItem.usize;
       break;
     default:
       return -1;
     }
+
+    if (iFilePosition == m_iFilePos)
+      return m_iFilePos; // mp3reader does this lots-of-times
+    if (iFilePosition > mZipItem.usize || iFilePosition < 0)
+      return -1;
+
+    // continue at the closest seek point. without one we have to restart at
+    // the beginning when going backwards - can't start in the middle of data
+    // since then we'd have no clue where we are in uncompressed data..
+    if (!SeekToPoint(iFilePosition) && iFilePosition < m_iFilePos)
+    {
+      if (!RestartDecompress())
+        return -1;
+    }
+
+    // read until position in 128k blocks, drop data
+    static const int blockSize = 128 * 1024;
+    XUTILS::auto_buffer buf(blockSize);
+    while (m_iFilePos < iFilePosition)
+    {
+      unsigned int iToRead = (iFilePosition - m_iFilePos)>blockSize ? blockSize : (int)(iFilePosition - m_iFilePos);
+      if (Read(buf.get(), iToRead) != iToRead)
+        return -1;
+    }
+    return m_iFilePos;
   }
   return -1;
 }
@@ -293,9 +258,6 @@ ssize_t CZipFile::Read(void* lpBuf, size_t uiBufSize)
   if (uiBufSize > SSIZE_MAX)
     uiBufSize = SSIZE_MAX;
 
-  if (m_bCached)
-    return mFile.Read(lpBuf,uiBufSize);
-
   // flush what might be left in the string buffer
   if (m_iDataInStringBuffer > 0)
   {
@@ -308,13 +270,14 @@ ssize_t CZipFile::Read(void* lpBuf, size_t uiBufSize)
   {
     uLong iDecompressed = 0;
     uLong prevOut = m_ZStream.total_out;
+    int64_t iStartPos = m_iFilePos;
     while ((iDecompressed < uiBufSize) && ((m_iZipFilePos < mZipItem.csize) || (m_bFlush)))
     {
       m_ZStream.next_out = (Bytef*)(lpBuf)+iDecompressed;
       m_ZStream.avail_out = static_cast<uInt>(uiBufSize-iDecompressed);
       if (m_bFlush) // need to flush buffer !
       {
-        int iMessage = inflate(&m_ZStream,Z_SYNC_FLUSH);
+        int iMessage = Inflate(iStartPos, prevOut);
         m_bFlush = ((iMessage == Z_OK) && (m_ZStream.avail_out == 0))?true:false;
         if (!m_ZStream.avail_out) // flush filled buffer, get out of here
         {
@@ -332,7 +295,7 @@ ssize_t CZipFile::Read(void* lpBuf, size_t uiBufSize)
         }
       }
 
-      int iMessage = inflate(&m_ZStream,Z_SYNC_FLUSH);
+      int iMessage = Inflate(iStartPos, prevOut);
       if (iMessage < 0)
       {
         Close();
@@ -367,10 +330,11 @@ ssize_t CZipFile::Read(void* lpBuf, size_t uiBufSize)
 
 void CZipFile::Close()
 {
-  if (mZipItem.method == 8 && !m_bCached && m_iRead != -1)
+  if (mZipItem.method == 8 && m_iRead != -1)
     inflateEnd(&m_ZStream);
 
   mFile.Close();
+  m_seekIndex.reset();
 }
 /* CHANGED: JM - moved to CFile
 bool CZipFile::ReadString(char* szLine, int iLineLength)
@@ -460,6 +424,111 @@ bool CZipFile::FillBuffer()
   return true;
 }
 
+int CZipFile::Inflate(int64_t iStartPos, uLong prevOut)
+{
+  if (!m_seekIndex)
+    return inflate(&m_ZStream, Z_SYNC_FLUSH);
+
+  // stop at deflate block boundaries, the only places we can resume from,
+  // but otherwise behave like Z_SYNC_FLUSH and use up input or output space
+  int iMessage;
+  do
+  {
+    Bytef* out = m_ZStream.next_out;
+    iMessage = inflate(&m_ZStream, Z_BLOCK);
+    UpdateWindow(out, m_ZStream.next_out - out);
+
+    // bit 128: end of a block header, bit 64: last block of the stream
+    if (iMessage == Z_OK && (m_ZStream.data_type & 128) && !(m_ZStream.data_type & 64))
+    {
+      int64_t iUncompressed = iStartPos + (m_ZStream.total_out - prevOut);
+      if (m_seekIndex->NeedsPoint(iUncompressed))
+      {
+        SZipSeekPoint point;
+        point.uncompressed = iUncompressed;
+        point.compressed = m_iZipFilePos - m_ZStream.avail_in;
+        point.bits = m_ZStream.data_type & 7;
+        point.window.reserve(ZIP_SEEK_WINDOW);
+        point.window.insert(point.window.end(), m_window.begin() + m_iWindowPos, m_window.end());
+        point.window.insert(point.window.end(), m_window.begin(), m_window.begin() + m_iWindowPos);
+        m_seekIndex->AddPoint(point);
+      }
+    }
+  } while (iMessage == Z_OK && m_ZStream.avail_in && m_ZStream.avail_out);
+
+  return iMessage;
+}
+
+void CZipFile::UpdateWindow(const unsigned char* data, size_t size)
+{
+  static const size_t windowSize = ZIP_SEEK_WINDOW;
+  if (size >= windowSize)
+  {
+    memcpy(m_window.data(), data + size - windowSize, windowSize);
+    m_iWindowPos = 0;
+    return;
+  }
+
+  size_t iFirst = std::min(size, windowSize - m_iWindowPos);
+  memcpy(m_window.data() + m_iWindowPos, data, iFirst);
+  memcpy(m_window.data(), data + iFirst, size - iFirst);
+  m_iWindowPos = (m_iWindowPos + size) % windowSize;
+}
+
+bool CZipFile::RestartDecompress()
+{
+  m_iFilePos = 0;
+  m_iZipFilePos = 0;
+  m_bFlush = false;
+  inflateEnd(&m_ZStream);
+  if (inflateInit2(&m_ZStream, -MAX_WBITS) != Z_OK) // simply restart zlib
+    return false;
+  if (mFile.Seek(mZipItem.offset, SEEK_SET) < 0)
+    return false;
+  m_ZStream.next_in = (Bytef*)m_szBuffer;
+  m_ZStream.avail_in = 0;
+  m_ZStream.total_out = 0;
+  return true;
+}
+
+bool CZipFile::SeekToPoint(int64_t iFilePosition)
+{
+  SZipSeekPoint point;
+  if (!m_seekIndex || !m_seekIndex->GetPoint(iFilePosition, point))
+    return false;
+
+  // just inflating forward is cheaper if no point lies ahead of us
+  if (iFilePosition >= m_iFilePos && point.uncompressed <= m_iFilePos)
+    return false;
+
+  // the point may start in the middle of a byte, prime zlib with its remaining bits
+  int64_t iCompressed = point.compressed - (point.bits ? 1 : 0);
+  inflateEnd(&m_ZStream);
+  if (inflateInit2(&m_ZStream, -MAX_WBITS) != Z_OK ||
+      mFile.Seek(mZipItem.offset + iCompressed, SEEK_SET) < 0)
+    return RestartDecompress();
+
+  m_iZipFilePos = iCompressed;
+  m_bFlush = false;
+  m_ZStream.next_in = (Bytef*)m_szBuffer;
+  m_ZStream.avail_in = 0;
+  m_ZStream.total_out = 0;
+  if (point.bits)
+  {
+    unsigned char ch;
+    if (mFile.Read(&ch, 1) != 1)
+      return RestartDecompress();
+    m_iZipFilePos++;
+    inflatePrime(&m_ZStream, point.bits, ch >> (8 - point.bits));
+  }
+  inflateSetDictionary(&m_ZStream, point.window.data(), point.window.size());
+
+  memcpy(m_window.data(), point.window.data(), point.window.size());
+  m_iWindowPos = 0;
+  m_iFilePos = point.uncompressed;
+  return true;
+}
+
 void CZipFile::DestroyBuffer(void* lpBuffer, int iBufSize)
 {
   if (!m_bFlush)
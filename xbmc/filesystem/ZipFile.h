@@ -22,6 +22,8 @@
 
 #include "IFile.h"
 #include <zlib.h>
+#include <memory>
+#include <vector>
 #include "File.h"
 #include "ZipManager.h"
 
@@ -54,6 +56,10 @@ namespace XFILE
     bool InitDecompress();
     bool FillBuffer();
     void DestroyBuffer(void* lpBuffer, int iBufSize);
+    int Inflate(int64_t iStartPos, uLong prevOut);
+    void UpdateWindow(const unsigned char* data, size_t size);
+    bool SeekToPoint(int64_t iFilePosition);
+    bool RestartDecompress();
     CFile mFile;
     SZipEntry mZipItem;
     int64_t m_iFilePos; // position in _uncompressed_ data read
@@ -66,7 +72,9 @@ namespace XFILE
     size_t m_iDataInStringBuffer;
     int m_iRead;
     bool m_bFlush;
-    bool m_bCached;
+    std::shared_ptr<CZipSeekIndex> m_seekIndex;
+    std::vector<unsigned char> m_window; // last ZIP_SEEK_WINDOW bytes of uncompressed data
+    size_t m_iWindowPos;
   };
 }
 
@@ -27,6 +27,7 @@
 #include "system.h"
 #include "URL.h"
 #include "linux/PlatformDefs.h"
+#include "threads/SingleLock.h"
 #include "utils/CharsetConverter.h"
 #include "utils/EndianSwap.h"
 #include "utils/log.h"
@@ -34,6 +35,45 @@
 
 using namespace XFILE;
 
+CZipSeekIndex::CZipSeekIndex(int64_t span)
+  : m_span(std::max(span, static_cast<int64_t>(ZIP_SEEK_WINDOW)))
+{
+}
+
+bool CZipSeekIndex::NeedsPoint(int64_t uncompressed) const
+{
+  CSingleLock lock(m_critSection);
+  int64_t last = m_points.empty() ? 0 : m_points.back().uncompressed;
+  return uncompressed >= last + m_span;
+}
+
+void CZipSeekIndex::AddPoint(const SZipSeekPoint& point)
+{
+  CSingleLock lock(m_critSection);
+  // another reader of the same entry might have been faster
+  int64_t last = m_points.empty() ? 0 : m_points.back().uncompressed;
+  if (point.uncompressed >= last + m_span)
+    m_points.push_back(point);
+}
+
+bool CZipSeekIndex::GetPoint(int64_t uncompressed, SZipSeekPoint& point) const
+{
+  CSingleLock lock(m_critSection);
+  auto it = std::upper_bound(m_points.begin(), m_points.end(), uncompressed,
+                             [](int64_t offset, const SZipSeekPoint& p) { return offset < p.uncompressed; });
+  if (it == m_points.begin())
+    return false;
+
+  point = *(--it);
+  return true;
+}
+
+size_t CZipSeekIndex::Size() const
+{
+  CSingleLock lock(m_critSection);
+  return m_points.size();
+}
+
 CZipManager::CZipManager()
 {
 }
@@ -67,6 +107,7 @@ bool CZipManager::GetZipList(const CURL& url, std::vector<SZipEntry>& items)
     }
     mZipMap.erase(it);
     mZipDate.erase(it2);
+    ReleaseSeekIndexes(strFile);
   }
 
   CFile mFile;
@@ -322,6 +363,26 @@ void CZipManager::release(const std::string& strPath)
     mZipMap.erase(it);
     mZipDate.erase(it2);
   }
+  ReleaseSeekIndexes(url.GetHostName());
+}
+
+std::shared_ptr<CZipSeekIndex> CZipManager::GetSeekIndex(const CURL& url, const SZipEntry& item)
+{
+  if (item.method != 8 || item.usize < 2 * ZIP_SEEK_SPAN)
+    return std::shared_ptr<CZipSeekIndex>();
+
+  CSingleLock lock(m_seekIndexSection);
+  std::shared_ptr<CZipSeekIndex>& index = mSeekIndexes[url.GetHostName()][item.name];
+  if (!index)
+    index = std::make_shared<CZipSeekIndex>(std::max(static_cast<int64_t>(ZIP_SEEK_SPAN),
+                                                     static_cast<int64_t>(item.usize / ZIP_SEEK_MAX_POINTS)));
+  return index;
+}
+
+void CZipManager::ReleaseSeekIndexes(const std::string& strFile)
+{
+  CSingleLock lock(m_seekIndexSection);
+  mSeekIndexes.erase(strFile);
 }
 
 
@@ -30,11 +30,17 @@
 #define LHDR_SIZE 30
 #define CHDR_SIZE 46
 #define ECDREC_SIZE 22
+#define ZIP_SEEK_WINDOW 32768 // deflate dictionary size
+#define ZIP_SEEK_SPAN (1024 * 1024) // minimum distance between two seek points
+#define ZIP_SEEK_MAX_POINTS 256 // upper bound of seek points per entry
 
 #include <memory.h>
+#include <map>
+#include <memory>
 #include <string>
 #include <vector>
-#include <map>
+
+#include "threads/CriticalSection.h"
 
 class CURL;
 
@@ -97,6 +103,43 @@ struct SZipEntry {
   }
 };
 
+/*!
+ \brief Inflate state at a deflate block boundary of a zip entry.
+
+ Decompression can be restarted at such a point by priming the inflater
+ with the remaining bits and the preceding window of uncompressed data.
+ */
+struct SZipSeekPoint
+{
+  int64_t uncompressed = 0; // offset in uncompressed data
+  int64_t compressed = 0;   // offset in compressed data of the first complete byte
+  int bits = 0;             // unused bits of the byte before compressed
+  std::vector<unsigned char> window; // ZIP_SEEK_WINDOW bytes of uncompressed data before the point
+};
+
+/*!
+ \brief Seek points of a deflated zip entry, built lazily while it is read.
+
+ Points are appended in order of their uncompressed offset and at least
+ one span apart, so random access costs at most one span of inflating.
+ */
+class CZipSeekIndex
+{
+public:
+  explicit CZipSeekIndex(int64_t span);
+
+  bool NeedsPoint(int64_t uncompressed) const;
+  void AddPoint(const SZipSeekPoint& point);
+  /*! \brief Get the last seek point at or before the given uncompressed offset */
+  bool GetPoint(int64_t uncompressed, SZipSeekPoint& point) const;
+  size_t Size() const;
+
+private:
+  mutable CCriticalSection m_critSection;
+  int64_t m_span;
+  std::vector<SZipSeekPoint> m_points;
+};
+
 class CZipManager
 {
 public:
@@ -108,11 +151,17 @@ public:
   bool ExtractArchive(const std::string& strArchive, const std::string& strPath);
   bool ExtractArchive(const CURL& archive, const std::string& strPath);
   void release(const std::string& strPath); // release resources used by list zip
+  /*! \brief Get the shared seek index of a deflated entry, NULL if the entry is too small to need one */
+  std::shared_ptr<CZipSeekIndex> GetSeekIndex(const CURL& url, const SZipEntry& item);
   static void readHeader(const char* buffer, SZipEntry& info);
   static void readCHeader(const char* buffer, SZipEntry& info);
 private:
+  void ReleaseSeekIndexes(const std::string& strFile);
+
   std::map<std::string,std::vector<SZipEntry> > mZipMap;
   std::map<std::string,int64_t> mZipDate;
+  std::map<std::string, std::map<std::string, std::shared_ptr<CZipSeekIndex> > > mSeekIndexes;
+  CCriticalSection m_seekIndexSection;
 };
 
 extern CZipManager g_ZipManager;
@@ -0,0 +1,172 @@
+/*
+ *      Copyright (C) 2017 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kodi; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "filesystem/Directory.h"
+#include "filesystem/DirectoryCache.h"
+#include "settings/AdvancedSettings.h"
+#include "test/TestHTTPServer.h"
+#include "threads/SystemClock.h"
+#include "utils/Stopwatch.h"
+#include "utils/StringUtils.h"
+#include "FileItem.h"
+
+#include <iostream>
+
+#include "gtest/gtest.h"
+
+using namespace XFILE;
+
+class TestDirectoryCache : public testing::Test
+{
+protected:
+  TestDirectoryCache()
+    : m_ttl(g_advancedSettings.m_networkDirectoryCacheTTL)
+  {
+    std::string listing;
+    for (int i = 0; i < 200; i++)
+    {
+      std::string name = StringUtils::Format("file%03i.mkv", i);
+      listing += "<a href=\"" + name + "\">" + name + "</a>\n";
+    }
+    // every request takes a while, as it would with a remote source
+    m_server.Start(listing, 0, 50);
+    g_directoryCache.Clear();
+    g_directoryCache.ResetStats();
+  }
+
+  ~TestDirectoryCache()
+  {
+    m_server.Stop();
+    g_directoryCache.Clear();
+    g_directoryCache.ResetStats();
+    g_advancedSettings.m_networkDirectoryCacheTTL = m_ttl;
+  }
+
+  /* Browse the test directory, returns the elapsed time in ms */
+  float Browse(CFileItemList& items)
+  {
+    CStopWatch watch;
+    watch.StartZero();
+    items.Clear();
+    EXPECT_TRUE(CDirectory::GetDirectory(m_server.GetUrl("dir/"), items, "", DIR_FLAG_DEFAULTS));
+    return watch.GetElapsedMilliseconds();
+  }
+
+  /* Wait for the server to see another request */
+  bool WaitForRequests(unsigned int count)
+  {
+    XbmcThreads::EndTime timeout(5000);
+    while (m_server.GetRequestCount() < count && !timeout.IsTimePast())
+      XbmcThreads::ThreadSleep(10);
+    return m_server.GetRequestCount() >= count;
+  }
+
+  CTestHTTPServer m_server;
+  unsigned int m_ttl;
+};
+
+TEST_F(TestDirectoryCache, FreshListingIsCached)
+{
+  g_advancedSettings.m_networkDirectoryCacheTTL = 60;
+
+  CFileItemList items;
+  float uncached = Browse(items);
+  EXPECT_EQ(200, items.Size());
+  unsigned int requests = m_server.GetRequestCount();
+  EXPECT_GT(requests, 0U);
+
+  float cached = Browse(items);
+  EXPECT_EQ(200, items.Size());
+  EXPECT_EQ(requests, m_server.GetRequestCount());
+
+  std::cout << "browse: " << uncached << " ms uncached, " << cached << " ms cached" << std::endl;
+  EXPECT_LT(cached, uncached);
+
+  std::map<std::string, CDirectoryCache::Stats> stats = g_directoryCache.GetStats();
+  EXPECT_EQ(1U, stats["http"].hits);
+  EXPECT_EQ(0U, stats["http"].staleHits);
+  EXPECT_GE(stats["http"].misses, 1U);
+}
+
+TEST_F(TestDirectoryCache, StaleListingIsRevalidated)
+{
+  g_advancedSettings.m_networkDirectoryCacheTTL = 1;
+
+  CFileItemList items;
+  Browse(items);
+  unsigned int requests = m_server.GetRequestCount();
+
+  // past the time to live, the listing is still served while refreshed in the background
+  XbmcThreads::ThreadSleep(1200);
+  float stale = Browse(items);
+  EXPECT_EQ(200, items.Size());
+  EXPECT_TRUE(WaitForRequests(requests + 1));
+  std::cout << "browse: " << stale << " ms stale" << std::endl;
+
+  XbmcThreads::EndTime timeout(5000);
+  while (g_directoryCache.GetStats()["http"].revalidations == 0 && !timeout.IsTimePast())
+    XbmcThreads::ThreadSleep(10);
+
+  std::map<std::string, CDirectoryCache::Stats> stats = g_directoryCache.GetStats();
+  EXPECT_EQ(1U, stats["http"].staleHits);
+  EXPECT_EQ(1U, stats["http"].revalidations);
+
+  // the refreshed listing is fresh again
+  requests = m_server.GetRequestCount();
+  Browse(items);
+  EXPECT_EQ(requests, m_server.GetRequestCount());
+}
+
+TEST_F(TestDirectoryCache, ExpiredListingIsRefetched)
+{
+  g_advancedSettings.m_networkDirectoryCacheTTL = 1;
+
+  CFileItemList items;
+  Browse(items);
+  unsigned int requests = m_server.GetRequestCount();
+
+  XbmcThreads::ThreadSleep(2200);
+  Browse(items);
+  EXPECT_EQ(200, items.Size());
+  EXPECT_GT(m_server.GetRequestCount(), requests);
+
+  std::map<std::string, CDirectoryCache::Stats> stats = g_directoryCache.GetStats();
+  EXPECT_EQ(0U, stats["http"].hits);
+  EXPECT_EQ(0U, stats["http"].revalidations);
+}
+
+TEST_F(TestDirectoryCache, LongTimeToLiveDoesntExpire)
+{
+  // about 50 days, which overflows when counted in ms
+  g_advancedSettings.m_networkDirectoryCacheTTL = 4294968;
+
+  CFileItemList items;
+  Browse(items);
+  unsigned int requests = m_server.GetRequestCount();
+
+  XbmcThreads::ThreadSleep(1500);
+  Browse(items);
+  EXPECT_EQ(200, items.Size());
+  EXPECT_EQ(requests, m_server.GetRequestCount());
+
+  std::map<std::string, CDirectoryCache::Stats> stats = g_directoryCache.GetStats();
+  EXPECT_EQ(1U, stats["http"].hits);
+  EXPECT_EQ(0U, stats["http"].staleHits);
+}
@@ -0,0 +1,266 @@
+/*
+ *      Copyright (C) 2017 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kodi; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "filesystem/DiskBlockCache.h"
+#include "filesystem/FileCache.h"
+#include "filesystem/ReadAheadController.h"
+#include "settings/AdvancedSettings.h"
+#include "test/TestHTTPServer.h"
+#include "utils/Stopwatch.h"
+#include "URL.h"
+
+#include <iostream>
+#include <random>
+
+#include "gtest/gtest.h"
+
+using namespace XFILE;
+
+class TestFileCache : public testing::Test
+{
+protected:
+  TestFileCache()
+    : m_parallelRanges(g_advancedSettings.m_cacheParallelRanges)
+    , m_diskSize(g_advancedSettings.m_cacheDiskSize)
+  {
+    std::mt19937 rng(42);
+    m_data.resize(2 * 1024 * 1024);
+    for (size_t i = 0; i < m_data.size(); i++)
+      m_data[i] = static_cast<char>(rng());
+  }
+
+  ~TestFileCache()
+  {
+    m_server.Stop();
+    g_advancedSettings.m_cacheParallelRanges = m_parallelRanges;
+    g_advancedSettings.m_cacheDiskSize = m_diskSize;
+    CDiskBlockCache::GetInstance().Clear();
+    CDiskBlockCache::GetInstance().Deinitialize();
+  }
+
+  /* Read the whole file through a CFileCache, returns the elapsed time */
+  float ReadAll(unsigned int parallelRanges, SCacheStatus& status)
+  {
+    g_advancedSettings.m_cacheParallelRanges = parallelRanges;
+
+    CStopWatch watch;
+    watch.StartZero();
+    CFileCache cache(READ_AUDIO_VIDEO);
+    EXPECT_TRUE(cache.Open(CURL(m_server.GetUrl())));
+    EXPECT_EQ(static_cast<int64_t>(m_data.size()), cache.GetLength());
+
+    std::string content;
+    char buffer[32 * 1024];
+    ssize_t read;
+    while ((read = cache.Read(buffer, sizeof(buffer))) > 0)
+      content.append(buffer, read);
+    EXPECT_EQ(m_data.size(), content.size());
+    EXPECT_TRUE(content == m_data);
+
+    EXPECT_EQ(0, cache.IoControl(IOCTRL_CACHE_STATUS, &status));
+    cache.Close();
+    return watch.GetElapsedSeconds();
+  }
+
+  /* Read from a slow source over one and over several connections */
+  void ThrottledSource(bool report)
+  {
+    // 1 MB/s per connection with 50 ms of latency on every request
+    ASSERT_TRUE(m_server.Start(m_data, 1024 * 1024, 50));
+
+    SCacheStatus single;
+    float singleTime = ReadAll(0, single);
+    EXPECT_EQ(1u, m_server.GetMaxConnections());
+
+    m_server.ResetCounters();
+    SCacheStatus parallel;
+    float parallelTime = ReadAll(4, parallel);
+    EXPECT_GT(m_server.GetMaxConnections(), 1u);
+    EXPECT_GT(m_server.GetRequestCount(), 1u);
+    EXPECT_GT(parallel.readahead, 0u);
+
+    // reading ahead over several connections gets the file in sooner than one connection can
+    EXPECT_LT(parallelTime, singleTime);
+
+    if (report)
+    {
+      std::cout << "single connection: " << singleTime << "s, fill rate " << single.currate
+                << " B/s, hit ratio " << single.hitratio << ", stalled " << single.stalltime << "ms" << std::endl;
+      std::cout << "4 connections: " << parallelTime << "s, fill rate " << parallel.currate
+                << " B/s, hit ratio " << parallel.hitratio << ", stalled " << parallel.stalltime << "ms, read-ahead "
+                << parallel.readahead << " bytes" << std::endl;
+    }
+  }
+
+  CTestHTTPServer m_server;
+  std::string m_data;
+  unsigned int m_parallelRanges;
+  unsigned int m_diskSize;
+};
+
+TEST_F(TestFileCache, ReadAheadFollowsBandwidthDelayProduct)
+{
+  CReadAheadController controller(64 * 1024, 4 * 1024 * 1024);
+  EXPECT_EQ(64u * 1024, controller.GetChunkSize());
+
+  // 1 MB/s with 200 ms to get a new request going
+  controller.Update(100 * 1024, 100, false);
+  for (int i = 0; i < 20; i++)
+    controller.Update(100 * 1024, 300, true);
+
+  EXPECT_NEAR(1024 * 1024, controller.GetBandwidth(), 100 * 1024);
+  EXPECT_NEAR(200, controller.GetLatency(), 20);
+  EXPECT_GE(controller.GetChunkSize(), 2u * 180 * 1024);
+  EXPECT_EQ(0u, controller.GetChunkSize() % (64 * 1024));
+
+  // a fast local source stays at the minimum
+  CReadAheadController local(64 * 1024, 4 * 1024 * 1024);
+  local.Update(64 * 1024, 1, false);
+  local.Update(64 * 1024, 1, true);
+  EXPECT_EQ(0u, local.GetLatency());
+  EXPECT_EQ(64u * 1024, local.GetChunkSize());
+}
+
+TEST_F(TestFileCache, ThrottledSource)
+{
+  ThrottledSource(false);
+}
+
+// Timing run, not part of the unit tests. Run it with
+// --gtest_also_run_disabled_tests --gtest_filter=TestFileCache.DISABLED_ThrottledSourceBenchmark
+TEST_F(TestFileCache, DISABLED_ThrottledSourceBenchmark)
+{
+  ThrottledSource(true);
+}
+
+TEST_F(TestFileCache, ParallelRangesSeek)
+{
+  ASSERT_TRUE(m_server.Start(m_data, 4 * 1024 * 1024, 10));
+  g_advancedSettings.m_cacheParallelRanges = 4;
+
+  CFileCache cache(READ_AUDIO_VIDEO);
+  ASSERT_TRUE(cache.Open(CURL(m_server.GetUrl())));
+
+  std::mt19937 rng(1234);
+  char buffer[4096];
+  for (int i = 0; i < 20; i++)
+  {
+    int64_t pos = rng() % (m_data.size() - sizeof(buffer));
+    ASSERT_EQ(pos, cache.Seek(pos, SEEK_SET));
+
+    size_t total = 0;
+    while (total < sizeof(buffer))
+    {
+      ssize_t read = cache.Read(buffer + total, sizeof(buffer) - total);
+      ASSERT_GT(read, 0);
+      total += read;
+    }
+    EXPECT_EQ(0, memcmp(buffer, m_data.data() + pos, sizeof(buffer)));
+  }
+  cache.Close();
+}
+
+TEST_F(TestFileCache, DiskCacheAvoidsRefetch)
+{
+  ASSERT_TRUE(m_server.Start(m_data, 4 * 1024 * 1024, 0));
+  g_advancedSettings.m_cacheDiskSize = 16;
+
+  SCacheStatus first;
+  ReadAll(0, first);
+  EXPECT_GE(m_server.GetBytesServed(), m_data.size());
+  EXPECT_EQ(0.0f, first.diskhitratio);
+
+  CDiskBlockCache& diskCache = CDiskBlockCache::GetInstance();
+  EXPECT_EQ(2u, diskCache.GetStats().blocks);
+  EXPECT_EQ(m_data.size(), diskCache.GetStats().size);
+
+  // reading it again is served from disk
+  m_server.ResetCounters();
+  diskCache.ResetStats();
+  SCacheStatus second;
+  ReadAll(0, second);
+
+  CDiskBlockCache::Stats stats = diskCache.GetStats();
+  EXPECT_LT(m_server.GetBytesServed(), m_data.size() / 4);
+  EXPECT_EQ(1.0f, second.diskhitratio);
+  EXPECT_EQ(m_data.size(), stats.bytesRead);
+  EXPECT_GT(stats.hits, 0u);
+
+  std::cout << "second read: " << m_server.GetBytesServed() << " bytes from the source, disk hits "
+            << stats.hits << ", misses " << stats.misses << ", disk hit ratio " << second.diskhitratio << std::endl;
+}
+
+TEST_F(TestFileCache, DiskCacheResumesPartialFile)
+{
+  ASSERT_TRUE(m_server.Start(m_data, 1024 * 1024, 0));
+  g_advancedSettings.m_cacheDiskSize = 16;
+
+  // stop after the first block is complete, but long before the second one
+  {
+    CFileCache cache(READ_AUDIO_VIDEO);
+    ASSERT_TRUE(cache.Open(CURL(m_server.GetUrl())));
+    char buffer[32 * 1024];
+    size_t total = 0;
+    while (total < DISK_BLOCK_SIZE + 128 * 1024)
+    {
+      ssize_t read = cache.Read(buffer, sizeof(buffer));
+      ASSERT_GT(read, 0);
+      total += read;
+    }
+    cache.Close();
+  }
+  CDiskBlockCache& diskCache = CDiskBlockCache::GetInstance();
+  EXPECT_EQ(1u, diskCache.GetStats().blocks);
+
+  m_server.ResetCounters();
+  SCacheStatus status;
+  ReadAll(0, status);
+  EXPECT_LT(m_server.GetBytesServed(), m_data.size() - DISK_BLOCK_SIZE + 256 * 1024);
+  EXPECT_NEAR(0.5f, status.diskhitratio, 0.01f);
+  EXPECT_EQ(2u, diskCache.GetStats().blocks);
+}
+
+TEST_F(TestFileCache, DiskCacheEvictsLeastRecentlyUsed)
+{
+  CDiskBlockCache& diskCache = CDiskBlockCache::GetInstance();
+  ASSERT_TRUE(diskCache.Initialize("special://temp/blockcachetest/", 3 * DISK_BLOCK_SIZE));
+
+  const std::string key = CDiskBlockCache::GetKey("http://example.com/file.bin", 4 * DISK_BLOCK_SIZE, 0);
+  for (int64_t i = 0; i < 3; i++)
+    ASSERT_TRUE(diskCache.Write(key, i, m_data.data(), DISK_BLOCK_SIZE));
+
+  // block 0 becomes the most recently used one, so block 1 is evicted
+  char buffer[1024];
+  EXPECT_EQ(static_cast<ssize_t>(sizeof(buffer)), diskCache.Read(key, 0, buffer, sizeof(buffer)));
+  ASSERT_TRUE(diskCache.Write(key, 3, m_data.data(), DISK_BLOCK_SIZE));
+  EXPECT_TRUE(diskCache.Contains(key, 0));
+  EXPECT_FALSE(diskCache.Contains(key, 1));
+  EXPECT_TRUE(diskCache.Contains(key, 2));
+  EXPECT_TRUE(diskCache.Contains(key, 3));
+  EXPECT_EQ(1u, diskCache.GetStats().evictions);
+
+  // a new session picks up the stored blocks again
+  diskCache.Deinitialize();
+  ASSERT_TRUE(diskCache.Initialize("special://temp/blockcachetest/", 3 * DISK_BLOCK_SIZE));
+  EXPECT_EQ(3u, diskCache.GetStats().blocks);
+  EXPECT_EQ(static_cast<ssize_t>(sizeof(buffer)), diskCache.Read(key, 2 * DISK_BLOCK_SIZE + 10, buffer, sizeof(buffer)));
+  EXPECT_EQ(0, memcmp(buffer, m_data.data() + 10, sizeof(buffer)));
+  EXPECT_EQ(0, diskCache.Read(key, DISK_BLOCK_SIZE, buffer, sizeof(buffer)));
+}
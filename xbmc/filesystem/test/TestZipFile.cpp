@@ -21,14 +21,19 @@
 #include "ServiceBroker.h"
 #include "filesystem/Directory.h"
 #include "filesystem/File.h"
+#include "filesystem/ZipManager.h"
 #include "utils/StringUtils.h"
 #include "utils/URIUtils.h"
 #include "FileItem.h"
 #include "settings/Settings.h"
 #include "test/TestUtils.h"
+#include "utils/Stopwatch.h"
 #include "URL.h"
 
+#include <algorithm>
 #include <errno.h>
+#include <random>
+#include <zlib.h>
 
 #include "gtest/gtest.h"
 
@@ -59,6 +64,77 @@ protected:
   }
 };
 
+namespace
+{
+void PutLE16(std::string& out, unsigned int value)
+{
+  out += static_cast<char>(value & 0xFF);
+  out += static_cast<char>((value >> 8) & 0xFF);
+}
+
+void PutLE32(std::string& out, unsigned int value)
+{
+  PutLE16(out, value & 0xFFFF);
+  PutLE16(out, value >> 16);
+}
+
+/* Build a zip archive holding a single deflated entry */
+std::string CreateDeflatedZip(const std::string& name, const std::string& data)
+{
+  std::string compressed(compressBound(data.size()), '\0');
+  z_stream stream = {};
+  deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+  stream.next_in = (Bytef*)data.data();
+  stream.avail_in = data.size();
+  stream.next_out = (Bytef*)&compressed[0];
+  stream.avail_out = compressed.size();
+  deflate(&stream, Z_FINISH);
+  compressed.resize(stream.total_out);
+  deflateEnd(&stream);
+  unsigned int crc = crc32(0, (const Bytef*)data.data(), data.size());
+
+  std::string zip;
+  PutLE32(zip, 0x04034b50); // local file header
+  PutLE16(zip, 20);
+  PutLE16(zip, 0);
+  PutLE16(zip, 8);
+  PutLE32(zip, 0);
+  PutLE32(zip, crc);
+  PutLE32(zip, compressed.size());
+  PutLE32(zip, data.size());
+  PutLE16(zip, name.size());
+  PutLE16(zip, 0);
+  zip += name + compressed;
+
+  unsigned int cdirOffset = zip.size();
+  PutLE32(zip, 0x02014b50); // central directory header
+  PutLE16(zip, 20);
+  PutLE16(zip, 20);
+  PutLE16(zip, 0);
+  PutLE16(zip, 8);
+  PutLE32(zip, 0);
+  PutLE32(zip, crc);
+  PutLE32(zip, compressed.size());
+  PutLE32(zip, data.size());
+  PutLE16(zip, name.size());
+  PutLE32(zip, 0);
+  PutLE32(zip, 0);
+  PutLE32(zip, 0);
+  PutLE32(zip, 0);
+  zip += name;
+
+  unsigned int cdirSize = zip.size() - cdirOffset;
+  PutLE32(zip, 0x06054b50); // end of central directory record
+  PutLE32(zip, 0);
+  PutLE16(zip, 1);
+  PutLE16(zip, 1);
+  PutLE32(zip, cdirSize);
+  PutLE32(zip, cdirOffset);
+  PutLE16(zip, 0);
+  return zip;
+}
+}
+
 TEST_F(TestZipFile, Read)
 {
   XFILE::CFile file;
@@ -218,3 +294,67 @@ TEST_F(TestZipFile, CorruptedFile)
   file->Close();
   XBMC_DELETETEMPFILE(file);
 }
+
+namespace
+{
+/* Random access into a large deflated entry. The first seek builds the seek
+ * index, afterwards every seek inflates at most one seek point span.
+ */
+void RandomSeekDeflated(size_t size, int seeks, bool report)
+{
+  const size_t chunk = 4096;
+  std::mt19937 rng(1234);
+  std::string data(size, '\0');
+  for (size_t i = 0; i < size; i++)
+    data[i] = "0123456789abcdef"[rng() % 16];
+
+  XFILE::CFile *file = XBMC_CREATETEMPFILE(".zip");
+  ASSERT_TRUE(file != NULL);
+  std::string zip = CreateDeflatedZip("large.bin", data);
+  ASSERT_EQ(static_cast<ssize_t>(zip.size()), file->Write(zip.data(), zip.size()));
+  file->Close();
+
+  CURL zipUrl = URIUtils::CreateArchivePath("zip", CURL(XBMC_TEMPFILEPATH(file)), "large.bin");
+  XFILE::CFile entry;
+  ASSERT_TRUE(entry.Open(zipUrl));
+  EXPECT_EQ(static_cast<int64_t>(size), entry.GetLength());
+
+  std::string buf(chunk, '\0');
+  CStopWatch watch;
+  watch.StartZero();
+  ASSERT_EQ(static_cast<int64_t>(size - chunk), entry.Seek(-static_cast<int64_t>(chunk), SEEK_END));
+  ASSERT_EQ(static_cast<ssize_t>(chunk), entry.Read(&buf[0], chunk));
+  EXPECT_EQ(0, memcmp(buf.data(), data.data() + size - chunk, chunk));
+  float indexTime = watch.GetElapsedSeconds();
+
+  watch.StartZero();
+  for (int i = 0; i < seeks; i++)
+  {
+    int64_t pos = rng() % (size - chunk);
+    ASSERT_EQ(pos, entry.Seek(pos, SEEK_SET));
+    ASSERT_EQ(static_cast<ssize_t>(chunk), entry.Read(&buf[0], chunk));
+    EXPECT_EQ(0, memcmp(buf.data(), data.data() + pos, chunk));
+  }
+  float seekTime = watch.GetElapsedSeconds();
+  if (report)
+    std::cout << "First seek to end: " << indexTime << "s, " << seeks << " random seeks: "
+              << seekTime << "s (" << seeks / std::max(seekTime, 0.001f) << " seeks/s)" << std::endl;
+
+  entry.Close();
+  g_ZipManager.release(zipUrl.Get());
+  XBMC_DELETETEMPFILE(file);
+}
+}
+
+/* Large enough for a seek index */
+TEST_F(TestZipFile, RandomSeekDeflated)
+{
+  RandomSeekDeflated(3 * ZIP_SEEK_SPAN, 20, false);
+}
+
+// Timing run, not part of the unit tests. Run it with
+// --gtest_also_run_disabled_tests --gtest_filter=TestZipFile.DISABLED_RandomSeekDeflatedBenchmark
+TEST_F(TestZipFile, DISABLED_RandomSeekDeflatedBenchmark)
+{
+  RandomSeekDeflated(16 * 1024 * 1024, 200, true);
+}
@@ -22,6 +22,8 @@
 #include "DDSImage.h"
 #include "XBTF.h"
 #include "utils/log.h"
+#include <climits>
+#include <stdlib.h>
 #include <string.h>
 
 #ifndef NO_XBMC_FILESYSTEM
@@ -31,6 +33,212 @@ using namespace XFILE;
 #include "SimpleFS.h"
 #endif
 
+namespace
+{
+  // DXT blocks store 4x4 pixels, with colours as RGB 5:6:5
+  uint16_t ToRGB565(int r, int g, int b)
+  {
+    return ((r * 31 + 127) / 255) << 11 | ((g * 63 + 127) / 255) << 5 | ((b * 31 + 127) / 255);
+  }
+
+  void FromRGB565(uint16_t color, int *rgb)
+  {
+    rgb[0] = (color >> 11) & 31;
+    rgb[1] = (color >> 5) & 63;
+    rgb[2] = color & 31;
+    rgb[0] = (rgb[0] << 3) | (rgb[0] >> 2);
+    rgb[1] = (rgb[1] << 2) | (rgb[1] >> 4);
+    rgb[2] = (rgb[2] << 3) | (rgb[2] >> 2);
+  }
+
+  void WriteLE(unsigned char *dest, uint64_t value, unsigned int bytes)
+  {
+    for (unsigned int i = 0; i < bytes; i++)
+      dest[i] = (value >> (8 * i)) & 0xff;
+  }
+
+  uint64_t ReadLE(unsigned char const *src, unsigned int bytes)
+  {
+    uint64_t value = 0;
+    for (unsigned int i = 0; i < bytes; i++)
+      value |= (uint64_t)src[i] << (8 * i);
+    return value;
+  }
+
+  void CompressColorBlock(unsigned char const *block, unsigned char *dest)
+  {
+    int minColor[3] = { 255, 255, 255 };
+    int maxColor[3] = { 0, 0, 0 };
+    for (unsigned int i = 0; i < 16; i++)
+    {
+      for (unsigned int c = 0; c < 3; c++)
+      {
+        int value = block[i * 4 + 2 - c];
+        minColor[c] = std::min(minColor[c], value);
+        maxColor[c] = std::max(maxColor[c], value);
+      }
+    }
+
+    // use the diagonal of the bounding box that follows the colours
+    int center[3];
+    for (unsigned int c = 0; c < 3; c++)
+      center[c] = (minColor[c] + maxColor[c]) / 2;
+    int covRB = 0, covGB = 0;
+    for (unsigned int i = 0; i < 16; i++)
+    {
+      int b = block[i * 4] - center[2];
+      covRB += (block[i * 4 + 2] - center[0]) * b;
+      covGB += (block[i * 4 + 1] - center[1]) * b;
+    }
+    if (covRB < 0)
+      std::swap(minColor[0], maxColor[0]);
+    if (covGB < 0)
+      std::swap(minColor[1], maxColor[1]);
+
+    // inset the line a little, as the ends are rarely hit exactly
+    for (unsigned int c = 0; c < 3; c++)
+    {
+      int inset = (maxColor[c] - minColor[c]) / 16;
+      minColor[c] += inset;
+      maxColor[c] -= inset;
+    }
+
+    uint16_t color0 = ToRGB565(maxColor[0], maxColor[1], maxColor[2]);
+    uint16_t color1 = ToRGB565(minColor[0], minColor[1], minColor[2]);
+    if (color0 < color1)
+      std::swap(color0, color1); // color0 > color1 selects the four colour mode
+
+    uint32_t indices = 0;
+    if (color0 != color1)
+    {
+      int palette[4][3];
+      FromRGB565(color0, palette[0]);
+      FromRGB565(color1, palette[1]);
+      for (unsigned int c = 0; c < 3; c++)
+      {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+      }
+      for (unsigned int i = 0; i < 16; i++)
+      {
+        unsigned int best = 0;
+        int bestError = INT_MAX;
+        for (unsigned int j = 0; j < 4; j++)
+        {
+          int error = 0;
+          for (unsigned int c = 0; c < 3; c++)
+          {
+            int diff = block[i * 4 + 2 - c] - palette[j][c];
+            error += diff * diff;
+          }
+          if (error < bestError)
+          {
+            bestError = error;
+            best = j;
+          }
+        }
+        indices |= best << (2 * i);
+      }
+    }
+    WriteLE(dest, color0, 2);
+    WriteLE(dest + 2, color1, 2);
+    WriteLE(dest + 4, indices, 4);
+  }
+
+  void CompressAlphaBlock(unsigned char const *block, unsigned char *dest)
+  {
+    int minAlpha = 255, maxAlpha = 0;
+    for (unsigned int i = 0; i < 16; i++)
+    {
+      minAlpha = std::min(minAlpha, (int)block[i * 4 + 3]);
+      maxAlpha = std::max(maxAlpha, (int)block[i * 4 + 3]);
+    }
+
+    // alpha0 > alpha1 selects 8 levels, otherwise all indices stay at alpha0
+    uint64_t indices = 0;
+    if (maxAlpha > minAlpha)
+    {
+      int palette[8] = { maxAlpha, minAlpha };
+      for (unsigned int j = 2; j < 8; j++)
+        palette[j] = ((8 - j) * maxAlpha + (j - 1) * minAlpha) / 7;
+      for (unsigned int i = 0; i < 16; i++)
+      {
+        unsigned int best = 0;
+        int bestError = INT_MAX;
+        for (unsigned int j = 0; j < 8; j++)
+        {
+          int error = abs(block[i * 4 + 3] - palette[j]);
+          if (error < bestError)
+          {
+            bestError = error;
+            best = j;
+          }
+        }
+        indices |= (uint64_t)best << (3 * i);
+      }
+    }
+    dest[0] = maxAlpha;
+    dest[1] = minAlpha;
+    WriteLE(dest + 2, indices, 6);
+  }
+
+  void DecompressColorBlock(unsigned char const *src, unsigned char *block, bool allowTransparent)
+  {
+    uint16_t color0 = ReadLE(src, 2);
+    uint16_t color1 = ReadLE(src + 2, 2);
+    uint32_t indices = ReadLE(src + 4, 4);
+
+    int palette[4][4];
+    FromRGB565(color0, palette[0]);
+    FromRGB565(color1, palette[1]);
+    palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+    for (unsigned int c = 0; c < 3; c++)
+    {
+      if (color0 > color1 || !allowTransparent)
+      {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+      }
+      else
+      {
+        palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+        palette[3][c] = 0;
+      }
+    }
+    if (color0 <= color1 && allowTransparent)
+      palette[3][3] = 0;
+
+    for (unsigned int i = 0; i < 16; i++)
+    {
+      const int *color = palette[(indices >> (2 * i)) & 3];
+      block[i * 4 + 0] = color[2];
+      block[i * 4 + 1] = color[1];
+      block[i * 4 + 2] = color[0];
+      block[i * 4 + 3] = color[3];
+    }
+  }
+
+  void DecompressAlphaBlock(unsigned char const *src, unsigned char *block)
+  {
+    int palette[8] = { src[0], src[1] };
+    if (palette[0] > palette[1])
+    {
+      for (unsigned int j = 2; j < 8; j++)
+        palette[j] = ((8 - j) * palette[0] + (j - 1) * palette[1]) / 7;
+    }
+    else
+    {
+      for (unsigned int j = 2; j < 6; j++)
+        palette[j] = ((6 - j) * palette[0] + (j - 1) * palette[1]) / 5;
+      palette[6] = 0;
+      palette[7] = 255;
+    }
+    uint64_t indices = ReadLE(src + 2, 6);
+    for (unsigned int i = 0; i < 16; i++)
+      block[i * 4 + 3] = palette[(indices >> (3 * i)) & 7];
+  }
+}
+
 CDDSImage::CDDSImage()
 {
   m_data = NULL;
@@ -115,6 +323,104 @@ bool CDDSImage::ReadFile(const std::string &inputFile)
   return true;
 }
 
+bool CDDSImage::Create(const std::string &outputFile, unsigned int width, unsigned int height, unsigned int pitch,
+                       unsigned char const *bgra, bool hasAlpha)
+{
+  if (!bgra || !width || !height)
+    return false;
+  Compress(width, height, pitch, bgra, hasAlpha);
+  return WriteFile(outputFile);
+}
+
+bool CDDSImage::WriteFile(const std::string &outputFile) const
+{
+  // open the file
+  CFile file;
+  if (!file.OpenForWrite(outputFile, true))
+    return false;
+
+  // write the header
+  file.Write("DDS ", 4);
+  file.Write(&m_desc, sizeof(m_desc));
+  // now the data
+  if (file.Write(m_data, m_desc.linearSize) != m_desc.linearSize)
+  {
+    CLog::Log(LOGERROR, "%s - failed writing %s", __FUNCTION__, outputFile.c_str());
+    return false;
+  }
+  file.Close();
+  return true;
+}
+
+void CDDSImage::Compress(unsigned int width, unsigned int height, unsigned int pitch, unsigned char const *bgra, bool hasAlpha)
+{
+  unsigned int format = hasAlpha ? XB_FMT_DXT5 : XB_FMT_DXT1;
+  Allocate(width, height, format);
+
+  unsigned int blockSize = hasAlpha ? 16 : 8;
+  unsigned char *dest = m_data;
+  unsigned char block[16 * 4];
+  for (unsigned int y = 0; y < height; y += 4)
+  {
+    for (unsigned int x = 0; x < width; x += 4)
+    {
+      // blocks over the edge of the image repeat the last row/column
+      for (unsigned int i = 0; i < 16; i++)
+      {
+        unsigned int px = std::min(x + i % 4, width - 1);
+        unsigned int py = std::min(y + i / 4, height - 1);
+        memcpy(block + i * 4, bgra + py * pitch + px * 4, 4);
+      }
+      if (hasAlpha)
+      {
+        CompressAlphaBlock(block, dest);
+        CompressColorBlock(block, dest + 8);
+      }
+      else
+        CompressColorBlock(block, dest);
+      dest += blockSize;
+    }
+  }
+}
+
+bool CDDSImage::Decompress(unsigned char *bgra, unsigned int width, unsigned int height, unsigned int pitch,
+                           unsigned char const *dxt, unsigned int format)
+{
+  if (format != XB_FMT_DXT1 && format != XB_FMT_DXT3 && format != XB_FMT_DXT5)
+    return false;
+
+  unsigned int blockSize = format == XB_FMT_DXT1 ? 8 : 16;
+  unsigned char block[16 * 4];
+  for (unsigned int y = 0; y < height; y += 4)
+  {
+    for (unsigned int x = 0; x < width; x += 4)
+    {
+      if (format == XB_FMT_DXT1)
+        DecompressColorBlock(dxt, block, true);
+      else
+      {
+        DecompressColorBlock(dxt + 8, block, false);
+        if (format == XB_FMT_DXT5)
+          DecompressAlphaBlock(dxt, block);
+        else
+        {
+          for (unsigned int i = 0; i < 16; i++)
+            block[i * 4 + 3] = ((dxt[i / 2] >> (4 * (i % 2))) & 15) * 17;
+        }
+      }
+      for (unsigned int i = 0; i < 16; i++)
+      {
+        unsigned int px = x + i % 4;
+        unsigned int py = y + i / 4;
+        if (px < width && py < height)
+          memcpy(bgra + py * pitch + px * 4, block + i * 4, 4);
+      }
+      dxt += blockSize;
+    }
+  }
+  return true;
+}
+
 unsigned int CDDSImage::GetStorageRequirements(unsigned int width, unsigned int height, unsigned int format)
 {
   switch (format)
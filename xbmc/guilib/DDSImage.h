@@ -38,6 +38,28 @@ public:
 
   bool ReadFile(const std::string &file);
 
+  /*! \brief Compress an image and write it to a file, see Compress()
+   \param outputFile the .dds file to write
+   \return true if successful, false otherwise
+   */
+  bool Create(const std::string &outputFile, unsigned int width, unsigned int height, unsigned int pitch,
+              unsigned char const *bgra, bool hasAlpha);
+  bool WriteFile(const std::string &outputFile) const;
+
+  /*! \brief Compress an image to DXT1, or DXT5 if it has alpha
+   Blocks are fitted to the bounding box of their colours, which is quick enough to be
+   done while caching images.
+   \param bgra the image in XB_FMT_A8R8G8B8
+   \param hasAlpha whether to keep the alpha channel
+   */
+  void Compress(unsigned int width, unsigned int height, unsigned int pitch, unsigned char const *bgra, bool hasAlpha);
+
+  /*! \brief Decompress DXT1, DXT3 or DXT5 data to XB_FMT_A8R8G8B8
+   \return true if successful, false if the format isn't supported
+   */
+  static bool Decompress(unsigned char *bgra, unsigned int width, unsigned int height, unsigned int pitch,
+                         unsigned char const *dxt, unsigned int format);
+
 private:
   void Allocate(unsigned int width, unsigned int height, unsigned int format);
   static const char *GetFourCC(unsigned int format);
@@ -0,0 +1,114 @@
+/*
+ *      Copyright (C) 2017 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kodi; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "DirtyRegionRecording.h"
+#include "filesystem/File.h"
+#include "utils/auto_buffer.h"
+#include "utils/log.h"
+#include "utils/StringUtils.h"
+
+#include <stdlib.h>
+
+void CDirtyRegionRecording::AddFrame(const CDirtyRegionList &regions)
+{
+  m_frames.push_back(regions);
+}
+
+bool CDirtyRegionRecording::Save(const std::string &file) const
+{
+  XFILE::CFile output;
+  if (!output.OpenForWrite(file, true))
+  {
+    CLog::Log(LOGERROR, "%s - unable to write %s", __FUNCTION__, file.c_str());
+    return false;
+  }
+
+  std::string data = StringUtils::Format("viewport %g %g %g %g\n", m_viewport.x1, m_viewport.y1, m_viewport.x2, m_viewport.y2);
+  for (std::vector<CDirtyRegionList>::const_iterator frame = m_frames.begin(); frame != m_frames.end(); ++frame)
+  {
+    std::string line;
+    for (CDirtyRegionList::const_iterator i = frame->begin(); i != frame->end(); ++i)
+    {
+      if (!line.empty())
+        line += ' ';
+      line += StringUtils::Format("%g %g %g %g", i->x1, i->y1, i->x2, i->y2);
+    }
+    data += line + '\n';
+  }
+
+  return output.Write(data.c_str(), data.size()) == (ssize_t)data.size();
+}
+
+bool CDirtyRegionRecording::Load(const std::string &file)
+{
+  XFILE::CFile input;
+  XUTILS::auto_buffer buffer;
+  if (input.LoadFile(file, buffer) <= 0)
+    return false;
+
+  std::vector<std::string> lines = StringUtils::Split(std::string(buffer.get(), buffer.size()), '\n');
+  if (lines.empty() || !StringUtils::StartsWith(lines[0], "viewport "))
+  {
+    CLog::Log(LOGERROR, "%s - %s is not a dirty region recording", __FUNCTION__, file.c_str());
+    return false;
+  }
+
+  m_frames.clear();
+  for (std::vector<std::string>::const_iterator line = lines.begin(); line != lines.end(); ++line)
+  {
+    // the last frame ends with a newline too
+    if (line + 1 == lines.end() && line->empty())
+      break;
+
+    std::vector<float> values;
+    const char *pos = line->c_str();
+    if (line == lines.begin())
+      pos += 9;
+    while (*pos)
+    {
+      char *end;
+      float value = (float)strtod(pos, &end);
+      if (end == pos)
+        break;
+      values.push_back(value);
+      pos = end;
+    }
+    if (values.size() % 4 != 0)
+    {
+      CLog::Log(LOGERROR, "%s - invalid line %u in %s", __FUNCTION__, (unsigned int)(line - lines.begin() + 1), file.c_str());
+      return false;
+    }
+
+    if (line == lines.begin())
+    {
+      if (values.size() != 4)
+        return false;
+      m_viewport = CRect(values[0], values[1], values[2], values[3]);
+      continue;
+    }
+
+    CDirtyRegionList frame;
+    for (size_t i = 0; i < values.size(); i += 4)
+      frame.push_back(CDirtyRegion(values[i], values[i + 1], values[i + 2], values[i + 3]));
+    m_frames.push_back(frame);
+  }
+
+  return true;
+}
@@ -0,0 +1,53 @@
+/*
+ *      Copyright (C) 2017 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kodi; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "DirtyRegion.h"
+
+/*!
+ \brief Dirty regions marked in each frame, as handed to the dirty region solver.
+
+ Recordings are saved as text: a "viewport left top right bottom" line followed by one line per
+ frame listing "left top right bottom" for each region. They can be replayed offline through the
+ solvers to compare how much each would redraw for a given skin and device.
+ \sa CDirtyRegionTracker::StartRecording
+ */
+class CDirtyRegionRecording
+{
+public:
+  CDirtyRegionRecording() { }
+  explicit CDirtyRegionRecording(const CRect &viewport) : m_viewport(viewport) { }
+
+  void AddFrame(const CDirtyRegionList &regions);
+
+  bool Save(const std::string &file) const;
+  bool Load(const std::string &file);
+
+  const CRect &GetViewport() const { return m_viewport; }
+  const std::vector<CDirtyRegionList> &GetFrames() const { return m_frames; }
+
+private:
+  CRect m_viewport;
+  std::vector<CDirtyRegionList> m_frames;
+};
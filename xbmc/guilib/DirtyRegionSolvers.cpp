@@ -20,6 +20,7 @@
 
 #include "DirtyRegionSolvers.h"
 #include "GraphicContext.h"
+#include <float.h>
 #include <stdio.h>
 
 void CUnionDirtyRegionSolver::Solve(const CDirtyRegionList &input, CDirtyRegionList &output)
@@ -34,20 +35,44 @@ void CUnionDirtyRegionSolver::Solve(const CDirtyRegionList &input, CDirtyRegionL
 
 void CFillViewportAlwaysRegionSolver::Solve(const CDirtyRegionList &input, CDirtyRegionList &output)
 {
-  CDirtyRegion unifiedRegion(g_graphicsContext.GetViewWindow());
+  CDirtyRegion unifiedRegion(m_viewport.IsEmpty() ? g_graphicsContext.GetViewWindow() : m_viewport);
   output.push_back(unifiedRegion);
 }
 
 void CFillViewportOnChangeRegionSolver::Solve(const CDirtyRegionList &input, CDirtyRegionList &output)
 {
   if (!input.empty())
-    output.assign(1,g_graphicsContext.GetViewWindow());
+    output.assign(1, m_viewport.IsEmpty() ? g_graphicsContext.GetViewWindow() : m_viewport);
 }
 
+// until the costs are fitted, a pass costs as much as drawing 1000 pixels
+#define GREEDY_DEFAULT_COST_NEW_REGION 10.0f
+#define GREEDY_DEFAULT_COST_PER_AREA 0.01f
+
 CGreedyDirtyRegionSolver::CGreedyDirtyRegionSolver()
+  : m_model(GREEDY_DEFAULT_COST_NEW_REGION, GREEDY_DEFAULT_COST_PER_AREA)
+{
+  m_costNewRegion = GREEDY_DEFAULT_COST_NEW_REGION;
+  m_costPerArea   = GREEDY_DEFAULT_COST_PER_AREA;
+}
+
+CGreedyDirtyRegionSolver::CGreedyDirtyRegionSolver(float costNewRegion, float costPerArea)
+  : m_model(costNewRegion, costPerArea)
 {
-  m_costNewRegion = 10.0f;
-  m_costPerArea   = 0.01f;
+  m_costNewRegion = costNewRegion;
+  m_costPerArea   = costPerArea;
+}
+
+void CGreedyDirtyRegionSolver::SetCosts(float costNewRegion, float costPerArea)
+{
+  m_costNewRegion = costNewRegion;
+  m_costPerArea   = costPerArea;
+}
+
+void CGreedyDirtyRegionSolver::OnRendered(const CDirtyRegionList &passes, float seconds)
+{
+  if (m_model.OnRendered(passes, seconds))
+    SetCosts(m_model.GetCostPerPass(), m_model.GetCostPerArea());
 }
 
 void CGreedyDirtyRegionSolver::Solve(const CDirtyRegionList &input, CDirtyRegionList &output)
@@ -56,7 +81,7 @@ void CGreedyDirtyRegionSolver::Solve(const CDirtyRegionList &input, CDirtyRegion
   {
     CDirtyRegion possibleUnionRegion;
     int   possibleUnionNbr = -1;
-    float possibleUnionCost = 100000.0f;
+    float possibleUnionCost = FLT_MAX;
 
     CDirtyRegion currentRegion = input[i];
     for (unsigned int j = 0; j < output.size(); j++)
@@ -81,3 +106,114 @@ void CGreedyDirtyRegionSolver::Solve(const CDirtyRegionList &input, CDirtyRegion
       output.push_back(currentRegion);
   }
 }
+
+// minimum number of frames to fit the costs to
+#define COST_MODEL_MIN_SAMPLES 16
+// weight of a measurement is halved after ~35 frames
+#define COST_MODEL_DECAY 0.98
+
+CDirtyRegionCostModel::CDirtyRegionCostModel(float costPerPass, float costPerArea)
+{
+  m_costPerPass   = costPerPass;
+  m_costPerArea   = costPerArea;
+  m_passesPasses  = 0.0;
+  m_passesArea    = 0.0;
+  m_areaArea      = 0.0;
+  m_passesSeconds = 0.0;
+  m_areaSeconds   = 0.0;
+  m_samples       = 0;
+  m_fitted        = false;
+}
+
+bool CDirtyRegionCostModel::OnRendered(const CDirtyRegionList &passes, float seconds)
+{
+  if (passes.empty() || seconds <= 0.0f)
+    return false;
+
+  double count = (double)passes.size();
+  double area = 0.0;
+  for (CDirtyRegionList::const_iterator i = passes.begin(); i != passes.end(); ++i)
+    area += i->Area();
+
+  m_passesPasses  = m_passesPasses  * COST_MODEL_DECAY + count * count;
+  m_passesArea    = m_passesArea    * COST_MODEL_DECAY + count * area;
+  m_areaArea      = m_areaArea      * COST_MODEL_DECAY + area * area;
+  m_passesSeconds = m_passesSeconds * COST_MODEL_DECAY + count * seconds;
+  m_areaSeconds   = m_areaSeconds   * COST_MODEL_DECAY + area * seconds;
+
+  if (++m_samples < COST_MODEL_MIN_SAMPLES)
+    return false;
+
+  // the fit can't tell the costs apart while passes and area keep the same ratio
+  double det = m_passesPasses * m_areaArea - m_passesArea * m_passesArea;
+  m_fitted = det > 0.001 * m_passesPasses * m_areaArea;
+  if (!m_fitted)
+    return false;
+
+  double costPerPass = (m_passesSeconds * m_areaArea - m_areaSeconds * m_passesArea) / det;
+  double costPerArea = (m_areaSeconds * m_passesPasses - m_passesSeconds * m_passesArea) / det;
+  // neither cost can be negative, fall back to fitting the other one alone
+  if (costPerPass < 0.0)
+  {
+    costPerPass = 0.0;
+    costPerArea = m_areaSeconds / m_areaArea;
+  }
+  else if (costPerArea < 0.0)
+  {
+    costPerArea = 0.0;
+    costPerPass = m_passesSeconds / m_passesPasses;
+  }
+  if (costPerPass <= 0.0 && costPerArea <= 0.0)
+    return false;
+
+  m_costPerPass = (float)costPerPass;
+  m_costPerArea = (float)costPerArea;
+  return true;
+}
+
+float CDirtyRegionCostModel::Cost(const CDirtyRegionList &passes) const
+{
+  float cost = m_costPerPass * passes.size();
+  for (CDirtyRegionList::const_iterator i = passes.begin(); i != passes.end(); ++i)
+    cost += m_costPerArea * i->Area();
+  return cost;
+}
+
+// until enough frames are measured, assume a pass costs as much as drawing 1000 pixels like the greedy solver does
+#define ADAPTIVE_DEFAULT_COST_PER_PASS 0.0002f
+#define ADAPTIVE_DEFAULT_COST_PER_AREA 0.0000002f
+// while the costs can't be told apart, render the other solution every so often to get frames that do
+#define ADAPTIVE_EXPLORE_INTERVAL 32
+
+CAdaptiveDirtyRegionSolver::CAdaptiveDirtyRegionSolver()
+  : m_greedy(ADAPTIVE_DEFAULT_COST_PER_PASS, ADAPTIVE_DEFAULT_COST_PER_AREA)
+  , m_model(ADAPTIVE_DEFAULT_COST_PER_PASS, ADAPTIVE_DEFAULT_COST_PER_AREA)
+{
+  m_frames = 0;
+}
+
+void CAdaptiveDirtyRegionSolver::Solve(const CDirtyRegionList &input, CDirtyRegionList &output)
+{
+  CDirtyRegionList unified;
+  m_union.Solve(input, unified);
+  if (unified.empty())
+    return;
+
+  CDirtyRegionList reduced;
+  m_greedy.Solve(input, reduced);
+
+  bool useReduced = reduced.size() > 1 && m_model.Cost(reduced) < m_model.Cost(unified);
+  if (reduced.size() > 1 && !m_model.IsFitted() && ++m_frames % ADAPTIVE_EXPLORE_INTERVAL == 0)
+    useReduced = !useReduced;
+
+  if (useReduced)
+    output.insert(output.end(), reduced.begin(), reduced.end());
+  else
+    output.insert(output.end(), unified.begin(), unified.end());
+}
+
+void CAdaptiveDirtyRegionSolver::OnRendered(const CDirtyRegionList &passes, float seconds)
+{
+  if (m_model.OnRendered(passes, seconds))
+    m_greedy.SetCosts(m_model.GetCostPerPass(), m_model.GetCostPerArea());
+}
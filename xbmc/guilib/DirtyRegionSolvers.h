@@ -30,21 +30,97 @@ public:
 class CFillViewportAlwaysRegionSolver : public IDirtyRegionSolver
 {
 public:
+  // fills the given viewport, or the view window of the graphics context if it is empty
+  CFillViewportAlwaysRegionSolver(const CRect &viewport = CRect()) : m_viewport(viewport) { }
   virtual void Solve(const CDirtyRegionList &input, CDirtyRegionList &output);
+private:
+  CRect m_viewport;
 };
 
 class CFillViewportOnChangeRegionSolver : public IDirtyRegionSolver
 {
 public:
+  // fills the given viewport, or the view window of the graphics context if it is empty
+  CFillViewportOnChangeRegionSolver(const CRect &viewport = CRect()) : m_viewport(viewport) { }
   virtual void Solve(const CDirtyRegionList &input, CDirtyRegionList &output);
+private:
+  CRect m_viewport;
+};
+
+/*!
+ \brief Fits the render time of a frame to costPerPass * passes + costPerArea * pixels.
+
+ The costs are fitted to the render times reported through OnRendered(), recent frames weighing the
+ most, so they follow the fill-rate and per-draw overhead of the device and skin it runs on.
+ */
+class CDirtyRegionCostModel
+{
+public:
+  CDirtyRegionCostModel(float costPerPass, float costPerArea);
+
+  // Adds the render time of a frame, returns true if the costs were fitted again.
+  bool OnRendered(const CDirtyRegionList &passes, float seconds);
+
+  // Whether the recent frames tell the two costs apart.
+  bool IsFitted() const { return m_fitted; }
+  float GetCostPerPass() const { return m_costPerPass; }
+  float GetCostPerArea() const { return m_costPerArea; }
+  float Cost(const CDirtyRegionList &passes) const;
+private:
+  float m_costPerPass;
+  float m_costPerArea;
+
+  // sums for the least squares fit of seconds = costPerPass * passes + costPerArea * area
+  double m_passesPasses;
+  double m_passesArea;
+  double m_areaArea;
+  double m_passesSeconds;
+  double m_areaSeconds;
+  unsigned int m_samples;
+  bool m_fitted;
 };
 
+/*!
+ \brief Merges regions while that costs less than rendering them in passes of their own.
+
+ Starts from fixed costs, and switches to the costs fitted to the render times reported through
+ OnRendered() once they can be told apart.
+ */
 class CGreedyDirtyRegionSolver : public IDirtyRegionSolver
 {
 public:
   CGreedyDirtyRegionSolver();
+  CGreedyDirtyRegionSolver(float costNewRegion, float costPerArea);
   virtual void Solve(const CDirtyRegionList &input, CDirtyRegionList &output);
+  virtual void OnRendered(const CDirtyRegionList &passes, float seconds);
+
+  void SetCosts(float costNewRegion, float costPerArea);
+  float GetCostNewRegion() const { return m_costNewRegion; }
+  float GetCostPerArea() const { return m_costPerArea; }
 private:
   float m_costNewRegion;
   float m_costPerArea;
+  CDirtyRegionCostModel m_model;
+};
+
+/*!
+ \brief Picks the cheapest of the union and cost reduction solutions for each frame.
+
+ The cost of each solution is given by a CDirtyRegionCostModel, which also gives the costs of the
+ cost reduction solver once fitted.
+ */
+class CAdaptiveDirtyRegionSolver : public IDirtyRegionSolver
+{
+public:
+  CAdaptiveDirtyRegionSolver();
+  virtual void Solve(const CDirtyRegionList &input, CDirtyRegionList &output);
+  virtual void OnRendered(const CDirtyRegionList &passes, float seconds);
+
+  float GetCostPerPass() const { return m_model.GetCostPerPass(); }
+  float GetCostPerArea() const { return m_model.GetCostPerArea(); }
+private:
+  CUnionDirtyRegionSolver m_union;
+  CGreedyDirtyRegionSolver m_greedy;
+  CDirtyRegionCostModel m_model;
+  unsigned int m_frames;
 };
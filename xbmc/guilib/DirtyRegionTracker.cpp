@@ -23,16 +23,19 @@
 #include "utils/log.h"
 #include <stdio.h>
 #include "DirtyRegionSolvers.h"
+#include "DirtyRegionRecording.h"
 
 CDirtyRegionTracker::CDirtyRegionTracker(int buffering)
 {
   m_buffering = buffering;
   m_solver = NULL;
+  m_recording = NULL;
 }
 
 CDirtyRegionTracker::~CDirtyRegionTracker()
 {
   delete m_solver;
+  delete m_recording;
 }
 
 void CDirtyRegionTracker::SelectAlgorithm()
@@ -53,6 +56,10 @@ void CDirtyRegionTracker::SelectAlgorithm()
       m_solver = new CUnionDirtyRegionSolver();
       CLog::Log(LOGDEBUG, "guilib: Union as algorithm for solving rendering passes");
       break;
+    case DIRTYREGION_SOLVER_ADAPTIVE:
+      CLog::Log(LOGDEBUG, "guilib: Adaptive union or cost reduction for solving rendering passes");
+      m_solver = new CAdaptiveDirtyRegionSolver();
+      break;
     case DIRTYREGION_SOLVER_FILL_VIEWPORT_ALWAYS:
     default:
       CLog::Log(LOGDEBUG, "guilib: Fill viewport always for solving rendering passes");
@@ -84,6 +91,9 @@ CDirtyRegionList CDirtyRegionTracker::GetDirtyRegions()
 
 void CDirtyRegionTracker::CleanMarkedRegions()
 {
+  if (m_recording)
+    m_recording->AddFrame(m_markedRegions);
+
   int buffering = g_advancedSettings.m_guiVisualizeDirtyRegions ? 20 : m_buffering;
   int i = m_markedRegions.size() - 1;
   while (i >= 0)
@@ -94,3 +104,30 @@ void CDirtyRegionTracker::CleanMarkedRegions()
     i--;
   }
 }
+
+void CDirtyRegionTracker::OnRendered(const CDirtyRegionList &passes, float seconds)
+{
+  if (m_solver)
+    m_solver->OnRendered(passes, seconds);
+}
+
+void CDirtyRegionTracker::StartRecording(const CRect &viewport)
+{
+  delete m_recording;
+  m_recording = new CDirtyRegionRecording(viewport);
+  CLog::Log(LOGNOTICE, "guilib: Recording dirty regions");
+}
+
+bool CDirtyRegionTracker::StopRecording(const std::string &file)
+{
+  if (!m_recording)
+    return false;
+
+  bool saved = m_recording->Save(file);
+  if (saved)
+    CLog::Log(LOGNOTICE, "guilib: Saved %u frames of dirty regions to %s", (unsigned int)m_recording->GetFrames().size(), file.c_str());
+
+  delete m_recording;
+  m_recording = NULL;
+  return saved;
+}
@@ -21,12 +21,16 @@
 
 #include "IDirtyRegionSolver.h"
 
+#include <string>
+
 #if defined(TARGET_DARWIN_IOS)
 #define DEFAULT_BUFFERING 4
 #else
 #define DEFAULT_BUFFERING 3
 #endif
 
+class CDirtyRegionRecording;
+
 class CDirtyRegionTracker
 {
 public:
@@ -39,8 +43,25 @@ public:
   CDirtyRegionList GetDirtyRegions();
   void CleanMarkedRegions();
 
+  /*! \brief Report the time taken to render the regions returned by GetDirtyRegions() to the solver.
+   */
+  void OnRendered(const CDirtyRegionList &passes, float seconds);
+
+  /*! \brief Start recording the regions marked in each frame
+   \param viewport the area rendered to, used by solvers that fill the viewport
+   \sa CDirtyRegionRecording
+   */
+  void StartRecording(const CRect &viewport);
+  /*! \brief Stop recording and save the recorded frames
+   \param file where to save the recording
+   \return true if the recording was saved, false otherwise
+   */
+  bool StopRecording(const std::string &file);
+  bool IsRecording() const { return m_recording != NULL; }
+
 private:
   CDirtyRegionList m_markedRegions;
   int m_buffering;
   IDirtyRegionSolver *m_solver;
+  CDirtyRegionRecording *m_recording;
 };
@@ -0,0 +1,170 @@
+/*
+ *      Copyright (C) 2017 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kodi; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "GUIFontGlyphAtlas.h"
+
+#include <algorithm>
+
+const unsigned int CGUIFontGlyphAtlas::NO_SLOT;
+
+CGUIFontGlyphAtlas::Stats CGUIFontGlyphAtlas::m_totals = { 0, 0, 0, 0 };
+
+CGUIFontGlyphAtlas::CGUIFontGlyphAtlas()
+{
+  m_width = 0;
+  m_maxHeight = 0;
+  m_usedHeight = 0;
+  m_pass = 0;
+  m_stats.bytes = m_stats.hits = m_stats.misses = m_stats.evictions = 0;
+}
+
+CGUIFontGlyphAtlas::~CGUIFontGlyphAtlas()
+{
+  SetTextureSize(0, 0);
+}
+
+void CGUIFontGlyphAtlas::Reset(unsigned int width, unsigned int maxHeight)
+{
+  m_width = width;
+  m_maxHeight = maxHeight;
+  m_usedHeight = 0;
+  m_slots.clear();
+  m_skyline.clear();
+  Segment segment = { 0, 0, width };
+  m_skyline.push_back(segment);
+}
+
+bool CGUIFontGlyphAtlas::Fit(unsigned int index, unsigned int width, unsigned int &y) const
+{
+  if (m_skyline[index].x + width > m_width)
+    return false;
+
+  // the glyph has to sit on the highest segment it spans
+  y = 0;
+  unsigned int remaining = width;
+  for (unsigned int i = index; remaining > 0 && i < m_skyline.size(); i++)
+  {
+    y = std::max(y, m_skyline[i].y);
+    remaining -= std::min(remaining, m_skyline[i].width);
+  }
+  return true;
+}
+
+bool CGUIFontGlyphAtlas::Allocate(unsigned int width, unsigned int height, unsigned int &slot)
+{
+  if (width == 0 || height == 0 || width > m_width)
+    return false;
+
+  // bottom-left rule: lowest resulting top edge, then the narrowest segment to keep wide ones free
+  unsigned int bestIndex = m_skyline.size();
+  unsigned int bestBottom = m_maxHeight + 1;
+  unsigned int bestWidth = 0;
+  unsigned int bestY = 0;
+  for (unsigned int i = 0; i < m_skyline.size(); i++)
+  {
+    unsigned int y;
+    if (!Fit(i, width, y) || y + height > m_maxHeight)
+      continue;
+    if (y + height < bestBottom || (y + height == bestBottom && m_skyline[i].width < bestWidth))
+    {
+      bestIndex = i;
+      bestBottom = y + height;
+      bestWidth = m_skyline[i].width;
+      bestY = y;
+    }
+  }
+  if (bestIndex == m_skyline.size())
+    return false;
+
+  Slot newSlot = { m_skyline[bestIndex].x, bestY, width, height, m_pass, 0 };
+  AddSegment(bestIndex, newSlot.x, bestBottom, width);
+  m_usedHeight = std::max(m_usedHeight, bestBottom);
+
+  slot = m_slots.size();
+  m_slots.push_back(newSlot);
+  return true;
+}
+
+void CGUIFontGlyphAtlas::AddSegment(unsigned int index, unsigned int x, unsigned int y, unsigned int width)
+{
+  Segment segment = { x, y, width };
+  m_skyline.insert(m_skyline.begin() + index, segment);
+
+  // shrink or remove the segments now covered by the new one
+  for (unsigned int i = index + 1; i < m_skyline.size();)
+  {
+    const Segment &previous = m_skyline[i - 1];
+    unsigned int end = previous.x + previous.width;
+    if (m_skyline[i].x >= end)
+      break;
+    unsigned int overlap = end - m_skyline[i].x;
+    if (m_skyline[i].width <= overlap)
+    {
+      m_skyline.erase(m_skyline.begin() + i);
+      continue;
+    }
+    m_skyline[i].x += overlap;
+    m_skyline[i].width -= overlap;
+    break;
+  }
+
+  // merge neighbours at the same height
+  for (unsigned int i = 1; i < m_skyline.size();)
+  {
+    if (m_skyline[i - 1].y == m_skyline[i].y)
+    {
+      m_skyline[i - 1].width += m_skyline[i].width;
+      m_skyline.erase(m_skyline.begin() + i);
+    }
+    else
+      i++;
+  }
+}
+
+bool CGUIFontGlyphAtlas::Evict(unsigned int width, unsigned int height, unsigned int &slot)
+{
+  unsigned int best = NO_SLOT;
+  for (unsigned int i = 0; i < m_slots.size(); i++)
+  {
+    const Slot &candidate = m_slots[i];
+    if (candidate.lastUsed >= m_pass || candidate.width < width || candidate.height < height)
+      continue;
+    if (best == NO_SLOT || candidate.lastUsed < m_slots[best].lastUsed ||
+        (candidate.lastUsed == m_slots[best].lastUsed &&
+         candidate.width * candidate.height < m_slots[best].width * m_slots[best].height))
+      best = i;
+  }
+  if (best == NO_SLOT)
+    return false;
+
+  m_slots[best].lastUsed = m_pass;
+  m_stats.evictions++;
+  m_totals.evictions++;
+  slot = best;
+  return true;
+}
+
+void CGUIFontGlyphAtlas::SetTextureSize(unsigned int width, unsigned int height)
+{
+  uint64_t bytes = (uint64_t)width * height; // 8bit alpha
+  m_totals.bytes -= m_stats.bytes;
+  m_totals.bytes += bytes;
+  m_stats.bytes = bytes;
+}
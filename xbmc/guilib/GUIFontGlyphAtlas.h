@@ -0,0 +1,140 @@
+/*
+ *      Copyright (C) 2017 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kodi; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+/*!
+ \ingroup textures
+ \brief Allocates glyph slots in a font's cache texture.
+
+ Slots are packed with a skyline: the atlas keeps the top edge of the allocated area as a list of
+ horizontal segments and places each glyph as low as it fits, so glyphs of different heights and
+ styles fill the texture without the gaps of fixed line heights. The texture grows downwards up to
+ a maximum height. Once that is reached, the least recently used slot that is big enough is handed
+ out again instead of throwing away the whole cache.
+ */
+class CGUIFontGlyphAtlas
+{
+public:
+  struct Slot
+  {
+    unsigned int x, y;
+    unsigned int width, height;
+    unsigned int lastUsed;   ///< pass the slot was last drawn in
+    uint32_t owner;          ///< letter and style of the glyph in the slot
+  };
+
+  struct Stats
+  {
+    uint64_t bytes;          ///< texture memory of the atlases
+    uint64_t hits;           ///< glyph lookups served from the cache
+    uint64_t misses;         ///< glyphs that had to be rendered
+    uint64_t evictions;      ///< slots reused for another glyph
+  };
+
+  static const unsigned int NO_SLOT = ~0U; ///< used for glyphs without pixels
+
+  CGUIFontGlyphAtlas();
+  ~CGUIFontGlyphAtlas();
+
+  /*! \brief Drop all slots and start over with an empty texture
+   \param width the width of the texture
+   \param maxHeight the height the texture may grow to
+   */
+  void Reset(unsigned int width, unsigned int maxHeight);
+
+  /*! \brief Place a glyph in the free area of the texture
+   \param width the width of the slot
+   \param height the height of the slot
+   \param slot [out] the index of the new slot
+   \return false if the texture can't grow to fit it
+   */
+  bool Allocate(unsigned int width, unsigned int height, unsigned int &slot);
+
+  /*! \brief Reuse the least recently used slot that fits a glyph. Slots used in the current pass are kept.
+   \param width the width of the glyph
+   \param height the height of the glyph
+   \param slot [out] the index of the reused slot. Its owner is still the glyph it is taken from.
+   \return false if no slot can be reused
+   */
+  bool Evict(unsigned int width, unsigned int height, unsigned int &slot);
+
+  /*! \brief Start a new pass of drawing. Glyphs touched from now on are protected from eviction.
+   */
+  void BeginPass() { m_pass++; }
+
+  /*! \brief Mark a cached glyph as drawn in the current pass
+   */
+  void Touch(unsigned int slot)
+  {
+    if (slot != NO_SLOT)
+      m_slots[slot].lastUsed = m_pass;
+    m_stats.hits++;
+    m_totals.hits++;
+  }
+
+  /*! \brief Count a glyph that wasn't cached yet
+   */
+  void CountMiss()
+  {
+    m_stats.misses++;
+    m_totals.misses++;
+  }
+
+  void SetOwner(unsigned int slot, uint32_t owner) { m_slots[slot].owner = owner; }
+  const Slot &GetSlot(unsigned int slot) const { return m_slots[slot]; }
+  unsigned int GetNumSlots() const { return m_slots.size(); }
+
+  /*! \brief The height of the texture needed to hold all slots
+   */
+  unsigned int GetUsedHeight() const { return m_usedHeight; }
+
+  /*! \brief Account for the texture backing this atlas
+   */
+  void SetTextureSize(unsigned int width, unsigned int height);
+
+  const Stats &GetStats() const { return m_stats; }
+
+  /*! \brief The statistics summed over all atlases
+   */
+  static const Stats &GetTotals() { return m_totals; }
+
+private:
+  struct Segment
+  {
+    unsigned int x, y, width;
+  };
+
+  bool Fit(unsigned int index, unsigned int width, unsigned int &y) const;
+  void AddSegment(unsigned int index, unsigned int x, unsigned int y, unsigned int width);
+
+  std::vector<Segment> m_skyline;
+  std::vector<Slot> m_slots;
+  unsigned int m_width;
+  unsigned int m_maxHeight;
+  unsigned int m_usedHeight;
+  unsigned int m_pass;
+  Stats m_stats;
+
+  static Stats m_totals;
+};
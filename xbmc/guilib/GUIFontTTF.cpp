@@ -24,13 +24,16 @@
 #include "Texture.h"
 #include "GraphicContext.h"
 #include "filesystem/SpecialProtocol.h"
+#include "utils/FrameTracer.h"
 #include "utils/MathUtils.h"
+#include "utils/StringUtils.h"
 #include "utils/log.h"
 #include "windowing/WindowingFactory.h"
 #include "URL.h"
 #include "filesystem/File.h"
 #include "threads/SystemClock.h"
 
+#include <map>
 #include <math.h>
 #include <memory>
 #include <queue>
@@ -66,11 +69,82 @@ public:
 
   virtual ~CFreeTypeLibrary()
   {
+    for (std::map<std::string, std::unique_ptr<CSharedFace> >::iterator it = m_faces.begin(); it != m_faces.end(); ++it)
+      FT_Done_Face(it->second->face);
+    m_faces.clear();
     if (m_library)
       FT_Done_FreeType(m_library);
   }
 
-  FT_Face GetFont(const std::string &filename, float size, float aspect, XUTILS::auto_buffer& memoryBuf)
+  /*! \brief Get the face of a font file at the given size.
+   Fonts of the same file and size, like the bordered variant of a font, share the face
+   and the copy of the file held in memory.
+   */
+  FT_Face GetFont(const std::string &filename, float size, float aspect)
+  {
+    std::string key = StringUtils::Format("%s_%f_%f", filename.c_str(), size, aspect);
+    std::map<std::string, std::unique_ptr<CSharedFace> >::iterator it = m_faces.find(key);
+    if (it != m_faces.end())
+    {
+      it->second->references++;
+      return it->second->face;
+    }
+
+    std::unique_ptr<CSharedFace> shared(new CSharedFace);
+    shared->face = LoadFont(filename, size, aspect, shared->memory);
+    if (!shared->face)
+      return NULL;
+    shared->references = 1;
+    FT_Face face = shared->face;
+    m_faces[key] = std::move(shared);
+    return face;
+  }
+
+  FT_Stroker GetStroker()
+  {
+    if (!m_library)
+      return NULL;
+
+    FT_Stroker stroker;
+    if (FT_Stroker_New(m_library, &stroker))
+      return NULL;
+
+    return stroker;
+  };
+
+  void ReleaseFont(FT_Face face)
+  {
+    assert(face);
+    for (std::map<std::string, std::unique_ptr<CSharedFace> >::iterator it = m_faces.begin(); it != m_faces.end(); ++it)
+    {
+      if (it->second->face == face)
+      {
+        if (--it->second->references == 0)
+        {
+          FT_Done_Face(face);
+          m_faces.erase(it);
+        }
+        return;
+      }
+    }
+    FT_Done_Face(face);
+  };
+  
+  static void ReleaseStroker(FT_Stroker stroker)
+  {
+    assert(stroker);
+    FT_Stroker_Done(stroker);
+  }
+
+private:
+  struct CSharedFace
+  {
+    FT_Face face;
+    unsigned int references;
+    XUTILS::auto_buffer memory; // used only in some cases, see LoadFont()
+  };
+
+  FT_Face LoadFont(const std::string &filename, float size, float aspect, XUTILS::auto_buffer& memoryBuf)
   {
     // don't have it yet - create it
     if (!m_library)
@@ -122,33 +196,9 @@ public:
 
     return face;
   };
-  
-  FT_Stroker GetStroker()
-  {
-    if (!m_library)
-      return NULL;
-
-    FT_Stroker stroker;
-    if (FT_Stroker_New(m_library, &stroker))
-      return NULL;
-
-    return stroker;
-  };
 
-  static void ReleaseFont(FT_Face face)
-  {
-    assert(face);
-    FT_Done_Face(face);
-  };
-  
-  static void ReleaseStroker(FT_Stroker stroker)
-  {
-    assert(stroker);
-    FT_Stroker_Done(stroker);
-  }
-
-private:
   FT_Library   m_library;
+  std::map<std::string, std::unique_ptr<CSharedFace> > m_faces;
 };
 
 XBMC_GLOBAL_REF(CFreeTypeLibrary, g_freeTypeLibrary); // our freetype library
@@ -171,7 +221,7 @@ CGUIFontTTFBase::CGUIFontTTFBase(const std::string& strFileName) : m_staticCache
   m_originX = m_originY = 0.0f;
   m_cellBaseLine = m_cellHeight = 0;
   m_numChars = 0;
-  m_posX = m_posY = 0;
+  m_slotsReused = false;
   m_textureHeight = m_textureWidth = 0;
   m_textureScaleX = m_textureScaleY = 0.0;
   m_ellipsesWidth = m_height = 0.0f;
@@ -210,9 +260,9 @@ void CGUIFontTTFBase::ClearCharacterCache()
   memset(m_charquick, 0, sizeof(m_charquick));
   m_numChars = 0;
   m_maxChars = CHAR_CHUNK;
-  // set the posX and posY so that our texture will be created on first character write.
-  m_posX = m_textureWidth;
-  m_posY = -(int)GetTextureLineHeight();
+  // our texture will be created on first character write.
+  m_atlas.Reset(m_textureWidth, g_Windowing.GetMaxTextureSize());
+  m_atlas.SetTextureSize(0, 0);
   m_textureHeight = 0;
 }
 
@@ -225,8 +275,9 @@ void CGUIFontTTFBase::Clear()
   m_char = NULL;
   m_maxChars = 0;
   m_numChars = 0;
-  m_posX = 0;
-  m_posY = 0;
+  m_atlas.Reset(0, 0);
+  m_atlas.SetTextureSize(0, 0);
+  m_slotsReused = false;
   m_nestedBeginCount = 0;
 
   if (m_face)
@@ -240,14 +291,13 @@ void CGUIFontTTFBase::Clear()
   m_vertex.clear();
 
   m_strFileName.clear();
-  m_fontFileInMemory.clear();
 }
 
 bool CGUIFontTTFBase::Load(const std::string& strFilename, float height, float aspect, float lineSpacing, bool border)
 {
   // we now know that this object is unique - only the GUIFont objects are non-unique, so no need
   // for reference tracking these fonts
-  m_face = g_freeTypeLibrary.GetFont(strFilename, height, aspect, m_fontFileInMemory);
+  m_face = g_freeTypeLibrary.GetFont(strFilename, height, aspect);
 
   if (!m_face)
     return false;
@@ -320,9 +370,9 @@ bool CGUIFontTTFBase::Load(const std::string& strFilename, float height, float a
     m_textureWidth = g_Windowing.GetMaxTextureSize();
   m_textureScaleX = 1.0f / m_textureWidth;
 
-  // set the posX and posY so that our texture will be created on first character write.
-  m_posX = m_textureWidth;
-  m_posY = -(int)GetTextureLineHeight();
+  // our texture will be created on first character write.
+  m_atlas.Reset(m_textureWidth, g_Windowing.GetMaxTextureSize());
+  m_atlas.SetTextureSize(0, 0);
 
   // cache the ellipses width
   Character *ellipse = GetCharacter(L'.');
@@ -357,6 +407,15 @@ void CGUIFontTTFBase::DrawTextInternal(float x, float y, const vecColors &colors
 {
   Begin();
 
+  // glyphs used by this text are kept in the texture while it is laid out
+  m_atlas.BeginPass();
+  if (m_slotsReused)
+  { // cached text may refer to glyphs whose slots have been handed to others since
+    m_staticCache.Flush();
+    m_dynamicCache.Flush();
+    m_slotsReused = false;
+  }
+
   uint32_t rawAlignment = alignment;
   bool dirtyCache(false);
   bool hardwareClipping = g_Windowing.ScissorsCanEffectClipping();
@@ -612,27 +671,46 @@ CGUIFontTTFBase::Character* CGUIFontTTFBase::GetCharacter(character_t chr)
     return NULL;
 
   // quick access to ascii chars
+  Character *cached = NULL;
   if (letter < 255)
   {
     character_t ch = (style << 8) | letter;
-    if (ch < LOOKUPTABLE_SIZE && m_charquick[ch])
-      return m_charquick[ch];
+    if (ch < LOOKUPTABLE_SIZE)
+      cached = m_charquick[ch];
   }
 
   // letters are stored based on style and letter
   character_t ch = (style << 16) | letter;
 
   int low = 0;
-  int high = m_numChars - 1;
-  while (low <= high)
+  if (!cached)
   {
-    int mid = (low + high) >> 1;
-    if (ch > m_char[mid].letterAndStyle)
-      low = mid + 1;
-    else if (ch < m_char[mid].letterAndStyle)
-      high = mid - 1;
-    else
-      return &m_char[mid];
+    int high = m_numChars - 1;
+    while (low <= high)
+    {
+      int mid = (low + high) >> 1;
+      if (ch > m_char[mid].letterAndStyle)
+        low = mid + 1;
+      else if (ch < m_char[mid].letterAndStyle)
+        high = mid - 1;
+      else
+      {
+        cached = &m_char[mid];
+        break;
+      }
+    }
+  }
+  if (cached)
+  {
+    if (cached->slot == CGUIFontGlyphAtlas::NO_SLOT || m_atlas.GetSlot(cached->slot).owner == cached->letterAndStyle)
+    {
+      m_atlas.Touch(cached->slot);
+      return cached;
+    }
+    // its slot has been handed to another glyph - drop it and render it again
+    low = cached - m_char;
+    m_numChars--;
+    memmove(m_char + low, m_char + low + 1, (m_numChars - low) * sizeof(Character));
   }
   // if we get to here, then low is where we should insert the new character
 
@@ -691,6 +769,7 @@ CGUIFontTTFBase::Character* CGUIFontTTFBase::GetCharacter(character_t chr)
 
 bool CGUIFontTTFBase::CacheCharacter(wchar_t letter, uint32_t style, Character *ch)
 {
+  TRACE_ZONE("CGUIFontTTF::CacheCharacter");
   int glyph_index = FT_Get_Char_Index( m_face, letter );
 
   FT_Glyph glyph = NULL;
@@ -726,41 +805,41 @@ bool CGUIFontTTFBase::CacheCharacter(wchar_t letter, uint32_t style, Character *
   FT_Bitmap bitmap = bitGlyph->bitmap;
   bool isEmptyGlyph = (bitmap.width == 0 || bitmap.rows == 0);
 
+  unsigned int slot = CGUIFontGlyphAtlas::NO_SLOT;
+  bool reused = false;
   if (!isEmptyGlyph)
   {
-    if (bitGlyph->left < 0)
-      m_posX += -bitGlyph->left;
-
-    // check we have enough room for the character
-    if ((m_posX + bitGlyph->left + bitmap.width) > static_cast<int>(m_textureWidth))
-    { // no space - gotta drop to the next line (which means creating a new texture and copying it across)
-      m_posX = 0;
-      m_posY += GetTextureLineHeight();
-      if (bitGlyph->left < 0)
-        m_posX += -bitGlyph->left;
-
-      if(m_posY + GetTextureLineHeight() >= m_textureHeight)
+    // leave a gap to the next glyphs so they don't bleed into each other when filtered
+    unsigned int width = bitmap.width + spacing_between_characters_in_texture;
+    unsigned int height = bitmap.rows + spacing_between_characters_in_texture;
+    if (!m_atlas.Allocate(width, height, slot))
+    { // the texture can't grow any further - take the slot of a glyph that hasn't been drawn for the longest time
+      if (!m_atlas.Evict(width, height, slot))
       {
-        // create the new larger texture
-        unsigned int newHeight = m_posY + GetTextureLineHeight();
-        // check for max height
-        if (newHeight > g_Windowing.GetMaxTextureSize())
-        {
-          CLog::Log(LOGDEBUG, "%s: New cache texture is too large (%u > %u pixels long)", __FUNCTION__, newHeight, g_Windowing.GetMaxTextureSize());
-          FT_Done_Glyph(glyph);
-          return false;
-        }
+        CLog::Log(LOGDEBUG, "%s: No slot left for a %ux%u glyph in cache texture of %u pixels", __FUNCTION__, width, height, m_textureHeight);
+        FT_Done_Glyph(glyph);
+        return false;
+      }
+      reused = true;
+      m_slotsReused = true;
+    }
 
-        CBaseTexture* newTexture = NULL;
-        newTexture = ReallocTexture(newHeight);
-        if(newTexture == NULL)
-        {
-          FT_Done_Glyph(glyph);
-          CLog::Log(LOGDEBUG, "%s: Failed to allocate new texture of height %u", __FUNCTION__, newHeight);
-          return false;
-        }
-        m_texture = newTexture;
+    if (m_atlas.GetUsedHeight() > m_textureHeight)
+    {
+      // create the new larger texture, growing by at least a line of text
+      unsigned int newHeight = std::max(m_atlas.GetUsedHeight(), m_textureHeight + GetTextureLineHeight());
+      newHeight = std::min(newHeight, g_Windowing.GetMaxTextureSize());
+
+      CBaseTexture* newTexture = NULL;
+      newTexture = ReallocTexture(newHeight);
+      if(newTexture == NULL)
+      {
+        FT_Done_Glyph(glyph);
+        CLog::Log(LOGDEBUG, "%s: Failed to allocate new texture of height %u", __FUNCTION__, newHeight);
+        return false;
       }
+      m_texture = newTexture;
+      m_atlas.SetTextureSize(m_textureWidth, m_textureHeight);
     }
 
     if(m_texture == NULL)
@@ -774,23 +853,33 @@ bool CGUIFontTTFBase::CacheCharacter(wchar_t letter, uint32_t style, Character *
   ch->letterAndStyle = (style << 16) | letter;
   ch->offsetX = (short)bitGlyph->left;
   ch->offsetY = (short)m_cellBaseLine - bitGlyph->top;
-  ch->left = isEmptyGlyph ? 0 : ((float)m_posX + ch->offsetX);
-  ch->top = isEmptyGlyph ? 0 : ((float)m_posY + ch->offsetY);
+  ch->left = isEmptyGlyph ? 0 : (float)m_atlas.GetSlot(slot).x;
+  ch->top = isEmptyGlyph ? 0 : (float)m_atlas.GetSlot(slot).y;
   ch->right = ch->left + bitmap.width;
   ch->bottom = ch->top + bitmap.rows;
   ch->advance = (float)MathUtils::round_int( (float)m_face->glyph->advance.x / 64 );
+  ch->slot = slot;
+  m_atlas.CountMiss();
 
   // we need only render if we actually have some pixels
   if (!isEmptyGlyph)
   {
-    // ensure our rect will stay inside the texture (it *should* but we need to be certain)
-    unsigned int x1 = std::max(m_posX + ch->offsetX, 0);
-    unsigned int y1 = std::max(m_posY + ch->offsetY, 0);
-    unsigned int x2 = std::min(x1 + bitmap.width, m_textureWidth);
-    unsigned int y2 = std::min(y1 + bitmap.rows, m_textureHeight);
-    CopyCharToTexture(bitGlyph, x1, y1, x2, y2);
-  
-    m_posX += spacing_between_characters_in_texture + (unsigned short)std::max(ch->right - ch->left + ch->offsetX, ch->advance);
+    const CGUIFontGlyphAtlas::Slot &place = m_atlas.GetSlot(slot);
+    m_atlas.SetOwner(slot, ch->letterAndStyle);
+    if (reused)
+    { // overwrite the whole slot so nothing of the previous glyph is left around this one
+      std::vector<unsigned char> cleared(place.width * place.height);
+      for (unsigned int y = 0; y < bitmap.rows; y++)
+        memcpy(&cleared[y * place.width], bitmap.buffer + y * bitmap.width, bitmap.width);
+      bitGlyph->bitmap.buffer = &cleared[0];
+      bitGlyph->bitmap.width = place.width;
+      bitGlyph->bitmap.rows = place.height;
+      bitGlyph->bitmap.pitch = place.width;
+      CopyCharToTexture(bitGlyph, place.x, place.y, place.x + place.width, place.y + place.height);
+      bitGlyph->bitmap = bitmap;
+    }
+    else
+      CopyCharToTexture(bitGlyph, place.x, place.y, place.x + bitmap.width, place.y + bitmap.rows);
   }
   m_numChars++;
 
@@ -81,6 +81,7 @@ struct SVertex
 
 
 #include "GUIFontCache.h"
+#include "GUIFontGlyphAtlas.h"
 
 
 class CGUIFontTTFBase
@@ -111,6 +112,7 @@ protected:
     float left, top, right, bottom;
     float advance;
     character_t letterAndStyle;
+    unsigned int slot;         // slot in m_atlas, CGUIFontGlyphAtlas::NO_SLOT for empty glyphs
   };
   void AddReference();
   void RemoveReference();
@@ -146,8 +148,8 @@ protected:
 
   unsigned int m_textureWidth;       // width of our texture
   unsigned int m_textureHeight;      // heigth of our texture
-  int m_posX;                        // current position in the texture
-  int m_posY;
+  CGUIFontGlyphAtlas m_atlas;        // placement of the characters in the texture
+  bool m_slotsReused;                // cached vertices may refer to glyphs that have been replaced
 
   /*! \brief the height of each line in the texture.
    Accounts for spacing between lines to avoid characters overlapping.
@@ -194,7 +196,6 @@ protected:
   float    m_textureScaleY;
 
   std::string m_strFileName;
-  XUTILS::auto_buffer m_fontFileInMemory; // used only in some cases, see CFreeTypeLibrary::GetFont()
 
   CGUIFontCache<CGUIFontCacheStaticPosition, CGUIFontCacheStaticValue> m_staticCache;
   CGUIFontCache<CGUIFontCacheDynamicPosition, CGUIFontCacheDynamicValue> m_dynamicCache;
@@ -145,6 +145,7 @@ bool CGUIFontTTFGL::FirstBegin()
 void CGUIFontTTFGL::LastEnd()
 {
 #ifdef HAS_GL
+  g_Windowing.FlushBatchedRendering();
   glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
 
   glColorPointer   (4, GL_UNSIGNED_BYTE, sizeof(SVertex), (char*)&m_vertex[0] + offsetof(SVertex, r));
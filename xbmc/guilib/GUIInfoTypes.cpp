@@ -28,6 +28,8 @@
 #include "utils/StringUtils.h"
 #include "addons/Skin.h"
 
+#include <atomic>
+
 using ADDON::CAddonMgr;
 
 CGUIInfoBool::CGUIInfoBool(bool value)
@@ -120,6 +122,12 @@ void CGUIInfoColor::Parse(const std::string &label, int context)
     m_color = g_colorManager.GetColor(label);
 }
 
+namespace
+{
+std::atomic<unsigned int> labelRebuilds(0);
+std::atomic<unsigned int> labelFetches(0);
+}
+
 CGUIInfoLabel::CGUIInfoLabel() : m_dirty(false)
 {
 }
@@ -151,14 +159,19 @@ const std::string &CGUIInfoLabel::GetLabel(int contextWindow, bool preferImage,
   {
     for (std::vector<CInfoPortion>::const_iterator portion = m_info.begin(); portion != m_info.end(); ++portion)
     {
-      if (portion->m_info)
+      if (portion->m_info && !portion->IsCurrent(contextWindow, preferImage, fallback))
       {
         std::string infoLabel;
+        std::string infoFallback;
         if (preferImage)
-          infoLabel = g_infoManager.GetImage(portion->m_info, contextWindow, fallback);
+          infoLabel = g_infoManager.GetImage(portion->m_info, contextWindow, &infoFallback);
         if (infoLabel.empty())
-          infoLabel = g_infoManager.GetLabel(portion->m_info, contextWindow, fallback);
+          infoLabel = g_infoManager.GetLabel(portion->m_info, contextWindow, &infoFallback);
+        if (fallback && !infoFallback.empty())
+          *fallback = infoFallback;
+        portion->SetFetched(contextWindow, preferImage, infoFallback);
         needsUpdate |= portion->NeedsUpdate(infoLabel);
+        labelFetches++;
       }
     }
   }
@@ -177,6 +190,7 @@ const std::string &CGUIInfoLabel::GetItemLabel(const CGUIListItem *item, bool pr
     {
       if (portion->m_info)
       {
+        portion->Invalidate();
         std::string infoLabel;
         if (preferImages)
           infoLabel = g_infoManager.GetItemImage((const CFileItem *)item, portion->m_info, fallback);
@@ -200,6 +214,7 @@ const std::string &CGUIInfoLabel::CacheLabel(bool rebuild) const
     for (std::vector<CInfoPortion>::const_iterator portion = m_info.begin(); portion != m_info.end(); ++portion)
       m_label += portion->Get();
     m_dirty = false;
+    labelRebuilds++;
   }
   if (m_label.empty())  // empty label, use the fallback
     return m_fallback;
@@ -388,12 +403,27 @@ void CGUIInfoLabel::Parse(const std::string &label, int context)
     m_info.push_back(CInfoPortion(0, work, ""));
 }
 
+unsigned int CGUIInfoLabel::GetRebuilds()
+{
+  return labelRebuilds;
+}
+
+unsigned int CGUIInfoLabel::GetFetches()
+{
+  return labelFetches;
+}
+
 CGUIInfoLabel::CInfoPortion::CInfoPortion(int info, const std::string &prefix, const std::string &postfix, bool escaped /*= false */):
   m_prefix(prefix),
   m_postfix(postfix)
 {
   m_info = info;
   m_escaped = escaped;
+  m_dependencies = info ? g_infoManager.GetDependencies(info) : INFO::INFO_DEPENDS_NONE;
+  m_fetched = false;
+  m_version = 0;
+  m_contextWindow = 0;
+  m_preferImage = false;
   // filter our prefix and postfix for comma's
   StringUtils::Replace(m_prefix, "$COMMA", ",");
   StringUtils::Replace(m_postfix, "$COMMA", ",");
@@ -411,6 +441,25 @@ bool CGUIInfoLabel::CInfoPortion::NeedsUpdate(const std::string &label) const
   return false;
 }
 
+bool CGUIInfoLabel::CInfoPortion::IsCurrent(int contextWindow, bool preferImage, std::string *fallback) const
+{
+  if (!m_fetched || m_contextWindow != contextWindow || m_preferImage != preferImage ||
+      m_version != g_infoManager.GetVersion(m_dependencies))
+    return false;
+  if (fallback && !m_fallback.empty())
+    *fallback = m_fallback;
+  return true;
+}
+
+void CGUIInfoLabel::CInfoPortion::SetFetched(int contextWindow, bool preferImage, const std::string &fallback) const
+{
+  m_fetched = true;
+  m_version = g_infoManager.GetVersion(m_dependencies);
+  m_contextWindow = contextWindow;
+  m_preferImage = preferImage;
+  m_fallback = fallback;
+}
+
 std::string CGUIInfoLabel::CInfoPortion::Get() const
 {
   if (!m_info)
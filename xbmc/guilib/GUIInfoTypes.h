@@ -110,6 +110,12 @@ public:
 
   const std::string &GetFallback() const { return m_fallback; };
 
+  /*! \brief Number of times any info label was rebuilt from its portions, for profiling */
+  static unsigned int GetRebuilds();
+
+  /*! \brief Number of times any info label portion was fetched from the info manager, for profiling */
+  static unsigned int GetFetches();
+
   static std::string GetLabel(const std::string &label, int contextWindow = 0, bool preferImage = false);
   static std::string GetItemLabel(const std::string &label, const CGUIListItem *item, bool preferImage = false);
 
@@ -163,9 +169,33 @@ private:
     CInfoPortion(int info, const std::string &prefix, const std::string &postfix, bool escaped = false);
     bool NeedsUpdate(const std::string &label) const;
     std::string Get() const;
+
+    /*! \brief whether the value fetched for the given context is still current
+     \param contextWindow the context in which the value is evaluated
+     \param preferImage whether an image rather than a label is wanted
+     \param fallback if non-NULL, is set to the fallback obtained with the value, if any
+     \return true if none of the sources the value was fetched from changed since
+     \sa SetFetched
+     */
+    bool IsCurrent(int contextWindow, bool preferImage, std::string *fallback) const;
+
+    /*! \brief remember the version and context of a freshly fetched value
+     \sa IsCurrent
+     */
+    void SetFetched(int contextWindow, bool preferImage, const std::string &fallback) const;
+
+    /*! \brief forget the fetched value, e.g. after it was fetched for a list item */
+    void Invalidate() const { m_fetched = false; };
+
     int m_info;
   private:
     bool m_escaped;
+    unsigned int m_dependencies;
+    mutable bool m_fetched;
+    mutable unsigned int m_version;
+    mutable int m_contextWindow;
+    mutable bool m_preferImage;
+    mutable std::string m_fallback;
     mutable std::string m_label;
     std::string m_prefix;
     std::string m_postfix;
@@ -0,0 +1,153 @@
+/*
+ *      Copyright (C) 2017 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kodi; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "GUIQuadBatch.h"
+#include "utils/TimeUtils.h"
+
+#include <algorithm>
+#include <cfloat>
+
+namespace
+{
+unsigned int frameQuads = 0;
+unsigned int frameDrawCalls = 0;
+int64_t frameStart = 0;
+CGUIQuadBatch::FrameStats lastFrame = { 0, 0, 0.0f };
+}
+
+const unsigned int CGUIQuadBatch::LOOKBACK;
+
+CGUIQuadBatch::CGUIQuadBatch() :
+  m_used(0),
+  m_queued(0)
+{
+}
+
+bool CGUIQuadBatch::Overlaps(const CRect &a, const CRect &b)
+{
+  return a.x1 < b.x2 && b.x1 < a.x2 && a.y1 < b.y2 && b.y1 < a.y2;
+}
+
+void CGUIQuadBatch::Add(const State &state, const Vertex *quad)
+{
+  CRect bounds(quad[0].x, quad[0].y, quad[0].x, quad[0].y);
+  bool flat = true;
+  for (unsigned int i = 0; i < 4; i++)
+  {
+    bounds.x1 = std::min(bounds.x1, quad[i].x);
+    bounds.y1 = std::min(bounds.y1, quad[i].y);
+    bounds.x2 = std::max(bounds.x2, quad[i].x);
+    bounds.y2 = std::max(bounds.y2, quad[i].y);
+    flat &= quad[i].z == 0.0f;
+  }
+  // quads that are not flat end up elsewhere on screen after projection, so nothing may be
+  // moved across them
+  if (!flat)
+    bounds = CRect(-FLT_MAX, -FLT_MAX, FLT_MAX, FLT_MAX);
+
+  // find an earlier batch with the same textures that the quad may join without changing the
+  // result, i.e. it doesn't overlap anything drawn after that batch. Otherwise start a new batch
+  // as early as possible, so that later quads drawn on top of it can still join earlier batches.
+  Pending *target = nullptr;
+  unsigned int position = m_used;
+  for (unsigned int i = m_used; i > m_used - std::min(m_used, LOOKBACK); i--)
+  {
+    Pending &pending = m_pending[i - 1];
+    if (pending.state == state)
+    {
+      target = &pending;
+      break;
+    }
+    if (Overlaps(pending.bounds, bounds))
+      break;
+    position = i - 1;
+  }
+
+  if (!target)
+  {
+    if (m_used == m_pending.size())
+      m_pending.push_back(Pending());
+    // move the free batch at the end into place
+    std::rotate(m_pending.begin() + position, m_pending.begin() + m_used, m_pending.begin() + m_used + 1);
+    m_used++;
+    target = &m_pending[position];
+    target->state = state;
+    target->bounds = bounds;
+    target->vertices.clear();
+  }
+  else
+  {
+    target->bounds.x1 = std::min(target->bounds.x1, bounds.x1);
+    target->bounds.y1 = std::min(target->bounds.y1, bounds.y1);
+    target->bounds.x2 = std::max(target->bounds.x2, bounds.x2);
+    target->bounds.y2 = std::max(target->bounds.y2, bounds.y2);
+  }
+  target->vertices.insert(target->vertices.end(), quad, quad + 4);
+  m_queued++;
+}
+
+const std::vector<CGUIQuadBatch::Batch>& CGUIQuadBatch::Prepare(std::vector<Vertex> &vertices)
+{
+  vertices.clear();
+  m_batches.clear();
+  for (unsigned int i = 0; i < m_used; i++)
+  {
+    const Pending &pending = m_pending[i];
+    Batch batch;
+    batch.state = pending.state;
+    batch.bounds = pending.bounds;
+    batch.first = vertices.size();
+    batch.count = pending.vertices.size();
+    vertices.insert(vertices.end(), pending.vertices.begin(), pending.vertices.end());
+    m_batches.push_back(batch);
+  }
+  return m_batches;
+}
+
+void CGUIQuadBatch::Clear()
+{
+  m_used = 0;
+  m_queued = 0;
+}
+
+void CGUIQuadBatch::CountDraws(unsigned int quads, unsigned int drawCalls)
+{
+  frameQuads += quads;
+  frameDrawCalls += drawCalls;
+}
+
+void CGUIQuadBatch::BeginFrame()
+{
+  frameQuads = 0;
+  frameDrawCalls = 0;
+  frameStart = CurrentHostCounter();
+}
+
+void CGUIQuadBatch::EndFrame()
+{
+  lastFrame.quads = frameQuads;
+  lastFrame.drawCalls = frameDrawCalls;
+  lastFrame.renderTime = 1000.0f * (CurrentHostCounter() - frameStart) / CurrentHostFrequency();
+}
+
+CGUIQuadBatch::FrameStats CGUIQuadBatch::GetFrameStats()
+{
+  return lastFrame;
+}
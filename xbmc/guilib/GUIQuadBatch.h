@@ -0,0 +1,120 @@
+/*
+ *      Copyright (C) 2017 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kodi; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include "Geometry.h"
+
+#include <stdint.h>
+#include <vector>
+
+/*!
+ \ingroup textures
+ \brief Collects textured quads of consecutive GUI textures into as few draws as possible.
+
+ Quads sharing the same textures are merged into one batch. A quad may also join an earlier
+ batch with its textures, as long as it does not overlap anything queued in between, so that
+ the blended result is the same as drawing everything in order. The implementation for each
+ render system uploads the batches and issues one draw per batch.
+ */
+class CGUIQuadBatch
+{
+public:
+  struct Vertex
+  {
+    float x, y, z;
+    float u1, v1;
+    float u2, v2;
+    uint8_t r, g, b, a;
+  };
+
+  /*! \brief the render system handles of the textures a quad is drawn with.
+   Handles rather than textures are kept, as the render system defers freeing them until after the frame.
+   */
+  struct State
+  {
+    unsigned int texture;
+    unsigned int diffuse; ///< 0 if none
+
+    bool operator==(const State &right) const { return texture == right.texture && diffuse == right.diffuse; }
+    bool operator!=(const State &right) const { return !(*this == right); }
+  };
+
+  struct Batch
+  {
+    State state;
+    CRect bounds;           ///< covers all quads of the batch
+    unsigned int first;     ///< first vertex in GetVertices()
+    unsigned int count;     ///< number of vertices
+  };
+
+  struct FrameStats
+  {
+    unsigned int quads;
+    unsigned int drawCalls;
+    float renderTime;       ///< ms spent between begin and end of the frame
+  };
+
+  CGUIQuadBatch();
+
+  /*! \brief Queue a quad
+   \param state the textures to draw the quad with
+   \param quad the four corners in drawing order
+   */
+  void Add(const State &state, const Vertex *quad);
+
+  bool IsEmpty() const { return m_queued == 0; }
+
+  /*! \brief Lay out the queued quads batch by batch, ready to be drawn
+   \param vertices set to the vertices of all batches
+   \return the batches in the order they are to be drawn
+   */
+  const std::vector<Batch>& Prepare(std::vector<Vertex> &vertices);
+
+  /*! \brief Drop the queued quads, after they were drawn */
+  void Clear();
+
+  /*! \brief Count draws issued by a render system, for profiling */
+  static void CountDraws(unsigned int quads, unsigned int drawCalls);
+
+  /*! \brief Called around the rendering of each frame to collect the frame statistics */
+  static void BeginFrame();
+  static void EndFrame();
+
+  /*! \brief Statistics of the last frame rendered */
+  static FrameStats GetFrameStats();
+
+  static const unsigned int LOOKBACK = 16; ///< batches a quad may move ahead of
+
+private:
+  struct Pending
+  {
+    State state;
+    CRect bounds;
+    std::vector<Vertex> vertices;
+  };
+
+  static bool Overlaps(const CRect &a, const CRect &b);
+
+  std::vector<Pending> m_pending; ///< reused between frames to avoid reallocating
+  std::vector<Batch> m_batches;
+  unsigned int m_used;
+  unsigned int m_queued;
+};
@@ -30,15 +30,23 @@
 
 #if defined(HAS_GL)
 
+#include <cstddef>
+
+CGUIQuadBatch CGUITextureGL::m_batch;
+std::vector<CGUIQuadBatch::Vertex> CGUITextureGL::m_batchVertices;
+GLuint CGUITextureGL::m_vertexBuffer = 0;
+
 CGUITextureGL::CGUITextureGL(float posX, float posY, float width, float height, const CTextureInfo &texture)
 : CGUITextureBase(posX, posY, width, height, texture)
 {
   memset(m_col, 0, sizeof(m_col));
+  m_state.texture = 0;
+  m_state.diffuse = 0;
 }
 
 void CGUITextureGL::Begin(color_t color)
 {
-  int range, unit = 0;
+  int range;
   if(g_Windowing.UseLimitedColor())
     range = 235 - 16;
   else
@@ -54,11 +62,99 @@ void CGUITextureGL::Begin(color_t color)
   if (m_diffuse.size())
     m_diffuse.m_textures[0]->LoadToGPU();
 
-  texture->BindToUnit(unit++);
+  // the quads are queued, and drawn together with those of other textures on the next flush
+  m_state.texture = static_cast<CGLTexture*>(texture)->GetTextureObject();
+  m_state.diffuse = m_diffuse.size() ? static_cast<CGLTexture*>(m_diffuse.m_textures[0])->GetTextureObject() : 0;
+}
 
-  glBlendFunc(GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA);
-  glEnable(GL_BLEND);          // Turn Blending On
-  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+void CGUITextureGL::End()
+{
+}
+
+void CGUITextureGL::Draw(float *x, float *y, float *z, const CRect &texture, const CRect &diffuse, int orientation)
+{
+  CGUIQuadBatch::Vertex vertices[4];
+  for (int i = 0; i < 4; i++)
+  {
+    vertices[i].x = x[i];
+    vertices[i].y = y[i];
+    vertices[i].z = z[i];
+    vertices[i].r = m_col[0];
+    vertices[i].g = m_col[1];
+    vertices[i].b = m_col[2];
+    vertices[i].a = m_col[3];
+  }
+
+  // Top-left vertex (corner)
+  vertices[0].u1 = texture.x1;
+  vertices[0].v1 = texture.y1;
+  vertices[0].u2 = diffuse.x1;
+  vertices[0].v2 = diffuse.y1;
+
+  // Top-right vertex (corner)
+  if (orientation & 4)
+  {
+    vertices[1].u1 = texture.x1;
+    vertices[1].v1 = texture.y2;
+  }
+  else
+  {
+    vertices[1].u1 = texture.x2;
+    vertices[1].v1 = texture.y1;
+  }
+  if (m_info.orientation & 4)
+  {
+    vertices[1].u2 = diffuse.x1;
+    vertices[1].v2 = diffuse.y2;
+  }
+  else
+  {
+    vertices[1].u2 = diffuse.x2;
+    vertices[1].v2 = diffuse.y1;
+  }
+
+  // Bottom-right vertex (corner)
+  vertices[2].u1 = texture.x2;
+  vertices[2].v1 = texture.y2;
+  vertices[2].u2 = diffuse.x2;
+  vertices[2].v2 = diffuse.y2;
+
+  // Bottom-left vertex (corner)
+  if (orientation & 4)
+  {
+    vertices[3].u1 = texture.x2;
+    vertices[3].v1 = texture.y1;
+  }
+  else
+  {
+    vertices[3].u1 = texture.x1;
+    vertices[3].v1 = texture.y2;
+  }
+  if (m_info.orientation & 4)
+  {
+    vertices[3].u2 = diffuse.x2;
+    vertices[3].v2 = diffuse.y1;
+  }
+  else
+  {
+    vertices[3].u2 = diffuse.x1;
+    vertices[3].v2 = diffuse.y2;
+  }
+
+  m_batch.Add(m_state, vertices);
+}
+
+void CGUITextureGL::BindToUnit(GLuint texture, int unit)
+{
+  glActiveTexture(GL_TEXTURE0 + unit);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glEnable(GL_TEXTURE_2D);
+}
+
+void CGUITextureGL::SetupTextureUnits(const CGUIQuadBatch::State &state)
+{
+  int unit = 0;
+  BindToUnit(state.texture, unit++);
 
   // diffuse coloring
   glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_COMBINE);
@@ -75,9 +171,9 @@ void CGUITextureGL::Begin(color_t color)
   glTexEnvf(GL_TEXTURE_ENV, GL_OPERAND1_ALPHA, GL_SRC_ALPHA);
   VerifyGLState();
 
-  if (m_diffuse.size())
+  if (state.diffuse)
   {
-    m_diffuse.m_textures[0]->BindToUnit(unit++);
+    BindToUnit(state.diffuse, unit++);
     glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_COMBINE);
     glTexEnvf(GL_TEXTURE_ENV, GL_COMBINE_RGB, GL_MODULATE);
     glTexEnvf(GL_TEXTURE_ENV, GL_SOURCE0_RGB, GL_TEXTURE);
@@ -95,7 +191,7 @@ void CGUITextureGL::Begin(color_t color)
 
   if(g_Windowing.UseLimitedColor())
   {
-    texture->BindToUnit(unit++); // dummy bind
+    BindToUnit(state.texture, unit++); // dummy bind
     const GLfloat rgba[4] = {16.0f / 255.0f, 16.0f / 255.0f, 16.0f / 255.0f, 0.0f};
     glTexEnvi (GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE , GL_COMBINE);
     glTexEnvfv(GL_TEXTURE_ENV, GL_TEXTURE_ENV_COLOR, rgba);
@@ -110,14 +206,62 @@ void CGUITextureGL::Begin(color_t color)
     VerifyGLState();
   }
 
-  //glDisable(GL_TEXTURE_2D); // uncomment these 2 lines to switch to wireframe rendering
-  //glBegin(GL_LINE_LOOP);
-  glBegin(GL_QUADS);
+  // switch off the units a previous batch used
+  for (; unit < 3; unit++)
+  {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDisable(GL_TEXTURE_2D);
+  }
 }
 
-void CGUITextureGL::End()
+void CGUITextureGL::FlushBatch()
 {
-  glEnd();
+  if (m_batch.IsEmpty())
+    return;
+
+  const std::vector<CGUIQuadBatch::Batch> &batches = m_batch.Prepare(m_batchVertices);
+
+  // stream all quads of the flush into one buffer
+  if (!m_vertexBuffer)
+    glGenBuffers(1, &m_vertexBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+  GLsizeiptr size = m_batchVertices.size() * sizeof(CGUIQuadBatch::Vertex);
+  glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW); // orphan the previous contents
+  glBufferSubData(GL_ARRAY_BUFFER, 0, size, m_batchVertices.data());
+
+  glBlendFunc(GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA);
+  glEnable(GL_BLEND);          // Turn Blending On
+  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+  const GLsizei stride = sizeof(CGUIQuadBatch::Vertex);
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glVertexPointer(3, GL_FLOAT, stride, (GLvoid *) offsetof(CGUIQuadBatch::Vertex, x));
+  glEnableClientState(GL_COLOR_ARRAY);
+  glColorPointer(4, GL_UNSIGNED_BYTE, stride, (GLvoid *) offsetof(CGUIQuadBatch::Vertex, r));
+  glClientActiveTexture(GL_TEXTURE0);
+  glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+  glTexCoordPointer(2, GL_FLOAT, stride, (GLvoid *) offsetof(CGUIQuadBatch::Vertex, u1));
+  glClientActiveTexture(GL_TEXTURE1);
+  glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+  glTexCoordPointer(2, GL_FLOAT, stride, (GLvoid *) offsetof(CGUIQuadBatch::Vertex, u2));
+
+  //glDisable(GL_TEXTURE_2D); // uncomment these 2 lines to switch to wireframe rendering
+  //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+  for (std::vector<CGUIQuadBatch::Batch>::const_iterator batch = batches.begin(); batch != batches.end(); ++batch)
+  {
+    SetupTextureUnits(batch->state);
+    glDrawArrays(GL_QUADS, batch->first, batch->count);
+  }
+  CGUIQuadBatch::CountDraws(m_batchVertices.size() / 4, batches.size());
+
+  glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+  glClientActiveTexture(GL_TEXTURE0);
+  glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+  glDisableClientState(GL_COLOR_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
   glActiveTexture(GL_TEXTURE2_ARB);
   glBindTexture(GL_TEXTURE_2D, 0);
   glDisable(GL_TEXTURE_2D);
@@ -127,57 +271,25 @@ void CGUITextureGL::End()
   glActiveTexture(GL_TEXTURE0_ARB);
   glBindTexture(GL_TEXTURE_2D, 0);
   glDisable(GL_TEXTURE_2D);
+  VerifyGLState();
+
+  m_batch.Clear();
 }
 
-void CGUITextureGL::Draw(float *x, float *y, float *z, const CRect &texture, const CRect &diffuse, int orientation)
+void CGUITextureGL::DestroyBatch()
 {
-  // Top-left vertex (corner)
-  glColor4ub(m_col[0], m_col[1], m_col[2], m_col[3]);
-  glMultiTexCoord2fARB(GL_TEXTURE0_ARB, texture.x1, texture.y1);
-  if (m_diffuse.size())
-    glMultiTexCoord2fARB(GL_TEXTURE1_ARB, diffuse.x1, diffuse.y1);
-  glVertex3f(x[0], y[0], z[0]);
-
-  // Top-right vertex (corner)
-  glColor4ub(m_col[0], m_col[1], m_col[2], m_col[3]);
-  if (orientation & 4)
-    glMultiTexCoord2fARB(GL_TEXTURE0_ARB, texture.x1, texture.y2);
-  else
-    glMultiTexCoord2fARB(GL_TEXTURE0_ARB, texture.x2, texture.y1);
-  if (m_diffuse.size())
+  m_batch.Clear();
+  if (m_vertexBuffer)
   {
-    if (m_info.orientation & 4)
-      glMultiTexCoord2fARB(GL_TEXTURE1_ARB, diffuse.x1, diffuse.y2);
-    else
-      glMultiTexCoord2fARB(GL_TEXTURE1_ARB, diffuse.x2, diffuse.y1);
+    glDeleteBuffers(1, &m_vertexBuffer);
+    m_vertexBuffer = 0;
   }
-  glVertex3f(x[1], y[1], z[1]);
-
-  // Bottom-right vertex (corner)
-  glColor4ub(m_col[0], m_col[1], m_col[2], m_col[3]);
-  glMultiTexCoord2fARB(GL_TEXTURE0_ARB, texture.x2, texture.y2);
-  if (m_diffuse.size())
-    glMultiTexCoord2fARB(GL_TEXTURE1_ARB, diffuse.x2, diffuse.y2);
-  glVertex3f(x[2], y[2], z[2]);
-
-  // Bottom-left vertex (corner)
-  glColor4ub(m_col[0], m_col[1], m_col[2], m_col[3]);
-  if (orientation & 4)
-    glMultiTexCoord2fARB(GL_TEXTURE0_ARB, texture.x2, texture.y1);
-  else
-    glMultiTexCoord2fARB(GL_TEXTURE0_ARB, texture.x1, texture.y2);
-  if (m_diffuse.size())
-  {
-    if (m_info.orientation & 4)
-      glMultiTexCoord2fARB(GL_TEXTURE1_ARB, diffuse.x2, diffuse.y1);
-    else
-      glMultiTexCoord2fARB(GL_TEXTURE1_ARB, diffuse.x1, diffuse.y2);
-  }
-  glVertex3f(x[3], y[3], z[3]);
 }
 
 void CGUITextureGL::DrawQuad(const CRect &rect, color_t color, CBaseTexture *texture, const CRect *texCoords)
 {
+  FlushBatch();
+
   if (texture)
   {
     texture->LoadToGPU();
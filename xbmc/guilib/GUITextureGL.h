@@ -29,20 +29,39 @@
  */
 
 #include "GUITexture.h"
+#include "GUIQuadBatch.h"
 
 #include "system_gl.h"
 
+#include <vector>
+
 class CGUITextureGL : public CGUITextureBase
 {
 public:
   CGUITextureGL(float posX, float posY, float width, float height, const CTextureInfo& texture);
   static void DrawQuad(const CRect &coords, color_t color, CBaseTexture *texture = NULL, const CRect *texCoords = NULL);
+
+  /*! \brief Draw the quads queued by all textures so far.
+   Must be called before anything else draws or the GL state the quads depend on changes.
+   */
+  static void FlushBatch();
+
+  /*! \brief Free the GL resources of the batch, with the render system */
+  static void DestroyBatch();
 protected:
   void Begin(color_t color);
   void Draw(float *x, float *y, float *z, const CRect &texture, const CRect &diffuse, int orientation);
   void End();
 private:
+  static void BindToUnit(GLuint texture, int unit);
+  static void SetupTextureUnits(const CGUIQuadBatch::State &state);
+
   GLubyte m_col[4];
+  CGUIQuadBatch::State m_state;
+
+  static CGUIQuadBatch m_batch;
+  static std::vector<CGUIQuadBatch::Vertex> m_batchVertices;
+  static GLuint m_vertexBuffer;
 };
 
 #endif
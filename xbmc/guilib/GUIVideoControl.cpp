@@ -24,6 +24,7 @@
 #include "Application.h"
 #include "input/Key.h"
 #include "WindowIDs.h"
+#include "windowing/WindowingFactory.h"
 
 CGUIVideoControl::CGUIVideoControl(int parentID, int controlID, float posX, float posY, float width, float height)
     : CGUIControl(parentID, controlID, posX, posY, width, height)
@@ -55,6 +56,7 @@ void CGUIVideoControl::Render()
     g_graphicsContext.SetTransform(mat, 1.0, 1.0);
 
     color_t alpha = g_graphicsContext.MergeAlpha(0xFF000000) >> 24;
+    g_Windowing.FlushBatchedRendering();
     if (g_application.m_pPlayer->IsRenderingVideoLayer())
     {
       CRect old = g_graphicsContext.GetScissors();
@@ -81,7 +83,10 @@ void CGUIVideoControl::Render()
 void CGUIVideoControl::RenderEx()
 {
   if (g_application.m_pPlayer->IsRenderingVideo())
+  {
+    g_Windowing.FlushBatchedRendering();
     g_application.m_pPlayer->Render(false, 255, false);
+  }
   
   CGUIControl::RenderEx();
 }
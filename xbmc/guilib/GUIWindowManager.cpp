@@ -30,13 +30,16 @@
 #include "utils/URIUtils.h"
 #include "settings/AdvancedSettings.h"
 #include "settings/Settings.h"
+#include "windowing/WindowingFactory.h"
 #include "addons/Skin.h"
 #include "GUITexture.h"
 #include "utils/Variant.h"
 #include "input/Key.h"
+#include "utils/FrameTracer.h"
 #include "utils/log.h"
 #include "utils/StringUtils.h"
 #include "utils/SeekHandler.h"
+#include "utils/TimeUtils.h"
 
 #include "windows/GUIWindowHome.h"
 #include "events/windows/GUIWindowEventLog.h"
@@ -1015,6 +1018,7 @@ bool RenderOrderSortFunction(CGUIWindow *first, CGUIWindow *second)
 
 void CGUIWindowManager::Process(unsigned int currentTime)
 {
+  TRACE_ZONE("CGUIWindowManager::Process");
   assert(g_application.IsCurrentThread());
   CSingleLock lock(g_graphicsContext);
 
@@ -1046,8 +1050,18 @@ void CGUIWindowManager::MarkDirty(const CRect& rect)
   m_tracker.MarkDirtyRegion(rect);
 }
 
+void CGUIWindowManager::ToggleDirtyRegionRecording()
+{
+  CSingleLock lock(g_graphicsContext);
+  if (m_tracker.IsRecording())
+    m_tracker.StopRecording("special://logpath/dirtyregions.txt");
+  else
+    m_tracker.StartRecording(g_graphicsContext.GetViewWindow());
+}
+
 void CGUIWindowManager::RenderPass() const
 {
+  TRACE_ZONE("CGUIWindowManager::RenderPass");
   CGUIWindow* pWindow = GetWindow(GetActiveWindow());
   if (pWindow)
   {
@@ -1064,10 +1078,14 @@ void CGUIWindowManager::RenderPass() const
     if ((*it)->IsDialogRunning())
       (*it)->DoRender();
   }
+
+  // draw everything queued within this region
+  g_Windowing.FlushBatchedRendering();
 }
 
 void CGUIWindowManager::RenderEx() const
 {
+  g_Windowing.FlushBatchedRendering();
   CGUIWindow* pWindow = GetWindow(GetActiveWindow());
   if (pWindow)
     pWindow->RenderEx();
@@ -1108,6 +1126,7 @@ bool CGUIWindowManager::Render()
   }
   else
   {
+    int64_t start = CurrentHostCounter();
     for (CDirtyRegionList::const_iterator i = dirtyRegions.begin(); i != dirtyRegions.end(); ++i)
     {
       if (i->IsEmpty())
@@ -1118,6 +1137,8 @@ bool CGUIWindowManager::Render()
       hasRendered = true;
     }
     g_graphicsContext.ResetScissors();
+    if (hasRendered)
+      m_tracker.OnRendered(dirtyRegions, (float)(CurrentHostCounter() - start) / CurrentHostFrequency());
   }
 
   if (g_advancedSettings.m_guiVisualizeDirtyRegions)
@@ -104,6 +104,11 @@ public:
    */
   void MarkDirty(const CRect& rect);
 
+  /*! \brief Start recording the dirty regions of each frame, or stop and save them to the log folder
+   \sa CDirtyRegionRecording
+   */
+  void ToggleDirtyRegionRecording();
+
   /*! \brief Get the current dirty region
    */
   CDirtyRegionList GetDirty() { return m_tracker.GetDirtyRegions(); }
@@ -256,6 +256,11 @@ public:
     return fragmentsList;
   }
 
+  bool operator ==(const this_type &rect) const
+  {
+    return !(*this != rect);
+  };
+
   bool operator !=(const this_type &rect) const
   {
     if (x1 != rect.x1) return true;
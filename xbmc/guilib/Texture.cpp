@@ -122,7 +122,7 @@ void CBaseTexture::Update(unsigned int width, unsigned int height, unsigned int
   if (pixels == NULL)
     return;
 
-  if (format & XB_FMT_DXT_MASK)
+  if ((format & XB_FMT_DXT_MASK) && !g_Windowing.SupportsDXT())
     return;
 
   Allocate(width, height, format);
@@ -154,6 +154,14 @@ void CBaseTexture::Update(unsigned int width, unsigned int height, unsigned int
     LoadToGPU();
 }
 
+bool CBaseTexture::LoadRowsToGPU(unsigned int &budget)
+{
+  unsigned int size = GetPitch() * GetRows();
+  LoadToGPU();
+  budget -= std::min(budget, size);
+  return true;
+}
+
 void CBaseTexture::ClampToEdge()
 {
   if (m_pixels == nullptr)
@@ -235,7 +243,7 @@ bool CBaseTexture::LoadFromFileInternal(const std::string& texturePath, unsigned
     if (image.ReadFile(texturePath))
     {
       Update(image.GetWidth(), image.GetHeight(), 0, image.GetFormat(), image.GetData(), false);
-      return true;
+      return m_pixels != nullptr; // DXT is only kept if the GPU supports it
     }
     return false;
   }
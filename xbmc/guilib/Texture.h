@@ -86,6 +86,14 @@ public:
   virtual void LoadToGPU() = 0;
   virtual void BindToUnit(unsigned int unit) = 0;
 
+  /*! \brief Load the texture to the GPU a few rows at a time, spreading large textures over several frames.
+   The texture may only be drawn once this has returned true.
+   \param budget [in,out] the number of bytes that may still be uploaded in this frame, reduced by the bytes uploaded.
+   At least one row is uploaded on each call.
+   \return true once the whole texture has been loaded
+   */
+  virtual bool LoadRowsToGPU(unsigned int &budget);
+
   unsigned char* GetPixels() const { return m_pixels; }
   unsigned int GetPitch() const { return GetPitch(m_textureWidth); }
   unsigned int GetRows() const { return GetRows(m_textureHeight); }
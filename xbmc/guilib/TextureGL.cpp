@@ -34,10 +34,14 @@
 /************************************************************************/
 /*    CGLTexture                                                       */
 /************************************************************************/
+GLuint CGLTexture::m_uploadBuffer = 0;
+unsigned int CGLTexture::m_uploadBufferSize = 0;
+
 CGLTexture::CGLTexture(unsigned int width, unsigned int height, unsigned int format)
 : CBaseTexture(width, height, format)
 {
   m_texture = 0;
+  m_uploadedRows = 0;
 }
 
 CGLTexture::~CGLTexture()
@@ -204,6 +208,91 @@ void CGLTexture::LoadToGPU()
   m_loadedToGPU = true;
 }
 
+bool CGLTexture::LoadRowsToGPU(unsigned int &budget)
+{
+#ifndef HAS_GLES
+  unsigned int maxSize = g_Windowing.GetMaxTextureSize();
+  if (!m_pixels || IsMipmapped() || m_textureWidth > maxSize || m_textureHeight > maxSize ||
+      (m_format != XB_FMT_A8R8G8B8 && m_format != XB_FMT_RGB8))
+    return CBaseTexture::LoadRowsToGPU(budget);
+
+  GLenum format = GL_BGRA;
+  GLint numcomponents = GL_RGBA;
+  if (m_format == XB_FMT_RGB8)
+    format = numcomponents = GL_RGB;
+
+  if (m_uploadedRows == 0)
+  {
+    if (m_texture == 0)
+      CreateTextureObject();
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    // allocate the storage only, the rows follow
+    glTexImage2D(GL_TEXTURE_2D, 0, numcomponents, m_textureWidth, m_textureHeight, 0,
+      format, GL_UNSIGNED_BYTE, NULL);
+  }
+  else
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+
+  unsigned int pitch = GetPitch();
+  unsigned int rows = std::min(std::max(budget / pitch, 1U), m_textureHeight - m_uploadedRows);
+  unsigned int size = rows * pitch;
+  const unsigned char *source = m_pixels + m_uploadedRows * pitch;
+
+  if (g_Windowing.SupportsPBO())
+  {
+    // copy into memory owned by the driver, which can then transfer it without stalling us
+    if (m_uploadBuffer == 0)
+      glGenBuffers(1, &m_uploadBuffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_uploadBuffer);
+    // orphan the storage of the previous upload instead of waiting for it to be consumed
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, std::max(size, m_uploadBufferSize), NULL, GL_STREAM_DRAW);
+    m_uploadBufferSize = std::max(size, m_uploadBufferSize);
+    void *mapped = glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+    if (mapped)
+    {
+      memcpy(mapped, source, size);
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+      source = NULL;
+    }
+    else
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  }
+
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, m_uploadedRows, m_textureWidth, rows, format, GL_UNSIGNED_BYTE, source);
+  if (source == NULL)
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  VerifyGLState();
+
+  m_uploadedRows += rows;
+  budget -= std::min(budget, size);
+  if (m_uploadedRows < m_textureHeight)
+    return false;
+
+  _aligned_free(m_pixels);
+  m_pixels = NULL;
+  m_uploadedRows = 0;
+  m_loadedToGPU = true;
+  return true;
+#else
+  return CBaseTexture::LoadRowsToGPU(budget);
+#endif
+}
+
+void CGLTexture::DestroyUploadBuffer()
+{
+#ifndef HAS_GLES
+  if (m_uploadBuffer)
+    glDeleteBuffers(1, &m_uploadBuffer);
+  m_uploadBuffer = 0;
+  m_uploadBufferSize = 0;
+#endif
+}
+
 void CGLTexture::BindToUnit(unsigned int unit)
 {
   glActiveTexture(GL_TEXTURE0 + unit);
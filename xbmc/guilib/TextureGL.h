@@ -39,9 +39,20 @@ public:
   virtual void DestroyTextureObject();
   void LoadToGPU();
   void BindToUnit(unsigned int unit);
+  virtual bool LoadRowsToGPU(unsigned int &budget);
+  GLuint GetTextureObject() const { return m_texture; }
+
+  /*! \brief Release the buffer object textures are streamed through. Call before the GL context goes away.
+   */
+  static void DestroyUploadBuffer();
 
 protected:
   GLuint m_texture;
+  unsigned int m_uploadedRows;   ///< rows loaded by LoadRowsToGPU() so far
+
+private:
+  static GLuint m_uploadBuffer;
+  static unsigned int m_uploadBufferSize;
 };
 
 #endif
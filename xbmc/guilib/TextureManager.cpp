@@ -31,6 +31,7 @@
 #include "threads/SingleLock.h"
 #include "threads/SystemClock.h"
 #include "URL.h"
+#include "utils/FrameTracer.h"
 #include "utils/log.h"
 #include "utils/StringUtils.h"
 #include "utils/URIUtils.h"
@@ -294,6 +295,7 @@ bool CGUITextureManager::HasTexture(const std::string &textureName, std::string
 
 const CTextureArray& CGUITextureManager::Load(const std::string& strTextureName, bool checkBundleOnly /*= false */)
 {
+  TRACE_ZONE("CGUITextureManager::Load");
   std::string strPath;
   static CTextureArray emptyTexture;
   int bundle = -1;
@@ -0,0 +1,226 @@
+/*
+ *      Copyright (C) 2017 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kodi; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "guilib/DDSImage.h"
+#include "guilib/FFmpegImage.h"
+#include "guilib/XBTF.h"
+#include "filesystem/File.h"
+#include "utils/auto_buffer.h"
+#include "utils/TimeUtils.h"
+#include "test/TestUtils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace
+{
+std::vector<unsigned char> CreateImage(unsigned int width, unsigned int height, bool alpha)
+{
+  std::vector<unsigned char> image(width * height * 4);
+  for (unsigned int y = 0; y < height; y++)
+  {
+    for (unsigned int x = 0; x < width; x++)
+    {
+      unsigned char *pixel = &image[(y * width + x) * 4];
+      pixel[0] = x * 255 / width;
+      pixel[1] = y * 255 / height;
+      pixel[2] = 128 + (int)(64 * sin(x / 8.0));
+      pixel[3] = alpha ? (x + y) * 255 / (width + height) : 255;
+    }
+  }
+  return image;
+}
+
+// root mean square and maximum of the difference per channel
+void Compare(const std::vector<unsigned char> &a, const std::vector<unsigned char> &b, double &rms, int &max)
+{
+  double sum = 0;
+  max = 0;
+  for (size_t i = 0; i < a.size(); i++)
+  {
+    int diff = abs(a[i] - b[i]);
+    sum += diff * diff;
+    max = std::max(max, diff);
+  }
+  rms = sqrt(sum / a.size());
+}
+}
+
+TEST(TestDDSImage, CompressesOpaqueImagesToDXT1)
+{
+  std::vector<unsigned char> image = CreateImage(64, 64, false);
+  CDDSImage dds;
+  dds.Compress(64, 64, 64 * 4, &image[0], false);
+  EXPECT_EQ((unsigned int)XB_FMT_DXT1, dds.GetFormat());
+  EXPECT_EQ(64U * 64U / 2, dds.GetSize());
+
+  std::vector<unsigned char> result(image.size());
+  ASSERT_TRUE(CDDSImage::Decompress(&result[0], 64, 64, 64 * 4, dds.GetData(), dds.GetFormat()));
+  double rms;
+  int max;
+  Compare(image, result, rms, max);
+  EXPECT_LT(rms, 4.0);
+  EXPECT_LT(max, 24);
+}
+
+TEST(TestDDSImage, CompressesAlphaToDXT5)
+{
+  std::vector<unsigned char> image = CreateImage(64, 64, true);
+  CDDSImage dds;
+  dds.Compress(64, 64, 64 * 4, &image[0], true);
+  EXPECT_EQ((unsigned int)XB_FMT_DXT5, dds.GetFormat());
+  EXPECT_EQ(64U * 64U, dds.GetSize());
+
+  std::vector<unsigned char> result(image.size());
+  ASSERT_TRUE(CDDSImage::Decompress(&result[0], 64, 64, 64 * 4, dds.GetData(), dds.GetFormat()));
+  for (size_t i = 3; i < image.size(); i += 4)
+    EXPECT_LE(abs(image[i] - result[i]), 2);
+}
+
+TEST(TestDDSImage, KeepsFlatBlocks)
+{
+  std::vector<unsigned char> image(8 * 8 * 4);
+  for (size_t i = 0; i < image.size(); i += 4)
+  {
+    image[i] = 0; image[i + 1] = 255; image[i + 2] = 255; image[i + 3] = i < image.size() / 2 ? 0 : 255;
+  }
+  CDDSImage dds;
+  dds.Compress(8, 8, 8 * 4, &image[0], true);
+  std::vector<unsigned char> result(image.size());
+  ASSERT_TRUE(CDDSImage::Decompress(&result[0], 8, 8, 8 * 4, dds.GetData(), dds.GetFormat()));
+  EXPECT_TRUE(image == result);
+}
+
+TEST(TestDDSImage, PadsPartialBlocks)
+{
+  // the edge blocks should come out as if the last row and column were repeated
+  std::vector<unsigned char> image = CreateImage(6, 5, false);
+  std::vector<unsigned char> padded(8 * 8 * 4);
+  for (unsigned int y = 0; y < 8; y++)
+    for (unsigned int x = 0; x < 8; x++)
+      memcpy(&padded[(y * 8 + x) * 4], &image[(std::min(y, 4U) * 6 + std::min(x, 5U)) * 4], 4);
+
+  CDDSImage dds, paddedDDS;
+  dds.Compress(6, 5, 6 * 4, &image[0], false);
+  paddedDDS.Compress(8, 8, 8 * 4, &padded[0], false);
+  ASSERT_EQ(2U * 2U * 8U, dds.GetSize());
+  ASSERT_EQ(paddedDDS.GetSize(), dds.GetSize());
+  EXPECT_EQ(0, memcmp(dds.GetData(), paddedDDS.GetData(), dds.GetSize()));
+
+  std::vector<unsigned char> result(image.size(), 0xcd);
+  ASSERT_TRUE(CDDSImage::Decompress(&result[0], 6, 5, 6 * 4, dds.GetData(), dds.GetFormat()));
+  std::vector<unsigned char> paddedResult(padded.size());
+  ASSERT_TRUE(CDDSImage::Decompress(&paddedResult[0], 8, 8, 8 * 4, paddedDDS.GetData(), paddedDDS.GetFormat()));
+  for (unsigned int y = 0; y < 5; y++)
+    EXPECT_EQ(0, memcmp(&result[y * 6 * 4], &paddedResult[y * 8 * 4], 6 * 4));
+}
+
+TEST(TestDDSImage, WritesAndReadsFiles)
+{
+  std::vector<unsigned char> image = CreateImage(32, 16, false);
+  XFILE::CFile *file = XBMC_CREATETEMPFILE(".dds");
+  ASSERT_TRUE(file != NULL);
+  std::string path = XBMC_TEMPFILEPATH(file);
+  file->Close();
+
+  CDDSImage dds;
+  ASSERT_TRUE(dds.Create(path, 32, 16, 32 * 4, &image[0], false));
+
+  CDDSImage read;
+  ASSERT_TRUE(read.ReadFile(path));
+  EXPECT_EQ(32U, read.GetWidth());
+  EXPECT_EQ(16U, read.GetHeight());
+  EXPECT_EQ((unsigned int)XB_FMT_DXT1, read.GetFormat());
+  ASSERT_EQ(dds.GetSize(), read.GetSize());
+  EXPECT_EQ(0, memcmp(dds.GetData(), read.GetData(), dds.GetSize()));
+  EXPECT_TRUE(XBMC_DELETETEMPFILE(file));
+}
+
+namespace
+{
+/* Compares loading a cached 1080p image from its .jpg, which is decoded to
+   A8R8G8B8 on the CPU, to loading the .dds version which goes to the GPU as it is. */
+void CachedPosters(unsigned int loops, bool report)
+{
+  XFILE::CFile jpgFile;
+  XUTILS::auto_buffer jpg;
+  ASSERT_LT(0, jpgFile.LoadFile(XBMC_REF_FILE_PATH("addons/skin.estouchy/resources/screenshot-01.jpg"), jpg));
+
+  int64_t start = CurrentHostCounter();
+  unsigned int width = 0, height = 0;
+  std::vector<unsigned char> pixels;
+  for (unsigned int i = 0; i < loops; i++)
+  {
+    CFFmpegImage decoder("image/jpeg");
+    ASSERT_TRUE(decoder.LoadImageFromMemory((unsigned char *)jpg.get(), jpg.size(), 0, 0));
+    width = decoder.Width();
+    height = decoder.Height();
+    pixels.resize(width * height * 4);
+    ASSERT_TRUE(decoder.Decode(&pixels[0], width, height, width * 4, XB_FMT_A8R8G8B8));
+  }
+  double jpgTime = (double)(CurrentHostCounter() - start) / CurrentHostFrequency() / loops;
+
+  XFILE::CFile *file = XBMC_CREATETEMPFILE(".dds");
+  ASSERT_TRUE(file != NULL);
+  std::string path = XBMC_TEMPFILEPATH(file);
+  file->Close();
+
+  start = CurrentHostCounter();
+  CDDSImage dds;
+  ASSERT_TRUE(dds.Create(path, width, height, width * 4, &pixels[0], false));
+  double compressTime = (double)(CurrentHostCounter() - start) / CurrentHostFrequency();
+
+  start = CurrentHostCounter();
+  for (unsigned int i = 0; i < loops; i++)
+  {
+    CDDSImage read;
+    ASSERT_TRUE(read.ReadFile(path));
+  }
+  double ddsTime = (double)(CurrentHostCounter() - start) / CurrentHostFrequency() / loops;
+  EXPECT_TRUE(XBMC_DELETETEMPFILE(file));
+
+  uint64_t rgbaBytes = (uint64_t)width * height * 4 * 1000;
+  uint64_t dxtBytes = (uint64_t)dds.GetSize() * 1000;
+  EXPECT_EQ(rgbaBytes / 8, dxtBytes);
+  if (report)
+    std::cout << width << "x" << height << " per 1000 images: jpg decode " << jpgTime * 1000 << " s, "
+              << rgbaBytes / (1024 * 1024) << " MB of textures; dds read " << ddsTime * 1000 << " s, "
+              << dxtBytes / (1024 * 1024) << " MB of textures (compressing took " << compressTime * 1000 << " ms per image)" << std::endl;
+}
+}
+
+/* A cached 1080p image takes an eighth of the texture memory as a .dds */
+TEST(TestDDSImage, CachedPosters)
+{
+  CachedPosters(1, false);
+}
+
+// Timing run, not part of the unit tests. Run it with
+// --gtest_also_run_disabled_tests --gtest_filter=TestDDSImage.DISABLED_CachedPostersBenchmark
+TEST(TestDDSImage, DISABLED_CachedPostersBenchmark)
+{
+  CachedPosters(10, true);
+}
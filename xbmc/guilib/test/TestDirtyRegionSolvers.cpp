@@ -0,0 +1,304 @@
+/*
+ *      Copyright (C) 2017 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kodi; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "guilib/DirtyRegionRecording.h"
+#include "guilib/DirtyRegionSolvers.h"
+#include "guilib/DirtyRegionTracker.h"
+#include "filesystem/File.h"
+#include "test/TestUtils.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace
+{
+const CRect viewport(0, 0, 1920, 1080);
+
+/* Render time of a frame on a device, as seconds per pass and per pixel. */
+struct DeviceProfile
+{
+  const char *name;
+  float costPerPass;
+  float costPerArea;
+};
+
+/* A pass renders the whole window with a scissor, so its overhead is the CPU side of drawing
+   the skin; the fill rate is what the GPU takes to draw a pixel. */
+const DeviceProfile profiles[] =
+{
+  { "draw bound", 0.004f, 0.000000001f },
+  { "fill bound", 0.0005f, 0.000000008f },
+};
+
+struct ReplayStats
+{
+  unsigned int renderedFrames = 0;
+  unsigned int passes = 0;
+  double pixels = 0.0;
+  double seconds = 0.0;
+};
+
+/* Replays a recording through a solver, feeding it the render time the profile gives for each frame. */
+ReplayStats Replay(const CDirtyRegionRecording &recording, IDirtyRegionSolver &solver, const DeviceProfile &profile)
+{
+  ReplayStats stats;
+  for (std::vector<CDirtyRegionList>::const_iterator frame = recording.GetFrames().begin(); frame != recording.GetFrames().end(); ++frame)
+  {
+    CDirtyRegionList passes;
+    solver.Solve(*frame, passes);
+    if (passes.empty())
+      continue;
+
+    double pixels = 0.0;
+    for (CDirtyRegionList::const_iterator i = passes.begin(); i != passes.end(); ++i)
+      pixels += i->Area();
+    float seconds = profile.costPerPass * passes.size() + profile.costPerArea * (float)pixels;
+    solver.OnRendered(passes, seconds);
+
+    stats.renderedFrames++;
+    stats.passes += passes.size();
+    stats.pixels += pixels;
+    stats.seconds += seconds;
+  }
+  return stats;
+}
+
+/* Records frames through the tracker the way the window manager does, and loads them back. */
+class RecordingBuilder
+{
+public:
+  RecordingBuilder() { m_tracker.StartRecording(viewport); }
+
+  void Mark(float x, float y, float width, float height) { m_tracker.MarkDirtyRegion(CDirtyRegion(x, y, x + width, y + height)); }
+  void EndFrame() { m_tracker.CleanMarkedRegions(); }
+
+  bool Finish(CDirtyRegionRecording &recording)
+  {
+    XFILE::CFile *file = XBMC_CREATETEMPFILE(".txt");
+    if (!file)
+      return false;
+    std::string path = XBMC_TEMPFILEPATH(file);
+    file->Close();
+    bool loaded = m_tracker.StopRecording(path) && recording.Load(path);
+    XBMC_DELETETEMPFILE(file);
+    return loaded;
+  }
+
+private:
+  CDirtyRegionTracker m_tracker;
+};
+
+/* A list scrolling by one item each 10 frames, with a clock ticking in the corner. */
+void ScrollingList(RecordingBuilder &builder)
+{
+  for (int frame = 0; frame < 600; frame++)
+  {
+    if (frame % 10 < 6)
+    {
+      int item = (frame / 10) % 10;
+      builder.Mark(100, 200 + item * 70.0f, 700, 70);
+      builder.Mark(100, 270 + item * 70.0f, 700, 70);
+      builder.Mark(900, 200, 900, 500); // info panel of the focused item
+    }
+    if (frame % 60 == 0)
+      builder.Mark(1700, 20, 180, 50);
+    builder.EndFrame();
+  }
+}
+
+/* Two small animations at opposite corners of the screen. */
+void Spinners(RecordingBuilder &builder)
+{
+  for (int frame = 0; frame < 600; frame++)
+  {
+    builder.Mark(40, 40, 64, 64);
+    builder.Mark(1800, 960, 64, 64);
+    builder.EndFrame();
+  }
+}
+
+/* A home screen that is mostly idle, fading in a new background every 5 seconds. */
+void Idle(RecordingBuilder &builder)
+{
+  for (int frame = 0; frame < 600; frame++)
+  {
+    if (frame % 300 < 30)
+      builder.Mark(0, 0, 1920, 1080);
+    else if (frame % 30 == 0)
+      builder.Mark(1700, 20, 180, 50);
+    builder.EndFrame();
+  }
+}
+}
+
+TEST(TestDirtyRegionSolvers, RecordsFrames)
+{
+  RecordingBuilder builder;
+  builder.Mark(10, 20, 30, 40);
+  builder.Mark(0.5f, 0, 1919.5f, 1080);
+  builder.EndFrame();
+  builder.EndFrame();
+  builder.Mark(100, 100, 1, 1);
+  builder.EndFrame();
+
+  CDirtyRegionRecording recording;
+  ASSERT_TRUE(builder.Finish(recording));
+  EXPECT_EQ(viewport, recording.GetViewport());
+  ASSERT_EQ(3U, recording.GetFrames().size());
+  ASSERT_EQ(2U, recording.GetFrames()[0].size());
+  EXPECT_EQ(CRect(10, 20, 40, 60), recording.GetFrames()[0][0]);
+  EXPECT_EQ(CRect(0.5f, 0, 1920, 1080), recording.GetFrames()[0][1]);
+  // regions stay marked while they may still be in one of the back buffers
+  EXPECT_EQ(recording.GetFrames()[0], recording.GetFrames()[1]);
+  ASSERT_EQ(3U, recording.GetFrames()[2].size());
+  EXPECT_EQ(CRect(100, 100, 101, 101), recording.GetFrames()[2][2]);
+}
+
+TEST(TestDirtyRegionSolvers, AdaptiveLearnsCosts)
+{
+  RecordingBuilder builder;
+  ScrollingList(builder);
+  Spinners(builder);
+  CDirtyRegionRecording recording;
+  ASSERT_TRUE(builder.Finish(recording));
+
+  for (const DeviceProfile &profile : profiles)
+  {
+    CAdaptiveDirtyRegionSolver solver;
+    Replay(recording, solver, profile);
+    EXPECT_NEAR(profile.costPerPass, solver.GetCostPerPass(), profile.costPerPass * 0.01f) << profile.name;
+    EXPECT_NEAR(profile.costPerArea, solver.GetCostPerArea(), profile.costPerArea * 0.01f) << profile.name;
+  }
+}
+
+TEST(TestDirtyRegionSolvers, CostReductionLearnsCosts)
+{
+  RecordingBuilder builder;
+  ScrollingList(builder);
+  Spinners(builder);
+  CDirtyRegionRecording recording;
+  ASSERT_TRUE(builder.Finish(recording));
+
+  // two spinners at opposite corners
+  CDirtyRegionList spinners;
+  spinners.push_back(CDirtyRegion(40, 40, 104, 104));
+  spinners.push_back(CDirtyRegion(1800, 960, 1864, 1024));
+
+  for (const DeviceProfile &profile : profiles)
+  {
+    CGreedyDirtyRegionSolver solver;
+    Replay(recording, solver, profile);
+    EXPECT_NEAR(profile.costPerPass / profile.costPerArea, solver.GetCostNewRegion() / solver.GetCostPerArea(),
+                profile.costPerPass / profile.costPerArea * 0.01f) << profile.name;
+
+    // where a pass costs more than drawing the whole screen they are merged
+    CDirtyRegionList passes;
+    solver.Solve(spinners, passes);
+    EXPECT_EQ(profile.costPerPass > profile.costPerArea * viewport.Area() ? 1U : 2U, passes.size()) << profile.name;
+  }
+}
+
+namespace
+{
+struct Scenario
+{
+  const char *name;
+  void (*record)(RecordingBuilder &);
+};
+
+const Scenario scenarios[] =
+{
+  { "scrolling list", ScrollingList },
+  { "spinners", Spinners },
+  { "idle", Idle },
+};
+
+const char *solverNames[] = { "fill always", "fill on change", "union", "cost reduction", "adaptive" };
+
+/* Replays a recording through every solver, in the order of solverNames. */
+void ReplaySolvers(const CDirtyRegionRecording &recording, const DeviceProfile &profile, ReplayStats stats[5])
+{
+  std::unique_ptr<IDirtyRegionSolver> solvers[] =
+  {
+    std::unique_ptr<IDirtyRegionSolver>(new CFillViewportAlwaysRegionSolver(recording.GetViewport())),
+    std::unique_ptr<IDirtyRegionSolver>(new CFillViewportOnChangeRegionSolver(recording.GetViewport())),
+    std::unique_ptr<IDirtyRegionSolver>(new CUnionDirtyRegionSolver()),
+    std::unique_ptr<IDirtyRegionSolver>(new CGreedyDirtyRegionSolver()),
+    std::unique_ptr<IDirtyRegionSolver>(new CAdaptiveDirtyRegionSolver()),
+  };
+  for (int i = 0; i < 5; i++)
+    stats[i] = Replay(recording, *solvers[i], profile);
+}
+}
+
+/* Once it has learnt the costs of the device, the adaptive solver should be about as fast as the
+   best of the union and cost reduction solvers. */
+TEST(TestDirtyRegionSolvers, AdaptiveMatchesBestSolver)
+{
+  for (const Scenario &scenario : scenarios)
+  {
+    RecordingBuilder builder;
+    scenario.record(builder);
+    CDirtyRegionRecording recording;
+    ASSERT_TRUE(builder.Finish(recording));
+
+    for (const DeviceProfile &profile : profiles)
+    {
+      ReplayStats stats[5];
+      ReplaySolvers(recording, profile, stats);
+      EXPECT_EQ(recording.GetFrames().size(), stats[0].renderedFrames) << scenario.name << ", " << profile.name;
+      EXPECT_EQ(stats[1].renderedFrames, stats[2].renderedFrames) << scenario.name << ", " << profile.name;
+      EXPECT_EQ(stats[2].renderedFrames, stats[2].passes) << scenario.name << ", " << profile.name;
+      EXPECT_LE(stats[4].seconds, std::min(stats[2].seconds, stats[3].seconds) * 1.05) << scenario.name << ", " << profile.name;
+    }
+  }
+}
+
+/* Prints the frames, passes, pixels and modelled time each solver renders for each recording. */
+TEST(TestDirtyRegionSolvers, DISABLED_Benchmark)
+{
+  for (const Scenario &scenario : scenarios)
+  {
+    RecordingBuilder builder;
+    scenario.record(builder);
+    CDirtyRegionRecording recording;
+    ASSERT_TRUE(builder.Finish(recording));
+
+    for (const DeviceProfile &profile : profiles)
+    {
+      ReplayStats stats[5];
+      ReplaySolvers(recording, profile, stats);
+      std::cout << scenario.name << ", " << profile.name << ", " << recording.GetFrames().size() << " frames:" << std::endl;
+      for (int i = 0; i < 5; i++)
+      {
+        std::cout << "  " << std::setw(15) << std::left << solverNames[i] << std::right
+                  << std::setw(5) << stats[i].renderedFrames << " frames"
+                  << std::setw(6) << stats[i].passes << " passes"
+                  << std::setw(8) << std::fixed << std::setprecision(1) << stats[i].pixels / 1000000 << " Mpixels"
+                  << std::setw(8) << std::setprecision(3) << stats[i].seconds << " s" << std::endl;
+      }
+    }
+  }
+}
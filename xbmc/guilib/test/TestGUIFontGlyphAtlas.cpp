@@ -0,0 +1,404 @@
+/*
+ *      Copyright (C) 2017 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kodi; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "guilib/GUIFontGlyphAtlas.h"
+#include "test/TestUtils.h"
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace
+{
+bool Overlaps(const CGUIFontGlyphAtlas::Slot &a, const CGUIFontGlyphAtlas::Slot &b)
+{
+  return a.x < b.x + b.width && b.x < a.x + a.width &&
+         a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+/* Caches the glyphs of a face the way CGUIFontTTFBase does, but without a texture:
+   only the texture size is tracked. The layout of the previous fixed height lines
+   is followed alongside for comparison. */
+class CGlyphCache
+{
+public:
+  CGlyphCache(FT_Face face, unsigned int maxHeight, bool reuseSlots)
+    : m_face(face), m_maxHeight(maxHeight), m_reuseSlots(reuseSlots)
+  {
+    int descender = std::min<int>(face->bbox.yMin, face->descender);
+    int ascender = std::max<int>(face->bbox.yMax, face->ascender);
+    float scaler = (float)face->size->metrics.y_ppem / face->units_per_EM;
+    m_lineHeight = (unsigned int)(ascender * scaler + 0.5f) - (int)(descender * scaler - 0.5f) + 1;
+    m_width = 64;
+    while (m_width < (((m_lineHeight - 1) * 20) & ~63) + 64)
+      m_width *= 2;
+    m_width = std::min(m_width, maxHeight);
+    Clear();
+  }
+
+  void Clear()
+  {
+    m_atlas.Reset(m_width, m_maxHeight);
+    m_glyphs.clear();
+    m_textureHeight = 0;
+    m_lineX = m_width;
+    m_lineY = -(int)m_lineHeight;
+    m_lineTextureHeight = 0;
+    m_atlas.SetTextureSize(0, 0);
+  }
+
+  void Draw(const std::wstring &text)
+  {
+    m_atlas.BeginPass();
+    for (std::wstring::const_iterator it = text.begin(); it != text.end(); ++it)
+      DrawGlyph(*it);
+  }
+
+  const CGUIFontGlyphAtlas &GetAtlas() const { return m_atlas; }
+  uint64_t GetLineBytes() const { return (uint64_t)m_width * m_lineTextureHeight; }
+
+private:
+  void DrawGlyph(wchar_t letter)
+  {
+    std::map<wchar_t, unsigned int>::const_iterator it = m_glyphs.find(letter);
+    if (it != m_glyphs.end() &&
+        (it->second == CGUIFontGlyphAtlas::NO_SLOT || m_atlas.GetSlot(it->second).owner == (uint32_t)letter))
+    {
+      m_atlas.Touch(it->second);
+      return;
+    }
+
+    m_atlas.CountMiss();
+    ASSERT_EQ(0, FT_Load_Char(m_face, letter, FT_LOAD_TARGET_LIGHT | FT_LOAD_RENDER));
+    const FT_Bitmap &bitmap = m_face->glyph->bitmap;
+    unsigned int slot = CGUIFontGlyphAtlas::NO_SLOT;
+    if (bitmap.width > 0 && bitmap.rows > 0)
+    {
+      if (!m_atlas.Allocate(bitmap.width + 1, bitmap.rows + 1, slot) &&
+          (!m_reuseSlots || !m_atlas.Evict(bitmap.width + 1, bitmap.rows + 1, slot)))
+      { // start over, as fonts did before slots could be reused
+        Clear();
+        m_atlas.BeginPass();
+        ASSERT_TRUE(m_atlas.Allocate(bitmap.width + 1, bitmap.rows + 1, slot));
+      }
+      m_atlas.SetOwner(slot, letter);
+      if (m_atlas.GetUsedHeight() > m_textureHeight)
+      {
+        m_textureHeight = std::min(std::max(m_atlas.GetUsedHeight(), m_textureHeight + m_lineHeight), m_maxHeight);
+        m_atlas.SetTextureSize(m_width, m_textureHeight);
+      }
+      AddToLine(m_face->glyph->bitmap_left, bitmap.width, m_face->glyph->advance.x / 64);
+    }
+    m_glyphs[letter] = slot;
+  }
+
+  void AddToLine(int left, unsigned int width, int advance)
+  {
+    if (left < 0)
+      m_lineX -= left;
+    if (m_lineX + left + (int)width > (int)m_width)
+    {
+      m_lineX = left < 0 ? -left : 0;
+      m_lineY += m_lineHeight;
+      if (m_lineY + m_lineHeight >= m_lineTextureHeight)
+        m_lineTextureHeight = m_lineY + m_lineHeight;
+    }
+    m_lineX += 1 + std::max<int>(width + left, advance);
+  }
+
+  FT_Face m_face;
+  unsigned int m_maxHeight;
+  bool m_reuseSlots;
+  unsigned int m_lineHeight;
+  unsigned int m_width;
+  unsigned int m_textureHeight;
+  CGUIFontGlyphAtlas m_atlas;
+  std::map<wchar_t, unsigned int> m_glyphs;
+  int m_lineX;
+  int m_lineY;
+  unsigned int m_lineTextureHeight;
+};
+
+struct FontDefinition
+{
+  const char *file;
+  float size;
+};
+
+/* the distinct faces of Estuary's default font set */
+const FontDefinition estuaryFonts[] = {
+  { "NotoSans-Regular.ttf", 23 }, { "NotoSans-Regular.ttf", 25 }, { "NotoSans-Regular.ttf", 27 },
+  { "NotoSans-Regular.ttf", 30 }, { "NotoSans-Regular.ttf", 33 }, { "NotoSans-Regular.ttf", 37 },
+  { "NotoSans-Regular.ttf", 45 }, { "NotoSans-Regular.ttf", 60 }, { "NotoSans-Bold.ttf", 18 },
+  { "NotoSans-Bold.ttf", 20 }, { "NotoSans-Bold.ttf", 25 }, { "NotoSans-Bold.ttf", 30 },
+  { "NotoSans-Bold.ttf", 32 }, { "NotoSans-Bold.ttf", 36 }, { "NotoSans-Bold.ttf", 45 },
+  { "NotoSans-Bold.ttf", 52 }, { "NotoSans-Bold.ttf", 60 }, { "NotoSans-Bold.ttf", 120 },
+};
+
+const wchar_t *titles[] = {
+  L"Amélie", L"Brazil", L"Casablanca", L"Das Boot", L"El laberinto del fauno", L"Fargo",
+  L"Good Will Hunting", L"Heat", L"Inception", L"Jaws", L"Kill Bill: Vol. 1", L"Léon",
+  L"Memento", L"No Country for Old Men", L"Oldboy", L"Psycho", L"Quiz Show", L"Rashōmon",
+  L"Sunshine", L"The Thing", L"Umberto D.", L"Vertigo", L"WALL·E", L"X-Men", L"Yojimbo", L"Zodiac",
+};
+
+const wchar_t plot[] = L"A young woman moves to Montmartre, where she quietly sets out to change the lives "
+                       L"of the people around her, from the grocer's assistant to her lonely neighbour, "
+                       L"while hiding from her own chance at happiness. Ça va être génial, n'est-ce pas?";
+
+struct BenchmarkResult
+{
+  uint64_t bytes;
+  uint64_t lineBytes;
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t evictions;
+};
+
+/* Scroll through a list of titles and the plot of the selected one with every face of the font set */
+BenchmarkResult RenderFontSet(unsigned int maxHeight, bool reuseSlots)
+{
+  FT_Library library;
+  EXPECT_EQ(0, FT_Init_FreeType(&library));
+
+  std::vector<FT_Face> faces;
+  std::vector<CGlyphCache*> caches;
+  for (unsigned int i = 0; i < sizeof(estuaryFonts) / sizeof(estuaryFonts[0]); i++)
+  {
+    std::string path = XBMC_REF_FILE_PATH(std::string("addons/skin.estuary/fonts/") + estuaryFonts[i].file);
+    FT_Face face;
+    if (FT_New_Face(library, path.c_str(), 0, &face))
+    {
+      ADD_FAILURE() << "unable to load " << path;
+      continue;
+    }
+    FT_Set_Char_Size(face, 0, (int)(estuaryFonts[i].size * 64 + 0.5f), 72, 72);
+    faces.push_back(face);
+    caches.push_back(new CGlyphCache(face, maxHeight, reuseSlots));
+  }
+
+  const unsigned int numTitles = sizeof(titles) / sizeof(titles[0]);
+  const std::wstring plotText(plot);
+  for (unsigned int frame = 0; frame < 600; frame++)
+  {
+    unsigned int selected = (frame / 12) % numTitles;
+    for (unsigned int i = 0; i < caches.size(); i++)
+    {
+      for (unsigned int row = 0; row < 8; row++)
+        caches[i]->Draw(titles[(selected + row) % numTitles]);
+      caches[i]->Draw(plotText.substr(frame % plotText.size(), 48));
+      caches[i]->Draw(std::to_wstring(frame / 60 % 24) + L":" + std::to_wstring(frame % 60));
+    }
+  }
+
+  BenchmarkResult result = { 0, 0, 0, 0, 0 };
+  for (unsigned int i = 0; i < caches.size(); i++)
+  {
+    const CGUIFontGlyphAtlas::Stats &stats = caches[i]->GetAtlas().GetStats();
+    result.bytes += stats.bytes;
+    result.lineBytes += caches[i]->GetLineBytes();
+    result.hits += stats.hits;
+    result.misses += stats.misses;
+    result.evictions += stats.evictions;
+    delete caches[i];
+    FT_Done_Face(faces[i]);
+  }
+  FT_Done_FreeType(library);
+  return result;
+}
+}
+
+TEST(TestGUIFontGlyphAtlas, PacksWithoutOverlap)
+{
+  CGUIFontGlyphAtlas atlas;
+  atlas.Reset(256, 4096);
+
+  std::mt19937 random(42);
+  std::uniform_int_distribution<unsigned int> width(1, 40), height(1, 50);
+  for (unsigned int i = 0; i < 500; i++)
+  {
+    unsigned int slot;
+    ASSERT_TRUE(atlas.Allocate(width(random), height(random), slot));
+    EXPECT_EQ(i, slot);
+  }
+
+  unsigned int area = 0;
+  for (unsigned int i = 0; i < atlas.GetNumSlots(); i++)
+  {
+    const CGUIFontGlyphAtlas::Slot &slot = atlas.GetSlot(i);
+    EXPECT_LE(slot.x + slot.width, 256U);
+    EXPECT_LE(slot.y + slot.height, atlas.GetUsedHeight());
+    area += slot.width * slot.height;
+    for (unsigned int j = 0; j < i; j++)
+      EXPECT_FALSE(Overlaps(slot, atlas.GetSlot(j))) << "slots " << i << " and " << j;
+  }
+  // the skyline should waste less than a third of the used area
+  EXPECT_GT(area, atlas.GetUsedHeight() * 256 * 2 / 3);
+}
+
+TEST(TestGUIFontGlyphAtlas, FillsGapsBelowTallGlyphs)
+{
+  CGUIFontGlyphAtlas atlas;
+  atlas.Reset(64, 256);
+
+  unsigned int tall, small1, small2;
+  ASSERT_TRUE(atlas.Allocate(32, 40, tall));
+  ASSERT_TRUE(atlas.Allocate(32, 10, small1));
+  ASSERT_TRUE(atlas.Allocate(32, 10, small2));
+  EXPECT_EQ(32U, atlas.GetSlot(small1).x);
+  EXPECT_EQ(0U, atlas.GetSlot(small1).y);
+  EXPECT_EQ(32U, atlas.GetSlot(small2).x);
+  EXPECT_EQ(10U, atlas.GetSlot(small2).y);
+  EXPECT_EQ(40U, atlas.GetUsedHeight());
+}
+
+TEST(TestGUIFontGlyphAtlas, StopsAtMaxHeight)
+{
+  CGUIFontGlyphAtlas atlas;
+  atlas.Reset(32, 64);
+
+  unsigned int slot;
+  for (unsigned int i = 0; i < 4; i++)
+    ASSERT_TRUE(atlas.Allocate(32, 16, slot));
+  EXPECT_EQ(64U, atlas.GetUsedHeight());
+  EXPECT_FALSE(atlas.Allocate(1, 1, slot));
+  EXPECT_FALSE(atlas.Allocate(33, 1, slot));
+}
+
+TEST(TestGUIFontGlyphAtlas, EvictsLeastRecentlyUsed)
+{
+  CGUIFontGlyphAtlas atlas;
+  atlas.Reset(40, 10);
+
+  unsigned int slots[4];
+  for (unsigned int i = 0; i < 4; i++)
+  {
+    ASSERT_TRUE(atlas.Allocate(10, 10, slots[i]));
+    atlas.SetOwner(slots[i], 'a' + i);
+  }
+
+  atlas.BeginPass();
+  atlas.Touch(slots[0]);
+  atlas.Touch(slots[2]);
+  atlas.BeginPass();
+  atlas.Touch(slots[2]);
+  atlas.BeginPass();
+  atlas.Touch(slots[3]);
+
+  // slot 1 hasn't been used since it was filled
+  unsigned int slot;
+  ASSERT_TRUE(atlas.Evict(8, 8, slot));
+  EXPECT_EQ(slots[1], slot);
+  EXPECT_EQ((uint32_t)'b', atlas.GetSlot(slot).owner);
+  atlas.SetOwner(slot, 'e');
+
+  // then slot 0, used two passes ago
+  ASSERT_TRUE(atlas.Evict(10, 10, slot));
+  EXPECT_EQ(slots[0], slot);
+  ASSERT_TRUE(atlas.Evict(10, 10, slot));
+  EXPECT_EQ(slots[2], slot);
+
+  // the rest has been used in this pass
+  EXPECT_FALSE(atlas.Evict(10, 10, slot));
+  EXPECT_EQ(3U, atlas.GetStats().evictions);
+}
+
+TEST(TestGUIFontGlyphAtlas, EvictsOnlySlotsThatFit)
+{
+  CGUIFontGlyphAtlas atlas;
+  atlas.Reset(30, 20);
+
+  unsigned int small, large;
+  ASSERT_TRUE(atlas.Allocate(10, 10, small));
+  ASSERT_TRUE(atlas.Allocate(20, 20, large));
+  atlas.BeginPass();
+
+  unsigned int slot;
+  ASSERT_TRUE(atlas.Evict(15, 12, slot));
+  EXPECT_EQ(large, slot);
+  EXPECT_FALSE(atlas.Evict(15, 12, slot));
+
+  // the small slot is older, but too small
+  atlas.BeginPass();
+  ASSERT_TRUE(atlas.Evict(15, 12, slot));
+  EXPECT_EQ(large, slot);
+  ASSERT_TRUE(atlas.Evict(5, 5, slot));
+  EXPECT_EQ(small, slot);
+}
+
+TEST(TestGUIFontGlyphAtlas, CountsTextureMemory)
+{
+  uint64_t before = CGUIFontGlyphAtlas::GetTotals().bytes;
+  {
+    CGUIFontGlyphAtlas atlas1, atlas2;
+    atlas1.SetTextureSize(256, 64);
+    atlas2.SetTextureSize(512, 32);
+    EXPECT_EQ(before + 256 * 64 + 512 * 32, CGUIFontGlyphAtlas::GetTotals().bytes);
+    atlas1.SetTextureSize(256, 128);
+    EXPECT_EQ(256U * 128, atlas1.GetStats().bytes);
+    EXPECT_EQ(before + 256 * 128 + 512 * 32, CGUIFontGlyphAtlas::GetTotals().bytes);
+  }
+  EXPECT_EQ(before, CGUIFontGlyphAtlas::GetTotals().bytes);
+}
+
+TEST(TestGUIFontGlyphAtlas, CountsHits)
+{
+  CGUIFontGlyphAtlas atlas;
+  atlas.Reset(64, 64);
+
+  unsigned int slot;
+  atlas.CountMiss();
+  ASSERT_TRUE(atlas.Allocate(8, 8, slot));
+  atlas.Touch(slot);
+  atlas.Touch(slot);
+  atlas.Touch(CGUIFontGlyphAtlas::NO_SLOT);
+  EXPECT_EQ(3U, atlas.GetStats().hits);
+  EXPECT_EQ(1U, atlas.GetStats().misses);
+}
+
+TEST(TestGUIFontGlyphAtlas, DISABLED_SkinFontSet)
+{
+  BenchmarkResult result = RenderFontSet(4096, true);
+  double hitRatio = (double)result.hits / (result.hits + result.misses);
+  std::cout << "glyph textures: " << result.bytes / 1024 << " kB packed, "
+            << result.lineBytes / 1024 << " kB in lines, "
+            << 100.0 * hitRatio << "% glyph hits" << std::endl;
+  EXPECT_LT(result.bytes, result.lineBytes);
+  EXPECT_GT(hitRatio, 0.95);
+  EXPECT_EQ(0U, result.evictions);
+}
+
+TEST(TestGUIFontGlyphAtlas, DISABLED_SkinFontSetInSmallTextures)
+{
+  BenchmarkResult reused = RenderFontSet(512, true);
+  BenchmarkResult cleared = RenderFontSet(512, false);
+  std::cout << "512 pixel glyph textures: " << reused.misses << " glyphs rendered reusing "
+            << reused.evictions << " slots, " << cleared.misses << " when clearing" << std::endl;
+  EXPECT_GT(reused.evictions, 0U);
+  EXPECT_LT(reused.misses, cleared.misses);
+}
@@ -0,0 +1,196 @@
+/*
+ *      Copyright (C) 2017 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kodi; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "guilib/GUIQuadBatch.h"
+
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace
+{
+CGUIQuadBatch::State MakeState(unsigned int texture, unsigned int diffuse = 0)
+{
+  CGUIQuadBatch::State state = { texture, diffuse };
+  return state;
+}
+
+/* Queue a quad, tagging its vertices with an id in the texture coordinates */
+void AddQuad(CGUIQuadBatch &batch, const CGUIQuadBatch::State &state, const CRect &rect, float id, float z = 0.0f)
+{
+  CGUIQuadBatch::Vertex quad[4];
+  float x[4] = { rect.x1, rect.x2, rect.x2, rect.x1 };
+  float y[4] = { rect.y1, rect.y1, rect.y2, rect.y2 };
+  for (int i = 0; i < 4; i++)
+  {
+    quad[i].x = x[i];
+    quad[i].y = y[i];
+    quad[i].z = z;
+    quad[i].u1 = id;
+    quad[i].v1 = id;
+    quad[i].u2 = 0;
+    quad[i].v2 = 0;
+    quad[i].r = quad[i].g = quad[i].b = quad[i].a = 255;
+  }
+  batch.Add(state, quad);
+}
+}
+
+TEST(TestGUIQuadBatch, MergesSameTextures)
+{
+  CGUIQuadBatch batch;
+  for (int i = 0; i < 100; i++)
+    AddQuad(batch, MakeState(1), CRect(i * 10.0f, 0, i * 10.0f + 5, 5), i);
+
+  std::vector<CGUIQuadBatch::Vertex> vertices;
+  const std::vector<CGUIQuadBatch::Batch> &batches = batch.Prepare(vertices);
+  ASSERT_EQ(1U, batches.size());
+  EXPECT_EQ(400U, batches[0].count);
+  EXPECT_EQ(400U, vertices.size());
+}
+
+TEST(TestGUIQuadBatch, SortsApartQuadsByTexture)
+{
+  CGUIQuadBatch batch;
+  // a row of icons with alternating textures, none overlapping
+  for (int i = 0; i < 10; i++)
+    AddQuad(batch, MakeState(1 + i % 2), CRect(i * 10.0f, 0, i * 10.0f + 5, 5), i);
+
+  std::vector<CGUIQuadBatch::Vertex> vertices;
+  EXPECT_EQ(2U, batch.Prepare(vertices).size());
+}
+
+TEST(TestGUIQuadBatch, KeepsOrderOfOverlappingQuads)
+{
+  CGUIQuadBatch batch;
+  AddQuad(batch, MakeState(1), CRect(0, 0, 10, 10), 0);
+  AddQuad(batch, MakeState(2), CRect(5, 5, 15, 15), 1);
+  AddQuad(batch, MakeState(1), CRect(8, 8, 20, 20), 2);
+
+  std::vector<CGUIQuadBatch::Vertex> vertices;
+  const std::vector<CGUIQuadBatch::Batch> &batches = batch.Prepare(vertices);
+  ASSERT_EQ(3U, batches.size());
+  EXPECT_EQ(1U, batches[0].state.texture);
+  EXPECT_EQ(2U, batches[1].state.texture);
+  EXPECT_EQ(1U, batches[2].state.texture);
+}
+
+TEST(TestGUIQuadBatch, DiffuseIsPartOfTheState)
+{
+  CGUIQuadBatch batch;
+  AddQuad(batch, MakeState(1), CRect(0, 0, 5, 5), 0);
+  AddQuad(batch, MakeState(1, 3), CRect(10, 0, 15, 5), 1);
+
+  std::vector<CGUIQuadBatch::Vertex> vertices;
+  EXPECT_EQ(2U, batch.Prepare(vertices).size());
+}
+
+TEST(TestGUIQuadBatch, DoesNotReorderProjectedQuads)
+{
+  CGUIQuadBatch batch;
+  // rotated in 3D, the second quad may end up anywhere on screen
+  AddQuad(batch, MakeState(1), CRect(0, 0, 5, 5), 0);
+  AddQuad(batch, MakeState(2), CRect(10, 0, 15, 5), 1, 1.0f);
+  AddQuad(batch, MakeState(1), CRect(20, 0, 25, 5), 2);
+
+  std::vector<CGUIQuadBatch::Vertex> vertices;
+  EXPECT_EQ(3U, batch.Prepare(vertices).size());
+}
+
+TEST(TestGUIQuadBatch, ClearedAfterFlush)
+{
+  CGUIQuadBatch batch;
+  AddQuad(batch, MakeState(1), CRect(0, 0, 5, 5), 0);
+  EXPECT_FALSE(batch.IsEmpty());
+  batch.Clear();
+  EXPECT_TRUE(batch.IsEmpty());
+
+  std::vector<CGUIQuadBatch::Vertex> vertices;
+  EXPECT_TRUE(batch.Prepare(vertices).empty());
+}
+
+TEST(TestGUIQuadBatch, OverlappingQuadsDrawnInOrder)
+{
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<float> position(0.0f, 1000.0f);
+  std::uniform_real_distribution<float> size(5.0f, 100.0f);
+  std::uniform_int_distribution<unsigned int> texture(1, 12);
+
+  const unsigned int count = 2000;
+  std::vector<CRect> rects;
+  CGUIQuadBatch batch;
+  for (unsigned int i = 0; i < count; i++)
+  {
+    float x = position(generator), y = position(generator);
+    rects.push_back(CRect(x, y, x + size(generator), y + size(generator)));
+    AddQuad(batch, MakeState(texture(generator)), rects.back(), i);
+  }
+
+  std::vector<CGUIQuadBatch::Vertex> vertices;
+  batch.Prepare(vertices);
+  ASSERT_EQ(count * 4, vertices.size());
+
+  // the position each quad ends up being drawn at
+  std::vector<unsigned int> drawn(count);
+  for (unsigned int i = 0; i < count; i++)
+    drawn[static_cast<unsigned int>(vertices[i * 4].u1)] = i;
+
+  unsigned int misordered = 0;
+  for (unsigned int a = 0; a < count; a++)
+  {
+    for (unsigned int b = a + 1; b < count; b++)
+    {
+      bool overlap = rects[a].x1 < rects[b].x2 && rects[b].x1 < rects[a].x2 &&
+                     rects[a].y1 < rects[b].y2 && rects[b].y1 < rects[a].y2;
+      if (overlap && drawn[a] > drawn[b])
+        misordered++;
+    }
+  }
+  EXPECT_EQ(0U, misordered);
+}
+
+TEST(TestGUIQuadBatch, DrawsPerHomeScreen)
+{
+  // a home screen like layout: a background, rows of posters each with a shadow, frame and
+  // overlay, and a text like strip of small icons
+  CGUIQuadBatch batch;
+  unsigned int quads = 0;
+  AddQuad(batch, MakeState(1), CRect(0, 0, 1920, 1080), quads++);
+  for (int row = 0; row < 4; row++)
+  {
+    for (int column = 0; column < 10; column++)
+    {
+      float x = 40.0f + column * 185.0f, y = 100.0f + row * 240.0f;
+      AddQuad(batch, MakeState(2), CRect(x - 5, y - 5, x + 175, y + 235), quads++);      // shadow
+      AddQuad(batch, MakeState(100 + row * 10 + column), CRect(x, y, x + 170, y + 230), quads++); // poster
+      AddQuad(batch, MakeState(3), CRect(x, y, x + 170, y + 230), quads++);              // frame
+      AddQuad(batch, MakeState(4), CRect(x + 140, y + 5, x + 165, y + 30), quads++);     // watched overlay
+    }
+  }
+  for (int i = 0; i < 60; i++)
+    AddQuad(batch, MakeState(5 + i % 3), CRect(i * 30.0f, 1050, i * 30.0f + 20, 1070), quads++);
+
+  std::vector<CGUIQuadBatch::Vertex> vertices;
+  unsigned int draws = batch.Prepare(vertices).size();
+  std::cout << quads << " quads drawn in " << draws << " draws" << std::endl;
+  EXPECT_LT(draws, quads / 2);
+}
@@ -20,10 +20,15 @@
 
 #include "AnnouncementManager.h"
 #include "threads/SingleLock.h"
+#include "threads/SystemClock.h"
+#include <algorithm>
 #include <stdio.h>
+#include <string.h>
+#include "utils/JobManager.h"
 #include "utils/log.h"
 #include "utils/Variant.h"
 #include "utils/StringUtils.h"
+#include "Application.h"
 #include "FileItem.h"
 #include "music/tags/MusicInfoTag.h"
 #include "music/MusicDatabase.h"
@@ -36,7 +41,177 @@
 
 using namespace ANNOUNCEMENT;
 
-CAnnouncementManager::CAnnouncementManager() : CThread("Announce")
+namespace
+{
+// announcements waiting for the announcement thread before Announce() holds back the caller
+const size_t MaxQueuedAnnouncements = 4096;
+// longest time Announce() holds back the caller for
+const unsigned int MaxQueueWait = 1000;
+// announcements waiting for an announcer before the oldest library update is dropped
+const size_t MaxQueuedPerAnnouncer = 1024;
+// queued announcements are replaced by duplicates announced within this many ms
+const unsigned int CoalescingWindow = 1000;
+// library updates are coalesced, and dropped by announcers that can't keep up. Scans send lots of these.
+const int CoalescedFlags = VideoLibrary | AudioLibrary;
+const char *CoalescedMessage = "OnUpdate";
+}
+
+bool CAnnouncementManager::CAnnouncementQueue::Push(const AnnouncementPtr &announcement)
+{
+  if (announcement->key.empty())
+  {
+    m_announcements.push_back(announcement);
+    return false;
+  }
+
+  bool replaced = false;
+  std::unordered_map<std::string, Announcements::iterator>::iterator queued = m_keys.find(announcement->key);
+  if (queued != m_keys.end())
+  {
+    const CAnnounceData &duplicate = **queued->second;
+    if (announcement->queued - duplicate.queued < CoalescingWindow && announcement->data == duplicate.data)
+    {
+      m_announcements.erase(queued->second);
+      replaced = true;
+    }
+  }
+
+  m_announcements.push_back(announcement);
+  m_keys[announcement->key] = --m_announcements.end();
+  return replaced;
+}
+
+bool CAnnouncementManager::CAnnouncementQueue::Pop(AnnouncementPtr &announcement)
+{
+  if (m_announcements.empty())
+    return false;
+
+  announcement = m_announcements.front();
+  if (!announcement->key.empty())
+  {
+    // a later announcement with the same key that isn't a duplicate takes over the key
+    std::unordered_map<std::string, Announcements::iterator>::iterator queued = m_keys.find(announcement->key);
+    if (queued != m_keys.end() && queued->second == m_announcements.begin())
+      m_keys.erase(queued);
+  }
+  m_announcements.pop_front();
+  return true;
+}
+
+bool CAnnouncementManager::CAnnouncementQueue::DropOldestCoalesced()
+{
+  for (Announcements::iterator it = m_announcements.begin(); it != m_announcements.end(); ++it)
+  {
+    if ((*it)->key.empty())
+      continue;
+
+    std::unordered_map<std::string, Announcements::iterator>::iterator queued = m_keys.find((*it)->key);
+    if (queued != m_keys.end() && queued->second == it)
+      m_keys.erase(queued);
+    m_announcements.erase(it);
+    return true;
+  }
+  return false;
+}
+
+CAnnouncementManager::CSubscriber::CSubscriber(IAnnouncer *announcer, unsigned int maxPerSecond)
+  : m_announcer(announcer),
+    m_delivered(0),
+    m_maxPerSecond(maxPerSecond),
+    m_scheduled(false),
+    m_removed(false),
+    m_calling(false),
+    m_callingThread(0),
+    m_tokens(maxPerSecond),
+    m_refilled(XbmcThreads::SystemClockMillis())
+{
+}
+
+bool CAnnouncementManager::CSubscriber::Push(const AnnouncementPtr &announcement, bool &coalesced, bool &dropped)
+{
+  CSingleLock lock(m_section);
+  if (m_removed)
+    return false;
+
+  // only library updates are dropped, other announcements like OnQuit or OnStop must get through
+  coalesced = m_queue.Push(announcement);
+  dropped = m_queue.Size() > MaxQueuedPerAnnouncer && m_queue.DropOldestCoalesced();
+
+  if (m_scheduled)
+    return false;
+  m_scheduled = true;
+  return true;
+}
+
+bool CAnnouncementManager::CSubscriber::TakeToken()
+{
+  if (m_maxPerSecond == 0)
+    return true;
+
+  unsigned int now = XbmcThreads::SystemClockMillis();
+  uint64_t refill = (uint64_t)(now - m_refilled) * m_maxPerSecond / 1000;
+  if (m_tokens + refill >= m_maxPerSecond)
+  {
+    m_tokens = m_maxPerSecond;
+    m_refilled = now;
+  }
+  else if (refill > 0)
+  {
+    m_tokens += (unsigned int)refill;
+    m_refilled += (unsigned int)(refill * 1000 / m_maxPerSecond);
+  }
+
+  if (m_tokens == 0)
+    return false;
+  m_tokens--;
+  return true;
+}
+
+void CAnnouncementManager::CSubscriber::Deliver()
+{
+  CSingleLock lock(m_section);
+  while (!m_removed && m_queue.Size() > 0)
+  {
+    // wait for the rate limit, duplicates announced meanwhile replace the queued ones
+    if (!TakeToken())
+    {
+      CSingleExit exit(m_section);
+      m_wakeUp.WaitMSec(1000 / m_maxPerSecond + 1);
+      continue;
+    }
+
+    AnnouncementPtr announcement;
+    m_queue.Pop(announcement);
+    m_delivered++;
+    m_calling = true;
+    m_callingThread = CThread::GetCurrentThreadId();
+    {
+      CSingleExit exit(m_section);
+      m_announcer->Announce(announcement->flag, announcement->sender.c_str(), announcement->message.c_str(), announcement->data);
+    }
+    m_calling = false;
+    m_callDone.notifyAll();
+  }
+  m_scheduled = false;
+}
+
+void CAnnouncementManager::CSubscriber::Remove()
+{
+  CSingleLock lock(m_section);
+  m_removed = true;
+  m_wakeUp.Set();
+
+  // the announcer may be freed once we return, unless it's removing itself while it's called
+  while (m_calling && !CThread::IsCurrentThread(m_callingThread))
+    m_callDone.wait(lock);
+}
+
+CAnnouncementManager::CAnnouncementManager() : CThread("Announce"),
+  m_announced(0),
+  m_coalesced(0),
+  m_removedDelivered(0),
+  m_dropped(0),
+  m_blocked(0)
 {
 }
 
@@ -59,18 +234,28 @@ void CAnnouncementManager::Deinitialize()
 {
   m_bStop = true;
   m_queueEvent.Set();
+  m_queueSpace.Set();
   StopThread();
-  CSingleLock lock (m_critSection);
-  m_announcers.clear();
+
+  std::vector<SubscriberPtr> announcers;
+  {
+    CSingleLock lock (m_critSection);
+    announcers.swap(m_announcers);
+  }
+  for (std::vector<SubscriberPtr>::const_iterator it = announcers.begin(); it != announcers.end(); ++it)
+  {
+    (*it)->Remove();
+    m_removedDelivered += (*it)->m_delivered;
+  }
 }
 
-void CAnnouncementManager::AddAnnouncer(IAnnouncer *listener)
+void CAnnouncementManager::AddAnnouncer(IAnnouncer *listener, unsigned int maxPerSecond /* = 0 */)
 {
   if (!listener)
     return;
 
   CSingleLock lock (m_critSection);
-  m_announcers.push_back(listener);
+  m_announcers.push_back(std::make_shared<CSubscriber>(listener, maxPerSecond));
 }
 
 void CAnnouncementManager::RemoveAnnouncer(IAnnouncer *listener)
@@ -78,15 +263,25 @@ void CAnnouncementManager::RemoveAnnouncer(IAnnouncer *listener)
   if (!listener)
     return;
 
-  CSingleLock lock (m_critSection);
-  for (unsigned int i = 0; i < m_announcers.size(); i++)
+  SubscriberPtr subscriber;
   {
-    if (m_announcers[i] == listener)
+    CSingleLock lock (m_critSection);
+    for (unsigned int i = 0; i < m_announcers.size(); i++)
     {
-      m_announcers.erase(m_announcers.begin() + i);
-      return;
+      if (m_announcers[i]->m_announcer == listener)
+      {
+        subscriber = m_announcers[i];
+        m_announcers.erase(m_announcers.begin() + i);
+        break;
+      }
     }
   }
+
+  if (subscriber)
+  {
+    subscriber->Remove();
+    m_removedDelivered += subscriber->m_delivered;
+  }
 }
 
 void CAnnouncementManager::Announce(AnnouncementFlag flag, const char *sender, const char *message)
@@ -108,42 +303,102 @@ void CAnnouncementManager::Announce(AnnouncementFlag flag, const char *sender, c
 
 void CAnnouncementManager::Announce(AnnouncementFlag flag, const char *sender, const char *message, const std::shared_ptr<const CFileItem>& item, const CVariant &data)
 {
-  CAnnounceData announcement;
-  announcement.flag = flag;
-  announcement.sender = sender;
-  announcement.message = message;
-  announcement.data = data;
+  std::shared_ptr<CAnnounceData> announcement = std::make_shared<CAnnounceData>();
+  announcement->flag = flag;
+  announcement->sender = sender;
+  announcement->message = message;
+  announcement->data = data;
+  announcement->queued = XbmcThreads::SystemClockMillis();
 
   if (item != nullptr)
-    announcement.item = CFileItemPtr(new CFileItem(*item));
+    announcement->item = CFileItemPtr(new CFileItem(*item));
+
+  if ((flag & CoalescedFlags) && strcmp(message, CoalescedMessage) == 0)
+  {
+    announcement->key = StringUtils::Format("%d|%s|%s", flag, sender, message);
+    if (item != nullptr)
+      announcement->key += "|" + item->GetPath();
+  }
 
   {
     CSingleLock lock (m_critSection);
-    m_announcementQueue.push_back(announcement);
+
+    // hold back a scanner for a while if the announcement thread can't keep up. Other announcements
+    // are never held back, nor is the application thread, which would stall rendering.
+    if ((flag & CoalescedFlags) && m_announcementQueue.Size() >= MaxQueuedAnnouncements &&
+        IsRunning() && !IsCurrentThread() && !g_application.IsCurrentThread())
+    {
+      m_blocked++;
+      XbmcThreads::EndTime timeout(MaxQueueWait);
+      while (m_announcementQueue.Size() >= MaxQueuedAnnouncements && !m_bStop && !timeout.IsTimePast())
+      {
+        CSingleExit ex(m_critSection);
+        m_queueSpace.WaitMSec(timeout.MillisLeft());
+      }
+    }
+
+    if (m_announcementQueue.Push(announcement))
+      m_coalesced++;
+    m_announced++;
   }
   m_queueEvent.Set();
 }
 
-void CAnnouncementManager::DoAnnounce(AnnouncementFlag flag, const char *sender, const char *message, const CVariant &data)
+CAnnouncementManager::Stats CAnnouncementManager::GetStats() const
 {
-  CLog::Log(LOGDEBUG, "CAnnouncementManager - Announcement: %s from %s", message, sender);
+  Stats stats;
+  stats.announced = m_announced;
+  stats.coalesced = m_coalesced;
+  stats.delivered = m_removedDelivered;
+  stats.dropped = m_dropped;
+  stats.blocked = m_blocked;
 
   CSingleLock lock (m_critSection);
+  for (std::vector<SubscriberPtr>::const_iterator it = m_announcers.begin(); it != m_announcers.end(); ++it)
+    stats.delivered += (*it)->m_delivered;
+  return stats;
+}
+
+void CAnnouncementManager::Dispatch(const AnnouncementPtr &announcement)
+{
+  CLog::Log(LOGDEBUG, "CAnnouncementManager - Announcement: %s from %s", announcement->message.c_str(), announcement->sender.c_str());
 
-  // Make a copy of announers. They may be removed or even remove themselves during execution of IAnnouncer::Announce()!
-  std::vector<IAnnouncer *> announcers(m_announcers);
-  for (unsigned int i = 0; i < announcers.size(); i++)
-    announcers[i]->Announce(flag, sender, message, data);
+  // Make a copy of announcers. They may be removed or even remove themselves while they're called!
+  std::vector<SubscriberPtr> announcers;
+  {
+    CSingleLock lock (m_critSection);
+    announcers = m_announcers;
+  }
+
+  for (std::vector<SubscriberPtr>::const_iterator it = announcers.begin(); it != announcers.end(); ++it)
+  {
+    bool coalesced = false;
+    bool dropped = false;
+    if ((*it)->Push(announcement, coalesced, dropped))
+    {
+      // a worker of its own, announcers may block on slow clients
+      SubscriberPtr subscriber = *it;
+      CJobManager::GetInstance().Submit([subscriber]() { subscriber->Deliver(); }, CJob::PRIORITY_DEDICATED);
+    }
+    if (coalesced)
+      m_coalesced++;
+    if (dropped && m_dropped++ % MaxQueuedPerAnnouncer == 0)
+      CLog::Log(LOGWARNING, "CAnnouncementManager - announcer can't keep up, dropped %s from %s",
+                announcement->message.c_str(), announcement->sender.c_str());
+  }
 }
 
-void CAnnouncementManager::DoAnnounce(AnnouncementFlag flag, const char *sender, const char *message, CFileItemPtr item, const CVariant &data)
+void CAnnouncementManager::DoAnnounce(const AnnouncementPtr &announcement)
 {
-  if (item == nullptr)
+  if (announcement->item == nullptr)
   {
-    DoAnnounce(flag, sender, message, data);
+    Dispatch(announcement);
     return;
   }
 
+  CFileItemPtr item = announcement->item;
+  const CVariant &data = announcement->data;
+
   // Extract db id of item
   CVariant object = data.isNull() || data.isObject() ? data : CVariant::VariantTypeObject;
   std::string type;
@@ -280,7 +535,10 @@ void CAnnouncementManager::DoAnnounce(AnnouncementFlag flag, const char *sender,
   if (id > 0)
     object["item"]["id"] = id;
 
-  DoAnnounce(flag, sender, message, object);
+  std::shared_ptr<CAnnounceData> resolved = std::make_shared<CAnnounceData>(*announcement);
+  resolved->item.reset();
+  resolved->data = std::move(object);
+  Dispatch(resolved);
 }
 
 void CAnnouncementManager::Process()
@@ -290,14 +548,12 @@ void CAnnouncementManager::Process()
   while (!m_bStop)
   {
     CSingleLock lock (m_critSection);
-    if (!m_announcementQueue.empty())
+    AnnouncementPtr announcement;
+    if (m_announcementQueue.Pop(announcement))
     {
-      auto announcement = m_announcementQueue.front();
-      m_announcementQueue.pop_front();
-      {
-        CSingleExit ex(m_critSection);
-        DoAnnounce(announcement.flag, announcement.sender.c_str(), announcement.message.c_str(), announcement.item, announcement.data);
-      }
+      m_queueSpace.Set();
+      CSingleExit ex(m_critSection);
+      DoAnnounce(announcement);
     }
     else
     {
@@ -18,10 +18,17 @@
  *  <http://www.gnu.org/licenses/>.
  *
  */
+#include <atomic>
+#include <list>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "IAnnouncer.h"
 #include "FileItem.h"
+#include "threads/Condition.h"
 #include "threads/CriticalSection.h"
 #include "threads/Thread.h"
 #include "threads/Event.h"
@@ -31,9 +38,30 @@ class CVariant;
 
 namespace ANNOUNCEMENT
 {
+  /*!
+   \brief Passes announcements on to the announcers.
+
+   Announce() only queues the announcement. The announcement thread looks up the item of the
+   announcement and queues the result for each announcer, which is called from a job of its own, so
+   a slow announcer doesn't hold up the others. Library updates that are still queued are replaced
+   by later duplicates, and announcers can be limited to a number of announcements per second.
+   */
   class CAnnouncementManager : public CThread
   {
   public:
+    /*!
+     \brief Counters of the announcements handled, to check how well the announcers keep up.
+     \sa GetStats()
+     */
+    struct Stats
+    {
+      uint64_t announced;  ///< announcements queued by Announce()
+      uint64_t coalesced;  ///< queued announcements replaced by a later duplicate
+      uint64_t delivered;  ///< announcements passed to an announcer
+      uint64_t dropped;    ///< library updates dropped from the full queue of an announcer
+      uint64_t blocked;    ///< times Announce() held back a library update for room in the queue
+    };
+
     CAnnouncementManager();
     virtual ~CAnnouncementManager();
 
@@ -42,7 +70,18 @@ namespace ANNOUNCEMENT
     void Start();
     void Deinitialize();
 
-    void AddAnnouncer(IAnnouncer *listener);
+    /*!
+     \brief Add an announcer to pass announcements to.
+     \param listener the announcer.
+     \param maxPerSecond the maximum number of announcements passed to the announcer per second, 0 for no limit.
+     */
+    void AddAnnouncer(IAnnouncer *listener, unsigned int maxPerSecond = 0);
+    /*!
+     \brief Remove an announcer.
+     Once removed it isn't called again. Waits for a call that's in progress on another thread, so the
+     announcer may be freed afterwards, but mustn't be called while holding locks that the announcer takes.
+     An announcer may remove itself while it's called.
+     */
     void RemoveAnnouncer(IAnnouncer *listener);
 
     void Announce(AnnouncementFlag flag, const char *sender, const char *message);
@@ -52,11 +91,12 @@ namespace ANNOUNCEMENT
     void Announce(AnnouncementFlag flag, const char *sender, const char *message,
         const std::shared_ptr<const CFileItem>& item, const CVariant &data);
 
-  protected:
-    void Process();
-    void DoAnnounce(AnnouncementFlag flag, const char *sender, const char *message, CFileItemPtr item, const CVariant &data);
-    void DoAnnounce(AnnouncementFlag flag, const char *sender, const char *message, const CVariant &data);
+    /*!
+     \brief Get the counters of the announcements handled since the manager was created.
+     */
+    Stats GetStats() const;
 
+  protected:
     struct CAnnounceData
     {
       AnnouncementFlag flag;
@@ -64,15 +104,94 @@ namespace ANNOUNCEMENT
       std::string message;
       CFileItemPtr item;
       CVariant data;
+      std::string key;     ///< identifies duplicates, empty if the announcement isn't coalesced
+      unsigned int queued; ///< time the announcement was queued by Announce()
+    };
+    typedef std::shared_ptr<const CAnnounceData> AnnouncementPtr;
+
+    /*!
+     \brief Queue of announcements replacing a queued announcement by a later duplicate.
+     The duplicate has the same key and data, and is queued within the coalescing window of the first.
+     It takes the place of the first at the back of the queue, so it's still passed on after any
+     announcements queued in between.
+     */
+    class CAnnouncementQueue
+    {
+    public:
+      /*! \return true if a duplicate was replaced */
+      bool Push(const AnnouncementPtr &announcement);
+      bool Pop(AnnouncementPtr &announcement);
+      /*! \brief Drop the oldest announcement that may be coalesced, other announcements are never dropped. */
+      bool DropOldestCoalesced();
+      size_t Size() const { return m_announcements.size(); }
+
+    private:
+      typedef std::list<AnnouncementPtr> Announcements;
+      Announcements m_announcements;
+      std::unordered_map<std::string, Announcements::iterator> m_keys; ///< queued announcements that may be coalesced
     };
-    std::list<CAnnounceData> m_announcementQueue;
+
+    /*!
+     \brief An announcer with its own queue, called from a job that runs while the queue isn't empty.
+     Only holds state of its own, so the job doesn't depend on the manager.
+     */
+    class CSubscriber
+    {
+    public:
+      CSubscriber(IAnnouncer *announcer, unsigned int maxPerSecond);
+
+      /*!
+       \brief Queue an announcement, dropping the oldest library update if the queue is full.
+       \param coalesced set if a duplicate was replaced
+       \param dropped set if a library update was dropped
+       \return true if a job has to be started to pass the queue on
+       */
+      bool Push(const AnnouncementPtr &announcement, bool &coalesced, bool &dropped);
+      /*! \brief Pass the queued announcements on to the announcer, until the queue is empty. */
+      void Deliver();
+      /*! \brief Stop passing announcements on, waiting for a call in progress unless it's the caller. */
+      void Remove();
+
+      IAnnouncer* const m_announcer;
+      std::atomic<uint64_t> m_delivered;
+
+    private:
+      bool TakeToken();
+
+      const unsigned int m_maxPerSecond;
+      CCriticalSection m_section;
+      CAnnouncementQueue m_queue;
+      bool m_scheduled;        ///< a job passing the queue on is queued or running
+      bool m_removed;
+      bool m_calling;                      ///< the announcer is being called
+      ThreadIdentifier m_callingThread;    ///< thread calling the announcer while m_calling is set
+      XbmcThreads::ConditionVariable m_callDone;
+      CEvent m_wakeUp;         ///< set on removal, wakes a job waiting for the rate limit
+      unsigned int m_tokens;   ///< announcements that may be passed on before waiting for the rate limit
+      unsigned int m_refilled; ///< time m_tokens was last topped up
+    };
+    typedef std::shared_ptr<CSubscriber> SubscriberPtr;
+
+    void Process();
+    /*! \brief Look up the item of the announcement and queue the result for the announcers */
+    void DoAnnounce(const AnnouncementPtr &announcement);
+    void Dispatch(const AnnouncementPtr &announcement);
+
+    CAnnouncementQueue m_announcementQueue;
     CEvent m_queueEvent;
+    CEvent m_queueSpace;
 
   private:
     CAnnouncementManager(const CAnnouncementManager&);
     CAnnouncementManager const& operator=(CAnnouncementManager const&);
 
-    CCriticalSection m_critSection;
-    std::vector<IAnnouncer *> m_announcers;
+    mutable CCriticalSection m_critSection;
+    std::vector<SubscriberPtr> m_announcers;
+
+    std::atomic<uint64_t> m_announced;
+    std::atomic<uint64_t> m_coalesced;
+    std::atomic<uint64_t> m_removedDelivered; ///< deliveries of announcers since removed
+    std::atomic<uint64_t> m_dropped;
+    std::atomic<uint64_t> m_blocked;
   };
 }
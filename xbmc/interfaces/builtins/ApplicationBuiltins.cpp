@@ -33,6 +33,7 @@
 #include "settings/AdvancedSettings.h"
 #include "settings/Settings.h"
 #include "utils/FileOperationJob.h"
+#include "utils/FrameTracer.h"
 #include "utils/JSONVariantParser.h"
 #include "utils/log.h"
 #include "utils/StringUtils.h"
@@ -120,6 +121,28 @@ static int SetVolume(const std::vector<std::string>& params)
   return 0;
 }
 
+/*! \brief Start capturing a frame time trace.
+ *  \param params (ignored)
+ */
+static int StartTrace(const std::vector<std::string>& params)
+{
+  CFrameTracer::GetInstance().Start();
+
+  return 0;
+}
+
+/*! \brief Stop capturing a frame time trace and save it.
+ *  \param params The parameters.
+ *  \details params[0] = The file to save the trace to (optional).
+ */
+static int StopTrace(const std::vector<std::string>& params)
+{
+  CFrameTracer::GetInstance().Stop();
+  CFrameTracer::GetInstance().Save(params.empty() ? "special://temp/trace.json" : params[0]);
+
+  return 0;
+}
+
 /*! \brief Toggle debug info.
  *  \param params (ignored)
  */
@@ -199,6 +222,19 @@ static int WakeOnLAN(const std::vector<std::string>& params)
 ///     Toggles skin debug info on/off
 ///   }
 ///   \table_row2_l{
+///     <b>`StartTrace`</b>
+///     ,
+///     Starts capturing where the time of each frame goes.
+///   }
+///   \table_row2_l{
+///     <b>`StopTrace([file])`</b>
+///     ,
+///     Stops capturing the frame time trace and saves it in the Chrome trace
+///     event format\, which can be loaded into chrome://tracing.
+///     @param[in] file                  The file to save to (optional).
+///             @note If not given\, saves to special://temp/trace.json.
+///   }
+///   \table_row2_l{
 ///     <b>`ToggleDPMS`</b>
 ///     ,
 ///     Toggle DPMS mode manually
@@ -220,6 +256,8 @@ CBuiltins::CommandMap CApplicationBuiltins::GetOperations() const
            {"mute", {"Mute the player", 0, Mute}},
            {"notifyall", {"Notify all connected clients", 2, NotifyAll}},
            {"setvolume", {"Set the current volume", 1, SetVolume}},
+           {"starttrace", {"Start capturing a frame time trace", 0, StartTrace}},
+           {"stoptrace", {"Stop capturing a frame time trace and save it", 0, StopTrace}},
            {"toggledebug", {"Enables/disables debug mode", 0, ToggleDebug}},
            {"toggledpms", {"Toggle DPMS mode manually", 0, ToggleDPMS}},
            {"wakeonlan", {"Sends the wake-up packet to the broadcast address for the specified MAC address", 1, WakeOnLAN}}
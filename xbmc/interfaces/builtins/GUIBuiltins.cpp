@@ -412,6 +412,16 @@ static int ToggleDirty(const std::vector<std::string>&)
   return 0;
 }
 
+/*! \brief Start or stop recording dirty regions.
+ *  \param params Ignored.
+ */
+static int ToggleDirtyRecording(const std::vector<std::string>&)
+{
+  g_windowManager.ToggleDirtyRegionRecording();
+
+  return 0;
+}
+
 // Note: For new Texts with comma add a "\" before!!! Is used for table text.
 //
 /// \page page_List_of_built_in_functions
@@ -576,6 +586,11 @@ static int ToggleDirty(const std::vector<std::string>&)
 ///     @param[in] sync                  Add "sync" to run synchronously (optional).
 ///   }
 ///   \table_row2_l{
+///     <b>`ToggleDirtyRegionRecording`</b>
+///     ,
+///     Starts recording the dirty regions of each frame or stops and saves them to dirtyregions.txt in the log folder\, for replaying through the dirty region solvers offline.
+///   }
+///   \table_row2_l{
 ///     <b>`ToggleDirtyRegionVisualization`</b>
 ///     ,
 ///     makes dirty regions visible for debugging proposes.
@@ -602,6 +617,7 @@ CBuiltins::CommandMap CGUIBuiltins::GetOperations() const
            {"setproperty",                    {"Sets a window property for the current focused window/dialog (key,value)", 2, SetProperty}},
            {"setstereomode",                  {"Changes the stereo mode of the GUI. Params can be: toggle, next, previous, select, tomono or any of the supported stereomodes (off, split_vertical, split_horizontal, row_interleaved, hardware_based, anaglyph_cyan_red, anaglyph_green_magenta, anaglyph_yellow_blue, monoscopic)", 1, SetStereoMode}},
            {"takescreenshot",                 {"Takes a Screenshot", 0, Screenshot}},
+           {"toggledirtyregionrecording",     {"Starts/stops recording dirty regions", 0, ToggleDirtyRecording}},
            {"toggledirtyregionvisualization", {"Enables/disables dirty-region visualization", 0, ToggleDirty}}
          };
 }
@@ -27,6 +27,27 @@ class CGUIListItem;
 
 namespace INFO
 {
+/*!
+ \ingroup info
+ \brief Sources of state an info bool reads.
+ An info bool is only re-evaluated once one of the sources it depends on has changed.
+ \sa CGUIInfoManager::InvalidateInfo
+ */
+enum InfoDependency
+{
+  INFO_DEPENDS_NONE     = 0,       ///< constant, e.g. the platform
+  INFO_DEPENDS_PLAYER   = 1 << 0,  ///< player state, changes every frame during playback
+  INFO_DEPENDS_LIBRARY  = 1 << 1,  ///< library content
+  INFO_DEPENDS_SKIN     = 1 << 2,  ///< skin settings
+  INFO_DEPENDS_TIME     = 1 << 3,  ///< wall clock
+  INFO_DEPENDS_WINDOW   = 1 << 4,  ///< window, focus and container state
+  INFO_DEPENDS_LISTITEM = 1 << 5,  ///< the focused or given list item
+  INFO_DEPENDS_FRAME    = 1 << 6,  ///< anything else, re-evaluated every frame
+};
+
+/*! \brief Number of InfoDependency flags, excluding INFO_DEPENDS_NONE */
+static const unsigned int INFO_DEPENDS_SOURCES = 7;
+
 /*!
  \ingroup info
  \brief Base class, wrapping boolean conditions and expressions
@@ -73,11 +94,14 @@ public:
 
   const std::string &GetExpression() const { return m_expression; }
   bool ListItemDependent() const { return m_listItemDependent; }
+  /*! \brief Sources of state this info bool reads, a combination of InfoDependency flags */
+  unsigned int GetDependencies() const { return m_dependencies; }
 protected:
 
   bool m_value;                ///< current value
   int m_context;               ///< contextual information to go with the condition
   bool m_listItemDependent;    ///< do not cache if a listitem pointer is given
+  unsigned int m_dependencies; ///< InfoDependency flags of the state this reads
 
 private:
   std::string  m_expression;   ///< original expression
@@ -22,6 +22,7 @@
 #include <stack>
 #include "utils/log.h"
 #include "GUIInfoManager.h"
+#include <algorithm>
 #include <list>
 #include <memory>
 
@@ -31,51 +32,86 @@ InfoSingle::InfoSingle(const std::string &expression, int context)
 : InfoBool(expression, context)
 {
   m_condition = g_infoManager.TranslateSingleString(expression, m_listItemDependent);
+  m_dependencies = g_infoManager.GetDependencies(m_condition);
 }
 
 void InfoSingle::Update(const CGUIListItem *item)
 {
+  g_infoManager.m_boolEvaluations++;
   m_value = g_infoManager.GetBool(m_condition, m_context, item);
 }
 
 InfoExpression::InfoExpression(const std::string &expression, int context)
 : InfoBool(expression, context)
 {
+  // collects the dependencies of the operands
+  m_dependencies = INFO_DEPENDS_NONE;
   if (!Parse(expression))
   {
     CLog::Log(LOGERROR, "Error parsing boolean expression %s", expression.c_str());
-    m_expression_tree = std::make_shared<InfoLeaf>(g_infoManager.Register("false", 0), false);
+    m_program.clear();
+    m_operands.clear();
+    m_operands.push_back(g_infoManager.Register("false", 0));
+    m_program.push_back(Instruction(OPCODE_LEAF, 0));
+    m_dependencies = INFO_DEPENDS_NONE;
   }
 }
 
 void InfoExpression::Update(const CGUIListItem *item)
 {
-  m_value = m_expression_tree->Evaluate(item);
+  g_infoManager.m_boolEvaluations++;
+
+  bool value = false;
+  const Instruction *program = m_program.data();
+  const size_t size = m_program.size();
+  size_t pc = 0;
+  while (pc < size)
+  {
+    const Instruction &instruction = program[pc];
+    switch (instruction.op)
+    {
+    case OPCODE_LEAF:
+      value = instruction.invert ^ m_operands[instruction.arg]->Get(item);
+      pc++;
+      break;
+    case OPCODE_JUMP_IF_TRUE:
+      pc = value ? instruction.arg : pc + 1;
+      break;
+    case OPCODE_JUMP_IF_FALSE:
+      pc = value ? pc + 1 : instruction.arg;
+      break;
+    }
+  }
+  m_value = value;
 }
 
 /* Expressions are rewritten at parse time into a form which favours the
- * formation of groups of associative nodes. These groups are then reordered at
- * evaluation time such that nodes whose value renders the evaluation of the
- * remainder of the group unnecessary tend to be evaluated first (these are
- * true nodes for OR subexpressions, or false nodes for AND subexpressions).
- * The end effect is to minimise the number of leaf nodes that need to be
- * evaluated in order to determine the value of the expression. The runtime
- * adaptability has the advantage of not being customised for any particular skin.
+ * formation of groups of associative nodes, which are then compiled into a
+ * flat program with short-circuit jumps.
  *
  * The modifications to the expression at parse time fall into two groups:
  * 1) Moving logical NOTs so that they are only applied to leaf nodes.
- *    For example, rewriting ![A+B]|C as !A|!B|C allows reordering such that
- *    any of the three leaves can be evaluated first.
+ *    For example, rewriting ![A+B]|C as !A|!B|C so that the inversion is
+ *    part of the leaf instruction.
  * 2) Combining adjacent AND or OR operations such that each path from the root
  *    to a leaf encounters a strictly alternating pattern of AND and OR
  *    operations. So [A|B]|[C|D+[[E|F]|G] becomes A|B|C|[D+[E|F|G]].
+ *
+ * Every group is then compiled into the code of its children, separated by
+ * jumps to the end of the group taken as soon as a child decides the value
+ * of the group (true for OR groups, false for AND groups). The value of a
+ * group is the value of the child evaluated last, so no stack is needed.
+ * For example A|[B+C]|D compiles to
+ *
+ *   0: leaf A
+ *   1: jump if true 7
+ *   2: leaf B
+ *   3: jump if false 5
+ *   4: leaf C
+ *   5: jump if true 7
+ *   6: leaf D
  */
 
-bool InfoExpression::InfoLeaf::Evaluate(const CGUIListItem *item)
-{
-  return m_invert ^ m_info->Get(item);
-}
-
 InfoExpression::InfoAssociativeGroup::InfoAssociativeGroup(
     node_type_t type,
     const InfoSubexpressionPtr &left,
@@ -96,27 +132,36 @@ void InfoExpression::InfoAssociativeGroup::Merge(std::shared_ptr<InfoAssociative
   m_children.splice(m_children.end(), other->m_children);
 }
 
-bool InfoExpression::InfoAssociativeGroup::Evaluate(const CGUIListItem *item)
+void InfoExpression::Compile(const InfoSubexpressionPtr &node)
 {
-  /* Handle either AND or OR by using the relation
-   * A AND B == !(!A OR !B)
-   * to convert ANDs into ORs
-   */
-  std::list<InfoSubexpressionPtr>::iterator last = m_children.end();
-  std::list<InfoSubexpressionPtr>::iterator it = m_children.begin();
-  bool use_and = (m_type == NODE_AND);
-  bool result = use_and ^ (*it)->Evaluate(item);
-  while (!result && ++it != last)
+  if (node->Type() == NODE_LEAF)
   {
-    result = use_and ^ (*it)->Evaluate(item);
-    if (result)
+    std::shared_ptr<InfoLeaf> leaf = std::static_pointer_cast<InfoLeaf>(node);
+    // conditions used more than once are stored once
+    std::vector<InfoPtr>::const_iterator it = std::find(m_operands.begin(), m_operands.end(), leaf->m_info);
+    unsigned int operand = it - m_operands.begin();
+    if (it == m_operands.end())
+      m_operands.push_back(leaf->m_info);
+    m_program.push_back(Instruction(OPCODE_LEAF, operand, leaf->m_invert));
+    return;
+  }
+
+  std::shared_ptr<InfoAssociativeGroup> group = std::static_pointer_cast<InfoAssociativeGroup>(node);
+  opcode_t jump = group->m_type == NODE_AND ? OPCODE_JUMP_IF_FALSE : OPCODE_JUMP_IF_TRUE;
+  std::vector<size_t> jumps;
+  for (std::list<InfoSubexpressionPtr>::const_iterator it = group->m_children.begin(); it != group->m_children.end(); ++it)
+  {
+    if (it != group->m_children.begin())
     {
-      /* Move this child to the head of the list so we evaluate faster next time */
-      m_children.push_front(*it);
-      m_children.erase(it);
+      jumps.push_back(m_program.size());
+      m_program.push_back(Instruction(jump, 0));
     }
+    Compile(*it);
   }
-  return use_and ^ result;
+
+  // the jumps go to the end of the group
+  for (std::vector<size_t>::const_iterator it = jumps.begin(); it != jumps.end(); ++it)
+    m_program[*it].arg = m_program.size();
 }
 
 /* Expressions are parsed using the shunting-yard algorithm. Binary operators
@@ -250,6 +295,7 @@ bool InfoExpression::Parse(const std::string &expression)
         }
         /* Propagate any listItem dependency from the operand to the expression */
         m_listItemDependent |= info->ListItemDependent();
+        m_dependencies |= info->GetDependencies();
         nodes.push(std::make_shared<InfoLeaf>(info, invert));
         /* Reuse operand string for next operand */
         operand.clear();
@@ -301,11 +347,12 @@ bool InfoExpression::Parse(const std::string &expression)
     }
     /* Propagate any listItem dependency from the operand to the expression */
     m_listItemDependent |= info->ListItemDependent();
+    m_dependencies |= info->GetDependencies();
     nodes.push(std::make_shared<InfoLeaf>(info, invert));
   }
   while (!operator_stack.empty())
     OperatorPop(operator_stack, invert, nodes);
 
-  m_expression_tree = nodes.top();
+  Compile(nodes.top());
   return true;
 }
@@ -43,6 +43,9 @@ private:
 };
 
 /*! \brief Class to wrap active boolean expressions
+
+ Expressions are parsed into a tree, which is then compiled into a flat
+ program evaluated in a single loop.
  */
 class InfoExpression : public InfoBool
 {
@@ -74,7 +77,6 @@ private:
   {
   public:
     virtual ~InfoSubexpression(void) {}; // so we can destruct derived classes using a pointer to their base class
-    virtual bool Evaluate(const CGUIListItem *item) = 0;
     virtual node_type_t Type() const=0;
   };
 
@@ -85,9 +87,8 @@ private:
   {
   public:
     InfoLeaf(InfoPtr info, bool invert) : m_info(info), m_invert(invert) {};
-    virtual bool Evaluate(const CGUIListItem *item);
     virtual node_type_t Type() const { return NODE_LEAF; };
-  private:
+
     InfoPtr m_info;
     bool m_invert;
   };
@@ -99,17 +100,36 @@ private:
     InfoAssociativeGroup(node_type_t type, const InfoSubexpressionPtr &left, const InfoSubexpressionPtr &right);
     void AddChild(const InfoSubexpressionPtr &child);
     void Merge(std::shared_ptr<InfoAssociativeGroup> other);
-    virtual bool Evaluate(const CGUIListItem *item);
     virtual node_type_t Type() const { return m_type; };
-  private:
+
     node_type_t m_type;
     std::list<InfoSubexpressionPtr> m_children;
   };
 
+  typedef enum
+  {
+    OPCODE_LEAF,           // value = operand ^ invert
+    OPCODE_JUMP_IF_TRUE,   // short-circuits an OR group
+    OPCODE_JUMP_IF_FALSE,  // short-circuits an AND group
+  } opcode_t;
+
+  struct Instruction
+  {
+    Instruction(opcode_t opcode, unsigned int argument, bool invert = false)
+      : op(opcode), invert(invert), arg(argument) {}
+
+    opcode_t op;
+    bool invert;       ///< whether to invert the operand of a leaf
+    unsigned int arg;  ///< operand index of a leaf, or target of a jump
+  };
+
   static operator_t GetOperator(char ch);
   static void OperatorPop(std::stack<operator_t> &operator_stack, bool &invert, std::stack<InfoSubexpressionPtr> &nodes);
   bool Parse(const std::string &expression);
-  InfoSubexpressionPtr m_expression_tree;
+  void Compile(const InfoSubexpressionPtr &node);
+
+  std::vector<Instruction> m_program;  ///< the compiled expression
+  std::vector<InfoPtr> m_operands;     ///< the conditions the program reads
 };
 
 };
@@ -0,0 +1,316 @@
+/*
+ *      Copyright (C) 2017 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kodi; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "filesystem/File.h"
+#include "guiinfo/GUIInfoLabels.h"
+#include "interfaces/info/InfoBool.h"
+#include "test/TestUtils.h"
+#include "utils/Stopwatch.h"
+#include "utils/StringUtils.h"
+#include "GUIInfoManager.h"
+
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using namespace INFO;
+
+class TestInfoBool : public testing::Test
+{
+protected:
+  TestInfoBool()
+  {
+    // known library content, so evaluating doesn't query the databases
+    g_infoManager.SetLibraryBool(LIBRARY_HAS_MOVIES, true);
+    g_infoManager.SetLibraryBool(LIBRARY_HAS_TVSHOWS, false);
+    g_infoManager.SetLibraryBool(LIBRARY_HAS_MUSIC, true);
+    g_infoManager.SetLibraryBool(LIBRARY_HAS_MUSICVIDEOS, false);
+
+    XFILE::CFile file;
+    if (file.Open(XBMC_REF_FILE_PATH("xbmc/interfaces/info/test/data/conditions.txt")))
+    {
+      char line[1024];
+      while (file.ReadString(line, sizeof(line)))
+      {
+        std::string condition(line);
+        StringUtils::Trim(condition);
+        if (!condition.empty() && condition[0] != '#')
+          m_bools.push_back(g_infoManager.Register(condition));
+      }
+    }
+  }
+
+  ~TestInfoBool()
+  {
+    g_infoManager.ResetLibraryBools();
+  }
+
+  /* Evaluate every condition like the controls would for a number of frames,
+     returns the evaluations per frame */
+  float RunFrames(unsigned int frames, bool dependencyTracked, std::vector<bool>& values)
+  {
+    unsigned int evaluations = g_infoManager.GetBoolEvaluations();
+    for (unsigned int frame = 0; frame < frames; frame++)
+    {
+      values.clear();
+      for (std::vector<InfoPtr>::iterator it = m_bools.begin(); it != m_bools.end(); ++it)
+        values.push_back((*it)->Get());
+
+      if (dependencyTracked)
+        g_infoManager.ResetFrameCache();
+      else
+        g_infoManager.ResetCache();
+    }
+    return static_cast<float>(g_infoManager.GetBoolEvaluations() - evaluations) / frames;
+  }
+
+  std::vector<InfoPtr> m_bools;
+};
+
+namespace
+{
+/* Straightforward recursive evaluation of an expression, to check the compiled one against.
+   NOT binds tightest, then AND, then OR. */
+class CReferenceEvaluator
+{
+public:
+  bool Evaluate(const std::string &expression)
+  {
+    m_pos = expression.c_str();
+    return Or();
+  }
+
+private:
+  bool Or()
+  {
+    bool value = And();
+    while (Skip() == '|')
+    {
+      m_pos++;
+      value = And() || value;
+    }
+    return value;
+  }
+
+  bool And()
+  {
+    bool value = Not();
+    while (Skip() == '+')
+    {
+      m_pos++;
+      value = Not() && value;
+    }
+    return value;
+  }
+
+  bool Not()
+  {
+    char c = Skip();
+    if (c == '!')
+    {
+      m_pos++;
+      return !Not();
+    }
+    if (c == '[')
+    {
+      m_pos++;
+      bool value = Or();
+      Skip();
+      m_pos++; // ']'
+      return value;
+    }
+    // operands may contain brackets in their parameters, e.g. Window.IsActive(home)
+    std::string operand;
+    int depth = 0;
+    while (*m_pos && (depth > 0 || (*m_pos != '+' && *m_pos != '|' && *m_pos != ']')))
+    {
+      if (*m_pos == '(')
+        depth++;
+      else if (*m_pos == ')')
+        depth--;
+      operand += *m_pos++;
+    }
+    StringUtils::Trim(operand);
+    return g_infoManager.Register(operand)->Get();
+  }
+
+  char Skip()
+  {
+    while (*m_pos == ' ')
+      m_pos++;
+    return *m_pos;
+  }
+
+  const char *m_pos;
+};
+
+/* Combines the given conditions into nested expressions, like large skins do */
+std::vector<std::string> GenerateExpressions(const std::vector<InfoPtr> &bools, unsigned int count)
+{
+  std::vector<std::string> operands;
+  for (std::vector<InfoPtr>::const_iterator it = bools.begin(); it != bools.end(); ++it)
+  {
+    if ((*it)->GetExpression().find_first_of("|+[]!") == std::string::npos)
+      operands.push_back((*it)->GetExpression());
+  }
+
+  std::mt19937 rng(42);
+  std::vector<std::string> expressions;
+  while (expressions.size() < count)
+  {
+    std::string expression;
+    unsigned int groups = 1 + rng() % 4;
+    for (unsigned int group = 0; group < groups; group++)
+    {
+      if (group > 0)
+        expression += (rng() % 2) ? " + " : " | ";
+      if (rng() % 4 == 0)
+        expression += "!";
+      expression += "[";
+      unsigned int leaves = 1 + rng() % 4;
+      for (unsigned int leaf = 0; leaf < leaves; leaf++)
+      {
+        if (leaf > 0)
+          expression += (rng() % 2) ? " + " : " | ";
+        if (rng() % 3 == 0)
+          expression += "!";
+        expression += operands[rng() % operands.size()];
+      }
+      expression += "]";
+    }
+    expressions.push_back(expression);
+  }
+  return expressions;
+}
+}
+
+TEST_F(TestInfoBool, Dependencies)
+{
+  EXPECT_EQ(INFO_DEPENDS_NONE, g_infoManager.Register("System.Platform.Linux")->GetDependencies());
+  EXPECT_EQ(INFO_DEPENDS_LIBRARY, g_infoManager.Register("Library.HasContent(movies)")->GetDependencies());
+  EXPECT_EQ(INFO_DEPENDS_PLAYER, g_infoManager.Register("!Player.HasVideo")->GetDependencies());
+  EXPECT_EQ(INFO_DEPENDS_TIME, g_infoManager.Register("System.Time(06:00,18:00)")->GetDependencies());
+  EXPECT_EQ(INFO_DEPENDS_WINDOW, g_infoManager.Register("Window.IsActive(home)")->GetDependencies());
+  EXPECT_EQ(INFO_DEPENDS_LIBRARY | INFO_DEPENDS_PLAYER,
+            g_infoManager.Register("Library.HasContent(movies) + !Player.HasMedia")->GetDependencies());
+  EXPECT_NE(0U, g_infoManager.Register("ListItem.IsFolder")->GetDependencies() & INFO_DEPENDS_LISTITEM);
+}
+
+TEST_F(TestInfoBool, InvalidatedOnChange)
+{
+  InfoPtr movies = g_infoManager.Register("Library.HasContent(movies)");
+  g_infoManager.ResetFrameCache();
+  EXPECT_TRUE(movies->Get());
+
+  // stays cached across frames
+  unsigned int evaluations = g_infoManager.GetBoolEvaluations();
+  g_infoManager.ResetFrameCache();
+  EXPECT_TRUE(movies->Get());
+  EXPECT_EQ(evaluations, g_infoManager.GetBoolEvaluations());
+
+  // until the library publishes a change
+  g_infoManager.SetLibraryBool(LIBRARY_HAS_MOVIES, false);
+  g_infoManager.ResetFrameCache();
+  EXPECT_FALSE(movies->Get());
+}
+
+TEST_F(TestInfoBool, EvaluationsPerFrame)
+{
+  ASSERT_FALSE(m_bools.empty());
+
+  const unsigned int frames = 1000;
+  std::vector<bool> before, after;
+
+  CStopWatch watch;
+  watch.StartZero();
+  float evaluationsBefore = RunFrames(frames, false, before);
+  float timeBefore = watch.GetElapsedMilliseconds() / frames;
+
+  watch.StartZero();
+  float evaluationsAfter = RunFrames(frames, true, after);
+  float timeAfter = watch.GetElapsedMilliseconds() / frames;
+
+  std::cout << m_bools.size() << " conditions: " << evaluationsBefore << " evaluations per frame (" << timeBefore
+            << " ms) dirtying everything, " << evaluationsAfter << " (" << timeAfter << " ms) tracking dependencies"
+            << std::endl;
+
+  EXPECT_TRUE(before == after);
+  EXPECT_LT(evaluationsAfter, evaluationsBefore);
+}
+
+TEST_F(TestInfoBool, CompiledExpressionsMatchReference)
+{
+  ASSERT_FALSE(m_bools.empty());
+
+  std::vector<std::string> expressions = GenerateExpressions(m_bools, 2000);
+  CReferenceEvaluator reference;
+  g_infoManager.ResetCache();
+  for (std::vector<std::string>::const_iterator it = expressions.begin(); it != expressions.end(); ++it)
+    EXPECT_EQ(reference.Evaluate(*it), g_infoManager.Register(*it)->Get()) << *it;
+
+  for (std::vector<InfoPtr>::const_iterator it = m_bools.begin(); it != m_bools.end(); ++it)
+    EXPECT_EQ(reference.Evaluate((*it)->GetExpression()), (*it)->Get()) << (*it)->GetExpression();
+}
+
+TEST_F(TestInfoBool, LoadAndEvaluationThroughput)
+{
+  ASSERT_FALSE(m_bools.empty());
+
+  struct Fixture
+  {
+    const char *name;
+    std::vector<std::string> expressions;
+  };
+  Fixture fixtures[2];
+  fixtures[0].name = "estuary";
+  for (std::vector<InfoPtr>::const_iterator it = m_bools.begin(); it != m_bools.end(); ++it)
+    fixtures[0].expressions.push_back((*it)->GetExpression());
+  // a large third party skin, the expressions are new so registering them isn't a lookup
+  fixtures[1].name = "large skin";
+  fixtures[1].expressions = GenerateExpressions(m_bools, 20000);
+
+  for (unsigned int i = 0; i < 2; i++)
+  {
+    CStopWatch watch;
+    watch.StartZero();
+    std::vector<InfoPtr> bools;
+    for (std::vector<std::string>::const_iterator it = fixtures[i].expressions.begin(); it != fixtures[i].expressions.end(); ++it)
+      bools.push_back(g_infoManager.Register(*it, 10000 + i));
+    float load = watch.GetElapsedMilliseconds();
+
+    const unsigned int frames = 100;
+    unsigned int evaluations = g_infoManager.GetBoolEvaluations();
+    watch.StartZero();
+    for (unsigned int frame = 0; frame < frames; frame++)
+    {
+      g_infoManager.ResetCache();
+      for (std::vector<InfoPtr>::iterator it = bools.begin(); it != bools.end(); ++it)
+        (*it)->Get();
+    }
+    float seconds = watch.GetElapsedSeconds();
+    evaluations = g_infoManager.GetBoolEvaluations() - evaluations;
+
+    std::cout << fixtures[i].name << ": " << bools.size() << " expressions registered in " << load << " ms, "
+              << (seconds > 0 ? evaluations / seconds : 0) << " evaluations/s" << std::endl;
+    EXPECT_EQ(fixtures[i].expressions.size(), bools.size());
+  }
+}
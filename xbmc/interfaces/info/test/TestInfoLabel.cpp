@@ -0,0 +1,140 @@
+/*
+ *      Copyright (C) 2017 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kodi; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "guilib/GUIInfoTypes.h"
+#include "interfaces/info/InfoBool.h"
+#include "utils/Stopwatch.h"
+#include "utils/StringUtils.h"
+#include "GUIInfoManager.h"
+
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using namespace INFO;
+
+class TestInfoLabel : public testing::Test
+{
+protected:
+  /* A synthetic window of info labels, most of them reading the clock like a home screen
+     does, the others reading state re-evaluated every frame */
+  TestInfoLabel()
+  {
+    static const char *infos[] = { "System.Time", "System.Date", "System.Time(hh:mm:ss)",
+                                   "System.Date(DDDD)", "System.FPS", "System.BuildVersion" };
+    const unsigned int count = 500;
+    for (unsigned int i = 0; i < count; i++)
+    {
+      std::string label = StringUtils::Format("Label %u: $INFO[%s] - $INFO[%s,(,)]", i,
+                                              infos[i % 4], infos[(i / 4) % 6]);
+      m_labels.push_back(CGUIInfoLabel(label, "fallback"));
+      m_strings.push_back(label);
+    }
+  }
+
+  /* Get every label like the label controls would for a number of frames,
+     returns the portions fetched per frame */
+  float RunFrames(unsigned int frames, bool versioned)
+  {
+    unsigned int fetches = CGUIInfoLabel::GetFetches();
+    for (unsigned int frame = 0; frame < frames; frame++)
+    {
+      for (std::vector<CGUIInfoLabel>::const_iterator it = m_labels.begin(); it != m_labels.end(); ++it)
+        it->GetLabel(0);
+
+      if (versioned)
+        g_infoManager.ResetFrameCache();
+      else
+        g_infoManager.ResetCache();
+    }
+    return static_cast<float>(CGUIInfoLabel::GetFetches() - fetches) / frames;
+  }
+
+  std::vector<CGUIInfoLabel> m_labels;
+  std::vector<std::string> m_strings;
+};
+
+TEST_F(TestInfoLabel, Dependencies)
+{
+  EXPECT_EQ(INFO_DEPENDS_TIME, g_infoManager.GetDependencies(g_infoManager.TranslateString("System.Time")));
+  EXPECT_EQ(INFO_DEPENDS_TIME, g_infoManager.GetDependencies(g_infoManager.TranslateString("System.Date(DDDD)")));
+  EXPECT_EQ(INFO_DEPENDS_FRAME, g_infoManager.GetDependencies(g_infoManager.TranslateString("System.FPS")));
+}
+
+TEST_F(TestInfoLabel, RebuiltOnVersionChange)
+{
+  CGUIInfoLabel label("$INFO[System.Time(hh:mm:ss)]");
+  label.GetLabel(0);
+
+  // within the same frame the clock is not read again
+  unsigned int fetches = CGUIInfoLabel::GetFetches();
+  label.GetLabel(0);
+  EXPECT_EQ(fetches, CGUIInfoLabel::GetFetches());
+
+  // until the clock is marked as changed
+  g_infoManager.ResetCache();
+  label.GetLabel(0);
+  EXPECT_EQ(fetches + 1, CGUIInfoLabel::GetFetches());
+}
+
+TEST_F(TestInfoLabel, MatchesUncached)
+{
+  for (unsigned int frame = 0; frame < 10; frame++)
+  {
+    time_t start = time(NULL);
+    std::vector<std::string> cached, uncached;
+    for (unsigned int i = 0; i < m_labels.size(); i++)
+    {
+      cached.push_back(m_labels[i].GetLabel(0));
+      uncached.push_back(CGUIInfoLabel::GetLabel(m_strings[i]));
+    }
+    // the clock may have ticked in between
+    if (start == time(NULL))
+      EXPECT_TRUE(cached == uncached);
+    g_infoManager.ResetFrameCache();
+  }
+}
+
+TEST_F(TestInfoLabel, RebuildsPerFrame)
+{
+  const unsigned int frames = 200;
+
+  CStopWatch watch;
+  unsigned int rebuilds = CGUIInfoLabel::GetRebuilds();
+  watch.StartZero();
+  float fetchesBefore = RunFrames(frames, false);
+  float timeBefore = watch.GetElapsedMilliseconds() / frames;
+  float rebuildsBefore = static_cast<float>(CGUIInfoLabel::GetRebuilds() - rebuilds) / frames;
+
+  rebuilds = CGUIInfoLabel::GetRebuilds();
+  watch.StartZero();
+  float fetchesAfter = RunFrames(frames, true);
+  float timeAfter = watch.GetElapsedMilliseconds() / frames;
+  float rebuildsAfter = static_cast<float>(CGUIInfoLabel::GetRebuilds() - rebuilds) / frames;
+
+  std::cout << m_labels.size() << " labels: " << fetchesBefore << " portions fetched, " << rebuildsBefore
+            << " labels rebuilt per frame (" << timeBefore << " ms) refetching everything, " << fetchesAfter
+            << " fetched, " << rebuildsAfter << " rebuilt (" << timeAfter << " ms) tracking versions" << std::endl;
+
+  EXPECT_LT(fetchesAfter, fetchesBefore);
+  EXPECT_LE(rebuildsAfter, rebuildsBefore + 1);
+}
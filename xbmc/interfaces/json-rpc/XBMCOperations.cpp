@@ -22,6 +22,7 @@
 #include "messaging/ApplicationMessenger.h"
 #include "utils/Variant.h"
 #include "powermanagement/PowerManager.h"
+#include "utils/FrameTracer.h"
 
 using namespace JSONRPC;
 using namespace KODI::MESSAGING;
@@ -95,3 +96,10 @@ JSONRPC_STATUS CXBMCOperations::GetInfoBooleans(const std::string &method, ITran
 
   return OK;
 }
+
+JSONRPC_STATUS CXBMCOperations::GetTrace(const std::string &method, ITransportLayer *transport, IClient *client, const CVariant &parameterObject, CVariant &result)
+{
+  CFrameTracer::GetInstance().Export(result);
+
+  return OK;
+}
@@ -0,0 +1,393 @@
+/*
+ *      Copyright (C) 2005-2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "interfaces/AnnouncementManager.h"
+#include "threads/Event.h"
+#include "threads/SingleLock.h"
+#include "threads/SystemClock.h"
+#include "threads/Thread.h"
+#include "utils/JSONVariantWriter.h"
+#include "utils/TimeUtils.h"
+#include "utils/Variant.h"
+
+#include <algorithm>
+#include <atomic>
+#include <inttypes.h>
+#include <memory>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using namespace ANNOUNCEMENT;
+
+namespace
+{
+class CRecordingAnnouncer : public IAnnouncer
+{
+public:
+  CRecordingAnnouncer() : m_calls(0) { }
+
+  virtual void Announce(AnnouncementFlag flag, const char *sender, const char *message, const CVariant &data) override
+  {
+    {
+      CSingleLock lock(m_section);
+      m_messages.push_back(message);
+      m_data.push_back(data);
+    }
+    m_calls++;
+    m_announced.Set();
+  }
+
+  bool WaitForCalls(unsigned int calls)
+  {
+    XbmcThreads::EndTime timeout(10000);
+    while (m_calls < calls && !timeout.IsTimePast())
+      m_announced.WaitMSec(10);
+    return m_calls >= calls;
+  }
+
+  std::vector<std::string> GetMessages()
+  {
+    CSingleLock lock(m_section);
+    return m_messages;
+  }
+
+  std::vector<CVariant> GetData()
+  {
+    CSingleLock lock(m_section);
+    return m_data;
+  }
+
+  std::atomic<unsigned int> m_calls;
+
+private:
+  CCriticalSection m_section;
+  CEvent m_announced;
+  std::vector<std::string> m_messages;
+  std::vector<CVariant> m_data;
+};
+
+/* Blocks in its first call until released */
+class CBlockingAnnouncer : public CRecordingAnnouncer
+{
+public:
+  CBlockingAnnouncer() : m_released(true), m_blocked(false) { }
+
+  virtual void Announce(AnnouncementFlag flag, const char *sender, const char *message, const CVariant &data) override
+  {
+    if (!m_blocked.exchange(true))
+    {
+      m_blocking.Set();
+      m_released.Wait();
+    }
+    CRecordingAnnouncer::Announce(flag, sender, message, data);
+  }
+
+  CEvent m_blocking;
+  CEvent m_released;
+
+private:
+  std::atomic<bool> m_blocked;
+};
+
+/* Stands in for a JSON-RPC client, which is sent each announcement as JSON */
+class CJSONAnnouncer : public IAnnouncer
+{
+public:
+  CJSONAnnouncer() : m_bytes(0), m_calls(0) { }
+
+  virtual void Announce(AnnouncementFlag flag, const char *sender, const char *message, const CVariant &data) override
+  {
+    CVariant notification(CVariant::VariantTypeObject);
+    notification["jsonrpc"] = "2.0";
+    notification["method"] = std::string(AnnouncementFlagToString(flag)) + "." + message;
+    notification["params"]["sender"] = sender;
+    notification["params"]["data"] = data;
+    m_bytes += CJSONVariantWriter::Write(notification, true).size();
+    m_calls++;
+  }
+
+  std::atomic<uint64_t> m_bytes;
+  std::atomic<uint64_t> m_calls;
+};
+
+/* Announces library updates the way a scan does, with JSON-RPC clients
+ * listening, and checks that every update is either delivered to or dropped
+ * for each listener. The timings are printed when report is set. */
+void AnnounceUpdates(int updates, int listeners, bool report)
+{
+  std::vector< std::unique_ptr<CJSONAnnouncer> > announcers;
+  CAnnouncementManager manager;
+  manager.Start();
+  for (int i = 0; i < listeners; i++)
+  {
+    announcers.push_back(std::unique_ptr<CJSONAnnouncer>(new CJSONAnnouncer()));
+    manager.AddAnnouncer(announcers.back().get());
+  }
+
+  int64_t start = CurrentHostCounter();
+  for (int i = 0; i < updates; i++)
+  {
+    CVariant data;
+    data["item"]["type"] = "movie";
+    data["item"]["id"] = i;
+    manager.Announce(VideoLibrary, "xbmc", "OnUpdate", data);
+  }
+  int64_t announced = CurrentHostCounter();
+
+  // delivered counts the announcements passed on, the calls may still be in progress
+  CAnnouncementManager::Stats stats = manager.GetStats();
+  uint64_t calls = 0;
+  XbmcThreads::EndTime timeout(60000);
+  while ((stats.delivered + stats.dropped < (uint64_t)updates * listeners || calls < stats.delivered) && !timeout.IsTimePast())
+  {
+    XbmcThreads::ThreadSleep(1);
+    stats = manager.GetStats();
+    calls = 0;
+    for (int i = 0; i < listeners; i++)
+      calls += announcers[i]->m_calls;
+  }
+  int64_t delivered = CurrentHostCounter();
+
+  EXPECT_EQ((uint64_t)updates * listeners, stats.delivered + stats.dropped);
+  if (report)
+    printf("announcing %d updates to %d listeners: %.1f ms for the scanner, %.1f ms until delivered, "
+           "%" PRIu64 " dropped, %" PRIu64 " times held back\n", updates, listeners,
+           (announced - start) * 1000.0 / CurrentHostFrequency(), (delivered - start) * 1000.0 / CurrentHostFrequency(),
+           stats.dropped, stats.blocked);
+}
+}
+
+TEST(TestAnnouncementManager, DeliversInOrder)
+{
+  CRecordingAnnouncer first, second;
+  CAnnouncementManager manager;
+  manager.Start();
+  manager.AddAnnouncer(&first);
+  manager.AddAnnouncer(&second);
+
+  for (int i = 0; i < 100; i++)
+    manager.Announce(Other, "xbmc", std::to_string(i).c_str());
+
+  ASSERT_TRUE(first.WaitForCalls(100));
+  ASSERT_TRUE(second.WaitForCalls(100));
+  std::vector<std::string> messages = first.GetMessages();
+  for (int i = 0; i < 100; i++)
+    EXPECT_EQ(std::to_string(i), messages[i]);
+  EXPECT_EQ(messages, second.GetMessages());
+  EXPECT_EQ(200U, manager.GetStats().delivered);
+}
+
+TEST(TestAnnouncementManager, SlowAnnouncerDoesntHoldUpOthers)
+{
+  CBlockingAnnouncer slow;
+  CRecordingAnnouncer fast;
+  CAnnouncementManager manager;
+  manager.Start();
+  manager.AddAnnouncer(&slow);
+  manager.AddAnnouncer(&fast);
+
+  for (int i = 0; i < 10; i++)
+    manager.Announce(Other, "xbmc", "OnTest");
+
+  EXPECT_TRUE(fast.WaitForCalls(10));
+  EXPECT_EQ(0U, slow.m_calls);
+  slow.m_released.Set();
+  EXPECT_TRUE(slow.WaitForCalls(10));
+}
+
+TEST(TestAnnouncementManager, CoalescesLibraryUpdates)
+{
+  CBlockingAnnouncer announcer;
+  CAnnouncementManager manager;
+  manager.Start();
+  manager.AddAnnouncer(&announcer);
+
+  manager.Announce(Other, "xbmc", "OnTest");
+  ASSERT_TRUE(announcer.m_blocking.WaitMSec(10000));
+
+  // duplicates queued for the blocked announcer are replaced, other updates are kept
+  CVariant first, second;
+  first["item"]["id"] = 1;
+  second["item"]["id"] = 2;
+  for (int i = 0; i < 50; i++)
+    manager.Announce(VideoLibrary, "xbmc", "OnUpdate", first);
+  manager.Announce(VideoLibrary, "xbmc", "OnUpdate", second);
+  manager.Announce(Other, "xbmc", "OnTest");
+  manager.Announce(Other, "xbmc", "OnTest");
+
+  announcer.m_released.Set();
+  ASSERT_TRUE(announcer.WaitForCalls(5));
+  std::vector<CVariant> data = announcer.GetData();
+  ASSERT_EQ(5U, data.size());
+  EXPECT_EQ(1, data[1]["item"]["id"].asInteger());
+  EXPECT_EQ(2, data[2]["item"]["id"].asInteger());
+  EXPECT_EQ(49U, manager.GetStats().coalesced);
+}
+
+TEST(TestAnnouncementManager, DropsOnlyLibraryUpdates)
+{
+  CBlockingAnnouncer announcer;
+  CAnnouncementManager manager;
+  manager.Start();
+  manager.AddAnnouncer(&announcer);
+
+  manager.Announce(Other, "xbmc", "OnTest");
+  ASSERT_TRUE(announcer.m_blocking.WaitMSec(10000));
+
+  // fill the queue of the blocked announcer beyond its limit
+  for (int i = 0; i < 1500; i++)
+    manager.Announce(Other, "xbmc", "OnTest");
+  for (int i = 0; i < 1500; i++)
+  {
+    CVariant data;
+    data["item"]["id"] = i;
+    manager.Announce(VideoLibrary, "xbmc", "OnUpdate", data);
+  }
+  manager.Announce(VideoLibrary, "xbmc", "OnScanFinished");
+
+  // nothing is passed on while the announcer is blocked, so every update beyond the limit is dropped
+  XbmcThreads::EndTime timeout(10000);
+  while (manager.GetStats().dropped < 1500 && !timeout.IsTimePast())
+    XbmcThreads::ThreadSleep(1);
+  EXPECT_EQ(1500U, manager.GetStats().dropped);
+
+  announcer.m_released.Set();
+  ASSERT_TRUE(announcer.WaitForCalls(1502));
+  std::vector<std::string> messages = announcer.GetMessages();
+  EXPECT_EQ(1501, std::count(messages.begin(), messages.end(), "OnTest"));
+  EXPECT_EQ("OnScanFinished", messages.back());
+}
+
+TEST(TestAnnouncementManager, RateLimit)
+{
+  CRecordingAnnouncer limited, unlimited;
+  CAnnouncementManager manager;
+  manager.Start();
+  manager.AddAnnouncer(&limited, 20);
+  manager.AddAnnouncer(&unlimited);
+
+  unsigned int start = XbmcThreads::SystemClockMillis();
+  for (int i = 0; i < 30; i++)
+    manager.Announce(Other, "xbmc", std::to_string(i).c_str());
+
+  // a second's worth goes out at once, the rest at the limit
+  ASSERT_TRUE(unlimited.WaitForCalls(30));
+  ASSERT_TRUE(limited.WaitForCalls(30));
+  EXPECT_GE(XbmcThreads::SystemClockMillis() - start, 400U);
+}
+
+namespace
+{
+class CSelfRemovingAnnouncer : public CRecordingAnnouncer
+{
+public:
+  CSelfRemovingAnnouncer(CAnnouncementManager &manager) : m_manager(manager) { }
+
+  virtual void Announce(AnnouncementFlag flag, const char *sender, const char *message, const CVariant &data) override
+  {
+    m_manager.RemoveAnnouncer(this);
+    CRecordingAnnouncer::Announce(flag, sender, message, data);
+  }
+
+private:
+  CAnnouncementManager &m_manager;
+};
+}
+
+namespace
+{
+/* Removes an announcer from a thread of its own */
+class CRemovingThread : public CThread
+{
+public:
+  CRemovingThread(CAnnouncementManager &manager, IAnnouncer *announcer)
+    : CThread("RemoveAnnouncer"), m_removed(true), m_manager(manager), m_announcer(announcer) { }
+
+  CEvent m_removed;
+
+protected:
+  void Process() override
+  {
+    m_manager.RemoveAnnouncer(m_announcer);
+    m_removed.Set();
+  }
+
+  CAnnouncementManager &m_manager;
+  IAnnouncer *m_announcer;
+};
+}
+
+TEST(TestAnnouncementManager, RemoveWaitsForCallInProgress)
+{
+  CBlockingAnnouncer announcer;
+  CRecordingAnnouncer other;
+  CAnnouncementManager manager;
+  manager.Start();
+  manager.AddAnnouncer(&announcer);
+  manager.AddAnnouncer(&other);
+
+  manager.Announce(Other, "xbmc", "OnTest");
+  ASSERT_TRUE(announcer.m_blocking.WaitMSec(10000));
+
+  // the announcer may be freed once it's removed, so removal waits until the call returns
+  CRemovingThread remover(manager, &announcer);
+  remover.Create();
+  EXPECT_FALSE(remover.m_removed.WaitMSec(100));
+  manager.Announce(Other, "xbmc", "OnTest");
+  ASSERT_TRUE(other.WaitForCalls(2));
+
+  announcer.m_released.Set();
+  EXPECT_TRUE(remover.m_removed.WaitMSec(10000));
+  remover.StopThread();
+  EXPECT_EQ(1U, announcer.m_calls);
+}
+
+TEST(TestAnnouncementManager, AnnouncerRemovesItself)
+{
+  CRecordingAnnouncer other;
+  CAnnouncementManager manager;
+  manager.Start();
+  CSelfRemovingAnnouncer announcer(manager);
+  manager.AddAnnouncer(&announcer);
+  manager.AddAnnouncer(&other);
+
+  manager.Announce(Other, "xbmc", "OnTest");
+  manager.Announce(Other, "xbmc", "OnTest");
+
+  ASSERT_TRUE(other.WaitForCalls(2));
+  EXPECT_TRUE(announcer.WaitForCalls(1));
+  EXPECT_EQ(1U, announcer.m_calls);
+}
+
+TEST(TestAnnouncementManager, LibraryScan)
+{
+  AnnounceUpdates(500, 5, false);
+}
+
+/* A library scan announcing updates with 20 JSON-RPC clients listening. Timing
+ * run, not part of the unit tests. Run it with --gtest_also_run_disabled_tests
+ * --gtest_filter=TestAnnouncementManager.DISABLED_Benchmark */
+TEST(TestAnnouncementManager, DISABLED_Benchmark)
+{
+  AnnounceUpdates(10000, 20, true);
+}
@@ -20,12 +20,15 @@
 
 #include "ApplicationMessenger.h"
 
+#include <algorithm>
 #include <memory>
+#include <string.h>
 #include <utility>
 
 #include "Application.h"
 #include "guilib/GraphicContext.h"
 #include "threads/SingleLock.h"
+#include "threads/SystemClock.h"
 
 namespace KODI
 {
@@ -54,8 +57,14 @@ CApplicationMessenger& CApplicationMessenger::GetInstance()
   return appMessenger;
 }
 
+const unsigned int CApplicationMessenger::PROCESS_BUDGET;
+const unsigned int CApplicationMessenger::MAX_POOLED_MESSAGES;
+const unsigned int CApplicationMessenger::WAIT_BUCKETS;
+
 CApplicationMessenger::CApplicationMessenger()
 {
+  m_freeMessages.reserve(MAX_POOLED_MESSAGES);
+  memset(&m_stats, 0, sizeof(m_stats));
 }
 
 CApplicationMessenger::~CApplicationMessenger()
@@ -71,8 +80,8 @@ void CApplicationMessenger::Cleanup()
   {
     ThreadMessage* pMsg = m_vecMessages.front();
 
-    if (pMsg->waitEvent)
-      pMsg->waitEvent->Set();
+    if (pMsg->reply)
+      pMsg->reply->SetValue(pMsg->result);
 
     delete pMsg;
     m_vecMessages.pop();
@@ -82,68 +91,92 @@ void CApplicationMessenger::Cleanup()
   {
     ThreadMessage* pMsg = m_vecWindowMessages.front();
 
-    if (pMsg->waitEvent)
-      pMsg->waitEvent->Set();
+    if (pMsg->reply)
+      pMsg->reply->SetValue(pMsg->result);
 
     delete pMsg;
     m_vecWindowMessages.pop();
   }
+
+  for (std::vector<ThreadMessage*>::iterator it = m_freeMessages.begin(); it != m_freeMessages.end(); ++it)
+    delete *it;
+  m_freeMessages.clear();
 }
 
-int CApplicationMessenger::SendMsg(ThreadMessage&& message, bool wait)
+ThreadMessage* CApplicationMessenger::AllocMessage(ThreadMessage&& message)
 {
-  std::shared_ptr<CEvent> waitEvent;
-  std::shared_ptr<int> result;
+  if (m_freeMessages.empty())
+    return new ThreadMessage(std::move(message));
+
+  ThreadMessage* msg = m_freeMessages.back();
+  m_freeMessages.pop_back();
+  *msg = std::move(message);
+  return msg;
+}
 
-  if (wait)
-  { 
-    //Initialize result here as it's not needed for posted messages
-    message.result = std::make_shared<int>(-1);
+void CApplicationMessenger::FreeMessage(ThreadMessage *pMsg)
+{
+  if (m_freeMessages.size() >= MAX_POOLED_MESSAGES)
+  {
+    delete pMsg;
+    return;
+  }
+
+  pMsg->reply.reset();
+  pMsg->params.clear();
+  m_freeMessages.push_back(pMsg);
+}
+
+std::shared_ptr<CMessageReply> CApplicationMessenger::QueueMessage(ThreadMessage&& message, bool reply)
+{
+  if (reply)
+  {
+    message.reply = std::make_shared<CMessageReply>();
     // check that we're not being called from our application thread, else we'll be waiting
     // forever!
-    if (!g_application.IsCurrentThread())
-    {
-      message.waitEvent.reset(new CEvent(true));
-      waitEvent = message.waitEvent;
-      result = message.result;
-    }
-    else
+    if (g_application.IsCurrentThread())
     {
-      //OutputDebugString("Attempting to wait on a SendMessage() from our application thread will cause lockup!\n");
-      //OutputDebugString("Sending immediately\n");
       ProcessMessage(&message);
-      return *message.result;
+      message.reply->SetValue(message.result);
+      return message.reply;
     }
   }
 
-
+  std::shared_ptr<CMessageReply> state = message.reply;
   if (g_application.m_bStop)
-    return -1;
+  {
+    if (state)
+      state->SetValue(-1);
+    return state;
+  }
 
-  ThreadMessage* msg = new ThreadMessage(std::move(message));
-  
   CSingleLock lock (m_critSection);
+  ThreadMessage* msg = AllocMessage(std::move(message));
+  msg->queued = XbmcThreads::SystemClockMillis();
 
   if (msg->dwMessage == TMSG_GUI_MESSAGE)
     m_vecWindowMessages.push(msg);
   else
     m_vecMessages.push(msg);
-  lock.Leave();  // this releases the lock on the vec of messages and
-                 //   allows the ProcessMessage to execute and therefore
-                 //   delete the message itself. Therefore any accesss
-                 //   of the message itself after this point consittutes
-                 //   a race condition (yarc - "yet another race condition")
-                 //
-  if (waitEvent) // ... it just so happens we have a spare reference to the
-                 //  waitEvent ... just for such contingencies :)
-  { 
+
+  // the message belongs to ProcessMessages() from here on, which may already be done with it
+  // once the lock is released. Only the spare reference to the reply may be accessed.
+  return state;
+}
+
+int CApplicationMessenger::SendMsg(ThreadMessage&& message, bool wait)
+{
+  std::shared_ptr<CMessageReply> reply = QueueMessage(std::move(message), wait);
+  if (!reply)
+    return -1;
+
+  if (!reply->IsReady())
+  {
     // ensure the thread doesn't hold the graphics lock
     CSingleExit exit(g_graphicsContext);
-    waitEvent->Wait();
-    return *result;
+    reply->WaitProcessed();
   }
-
-  return -1;
+  return reply->GetValue();
 }
 
 int CApplicationMessenger::SendMsg(uint32_t messageId)
@@ -186,29 +219,59 @@ void CApplicationMessenger::PostMsg(uint32_t messageId, int param1, int param2,
   SendMsg(ThreadMessage{ messageId, param1, param2, payload, strParam, params }, false);
 }
 
+CJobFuture<int> CApplicationMessenger::SendMsgAsync(uint32_t messageId, int param1, int param2, void* payload)
+{
+  return CJobFuture<int>(QueueMessage(ThreadMessage{ messageId, param1, param2, payload }, true));
+}
+
+CJobFuture<int> CApplicationMessenger::SendMsgAsync(uint32_t messageId, int param1, int param2, void* payload, std::string strParam, std::vector<std::string> params)
+{
+  return CJobFuture<int>(QueueMessage(ThreadMessage{ messageId, param1, param2, payload, strParam, params }, true));
+}
+
 void CApplicationMessenger::ProcessMessages()
 {
   // process threadmessages
+  ProcessQueue(m_vecMessages);
+}
+
+void CApplicationMessenger::ProcessQueue(std::queue<ThreadMessage*> &messages)
+{
   CSingleLock lock (m_critSection);
-  while (!m_vecMessages.empty())
+  m_stats.maxQueued = std::max(m_stats.maxQueued, (unsigned int)(m_vecMessages.size() + m_vecWindowMessages.size()));
+
+  XbmcThreads::EndTime budget(PROCESS_BUDGET);
+  while (!messages.empty())
   {
-    ThreadMessage* pMsg = m_vecMessages.front();
+    // leave the rest for the next frame, rendering shouldn't stall on a burst of messages
+    if (budget.IsTimePast())
+    {
+      m_stats.deferred++;
+      break;
+    }
+
+    ThreadMessage* pMsg = messages.front();
     //first remove the message from the queue, else the message could be processed more then once
-    m_vecMessages.pop();
+    messages.pop();
+
+    unsigned int waited = XbmcThreads::SystemClockMillis() - pMsg->queued;
+    unsigned int bucket = 0;
+    for (unsigned int limit = 1; bucket < WAIT_BUCKETS - 1 && waited >= limit; limit *= 4)
+      bucket++;
+    m_stats.waits[bucket]++;
+    m_stats.processed++;
 
     //Leave here as the message might make another
     //thread call processmessages or sendmessage
-
-    std::shared_ptr<CEvent> waitEvent = pMsg->waitEvent;
-    lock.Leave(); // <- see the large comment in SendMessage ^
+    lock.Leave(); // <- see the large comment in QueueMessage ^
 
     ProcessMessage(pMsg);
-    
-    if (waitEvent)
-      waitEvent->Set();
-    delete pMsg;
+
+    if (pMsg->reply)
+      pMsg->reply->SetValue(pMsg->result);
 
     lock.Enter();
+    FreeMessage(pMsg);
   }
 }
 
@@ -235,26 +298,16 @@ void CApplicationMessenger::ProcessMessage(ThreadMessage *pMsg)
 
 void CApplicationMessenger::ProcessWindowMessages()
 {
-  CSingleLock lock (m_critSection);
   //message type is window, process window messages
-  while (!m_vecWindowMessages.empty())
-  {
-    ThreadMessage* pMsg = m_vecWindowMessages.front();
-    //first remove the message from the queue, else the message could be processed more then once
-    m_vecWindowMessages.pop();
-
-    // leave here in case we make more thread messages from this one
-
-    std::shared_ptr<CEvent> waitEvent = pMsg->waitEvent;
-    lock.Leave(); // <- see the large comment in SendMessage ^
-
-    ProcessMessage(pMsg);
-    if (waitEvent)
-      waitEvent->Set();
-    delete pMsg;
+  ProcessQueue(m_vecWindowMessages);
+}
 
-    lock.Enter();
-  }
+CApplicationMessenger::Stats CApplicationMessenger::GetStats() const
+{
+  CSingleLock lock (m_critSection);
+  Stats stats = m_stats;
+  stats.queued = m_vecMessages.size() + m_vecWindowMessages.size();
+  return stats;
 }
 
 void CApplicationMessenger::SendGUIMessage(const CGUIMessage &message, int windowID, bool waitResult)
@@ -23,10 +23,12 @@
 #include "guilib/WindowIDs.h"
 #include "threads/Thread.h"
 #include "messaging/ThreadMessage.h"
+#include "utils/JobManager.h"
 
 #include <map>
 #include <memory>
 #include <queue>
+#include <stdint.h>
 #include <string>
 #include <vector>
 
@@ -164,9 +166,36 @@ struct ThreadMessageCallback
 
 class IMessageTarget;
 
+/*!
+ \brief Reply to a sent message, completed with its result once the application thread has processed it.
+ \sa CApplicationMessenger::SendMsgAsync()
+ */
+class CMessageReply : public CJobFutureState<int>
+{
+public:
+  /*!
+   \brief Wait for the message to be processed without running queued jobs meanwhile,
+   the caller may hold locks that the jobs need.
+   */
+  void WaitProcessed() const { m_ready.Wait(); }
+};
+
 class CApplicationMessenger
 {
 public:
+  static const unsigned int PROCESS_BUDGET = 10;     ///< ms spent processing a queue per frame
+  static const unsigned int MAX_POOLED_MESSAGES = 64;
+  static const unsigned int WAIT_BUCKETS = 6;
+
+  struct Stats
+  {
+    unsigned int queued;              ///< messages waiting to be processed
+    unsigned int maxQueued;           ///< most messages waiting when a frame started processing them
+    uint64_t processed;               ///< messages processed
+    unsigned int deferred;            ///< frames that left messages for the next frame to stay within PROCESS_BUDGET
+    unsigned int waits[WAIT_BUCKETS]; ///< processed messages by time waited: under 1, 4, 16, 64, 256 ms and longer
+  };
+
   /*!
    \brief The only way through which the global instance of the CApplicationMessenger should be accessed.
    \return the global instance.
@@ -185,9 +214,28 @@ public:
   void PostMsg(uint32_t messageId, int param1, int param2, void* payload, std::string strParam);
   void PostMsg(uint32_t messageId, int param1, int param2, void* payload, std::string strParam, std::vector<std::string> params);
 
-  void ProcessMessages(); // only call from main thread.
+  /*! \brief Send a message without waiting for it to be processed.
+   Unlike PostMsg() the result can be retrieved from the returned future, which is completed once the
+   message is processed. Waiting for it from a job runs other queued jobs meanwhile, and Then()
+   passes the result on to a job without holding up any thread.
+   Sent from the application thread, the message is processed straight away.
+   \return the future result of the message, -1 if it's not processed because the application stops.
+   */
+  CJobFuture<int> SendMsgAsync(uint32_t messageId, int param1 = -1, int param2 = -1, void* payload = nullptr);
+  CJobFuture<int> SendMsgAsync(uint32_t messageId, int param1, int param2, void* payload, std::string strParam, std::vector<std::string> params = std::vector<std::string>());
+
+  /*! \brief Process the queued messages. Only call from the application thread.
+   Processing stops once it took PROCESS_BUDGET ms, except that each call processes at least one
+   message, so that bursts of messages are spread over several frames.
+   */
+  void ProcessMessages();
   void ProcessWindowMessages();
 
+  /*!
+   \brief Statistics of the message queues, shown by the debug overlay.
+   */
+  Stats GetStats() const;
+
   /*! \brief Send a GUIMessage, optionally waiting before it's processed to return.
    Should be used to send messages to the GUI from other threads.
    \param msg the GUIMessage to send.
@@ -206,12 +254,20 @@ private:
   ~CApplicationMessenger();
 
   int SendMsg(ThreadMessage&& msg, bool wait);
+  std::shared_ptr<CMessageReply> QueueMessage(ThreadMessage&& msg, bool reply);
+  void ProcessQueue(std::queue<ThreadMessage*> &messages);
   void ProcessMessage(ThreadMessage *pMsg);
 
+  // messages are recycled, callers send lots of them
+  ThreadMessage* AllocMessage(ThreadMessage&& msg);
+  void FreeMessage(ThreadMessage *pMsg);
+
   std::queue<ThreadMessage*> m_vecMessages;
   std::queue<ThreadMessage*> m_vecWindowMessages;
+  std::vector<ThreadMessage*> m_freeMessages;
   std::map<int, IMessageTarget*> m_mapTargets;
-  CCriticalSection m_critSection;
+  mutable CCriticalSection m_critSection;
+  Stats m_stats;
 };
 }
 }
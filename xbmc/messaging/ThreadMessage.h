@@ -23,14 +23,13 @@
 #include <string>
 #include <vector>
 
-class CEvent;
-
 namespace KODI
 {
 namespace MESSAGING
 {
 
 class CApplicationMessenger;
+class CMessageReply;
 
 class ThreadMessage
 {
@@ -51,6 +50,8 @@ public:
     , param1{ p1 }
     , param2{ p2 }
     , lpVoid{ payload }
+    , result{ -1 }
+    , queued{ 0 }
   {
   }
 
@@ -61,6 +62,8 @@ public:
     , lpVoid{ payload }
     , strParam( param )
     , params( vecParams )
+    , result{ -1 }
+    , queued{ 0 }
   {
   }
 
@@ -71,8 +74,9 @@ public:
     lpVoid(other.lpVoid),
     strParam(other.strParam),
     params(other.params),
-    waitEvent(other.waitEvent),
-    result(other.result)
+    reply(other.reply),
+    result(other.result),
+    queued(other.queued)
   {
   }
 
@@ -83,8 +87,9 @@ public:
     lpVoid(other.lpVoid),
     strParam(std::move(other.strParam)),
     params(std::move(other.params)),
-    waitEvent(std::move(other.waitEvent)),
-    result(std::move(other.result))
+    reply(std::move(other.reply)),
+    result(other.result),
+    queued(other.queued)
   {
   }
 
@@ -98,8 +103,9 @@ public:
     lpVoid = other.lpVoid;
     strParam = other.strParam;
     params = other.params;
-    waitEvent = other.waitEvent;
+    reply = other.reply;
     result = other.result;
+    queued = other.queued;
     return *this;
   }
 
@@ -113,8 +119,9 @@ public:
     lpVoid = other.lpVoid;
     strParam = std::move(other.strParam);
     params = std::move(other.params);
-    waitEvent = std::move(other.waitEvent);
-    result = std::move(other.result);
+    reply = std::move(other.reply);
+    result = other.result;
+    queued = other.queued;
     return *this;
   }
 
@@ -127,15 +134,15 @@ public:
 
   void SetResult(int res)
   {
-    //On posted messages result will be zero, since they can't
-    //retreive the response we silently ignore this to let message
-    //handlers not have to worry about it
-    if (result)
-      *result = res;
+    //Posted messages have nobody to retrieve the result, it's
+    //simply dropped so that message handlers don't have to
+    //worry about it
+    result = res;
   }
 protected:
-  std::shared_ptr<CEvent> waitEvent;
-  std::shared_ptr<int> result;
+  std::shared_ptr<CMessageReply> reply; ///< completed with the result once processed, unless the message was posted
+  int result;
+  unsigned int queued;                  ///< time the message was queued, in ms
 };
 }
 }
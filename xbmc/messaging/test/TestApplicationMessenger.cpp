@@ -0,0 +1,235 @@
+/*
+ *      Copyright (C) 2005-2013 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "messaging/ApplicationMessenger.h"
+#include "messaging/IMessageTarget.h"
+#include "threads/SystemClock.h"
+#include "threads/Thread.h"
+#include "utils/TimeUtils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <inttypes.h>
+#include <memory>
+#include <stdio.h>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using namespace KODI::MESSAGING;
+
+namespace
+{
+const uint32_t TMSG_MASK_TEST = 1 << 24;
+// returns param1 after working for param2 ms
+const uint32_t TMSG_TEST_ECHO = TMSG_MASK_TEST + 0;
+
+class CTestTarget : public IMessageTarget
+{
+public:
+  virtual int GetMessageMask() override { return TMSG_MASK_TEST; }
+  virtual void OnApplicationMessage(ThreadMessage* msg) override
+  {
+    if (msg->param2 > 0)
+      XbmcThreads::ThreadSleep(msg->param2);
+    msg->SetResult(msg->param1);
+  }
+};
+
+CApplicationMessenger& GetMessenger()
+{
+  static CTestTarget target;
+  static bool registered = false;
+  if (!registered)
+  {
+    CApplicationMessenger::GetInstance().RegisterReceiver(&target);
+    registered = true;
+  }
+  return CApplicationMessenger::GetInstance();
+}
+
+void ProcessAll()
+{
+  while (GetMessenger().GetStats().queued > 0)
+    GetMessenger().ProcessMessages();
+}
+
+/* Sends messages from another thread, recording how long each call took */
+class CSender : public IRunnable
+{
+public:
+  CSender(int messages, bool async) : m_messages(messages), m_async(async), m_done(false), m_correct(0), m_issueTime(0) { }
+
+  virtual void Run() override
+  {
+    std::vector< CJobFuture<int> > replies;
+    for (int i = 0; i < m_messages; i++)
+    {
+      int64_t start = CurrentHostCounter();
+      if (m_async)
+      {
+        replies.push_back(GetMessenger().SendMsgAsync(TMSG_TEST_ECHO, i));
+        m_issueTime += CurrentHostCounter() - start;
+      }
+      else
+      {
+        if (GetMessenger().SendMsg(TMSG_TEST_ECHO, i) == i)
+          m_correct++;
+        m_latencies.push_back(1000.0 * (CurrentHostCounter() - start) / CurrentHostFrequency());
+      }
+    }
+    for (int i = 0; i < (int)replies.size(); i++)
+    {
+      if (replies[i].Get() == i)
+        m_correct++;
+    }
+    m_done = true;
+  }
+
+  int m_messages;
+  bool m_async;
+  std::atomic<bool> m_done;
+  int m_correct;
+  int64_t m_issueTime;
+  std::vector<double> m_latencies;
+};
+
+/* Callers sending messages while the application thread renders frames and works off posted messages */
+void CallerLatencyUnderLoad(int senders, int messages, bool report)
+{
+  std::vector< std::unique_ptr<CSender> > syncSenders;
+  std::vector< std::unique_ptr<CThread> > threads;
+  for (int i = 0; i < senders; i++)
+  {
+    syncSenders.push_back(std::unique_ptr<CSender>(new CSender(messages, false)));
+    threads.push_back(std::unique_ptr<CThread>(new CThread(syncSenders.back().get(), "TestSender")));
+  }
+  CSender asyncSender(senders * messages, true);
+  threads.push_back(std::unique_ptr<CThread>(new CThread(&asyncSender, "TestSender")));
+
+  CApplicationMessenger::Stats before = GetMessenger().GetStats();
+  for (std::vector< std::unique_ptr<CThread> >::iterator it = threads.begin(); it != threads.end(); ++it)
+    (*it)->Create();
+
+  XbmcThreads::EndTime timeout(60000);
+  unsigned int frames = 0;
+  bool done = false;
+  while (!done && !timeout.IsTimePast())
+  {
+    // render a frame and keep some posted work queued
+    XbmcThreads::ThreadSleep(10);
+    for (int i = 0; i < 5; i++)
+      GetMessenger().PostMsg(TMSG_TEST_ECHO, i, 1);
+    GetMessenger().ProcessMessages();
+    frames++;
+
+    done = asyncSender.m_done;
+    for (int i = 0; i < senders; i++)
+      done = done && syncSenders[i]->m_done;
+  }
+  for (std::vector< std::unique_ptr<CThread> >::iterator it = threads.begin(); it != threads.end(); ++it)
+    (*it)->StopThread();
+  ProcessAll();
+
+  std::vector<double> latencies;
+  for (int i = 0; i < senders; i++)
+  {
+    EXPECT_EQ(messages, syncSenders[i]->m_correct);
+    latencies.insert(latencies.end(), syncSenders[i]->m_latencies.begin(), syncSenders[i]->m_latencies.end());
+  }
+  EXPECT_EQ(senders * messages, asyncSender.m_correct);
+  ASSERT_FALSE(latencies.empty());
+
+  std::sort(latencies.begin(), latencies.end());
+  double total = 0;
+  for (std::vector<double>::const_iterator it = latencies.begin(); it != latencies.end(); ++it)
+    total += *it;
+  double asyncTime = 1000.0 * asyncSender.m_issueTime / CurrentHostFrequency();
+
+  // sending asynchronously doesn't wait for frames
+  EXPECT_LT(asyncTime, total);
+
+  if (report)
+  {
+    CApplicationMessenger::Stats after = GetMessenger().GetStats();
+    printf("%u frames, SendMsg latency %.2f ms average, %.2f ms median, %.2f ms max, SendMsgAsync %.4f ms per call\n",
+           frames, total / latencies.size(), latencies[latencies.size() / 2], latencies.back(), asyncTime / (senders * messages));
+    printf("processed %" PRIu64 " messages, %u frames over budget, max %u queued, waited <1/4/16/64/256/+ ms: %u/%u/%u/%u/%u/%u\n",
+           after.processed - before.processed, after.deferred - before.deferred, after.maxQueued,
+           after.waits[0] - before.waits[0], after.waits[1] - before.waits[1], after.waits[2] - before.waits[2],
+           after.waits[3] - before.waits[3], after.waits[4] - before.waits[4], after.waits[5] - before.waits[5]);
+  }
+}
+}
+
+TEST(TestApplicationMessenger, SendMsgAsync)
+{
+  CJobFuture<int> reply = GetMessenger().SendMsgAsync(TMSG_TEST_ECHO, 42);
+  EXPECT_FALSE(reply.IsReady());
+
+  ProcessAll();
+  ASSERT_TRUE(reply.IsReady());
+  EXPECT_EQ(42, reply.Get());
+}
+
+TEST(TestApplicationMessenger, SendMsgWaitsForResult)
+{
+  CSender sender(10, false);
+  CThread thread(&sender, "TestSender");
+  thread.Create();
+
+  XbmcThreads::EndTime timeout(10000);
+  while (!sender.m_done && !timeout.IsTimePast())
+  {
+    GetMessenger().ProcessMessages();
+    XbmcThreads::ThreadSleep(1);
+  }
+  thread.StopThread();
+  EXPECT_EQ(10, sender.m_correct);
+}
+
+TEST(TestApplicationMessenger, FrameBudget)
+{
+  CApplicationMessenger::Stats before = GetMessenger().GetStats();
+  for (int i = 0; i < 100; i++)
+    GetMessenger().PostMsg(TMSG_TEST_ECHO, i, 1);
+
+  // a burst of messages is spread over several frames
+  GetMessenger().ProcessMessages();
+  CApplicationMessenger::Stats after = GetMessenger().GetStats();
+  EXPECT_LT(after.processed - before.processed, 100U);
+  EXPECT_GT(after.queued, 0U);
+  EXPECT_EQ(before.deferred + 1, after.deferred);
+
+  ProcessAll();
+  EXPECT_EQ(before.processed + 100, GetMessenger().GetStats().processed);
+}
+
+TEST(TestApplicationMessenger, CallerLatencyUnderLoad)
+{
+  CallerLatencyUnderLoad(2, 5, false);
+}
+
+// Timing run, not part of the unit tests. Run it with
+// --gtest_also_run_disabled_tests --gtest_filter=TestApplicationMessenger.DISABLED_CallerLatencyUnderLoadBenchmark
+TEST(TestApplicationMessenger, DISABLED_CallerLatencyUnderLoadBenchmark)
+{
+  CallerLatencyUnderLoad(4, 25, true);
+}
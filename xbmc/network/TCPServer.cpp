@@ -269,7 +269,7 @@ bool CTCPServer::Initialize()
 
   if (started)
   {
-    CAnnouncementManager::GetInstance().AddAnnouncer(this);
+    CAnnouncementManager::GetInstance().AddAnnouncer(this, g_advancedSettings.m_jsonAnnouncementsPerSecond);
     CLog::Log(LOGINFO, "JSONRPC Server: Successfully initialized");
     return true;
   }
@@ -212,6 +212,27 @@ bool CPicture::CacheTexture(uint8_t *pixels, uint32_t width, uint32_t height, ui
   uint32_t &dest_width, uint32_t &dest_height, const std::string &dest,
   CPictureScalingAlgorithm::Algorithm scalingAlgorithm /* = CPictureScalingAlgorithm::NoAlgorithm */)
 {
+  uint32_t *buffer = NULL;
+  SwsContext *scaler = NULL;
+  bool success = ScaleForCache(pixels, width, height, pitch, orientation, dest_width, dest_height, buffer, scalingAlgorithm, scaler);
+  sws_freeContext(scaler);
+  if (success)
+  {
+    if (buffer)
+      success = CreateThumbnailFromSurface((unsigned char*)buffer, dest_width, dest_height, dest_width * 4, dest);
+    else
+      success = CreateThumbnailFromSurface(pixels, width, height, pitch, dest);
+  }
+  delete[] buffer;
+  return success;
+}
+
+bool CPicture::ScaleForCache(uint8_t *pixels, uint32_t width, uint32_t height, uint32_t pitch, int orientation,
+  uint32_t &dest_width, uint32_t &dest_height, uint32_t *&result,
+  CPictureScalingAlgorithm::Algorithm scalingAlgorithm, SwsContext *&scaler)
+{
+  result = NULL;
+
   // if no max width or height is specified, don't resize
   if (dest_width == 0)
     dest_width = width;
@@ -247,11 +268,12 @@ bool CPicture::CacheTexture(uint8_t *pixels, uint32_t width, uint32_t height, ui
     {
       if (ScaleImage(pixels, width, height, pitch,
                      (uint8_t *)buffer, dest_width, dest_height, dest_width * 4,
-                     scalingAlgorithm))
+                     scalingAlgorithm, scaler))
       {
         if (!orientation || OrientateImage(buffer, dest_width, dest_height, orientation))
         {
-          success = CreateThumbnailFromSurface((unsigned char*)buffer, dest_width, dest_height, dest_width * 4, dest);
+          result = buffer;
+          return true;
         }
       }
       delete[] buffer;
@@ -262,7 +284,7 @@ bool CPicture::CacheTexture(uint8_t *pixels, uint32_t width, uint32_t height, ui
   { // no orientation needed
     dest_width = width;
     dest_height = height;
-    return CreateThumbnailFromSurface(pixels, width, height, pitch, dest);
+    return true;
   }
   return false;
 }
@@ -358,6 +380,27 @@ bool CPicture::ScaleImage(uint8_t *in_pixels, unsigned int in_width, unsigned in
   return false;
 }
 
+bool CPicture::ScaleImage(uint8_t *in_pixels, unsigned int in_width, unsigned int in_height, unsigned int in_pitch,
+                          uint8_t *out_pixels, unsigned int out_width, unsigned int out_height, unsigned int out_pitch,
+                          CPictureScalingAlgorithm::Algorithm scalingAlgorithm, SwsContext *&context)
+{
+  // setting up the filters is expensive, so the context is kept while the sizes stay the same.
+  // swscale picks the SIMD kernels of the cpu at runtime, as long as it isn't asked for accurate rounding.
+  context = sws_getCachedContext(context, in_width, in_height, AV_PIX_FMT_BGRA,
+                                 out_width, out_height, AV_PIX_FMT_BGRA,
+                                 CPictureScalingAlgorithm::ToSwscale(scalingAlgorithm), NULL, NULL, NULL);
+  if (!context)
+    return false;
+
+  uint8_t *src[] = { in_pixels, 0, 0, 0 };
+  int     srcStride[] = { (int)in_pitch, 0, 0, 0 };
+  uint8_t *dst[] = { out_pixels , 0, 0, 0 };
+  int     dstStride[] = { (int)out_pitch, 0, 0, 0 };
+
+  sws_scale(context, src, srcStride, 0, in_height, dst, dstStride);
+  return true;
+}
+
 bool CPicture::OrientateImage(uint32_t *&pixels, unsigned int &width, unsigned int &height, int orientation)
 {
   // ideas for speeding these functions up: http://cgit.freedesktop.org/pixman/tree/pixman/pixman-fast-path.c
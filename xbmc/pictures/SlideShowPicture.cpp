@@ -837,6 +837,7 @@ void CSlideShowPic::Render(float *x, float *y, CBaseTexture* pTexture, color_t c
   }
 
 #elif defined(HAS_GL)
+  g_Windowing.FlushBatchedRendering();
   if (pTexture)
   {
     int unit = 0;
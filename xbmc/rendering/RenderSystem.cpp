@@ -67,6 +67,11 @@ bool CRenderSystemBase::SupportsBGRAApple() const
   return (m_renderCaps & RENDER_CAPS_BGRA_APPLE) == RENDER_CAPS_BGRA_APPLE;
 }
 
+bool CRenderSystemBase::SupportsPBO() const
+{
+  return (m_renderCaps & RENDER_CAPS_PBO) == RENDER_CAPS_PBO;
+}
+
 bool CRenderSystemBase::SupportsStereo(RENDER_STEREO_MODE mode) const
 {
   switch(mode)
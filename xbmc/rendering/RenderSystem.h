@@ -50,7 +50,8 @@ enum
   RENDER_CAPS_NPOT     = (1 << 1),
   RENDER_CAPS_DXT_NPOT = (1 << 2),
   RENDER_CAPS_BGRA     = (1 << 3),
-  RENDER_CAPS_BGRA_APPLE = (1 << 4)
+  RENDER_CAPS_BGRA_APPLE = (1 << 4),
+  RENDER_CAPS_PBO      = (1 << 5)
 };
 
 enum
@@ -129,6 +130,12 @@ public:
 
   virtual bool TestRender() = 0;
 
+  /**
+   * Draw anything the GUI queued to draw in batches. Must be called before
+   * drawing outside of the GUI textures, e.g. video or addons.
+   */
+  virtual void FlushBatchedRendering() { }
+
   /**
    * Project (x,y,z) 3d scene coordinates to (x,y) 2d screen coordinates
    */
@@ -141,6 +148,7 @@ public:
   bool SupportsDXT() const;
   bool SupportsBGRA() const;
   bool SupportsBGRAApple() const;
+  bool SupportsPBO() const;
   bool SupportsNPOT(bool dxt) const;
   virtual bool SupportsStereo(RENDER_STEREO_MODE mode) const;
   unsigned int GetMaxTextureSize() const { return m_maxTextureSize; }
@@ -25,6 +25,8 @@
 
 #include "RenderSystemGL.h"
 #include "guilib/GraphicContext.h"
+#include "guilib/GUITextureGL.h"
+#include "guilib/TextureGL.h"
 #include "settings/AdvancedSettings.h"
 #include "guilib/MatrixGLES.h"
 #include "settings/DisplaySettings.h"
@@ -161,6 +163,10 @@ bool CRenderSystemGL::InitRenderSystem()
     if (m_renderCaps & RENDER_CAPS_DXT) 
       m_renderCaps |= RENDER_CAPS_DXT_NPOT;
   }
+
+  if (IsExtSupported("GL_ARB_pixel_buffer_object"))
+    m_renderCaps |= RENDER_CAPS_PBO;
+
   //Check OpenGL quirks and revert m_renderCaps as needed
   CheckOpenGLQuirks();
 	
@@ -236,6 +242,8 @@ bool CRenderSystemGL::ResetRenderSystem(int width, int height, bool fullScreen,
 
 bool CRenderSystemGL::DestroyRenderSystem()
 {
+  CGUITextureGL::DestroyBatch();
+  CGLTexture::DestroyUploadBuffer();
   m_bRenderCreated = false;
 
   return true;
@@ -246,6 +254,7 @@ bool CRenderSystemGL::BeginRender()
   if (!m_bRenderCreated)
     return false;
 
+  CGUIQuadBatch::BeginFrame();
   return true;
 }
 
@@ -254,11 +263,19 @@ bool CRenderSystemGL::EndRender()
   if (!m_bRenderCreated)
     return false;
 
+  FlushBatchedRendering();
+  CGUIQuadBatch::EndFrame();
   return true;
 }
 
+void CRenderSystemGL::FlushBatchedRendering()
+{
+  CGUITextureGL::FlushBatch();
+}
+
 bool CRenderSystemGL::ClearBuffers(color_t color)
 {
+  FlushBatchedRendering();
   if (!m_bRenderCreated)
     return false;
 
@@ -323,6 +340,7 @@ void CRenderSystemGL::SetVSync(bool enable)
 
 void CRenderSystemGL::CaptureStateBlock()
 {
+  FlushBatchedRendering();
   if (!m_bRenderCreated)
     return;
 
@@ -357,6 +375,7 @@ void CRenderSystemGL::ApplyStateBlock()
 
 void CRenderSystemGL::SetCameraPosition(const CPoint &camera, int screenWidth, int screenHeight, float stereoFactor)
 {
+  FlushBatchedRendering();
   if (!m_bRenderCreated)
     return;
 
@@ -389,6 +408,7 @@ void CRenderSystemGL::Project(float &x, float &y, float &z)
 
 bool CRenderSystemGL::TestRender()
 {
+  FlushBatchedRendering();
   static float theta = 0.0;
 
   glPushMatrix();
@@ -407,6 +427,7 @@ bool CRenderSystemGL::TestRender()
 
 void CRenderSystemGL::ApplyHardwareTransform(const TransformMatrix &finalMatrix)
 {
+  FlushBatchedRendering();
   if (!m_bRenderCreated)
     return;
 
@@ -428,6 +449,7 @@ void CRenderSystemGL::ApplyHardwareTransform(const TransformMatrix &finalMatrix)
 
 void CRenderSystemGL::RestoreHardwareTransform()
 {
+  FlushBatchedRendering();
   if (!m_bRenderCreated)
     return;
 
@@ -493,6 +515,7 @@ void CRenderSystemGL::GetViewPort(CRect& viewPort)
 
 void CRenderSystemGL::SetViewPort(CRect& viewPort)
 {
+  FlushBatchedRendering();
   if (!m_bRenderCreated)
     return;
 
@@ -506,6 +529,7 @@ void CRenderSystemGL::SetViewPort(CRect& viewPort)
 
 void CRenderSystemGL::SetScissors(const CRect &rect)
 {
+  FlushBatchedRendering();
   if (!m_bRenderCreated)
     return;
   GLint x1 = MathUtils::round_int(rect.x1);
@@ -517,6 +541,7 @@ void CRenderSystemGL::SetScissors(const CRect &rect)
 
 void CRenderSystemGL::ResetScissors()
 {
+  FlushBatchedRendering();
   SetScissors(CRect(0, 0, (float)m_width, (float)m_height));
 }
 
@@ -577,6 +602,7 @@ static const GLubyte stipple_3d[] = {
 
 void CRenderSystemGL::SetStereoMode(RENDER_STEREO_MODE mode, RENDER_STEREO_VIEW view)
 {
+  FlushBatchedRendering();
   CRenderSystemBase::SetStereoMode(mode, view);
 
   glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
@@ -38,6 +38,7 @@ public:
   bool EndRender() override;
   void PresentRender(bool rendered, bool videoLayer) override;
   bool ClearBuffers(color_t color) override;
+  void FlushBatchedRendering() override;
   bool IsExtSupported(const char* extension) override;
 
   void SetVSync(bool vsync);
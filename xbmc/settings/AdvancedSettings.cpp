@@ -261,10 +261,14 @@ void CAdvancedSettings::Initialize()
   m_fanartRes = 1080;
   m_imageRes = 720;
   m_imageScalingAlgorithm = CPictureScalingAlgorithm::Default;
+  m_useDDSTextures = false;
 
   m_sambaclienttimeout = 10;
   m_sambadoscodepage = "";
   m_sambastatfiles = true;
+  m_sambareadsize = 64;
+
+  m_nfsPipelineDepth = 0;
 
   m_bHTTPDirectoryStatFilesize = false;
 
@@ -321,6 +325,7 @@ void CAdvancedSettings::Initialize()
   m_curlretries = 2;
   m_curlDisableIPV6 = false;      //Certain hardware/OS combinations have trouble
                                   //with ipv6.
+  m_networkDirectoryCacheTTL = 60;
 
 #if defined(TARGET_DARWIN_IOS)
   m_startFullScreen = true;
@@ -360,11 +365,16 @@ void CAdvancedSettings::Initialize()
   // the following setting determines the readRate of a player data
   // as multiply of the default data read rate
   m_cacheReadFactor = 4.0f;
+  // number of connections used to fill the cache from http sources, 0 = one stream
+  m_cacheParallelRanges = 0;
+  // size in MB of the persistent block cache for remote files, 0 = disabled
+  m_cacheDiskSize = 0;
 
   m_addonPackageFolderSize = 200;
 
   m_jsonOutputCompact = true;
   m_jsonTcpPort = 9090;
+  m_jsonAnnouncementsPerSecond = 0;
 
   m_enableMultimediaKeys = false;
 
@@ -402,6 +412,7 @@ void CAdvancedSettings::Initialize()
   m_logLevelHint = m_logLevel = LOG_LEVEL_NORMAL;
   m_extraLogEnabled = false;
   m_extraLogLevels = 0;
+  m_logMaxSize = 0;
 
   m_userAgent = g_sysinfo.GetUserAgent();
 
@@ -791,6 +802,7 @@ void CAdvancedSettings::ParseSettingsFile(const std::string &file)
     XMLUtils::GetInt(pElement, "curllowspeedtime", m_curllowspeedtime, 1, 1000);
     XMLUtils::GetInt(pElement, "curlretries", m_curlretries, 0, 10);
     XMLUtils::GetBoolean(pElement,"disableipv6", m_curlDisableIPV6);
+    XMLUtils::GetUInt(pElement, "directorycachettl", m_networkDirectoryCacheTTL, 0, 86400);
   }
 
   pElement = pRootElement->FirstChildElement("cache");
@@ -799,6 +811,8 @@ void CAdvancedSettings::ParseSettingsFile(const std::string &file)
     XMLUtils::GetUInt(pElement, "memorysize", m_cacheMemSize);
     XMLUtils::GetUInt(pElement, "buffermode", m_cacheBufferMode, 0, 4);
     XMLUtils::GetFloat(pElement, "readfactor", m_cacheReadFactor);
+    XMLUtils::GetUInt(pElement, "parallelranges", m_cacheParallelRanges, 0, 16);
+    XMLUtils::GetUInt(pElement, "disksize", m_cacheDiskSize);
   }
 
   pElement = pRootElement->FirstChildElement("jsonrpc");
@@ -806,6 +820,7 @@ void CAdvancedSettings::ParseSettingsFile(const std::string &file)
   {
     XMLUtils::GetBoolean(pElement, "compactoutput", m_jsonOutputCompact);
     XMLUtils::GetUInt(pElement, "tcpport", m_jsonTcpPort);
+    XMLUtils::GetUInt(pElement, "announcementspersecond", m_jsonAnnouncementsPerSecond);
   }
 
   pElement = pRootElement->FirstChildElement("samba");
@@ -814,6 +829,13 @@ void CAdvancedSettings::ParseSettingsFile(const std::string &file)
     XMLUtils::GetString(pElement,  "doscodepage",   m_sambadoscodepage);
     XMLUtils::GetInt(pElement, "clienttimeout", m_sambaclienttimeout, 5, 100);
     XMLUtils::GetBoolean(pElement, "statfiles", m_sambastatfiles);
+    XMLUtils::GetUInt(pElement, "readsize", m_sambareadsize, 64, 16384);
+  }
+
+  pElement = pRootElement->FirstChildElement("nfs");
+  if (pElement)
+  {
+    XMLUtils::GetUInt(pElement, "readpipelinedepth", m_nfsPipelineDepth, 0, 32);
   }
 
   pElement = pRootElement->FirstChildElement("httpdirectory");
@@ -842,6 +864,9 @@ void CAdvancedSettings::ParseSettingsFile(const std::string &file)
     CLog::SetLogLevel(g_advancedSettings.m_logLevel);
   }
 
+  if (XMLUtils::GetInt(pRootElement, "logmaxsize", m_logMaxSize, 0, 4096))
+    CLog::SetMaxLogSize((uint64_t)m_logMaxSize * 1024 * 1024);
+
   XMLUtils::GetString(pRootElement, "cddbaddress", m_cddbAddress);
 
   //airtunes + airplay
@@ -1016,6 +1041,7 @@ void CAdvancedSettings::ParseSettingsFile(const std::string &file)
   XMLUtils::GetUInt(pRootElement, "imageres", m_imageRes, 0, 1080);
   if (XMLUtils::GetString(pRootElement, "imagescalingalgorithm", tmp))
     m_imageScalingAlgorithm = CPictureScalingAlgorithm::FromString(tmp);
+  XMLUtils::GetBoolean(pRootElement, "useddstextures", m_useDDSTextures);
   XMLUtils::GetBoolean(pRootElement, "playlistasfolders", m_playlistAsFolders);
   XMLUtils::GetBoolean(pRootElement, "detectasudf", m_detectAsUdf);
 
@@ -205,6 +205,7 @@ class CAdvancedSettings : public ISettingCallback, public ISettingsHandler
     int m_logLevelHint;
     bool m_extraLogEnabled;
     int m_extraLogLevels;
+    int m_logMaxSize; ///< size in MB the log is rotated at, 0 for no limit
     std::string m_cddbAddress;
 
     //airtunes + airplay
@@ -240,10 +241,14 @@ class CAdvancedSettings : public ISettingCallback, public ISettingsHandler
     unsigned int m_fanartRes; ///< \brief the maximal resolution to cache fanart at (assumes 16x9)
     unsigned int m_imageRes;  ///< \brief the maximal resolution to cache images at (assumes 16x9)
     CPictureScalingAlgorithm::Algorithm m_imageScalingAlgorithm;
+    bool m_useDDSTextures;    ///< \brief also cache images as DXT compressed .dds textures, if the GPU supports them
 
     int m_sambaclienttimeout;
     std::string m_sambadoscodepage;
     bool m_sambastatfiles;
+    unsigned int m_sambareadsize; ///< \brief max size of a read in KB, larger reads let libsmbclient pipeline them
+
+    unsigned int m_nfsPipelineDepth; ///< \brief number of NFS reads kept in flight, pipelining is off if < 2
 
     bool m_bHTTPDirectoryStatFilesize;
 
@@ -298,6 +303,7 @@ class CAdvancedSettings : public ISettingCallback, public ISettingsHandler
     int m_curllowspeedtime;
     int m_curlretries;
     bool m_curlDisableIPV6;
+    unsigned int m_networkDirectoryCacheTTL; ///< \brief seconds a network listing stays fresh in the directory cache
 
     bool m_fullScreen;
     bool m_startFullScreen;
@@ -345,9 +351,12 @@ class CAdvancedSettings : public ISettingCallback, public ISettingsHandler
     unsigned int m_cacheMemSize;
     unsigned int m_cacheBufferMode;
     float m_cacheReadFactor;
+    unsigned int m_cacheParallelRanges;
+    unsigned int m_cacheDiskSize;
 
     bool m_jsonOutputCompact;
     unsigned int m_jsonTcpPort;
+    unsigned int m_jsonAnnouncementsPerSecond; ///< notifications sent to the JSON-RPC clients per second at most, 0 for no limit
 
     bool m_enableMultimediaKeys;
     std::vector<std::string> m_settingsFiles;
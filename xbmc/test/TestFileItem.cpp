@@ -18,9 +18,13 @@
  *
  */
 
+#include <stdio.h>
+
 #include "FileItem.h"
 #include "URL.h"
 #include "settings/AdvancedSettings.h"
+#include "utils/StringUtils.h"
+#include "utils/TimeUtils.h"
 
 #include "gtest/gtest.h"
 
@@ -136,3 +140,180 @@ const TestFileData BaseMovies[] = {{ "c:\\dir\\filename.avi", false, "c:\\dir\\f
                                    { "/home/user/movies/movie_name/BDMV/index.bdmv", true, "/home/user/movies/movie_name/" }};
 
 INSTANTIATE_TEST_CASE_P(BaseNameMovies, TestFileItemBasePath, ValuesIn(BaseMovies));
+
+TEST(TestFileItemList, FastLookup)
+{
+  CFileItemList items;
+  for (int i = 0; i < 100; i++)
+    items.Add(CFileItemPtr(new CFileItem(StringUtils::Format("/music/%02d.mp3", i), false)));
+  items.SetFastLookup(true);
+  CFileItemPtr duplicate(new CFileItem("/music/07.mp3", false));
+  items.Add(duplicate);
+  items.Add(CFileItemPtr(new CFileItem("/music/new.mp3", false)));
+
+  EXPECT_TRUE(items.Contains("/music/42.mp3"));
+  EXPECT_TRUE(items.Contains("/music/new.mp3"));
+  EXPECT_FALSE(items.Contains("/music/100.mp3"));
+  EXPECT_EQ("/music/42.mp3", items.Get("/music/42.mp3")->GetPath());
+
+  // the first item with a path is found, removing it reveals the next one
+  CFileItemPtr first = items.Get("/music/07.mp3");
+  EXPECT_NE(duplicate, first);
+  items.Remove(first.get());
+  EXPECT_EQ(duplicate, items.Get("/music/07.mp3"));
+  items.Remove(items.Size() - 2);
+  EXPECT_FALSE(items.Contains("/music/07.mp3"));
+
+  items.Sort(SortByLabel, SortOrderDescending);
+  EXPECT_TRUE(items.Contains("/music/00.mp3"));
+  EXPECT_TRUE(items.Contains("/music/99.mp3"));
+
+  items.Add(CFileItemPtr(new CFileItem("http://host/stream.mp3?token=1", false)));
+  EXPECT_FALSE(items.Contains("http://host/stream.mp3"));
+  items.SetIgnoreURLOptions(true);
+  EXPECT_TRUE(items.Contains("http://host/stream.mp3"));
+}
+
+/* Merges a listing of count items with one that overlaps it by half, the way
+ * a directory update is merged, and checks that only the new items are added.
+ * The time taken is printed when report is set. */
+static void MergeListings(int count, bool report)
+{
+  CFileItemList listing, update;
+  for (int i = 0; i < count; i++)
+  {
+    listing.Add(CFileItemPtr(new CFileItem(StringUtils::Format("smb://server/music/Artist %d/Album/%02d - Title.flac", i / 12, i % 12), false)));
+    const int j = i + count / 2;
+    update.Add(CFileItemPtr(new CFileItem(StringUtils::Format("smb://server/music/Artist %d/Album/%02d - Title.flac", j / 12, j % 12), false)));
+  }
+
+  int64_t start = CurrentHostCounter();
+  listing.SetFastLookup(true);
+  int added = 0;
+  for (int i = 0; i < update.Size(); i++)
+  {
+    if (!listing.Contains(update[i]->GetPath()))
+    {
+      listing.Add(update[i]);
+      added++;
+    }
+  }
+  int64_t elapsed = CurrentHostCounter() - start;
+
+  EXPECT_EQ(count / 2, added);
+  EXPECT_EQ(count + count / 2, listing.Size());
+  if (report)
+    printf("merging two listings of %d items: %.1f ms\n", count, elapsed * 1000.0 / CurrentHostFrequency());
+}
+
+TEST(TestFileItemList, Merge)
+{
+  MergeListings(2000, false);
+}
+
+// Timing run, not part of the unit tests. Run it with
+// --gtest_also_run_disabled_tests --gtest_filter=TestFileItemList.DISABLED_MergeBenchmark
+TEST(TestFileItemList, DISABLED_MergeBenchmark)
+{
+  MergeListings(50000, true);
+}
+
+TEST(TestFileItemList, Resort)
+{
+  CFileItemList items;
+  for (int i = 0; i < 10000; i++)
+  {
+    CFileItemPtr item(new CFileItem(StringUtils::Format("Label %05d", (i * 7919) % 10000)));
+    item->m_dwSize = 10000 - i;
+    items.Add(item);
+  }
+
+  items.Sort(SortByLabel, SortOrderAscending);
+  EXPECT_EQ("Label 00000", items[0]->GetLabel());
+  EXPECT_EQ("Label 09999", items[9999]->GetLabel());
+
+  // and in the other order
+  items.Sort(SortByLabel, SortOrderDescending);
+  EXPECT_EQ("Label 09999", items[0]->GetLabel());
+  EXPECT_EQ("Label 00000", items[9999]->GetLabel());
+  items.Sort(SortBySize, SortOrderAscending);
+  for (int i = 1; i < items.Size(); i++)
+    ASSERT_LT(items[i - 1]->m_dwSize, items[i]->m_dwSize);
+
+  // relabelled items are sorted by their new label
+  items[0]->SetLabel("Label 99999");
+  items.Sort(SortByLabel, SortOrderAscending);
+  EXPECT_EQ("Label 99999", items[9999]->GetLabel());
+
+  // items taken into another list are sorted along with the items of that list
+  CFileItemList copy;
+  copy.Append(items);
+  copy.Add(CFileItemPtr(new CFileItem("Label 50000")));
+  copy.Sort(SortByLabel, SortOrderDescending);
+  EXPECT_EQ("Label 99999", copy[0]->GetLabel());
+  EXPECT_EQ("Label 50000", copy[1]->GetLabel());
+  EXPECT_EQ("Label 09999", copy[2]->GetLabel());
+}
+
+TEST(TestFileItemList, ResortChangedItems)
+{
+  CFileItemList items;
+  for (int i = 0; i < 100; i++)
+  {
+    CFileItemPtr item(new CFileItem(StringUtils::Format("Label %02d", i)));
+    item->m_dwSize = i;
+    items.Add(item);
+  }
+
+  items.Sort(SortBySize, SortOrderAscending);
+  EXPECT_EQ("Label 00", items[0]->GetLabel());
+
+  // sorting by another method picks up fields changed since the last sort
+  items[0]->m_dwSize = 1000;
+  items.Sort(SortByLabel, SortOrderDescending);
+  EXPECT_EQ("Label 99", items[0]->GetLabel());
+  items.Sort(SortBySize, SortOrderAscending);
+  EXPECT_EQ("Label 01", items[0]->GetLabel());
+  EXPECT_EQ("Label 00", items[99]->GetLabel());
+
+  // and so does a shared item changed through another list
+  CFileItemList other;
+  other.Add(items[0]);
+  other[0]->m_dwSize = 5000;
+  items.Sort(SortByLabel, SortOrderAscending);
+  items.Sort(SortBySize, SortOrderDescending);
+  EXPECT_EQ("Label 01", items[0]->GetLabel());
+}
+
+// Timing run, not part of the unit tests. Run it with
+// --gtest_also_run_disabled_tests --gtest_filter=TestFileItemList.DISABLED_SortBenchmark
+TEST(TestFileItemList, DISABLED_SortBenchmark)
+{
+  const int counts[] = { 10000, 50000, 100000 };
+  for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+  {
+    CFileItemList items;
+    for (int i = 0; i < counts[c]; i++)
+    {
+      const int n = (int)(((int64_t)i * 7919) % counts[c]);
+      CFileItemPtr item(new CFileItem(StringUtils::Format("smb://server/music/Artist %d/Album/%02d - Title.flac", n / 12, n % 12), false));
+      item->SetLabel(StringUtils::Format("The Title %d", n));
+      item->m_dwSize = i;
+      items.Add(item);
+    }
+
+    int64_t start = CurrentHostCounter();
+    items.Sort(SortByLabel, SortOrderAscending, SortAttributeIgnoreArticle);
+    int64_t sorted = CurrentHostCounter();
+    items.Sort(SortByLabel, SortOrderDescending, SortAttributeIgnoreArticle);
+    int64_t resorted = CurrentHostCounter();
+    items.Sort(SortBySize, SortOrderAscending);
+    int64_t bySize = CurrentHostCounter();
+
+    EXPECT_EQ(0, (int)items[0]->m_dwSize);
+    printf("sorting %d items: %.1f ms, in the other direction: %.1f ms, by another method: %.1f ms\n", counts[c],
+           (sorted - start) * 1000.0 / CurrentHostFrequency(),
+           (resorted - sorted) * 1000.0 / CurrentHostFrequency(),
+           (bySize - resorted) * 1000.0 / CurrentHostFrequency());
+  }
+}
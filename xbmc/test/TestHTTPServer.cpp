@@ -0,0 +1,270 @@
+/*
+ *      Copyright (C) 2017 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kodi; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "TestHTTPServer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// on Windows these come from the shims in platform/win32
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#include "threads/SingleLock.h"
+#include "utils/StringUtils.h"
+
+// size of the pieces a throttled connection sends at once
+#define TEST_HTTP_SEND_SIZE (16*1024)
+
+// don't raise SIGPIPE when a client hangs up, see SO_NOSIGPIPE where missing
+#if defined(MSG_NOSIGNAL)
+#define TEST_HTTP_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define TEST_HTTP_SEND_FLAGS 0
+#endif
+
+class CTestHTTPServer::CConnection : public CThread
+{
+public:
+  CConnection(CTestHTTPServer& server, SOCKET socket)
+    : CThread("TestHTTPConnection")
+    , m_server(server)
+    , m_socket(socket)
+  {
+  }
+
+  void Shutdown()
+  {
+    shutdown(m_socket, SHUT_RDWR);
+  }
+
+protected:
+  void Process() override
+  {
+    m_server.Serve(m_socket);
+    closesocket(m_socket);
+  }
+
+private:
+  CTestHTTPServer& m_server;
+  SOCKET m_socket;
+};
+
+CTestHTTPServer::CTestHTTPServer()
+  : CThread("TestHTTPServer")
+  , m_bytesPerSecond(0)
+  , m_latencyMs(0)
+  , m_socket(INVALID_SOCKET)
+  , m_port(0)
+  , m_requests(0)
+  , m_bytesServed(0)
+  , m_activeConnections(0)
+  , m_maxConnections(0)
+{
+}
+
+CTestHTTPServer::~CTestHTTPServer()
+{
+  Stop();
+}
+
+bool CTestHTTPServer::Start(const std::string& data, unsigned int bytesPerSecond, unsigned int latencyMs)
+{
+  Stop();
+
+  m_data = data;
+  m_bytesPerSecond = bytesPerSecond;
+  m_latencyMs = latencyMs;
+  ResetCounters();
+
+  m_socket = socket(AF_INET, SOCK_STREAM, 0);
+  if (m_socket == INVALID_SOCKET)
+    return false;
+
+  int reuse = 1;
+  setsockopt(m_socket, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  socklen_t addrlen = sizeof(addr);
+  if (bind(m_socket, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+      listen(m_socket, 16) < 0 ||
+      getsockname(m_socket, (struct sockaddr*)&addr, &addrlen) < 0)
+  {
+    closesocket(m_socket);
+    m_socket = INVALID_SOCKET;
+    return false;
+  }
+  m_port = ntohs(addr.sin_port);
+
+  Create();
+  return true;
+}
+
+void CTestHTTPServer::Stop()
+{
+  if (m_socket == INVALID_SOCKET)
+    return;
+
+  m_bStop = true;
+  shutdown(m_socket, SHUT_RDWR);
+  StopThread(true);
+  closesocket(m_socket);
+  m_socket = INVALID_SOCKET;
+
+  CSingleLock lock(m_critSection);
+  for (auto& connection : m_connections)
+    connection->Shutdown();
+  for (auto& connection : m_connections)
+    connection->StopThread(true);
+  m_connections.clear();
+}
+
+std::string CTestHTTPServer::GetUrl(const std::string& filename) const
+{
+  return StringUtils::Format("http://127.0.0.1:%d/%s", m_port, filename.c_str());
+}
+
+void CTestHTTPServer::ResetCounters()
+{
+  m_requests = 0;
+  m_bytesServed = 0;
+  m_maxConnections = 0;
+}
+
+void CTestHTTPServer::Process()
+{
+  while (!m_bStop)
+  {
+    SOCKET client = accept(m_socket, NULL, NULL);
+    if (client == INVALID_SOCKET)
+      break;
+
+#if defined(SO_NOSIGPIPE)
+    int noSigPipe = 1;
+    setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, (const char*)&noSigPipe, sizeof(noSigPipe));
+#endif
+
+    CSingleLock lock(m_critSection);
+    m_connections.emplace_back(new CConnection(*this, client));
+    m_connections.back()->Create();
+  }
+}
+
+void CTestHTTPServer::Serve(SOCKET socket)
+{
+  unsigned int active = ++m_activeConnections;
+  unsigned int peak = m_maxConnections;
+  while (active > peak && !m_maxConnections.compare_exchange_weak(peak, active))
+    ;
+
+  std::string request;
+  char buffer[4096];
+  while (!m_bStop)
+  {
+    size_t end = request.find("\r\n\r\n");
+    if (end == std::string::npos)
+    {
+      int received = recv(socket, buffer, sizeof(buffer), 0);
+      if (received <= 0)
+        break;
+      request.append(buffer, received);
+      continue;
+    }
+
+    std::string header = request.substr(0, end);
+    request.erase(0, end + 4);
+    m_requests++;
+
+    bool head = StringUtils::StartsWith(header, "HEAD ");
+    int64_t size = m_data.size();
+    int64_t start = 0;
+    int64_t last = size - 1;
+    bool range = false;
+
+    std::string lower(header);
+    StringUtils::ToLower(lower);
+    size_t pos = lower.find("\r\nrange: bytes=");
+    if (pos != std::string::npos)
+    {
+      const char* spec = header.c_str() + pos + 15;
+      char* next;
+      start = strtoll(spec, &next, 10);
+      if (*next == '-' && isdigit(next[1]))
+        last = std::min(static_cast<int64_t>(strtoll(next + 1, NULL, 10)), size - 1);
+      range = true;
+    }
+
+    std::string response;
+    if (range && start >= size)
+    {
+      response = StringUtils::Format("HTTP/1.1 416 Range Not Satisfiable\r\n"
+                                     "Content-Range: bytes */%" PRId64 "\r\n"
+                                     "Content-Length: 0\r\n\r\n", size);
+      start = last + 1;
+    }
+    else if (range)
+      response = StringUtils::Format("HTTP/1.1 206 Partial Content\r\n"
+                                     "Content-Range: bytes %" PRId64 "-%" PRId64 "/%" PRId64 "\r\n",
+                                     start, last, size);
+    else
+      response = "HTTP/1.1 200 OK\r\n";
+    if (!range || start < size)
+      response += StringUtils::Format("Accept-Ranges: bytes\r\n"
+                                      "Content-Type: application/octet-stream\r\n"
+                                      "Content-Length: %" PRId64 "\r\n\r\n", last - start + 1);
+
+    if (m_latencyMs > 0)
+      Sleep(m_latencyMs);
+
+    if (!SendData(socket, response.c_str(), response.size(), false))
+      break;
+    if (!head && start <= last && !SendData(socket, m_data.c_str() + start, last - start + 1, true))
+      break;
+  }
+
+  m_activeConnections--;
+}
+
+bool CTestHTTPServer::SendData(SOCKET socket, const char* data, size_t size, bool throttle)
+{
+  while (size > 0 && !m_bStop)
+  {
+    size_t length = size;
+    if (throttle && m_bytesPerSecond > 0)
+    {
+      length = std::min(length, static_cast<size_t>(TEST_HTTP_SEND_SIZE));
+      Sleep(static_cast<unsigned int>(1000 * length / m_bytesPerSecond));
+    }
+
+    int sent = send(socket, data, static_cast<int>(length), TEST_HTTP_SEND_FLAGS);
+    if (sent <= 0)
+      return false;
+
+    if (throttle)
+      m_bytesServed += sent;
+    data += sent;
+    size -= sent;
+  }
+  return size == 0;
+}
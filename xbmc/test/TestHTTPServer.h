@@ -0,0 +1,84 @@
+#pragma once
+
+/*
+ *      Copyright (C) 2017 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kodi; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "system.h"
+#include "threads/CriticalSection.h"
+#include "threads/Thread.h"
+
+/*!
+ \brief Minimal HTTP/1.1 server on localhost serving a single in-memory file.
+
+ Stands in for remote sources in filesystem tests. Supports keep-alive, HEAD
+ and single byte range requests, can add a fixed latency to every request and
+ throttle every connection to a given rate, and counts what it serves.
+ */
+class CTestHTTPServer : public CThread
+{
+public:
+  CTestHTTPServer();
+  ~CTestHTTPServer() override;
+
+  /*!
+   \brief Start serving data on a free port of 127.0.0.1
+   \param data content of the served file
+   \param bytesPerSecond throughput limit of every connection, 0 for unlimited
+   \param latencyMs delay before answering every request
+   */
+  bool Start(const std::string& data, unsigned int bytesPerSecond = 0, unsigned int latencyMs = 0);
+  void Stop();
+
+  /*! \brief URL of the served file, any path is accepted */
+  std::string GetUrl(const std::string& filename = "file.bin") const;
+
+  unsigned int GetRequestCount() const { return m_requests; }
+  uint64_t GetBytesServed() const { return m_bytesServed; }
+  unsigned int GetMaxConnections() const { return m_maxConnections; }
+  void ResetCounters();
+
+protected:
+  void Process() override;
+
+private:
+  class CConnection;
+  friend class CConnection;
+
+  void Serve(SOCKET socket);
+  bool SendData(SOCKET socket, const char* data, size_t size, bool throttle);
+
+  std::string m_data;
+  unsigned int m_bytesPerSecond;
+  unsigned int m_latencyMs;
+  SOCKET m_socket;
+  int m_port;
+
+  CCriticalSection m_critSection;
+  std::vector<std::unique_ptr<CConnection>> m_connections;
+  std::atomic<unsigned int> m_requests;
+  std::atomic<uint64_t> m_bytesServed;
+  std::atomic<unsigned int> m_activeConnections;
+  std::atomic<unsigned int> m_maxConnections;
+};
@@ -0,0 +1,203 @@
+/*
+ *      Copyright (C) 2017 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kodi; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "TextureCacheJob.h"
+#include "TextureCachePipeline.h"
+#include "threads/Event.h"
+#include "threads/SingleLock.h"
+#include "threads/Thread.h"
+#include "utils/StringUtils.h"
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <map>
+
+namespace
+{
+
+class CConcurrency
+{
+public:
+  CConcurrency() : m_current(0), m_max(0) {}
+  void Enter()
+  {
+    unsigned int current = ++m_current;
+    unsigned int max = m_max;
+    while (current > max && !m_max.compare_exchange_weak(max, current)) {}
+  }
+  void Leave() { --m_current; }
+  unsigned int GetMax() const { return m_max; }
+
+private:
+  std::atomic<unsigned int> m_current;
+  std::atomic<unsigned int> m_max;
+};
+
+CConcurrency g_io;
+CConcurrency g_cpu;
+
+class CFakeCacheJob : public CTextureCacheJob
+{
+public:
+  CFakeCacheJob(const std::string &url, const std::string &failStage = "")
+    : CTextureCacheJob(url), m_failStage(failStage) {}
+
+  virtual bool NeedsCaching() const { return true; }
+  virtual bool Prepare() { return Run("prepare", g_io); }
+  virtual bool Fetch() { return Run("fetch", g_io); }
+  virtual bool Decode() { return Run("decode", g_cpu); }
+  virtual bool Resize(SwsContext *&scaler) { return Run("resize", g_cpu); }
+  virtual bool Encode() { return Run("encode", g_cpu); }
+
+  std::string m_stages;
+
+private:
+  bool Run(const char *stage, CConcurrency &concurrency)
+  {
+    concurrency.Enter();
+    m_stages += stage;
+    m_stages += " ";
+    XbmcThreads::ThreadSleep(2);
+    concurrency.Leave();
+    return m_failStage != stage;
+  }
+
+  std::string m_failStage;
+};
+
+class TestTextureCachePipeline : public ::testing::Test, public ITextureCacheCallback
+{
+protected:
+  TestTextureCachePipeline() : m_expected(0), m_dropped(false) {}
+
+  virtual bool OnCachingStarted(const CTextureCacheJob *job)
+  {
+    return !m_dropped;
+  }
+
+  virtual void OnCachingComplete(bool success, CTextureCacheJob *job)
+  {
+    CSingleLock lock(m_section);
+    m_results[job->m_url] = std::make_pair(success, static_cast<CFakeCacheJob*>(job)->m_stages);
+    if (m_results.size() == m_expected)
+      m_complete.Set();
+  }
+
+  bool WaitForJobs(CTextureCachePipeline &pipeline, unsigned int count)
+  {
+    {
+      CSingleLock lock(m_section);
+      m_expected = count;
+      if (m_results.size() == m_expected)
+        return true;
+    }
+    return m_complete.WaitMSec(10000);
+  }
+
+  CCriticalSection m_section;
+  CEvent m_complete;
+  unsigned int m_expected;
+  bool m_dropped;
+  std::map<std::string, std::pair<bool, std::string> > m_results;
+};
+
+}
+
+TEST_F(TestTextureCachePipeline, RunsAllStagesInOrder)
+{
+  CTextureCachePipeline pipeline(this, 2, 2);
+  for (unsigned int i = 0; i < 20; i++)
+    EXPECT_TRUE(pipeline.AddJob(new CFakeCacheJob(StringUtils::Format("image%u.jpg", i))));
+  ASSERT_TRUE(WaitForJobs(pipeline, 20));
+
+  for (std::map<std::string, std::pair<bool, std::string> >::const_iterator i = m_results.begin(); i != m_results.end(); ++i)
+  {
+    EXPECT_TRUE(i->second.first);
+    EXPECT_EQ("prepare fetch decode resize encode ", i->second.second);
+  }
+
+  pipeline.Stop();
+  EXPECT_FALSE(pipeline.IsProcessing());
+  CTextureCachePipeline::Stats stats = pipeline.GetStats();
+  for (unsigned int stage = 0; stage < CTextureCachePipeline::NUM_STAGES; stage++)
+  {
+    EXPECT_EQ(20U, stats.stages[stage].images);
+    EXPECT_EQ(0U, stats.stages[stage].failed);
+    EXPECT_LT(0.0, stats.stages[stage].seconds);
+  }
+  EXPECT_EQ(0U, stats.pending);
+}
+
+TEST_F(TestTextureCachePipeline, LimitsConcurrency)
+{
+  CTextureCachePipeline pipeline(this, 2, 3);
+  for (unsigned int i = 0; i < 50; i++)
+    pipeline.AddJob(new CFakeCacheJob(StringUtils::Format("image%u.jpg", i)));
+  ASSERT_TRUE(WaitForJobs(pipeline, 50));
+  pipeline.Stop();
+
+  EXPECT_LE(g_io.GetMax(), 2U);
+  EXPECT_LE(g_cpu.GetMax(), 3U);
+  EXPECT_LE(1U, g_cpu.GetMax());
+}
+
+TEST_F(TestTextureCachePipeline, SkipsStagesAfterFailure)
+{
+  CTextureCachePipeline pipeline(this, 1, 1);
+  pipeline.AddJob(new CFakeCacheJob("missing.jpg", "fetch"));
+  pipeline.AddJob(new CFakeCacheJob("corrupt.jpg", "decode"));
+  ASSERT_TRUE(WaitForJobs(pipeline, 2));
+  pipeline.Stop();
+
+  EXPECT_FALSE(m_results["missing.jpg"].first);
+  EXPECT_EQ("prepare fetch ", m_results["missing.jpg"].second);
+  EXPECT_FALSE(m_results["corrupt.jpg"].first);
+  EXPECT_EQ("prepare fetch decode ", m_results["corrupt.jpg"].second);
+
+  CTextureCachePipeline::Stats stats = pipeline.GetStats();
+  EXPECT_EQ(1U, stats.stages[CTextureCachePipeline::STAGE_FETCH].images);
+  EXPECT_EQ(1U, stats.stages[CTextureCachePipeline::STAGE_FETCH].failed);
+  EXPECT_EQ(1U, stats.stages[CTextureCachePipeline::STAGE_DECODE].failed);
+  EXPECT_EQ(0U, stats.stages[CTextureCachePipeline::STAGE_RESIZE].images + stats.stages[CTextureCachePipeline::STAGE_RESIZE].failed);
+}
+
+TEST_F(TestTextureCachePipeline, DropsDuplicates)
+{
+  CTextureCachePipeline pipeline(this, 1, 1);
+  EXPECT_TRUE(pipeline.AddJob(new CFakeCacheJob("image.jpg")));
+  EXPECT_FALSE(pipeline.AddJob(new CFakeCacheJob("image.jpg")));
+  ASSERT_TRUE(WaitForJobs(pipeline, 1));
+  pipeline.Stop();
+  EXPECT_EQ(1U, pipeline.GetStats().stages[CTextureCachePipeline::STAGE_ENCODE].images);
+}
+
+TEST_F(TestTextureCachePipeline, DropsJobsStartedElsewhere)
+{
+  m_dropped = true;
+  CTextureCachePipeline pipeline(this, 1, 1);
+  pipeline.AddJob(new CFakeCacheJob("image.jpg"));
+  while (pipeline.IsProcessing())
+    XbmcThreads::ThreadSleep(1);
+  pipeline.Stop();
+
+  EXPECT_TRUE(m_results.empty());
+  EXPECT_EQ(0U, pipeline.GetStats().stages[CTextureCachePipeline::STAGE_FETCH].images);
+}
@@ -33,14 +33,6 @@ void Message::Release()
   if (skip)
     return;
 
-  // free data buffer
-  if (data != buffer)
-    delete [] data;
-
-  // delete event in case of sync message
-  if (event)
-    delete event;
-
   origin->ReturnMessage(this);
 }
 
@@ -63,13 +55,7 @@ bool Message::Reply(int sig, void *data /* = NULL*/, int size /* = 0 */)
     msg->isOut = !isOut;
     replyMessage = msg;
     if (data)
-    {
-      if (size > MSG_INTERNAL_BUFFER_SIZE)
-        msg->data = new uint8_t[size];
-      else
-        msg->data = msg->buffer;
-      memcpy(msg->data, data, size);
-    }
+      memcpy(msg->AllocatePayload(size), data, size);
   }
 
   origin->Unlock();
@@ -80,31 +66,212 @@ bool Message::Reply(int sig, void *data /* = NULL*/, int size /* = 0 */)
   return true;
 }
 
-Protocol::~Protocol()
+uint8_t *Message::AllocatePayload(int size)
 {
-  Message *msg;
-  Purge();
-  while (!freeMessageQueue.empty())
+  if (size > MSG_INTERNAL_BUFFER_SIZE)
   {
-    msg = freeMessageQueue.front();
-    freeMessageQueue.pop();
-    delete msg;
+    if (size > heapSize)
+    {
+      delete [] heapBuffer;
+      heapBuffer = new uint8_t[size];
+      heapSize = size;
+    }
+    data = heapBuffer;
   }
+  else
+    data = buffer;
+  payloadSize = size;
+  return data;
 }
 
-Message *Protocol::GetMessage()
+MessageQueue::MessageQueue()
+  : m_head(&m_stub)
+  , m_tail(&m_stub)
+  , m_frontPos(0)
+{
+}
+
+void MessageQueue::Push(Message *msg)
+{
+  PushNode(msg);
+}
+
+void MessageQueue::PushNode(MessageNode *node)
+{
+  node->next.store(NULL, std::memory_order_relaxed);
+  MessageNode *prev = m_head.exchange(node, std::memory_order_acq_rel);
+  prev->next.store(node, std::memory_order_release);
+}
+
+Message *MessageQueue::Pop()
 {
+  if (m_frontPos < m_front.size())
+  {
+    Message *msg = m_front[m_frontPos++];
+    if (m_frontPos == m_front.size())
+    {
+      m_front.clear();
+      m_frontPos = 0;
+    }
+    return msg;
+  }
+  return PopNode();
+}
+
+Message *MessageQueue::PopNode()
+{
+  MessageNode *tail = m_tail;
+  MessageNode *next = tail->next.load(std::memory_order_acquire);
+  if (tail == &m_stub)
+  {
+    if (!next)
+      return NULL;
+    m_tail = next;
+    tail = next;
+    next = next->next.load(std::memory_order_acquire);
+  }
+  if (next)
+  {
+    m_tail = next;
+    return static_cast<Message*>(tail);
+  }
+
+  // tail is the last node, unless a sender is half way through pushing
+  if (tail != m_head.load(std::memory_order_acquire))
+    return NULL;
+
+  // put the stub back behind it so that tail can be unlinked
+  PushNode(&m_stub);
+  next = tail->next.load(std::memory_order_acquire);
+  if (next)
+  {
+    m_tail = next;
+    return static_cast<Message*>(tail);
+  }
+  return NULL;
+}
+
+void MessageQueue::Remove(int signal, std::vector<Message*> &removed)
+{
+  std::vector<Message*> keep;
   Message *msg;
+  while ((msg = Pop()))
+  {
+    if (msg->signal == signal)
+      removed.push_back(msg);
+    else
+      keep.push_back(msg);
+  }
+  m_front.swap(keep);
+  m_frontPos = 0;
+}
+
+MessagePool::MessagePool()
+  : m_pushPos(0)
+  , m_popPos(0)
+{
+  for (size_t i = 0; i < Capacity; i++)
+    m_cells[i].sequence.store(i, std::memory_order_relaxed);
+}
 
-  CSingleLock lock(criticalSection);
+MessagePool::~MessagePool()
+{
+  for (std::vector<Message*>::iterator it = m_slabs.begin(); it != m_slabs.end(); ++it)
+    delete [] *it;
+}
+
+Message *MessagePool::Get()
+{
+  Message *msg = TryPop();
+  if (msg)
+    return msg;
 
-  if (!freeMessageQueue.empty())
+  CSingleLock lock(m_slabSection);
+
+  // messages may have come back while we waited for the lock
+  msg = TryPop();
+  if (msg)
+    return msg;
+
+  // the pool can only hold Capacity messages, anything beyond that is allocated on its own
+  if ((m_slabs.size() + 1) * SlabSize > Capacity)
+    return new Message();
+
+  Message *slab = new Message[SlabSize];
+  m_slabs.push_back(slab);
+  for (size_t i = 0; i < SlabSize; i++)
   {
-    msg = freeMessageQueue.front();
-    freeMessageQueue.pop();
+    slab[i].pooled = true;
+    if (i > 0)
+      TryPush(&slab[i]);
   }
+  return &slab[0];
+}
+
+void MessagePool::Return(Message *msg)
+{
+  if (!msg->pooled)
+    delete msg;
   else
-    msg = new Message();
+    TryPush(msg);
+}
+
+bool MessagePool::TryPush(Message *msg)
+{
+  size_t pos = m_pushPos.load(std::memory_order_relaxed);
+  for (;;)
+  {
+    Cell &cell = m_cells[pos & (Capacity - 1)];
+    size_t sequence = cell.sequence.load(std::memory_order_acquire);
+    intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+    if (diff == 0)
+    {
+      if (m_pushPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+      {
+        cell.msg = msg;
+        cell.sequence.store(pos + 1, std::memory_order_release);
+        return true;
+      }
+    }
+    else if (diff < 0)
+      return false;
+    else
+      pos = m_pushPos.load(std::memory_order_relaxed);
+  }
+}
+
+Message *MessagePool::TryPop()
+{
+  size_t pos = m_popPos.load(std::memory_order_relaxed);
+  for (;;)
+  {
+    Cell &cell = m_cells[pos & (Capacity - 1)];
+    size_t sequence = cell.sequence.load(std::memory_order_acquire);
+    intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+    if (diff == 0)
+    {
+      if (m_popPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+      {
+        Message *msg = cell.msg;
+        cell.sequence.store(pos + Capacity, std::memory_order_release);
+        return msg;
+      }
+    }
+    else if (diff < 0)
+      return NULL;
+    else
+      pos = m_popPos.load(std::memory_order_relaxed);
+  }
+}
+
+Protocol::~Protocol()
+{
+  Purge();
+}
+
+Message *Protocol::GetMessage()
+{
+  Message *msg = freeMessages.Get();
 
   msg->isSync = false;
   msg->isSyncFini = false;
@@ -120,9 +287,7 @@ Message *Protocol::GetMessage()
 
 void Protocol::ReturnMessage(Message *msg)
 {
-  CSingleLock lock(criticalSection);
-
-  freeMessageQueue.push(msg);
+  freeMessages.Return(msg);
 }
 
 bool Protocol::SendOutMessage(int signal, void *data /* = NULL */, int size /* = 0 */, Message *outMsg /* = NULL */)
@@ -133,24 +298,10 @@ bool Protocol::SendOutMessage(int signal, void *data /* = NULL */, int size /* =
   else
     msg = GetMessage();
 
-  msg->signal = signal;
-  msg->isOut = true;
-
   if (data)
-  {
-    if (size > MSG_INTERNAL_BUFFER_SIZE)
-      msg->data = new uint8_t[size];
-    else
-      msg->data = msg->buffer;
-    memcpy(msg->data, data, size);
-  }
-
-  { CSingleLock lock(criticalSection);
-    outMessages.push(msg);
-  }
-  containerOutEvent->Set();
+    memcpy(msg->AllocatePayload(size), data, size);
 
-  return true;
+  return SendOutMessage(signal, msg);
 }
 
 bool Protocol::SendInMessage(int signal, void *data /* = NULL */, int size /* = 0 */, Message *outMsg /* = NULL */)
@@ -161,33 +312,40 @@ bool Protocol::SendInMessage(int signal, void *data /* = NULL */, int size /* =
   else
     msg = GetMessage();
 
+  if (data)
+    memcpy(msg->AllocatePayload(size), data, size);
+
+  return SendInMessage(signal, msg);
+}
+
+bool Protocol::SendOutMessage(int signal, Message *msg)
+{
   msg->signal = signal;
-  msg->isOut = false;
+  msg->isOut = true;
 
-  if (data)
-  {
-    if (size > MSG_INTERNAL_BUFFER_SIZE)
-      msg->data = new uint8_t[size];
-    else
-      msg->data = msg->buffer;
-    memcpy(msg->data, data, size);
-  }
+  outMessages.Push(msg);
+  containerOutEvent->Set();
 
-  { CSingleLock lock(criticalSection);
-    inMessages.push(msg);
-  }
+  return true;
+}
+
+bool Protocol::SendInMessage(int signal, Message *msg)
+{
+  msg->signal = signal;
+  msg->isOut = false;
+
+  inMessages.Push(msg);
   containerInEvent->Set();
 
   return true;
 }
 
-
 bool Protocol::SendOutMessageSync(int signal, Message **retMsg, int timeout, void *data /* = NULL */, int size /* = 0 */)
 {
   Message *msg = GetMessage();
   msg->isOut = true;
   msg->isSync = true;
-  msg->event = new CEvent;
+  msg->event = &msg->syncEvent;
   msg->event->Reset();
   SendOutMessage(signal, data, size, msg);
 
@@ -216,27 +374,31 @@ bool Protocol::SendOutMessageSync(int signal, Message **retMsg, int timeout, voi
 
 bool Protocol::ReceiveOutMessage(Message **msg)
 {
-  CSingleLock lock(criticalSection);
-
-  if (outMessages.empty() || outDefered)
+  if (outDefered)
     return false;
 
-  *msg = outMessages.front();
-  outMessages.pop();
+  CSingleLock lock(outSection);
 
+  Message *next = outMessages.Pop();
+  if (!next)
+    return false;
+
+  *msg = next;
   return true;
 }
 
 bool Protocol::ReceiveInMessage(Message **msg)
 {
-  CSingleLock lock(criticalSection);
-
-  if (inMessages.empty() || inDefered)
+  if (inDefered)
     return false;
 
-  *msg = inMessages.front();
-  inMessages.pop();
+  CSingleLock lock(inSection);
+
+  Message *next = inMessages.Pop();
+  if (!next)
+    return false;
 
+  *msg = next;
   return true;
 }
 
@@ -254,44 +416,24 @@ void Protocol::Purge()
 
 void Protocol::PurgeIn(int signal)
 {
-  Message *msg;
-  std::queue<Message*> msgs;
-
-  CSingleLock lock(criticalSection);
+  std::vector<Message*> msgs;
 
-  while (!inMessages.empty())
-  {
-    msg = inMessages.front();
-    inMessages.pop();
-    if (msg->signal != signal)
-      msgs.push(msg);
-  }
-  while (!msgs.empty())
-  {
-    msg = msgs.front();
-    msgs.pop();
-    inMessages.push(msg);
+  { CSingleLock lock(inSection);
+    inMessages.Remove(signal, msgs);
   }
+
+  for (std::vector<Message*>::iterator it = msgs.begin(); it != msgs.end(); ++it)
+    (*it)->Release();
 }
 
 void Protocol::PurgeOut(int signal)
 {
-  Message *msg;
-  std::queue<Message*> msgs;
-
-  CSingleLock lock(criticalSection);
+  std::vector<Message*> msgs;
 
-  while (!outMessages.empty())
-  {
-    msg = outMessages.front();
-    outMessages.pop();
-    if (msg->signal != signal)
-      msgs.push(msg);
-  }
-  while (!msgs.empty())
-  {
-    msg = msgs.front();
-    msgs.pop();
-    outMessages.push(msg);
+  { CSingleLock lock(outSection);
+    outMessages.Remove(signal, msgs);
   }
+
+  for (std::vector<Message*>::iterator it = msgs.begin(); it != msgs.end(); ++it)
+    (*it)->Release();
 }
@@ -21,7 +21,9 @@
 #pragma once
 
 #include "threads/Thread.h"
+#include <atomic>
 #include <queue>
+#include <vector>
 #include "memory.h"
 
 #define MSG_INTERNAL_BUFFER_SIZE 32
@@ -31,9 +33,20 @@ namespace Actor
 
 class Protocol;
 
-class Message
+/*!
+ \brief Link in a MessageQueue.
+ */
+class MessageNode
+{
+public:
+  MessageNode() : next(NULL) {}
+  std::atomic<MessageNode*> next;
+};
+
+class Message : public MessageNode
 {
   friend class Protocol;
+  friend class MessagePool;
 public:
   int signal;
   bool isSync;
@@ -50,10 +63,102 @@ public:
   void Release();
   bool Reply(int sig, void *data = NULL, int size = 0);
 
+  /*! \brief Reserve room for a payload in the message, to be filled in before it is sent.
+   Payloads up to MSG_INTERNAL_BUFFER_SIZE are kept in the message, larger ones in a buffer that
+   the message keeps for reuse.
+   \param size size of the payload
+   \return pointer to the payload, also set as data
+   */
+  uint8_t *AllocatePayload(int size);
+
+private:
+  Message() : isSync(false), data(NULL), replyMessage(NULL), event(NULL),
+              pooled(false), heapBuffer(NULL), heapSize(0) {};
+  ~Message() { delete [] heapBuffer; };
+
+  bool pooled;          ///< message belongs to a slab of its MessagePool
+  uint8_t *heapBuffer;  ///< buffer for large payloads, kept while the message is recycled
+  int heapSize;
+  CEvent syncEvent;
+};
+
+/*!
+ \brief Unbounded lock-free queue of messages, for any number of senders and one receiver.
+
+ Pushing never blocks or allocates. Popping must be serialized by the caller. A message that is
+ being pushed may not be visible to Pop() until the push completes; the sender signals the receiver
+ after that so nothing is missed.
+ */
+class MessageQueue
+{
+public:
+  MessageQueue();
+  void Push(Message *msg);
+  Message *Pop();
+  /*! \brief Remove all queued messages with the given signal.
+   \param signal signal of the messages to remove
+   \param removed list the removed messages are appended to
+   */
+  void Remove(int signal, std::vector<Message*> &removed);
+
 private:
-  Message() {isSync = false; data = NULL; event = NULL; replyMessage = NULL;};
+  MessageQueue(const MessageQueue&) = delete;
+  MessageQueue& operator=(const MessageQueue&) = delete;
+
+  void PushNode(MessageNode *node);
+  Message *PopNode();
+
+  std::atomic<MessageNode*> m_head;  ///< last pushed node, shared by the senders
+  char m_pad[64];
+  MessageNode *m_tail;               ///< next node to pop, owned by the receiver
+  MessageNode m_stub;
+  std::vector<Message*> m_front;     ///< messages popped by Remove() that go before the queue
+  size_t m_frontPos;
 };
 
+/*!
+ \brief Lock-free pool of messages, allocated in slabs.
+ */
+class MessagePool
+{
+public:
+  MessagePool();
+  ~MessagePool();
+  Message *Get();
+  void Return(Message *msg);
+
+  static const size_t SlabSize = 32;
+  static const size_t Capacity = 1024;
+
+private:
+  MessagePool(const MessagePool&) = delete;
+  MessagePool& operator=(const MessagePool&) = delete;
+
+  struct Cell
+  {
+    std::atomic<size_t> sequence;
+    Message *msg;
+  };
+
+  bool TryPush(Message *msg);
+  Message *TryPop();
+
+  Cell m_cells[Capacity];
+  std::atomic<size_t> m_pushPos;
+  char m_pad[64];
+  std::atomic<size_t> m_popPos;
+  CCriticalSection m_slabSection;
+  std::vector<Message*> m_slabs;
+};
+
+/*!
+ \brief Two way message port between actors.
+
+ Messages come from a per-protocol pool and go through one lock-free queue per direction, so
+ sending takes no locks and, once the pool is warmed up, allocates no memory. To avoid copying a
+ payload, reserve it with GetMessage() and Message::AllocatePayload(), fill it in place and hand the
+ message to SendOutMessage() or SendInMessage().
+ */
 class Protocol
 {
 public:
@@ -64,6 +169,8 @@ public:
   void ReturnMessage(Message *msg);
   bool SendOutMessage(int signal, void *data = NULL, int size = 0, Message *outMsg = NULL);
   bool SendInMessage(int signal, void *data = NULL, int size = 0, Message *outMsg = NULL);
+  bool SendOutMessage(int signal, Message *msg);
+  bool SendInMessage(int signal, Message *msg);
   bool SendOutMessageSync(int signal, Message **retMsg, int timeout, void *data = NULL, int size = 0);
   bool ReceiveOutMessage(Message **msg);
   bool ReceiveInMessage(Message **msg);
@@ -79,10 +186,11 @@ public:
 protected:
   CEvent *containerInEvent, *containerOutEvent;
   CCriticalSection criticalSection;
-  std::queue<Message*> outMessages;
-  std::queue<Message*> inMessages;
-  std::queue<Message*> freeMessageQueue;
-  bool inDefered, outDefered;
+  CCriticalSection inSection, outSection;  ///< serialize the receivers of each direction
+  MessageQueue outMessages;
+  MessageQueue inMessages;
+  MessagePool freeMessages;
+  std::atomic<bool> inDefered, outDefered;
 };
 
 }
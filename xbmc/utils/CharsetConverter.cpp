@@ -22,6 +22,7 @@
 
 #include <cerrno>
 #include <algorithm>
+#include <vector>
 
 #include <iconv.h>
 #include <fribidi/fribidi.h>
@@ -93,6 +94,9 @@ enum SpecialCharset
   SubtitleCharset /* subtitles.charset */,
 };
 
+/* Keeps the iconv converters for one type of conversion. A converter is only ever used by one
+   thread at a time, so each thread converting at the same time gets its own. They are opened on
+   demand and kept for reuse, which leaves the lock to guard nothing but the list of idle ones. */
 class CConverterType : public CCriticalSection
 {
 public:
@@ -103,7 +107,9 @@ public:
   CConverterType(const CConverterType& other);
   ~CConverterType();
 
-  iconv_t GetConverter(CSingleLock& converterLock);
+  /* Take a converter for the sole use of the calling thread, give it back with ReleaseConverter() */
+  iconv_t AcquireConverter(unsigned int& generation, unsigned int& targetSingleCharMaxLen);
+  void ReleaseConverter(iconv_t converter, unsigned int generation);
 
   void Reset(void);
   void ReinitTo(const std::string& sourceCharset, const std::string& targetCharset, unsigned int targetSingleCharMaxLen = 1);
@@ -113,12 +119,14 @@ public:
 
 private:
   static std::string ResolveSpecialCharset(enum SpecialCharset charset);
+  void CloseIdleConverters(void);
 
   enum SpecialCharset m_sourceSpecialCharset;
   std::string         m_sourceCharset;
   enum SpecialCharset m_targetSpecialCharset;
   std::string         m_targetCharset;
-  iconv_t             m_iconv;
+  std::vector<iconv_t> m_idle;
+  unsigned int        m_generation; /* changes with the charsets, older converters are closed when they come back */
   unsigned int        m_targetSingleCharMaxLen;
 };
 
@@ -127,7 +135,7 @@ CConverterType::CConverterType(const std::string& sourceCharset, const std::stri
   m_sourceCharset(sourceCharset),
   m_targetSpecialCharset(NotSpecialCharset),
   m_targetCharset(targetCharset),
-  m_iconv(NO_ICONV),
+  m_generation(0),
   m_targetSingleCharMaxLen(targetSingleCharMaxLen)
 {
 }
@@ -137,7 +145,7 @@ CConverterType::CConverterType(enum SpecialCharset sourceSpecialCharset, const s
   m_sourceCharset(),
   m_targetSpecialCharset(NotSpecialCharset),
   m_targetCharset(targetCharset),
-  m_iconv(NO_ICONV),
+  m_generation(0),
   m_targetSingleCharMaxLen(targetSingleCharMaxLen)
 {
 }
@@ -147,7 +155,7 @@ CConverterType::CConverterType(const std::string& sourceCharset, enum SpecialCha
   m_sourceCharset(sourceCharset),
   m_targetSpecialCharset(targetSpecialCharset),
   m_targetCharset(),
-  m_iconv(NO_ICONV),
+  m_generation(0),
   m_targetSingleCharMaxLen(targetSingleCharMaxLen)
 {
 }
@@ -157,7 +165,7 @@ CConverterType::CConverterType(enum SpecialCharset sourceSpecialCharset, enum Sp
   m_sourceCharset(),
   m_targetSpecialCharset(targetSpecialCharset),
   m_targetCharset(),
-  m_iconv(NO_ICONV),
+  m_generation(0),
   m_targetSingleCharMaxLen(targetSingleCharMaxLen)
 {
 }
@@ -167,7 +175,7 @@ CConverterType::CConverterType(const CConverterType& other) : CCriticalSection()
   m_sourceCharset(other.m_sourceCharset),
   m_targetSpecialCharset(other.m_targetSpecialCharset),
   m_targetCharset(other.m_targetCharset),
-  m_iconv(NO_ICONV),
+  m_generation(0),
   m_targetSingleCharMaxLen(other.m_targetSingleCharMaxLen)
 {
 }
@@ -175,42 +183,62 @@ CConverterType::CConverterType(const CConverterType& other) : CCriticalSection()
 CConverterType::~CConverterType()
 {
   CSingleLock lock(*this);
-  if (m_iconv != NO_ICONV)
-    iconv_close(m_iconv);
+  CloseIdleConverters();
   lock.Leave(); // ensure unlocking before final destruction
 }
 
-iconv_t CConverterType::GetConverter(CSingleLock& converterLock)
+iconv_t CConverterType::AcquireConverter(unsigned int& generation, unsigned int& targetSingleCharMaxLen)
 {
-  // ensure that this unique instance is locked externally
-  if (&converterLock.get_underlying() != this)
-    return NO_ICONV;
+  CSingleLock lock(*this);
 
-  if (m_iconv == NO_ICONV)
-  {
-    if (m_sourceSpecialCharset)
-      m_sourceCharset = ResolveSpecialCharset(m_sourceSpecialCharset);
-    if (m_targetSpecialCharset)
-      m_targetCharset = ResolveSpecialCharset(m_targetSpecialCharset);
+  generation = m_generation;
+  targetSingleCharMaxLen = m_targetSingleCharMaxLen;
 
-    m_iconv = iconv_open(m_targetCharset.c_str(), m_sourceCharset.c_str());
-    
-    if (m_iconv == NO_ICONV)
-      CLog::Log(LOGERROR, "%s: iconv_open() for \"%s\" -> \"%s\" failed, errno = %d (%s)",
-                __FUNCTION__, m_sourceCharset.c_str(), m_targetCharset.c_str(), errno, strerror(errno));
+  if (!m_idle.empty())
+  {
+    iconv_t converter = m_idle.back();
+    m_idle.pop_back();
+    return converter;
   }
 
-  return m_iconv;
+  if (m_sourceSpecialCharset)
+    m_sourceCharset = ResolveSpecialCharset(m_sourceSpecialCharset);
+  if (m_targetSpecialCharset)
+    m_targetCharset = ResolveSpecialCharset(m_targetSpecialCharset);
+
+  iconv_t converter = iconv_open(m_targetCharset.c_str(), m_sourceCharset.c_str());
+
+  if (converter == NO_ICONV)
+    CLog::Log(LOGERROR, "%s: iconv_open() for \"%s\" -> \"%s\" failed, errno = %d (%s)",
+              __FUNCTION__, m_sourceCharset.c_str(), m_targetCharset.c_str(), errno, strerror(errno));
+
+  return converter;
+}
+
+void CConverterType::ReleaseConverter(iconv_t converter, unsigned int generation)
+{
+  if (converter == NO_ICONV)
+    return;
+
+  CSingleLock lock(*this);
+  if (generation == m_generation)
+    m_idle.push_back(converter);
+  else
+    iconv_close(converter);
+}
+
+void CConverterType::CloseIdleConverters(void)
+{
+  for (std::vector<iconv_t>::iterator it = m_idle.begin(); it != m_idle.end(); ++it)
+    iconv_close(*it);
+  m_idle.clear();
 }
 
 void CConverterType::Reset(void)
 {
   CSingleLock lock(*this);
-  if (m_iconv != NO_ICONV)
-  {
-    iconv_close(m_iconv);
-    m_iconv = NO_ICONV;
-  }
+  CloseIdleConverters();
+  m_generation++;
 
   if (m_sourceSpecialCharset)
     m_sourceCharset.clear();
@@ -224,11 +252,8 @@ void CConverterType::ReinitTo(const std::string& sourceCharset, const std::strin
   CSingleLock lock(*this);
   if (sourceCharset != m_sourceCharset || targetCharset != m_targetCharset)
   {
-    if (m_iconv != NO_ICONV)
-    {
-      iconv_close(m_iconv);
-      m_iconv = NO_ICONV;
-    }
+    CloseIdleConverters();
+    m_generation++;
 
     m_sourceSpecialCharset = NotSpecialCharset;
     m_sourceCharset = sourceCharset;
@@ -321,6 +346,18 @@ CConverterType CCharsetConverter::CInnerConverter::m_stdConversion[NumberOfStdCo
 
 CCriticalSection CCharsetConverter::CInnerConverter::m_critSectionFriBiDi;
 
+/* Conversions between UTF-8, UTF-16 and UTF-32 are done by CUtf8Utils without iconv. On Darwin
+   UTF8_SOURCE is UTF-8-MAC, which also composes decomposed characters, so there only plain ASCII
+   sources are left to CUtf8Utils. */
+static inline bool isTranscodableUtf8(const std::string& utf8String)
+{
+#if defined(TARGET_DARWIN)
+  return CUtf8Utils::checkStrForUtf8(utf8String) == CUtf8Utils::plainAscii;
+#else
+  return true;
+#endif
+}
+
 template<class INPUT,class OUTPUT>
 bool CCharsetConverter::CInnerConverter::stdConvert(StdConversionType convertType, const INPUT& strSource, OUTPUT& strDest, bool failOnInvalidChar /*= false*/)
 {
@@ -332,9 +369,13 @@ bool CCharsetConverter::CInnerConverter::stdConvert(StdConversionType convertTyp
     return false;
 
   CConverterType& convType = m_stdConversion[convertType];
-  CSingleLock converterLock(convType);
+  unsigned int generation, multiplier;
+  iconv_t converter = convType.AcquireConverter(generation, multiplier);
+
+  const bool result = convert(converter, multiplier, strSource, strDest, failOnInvalidChar);
+  convType.ReleaseConverter(converter, generation);
 
-  return convert(convType.GetConverter(converterLock), convType.GetTargetSingleCharMaxLen(), strSource, strDest, failOnInvalidChar);
+  return result;
 }
 
 template<class INPUT,class OUTPUT>
@@ -648,6 +689,9 @@ void CCharsetConverter::reinitCharsetsFromSettings(void)
 
 bool CCharsetConverter::utf8ToUtf32(const std::string& utf8StringSrc, std::u32string& utf32StringDst, bool failOnBadChar /*= true*/)
 {
+  if (isTranscodableUtf8(utf8StringSrc))
+    return CUtf8Utils::Utf8ToUtf32(utf8StringSrc, utf32StringDst, failOnBadChar);
+
   return CInnerConverter::stdConvert(Utf8ToUtf32, utf8StringSrc, utf32StringDst, failOnBadChar);
 }
 
@@ -663,17 +707,17 @@ bool CCharsetConverter::utf8ToUtf32Visual(const std::string& utf8StringSrc, std:
   if (bVisualBiDiFlip)
   {
     std::u32string converted;
-    if (!CInnerConverter::stdConvert(Utf8ToUtf32, utf8StringSrc, converted, failOnBadChar))
+    if (!utf8ToUtf32(utf8StringSrc, converted, failOnBadChar))
       return false;
 
     return CInnerConverter::logicalToVisualBiDi(converted, utf32StringDst, forceLTRReadingOrder ? FRIBIDI_TYPE_LTR : FRIBIDI_TYPE_PDF, failOnBadChar);
   }
-  return CInnerConverter::stdConvert(Utf8ToUtf32, utf8StringSrc, utf32StringDst, failOnBadChar);
+  return utf8ToUtf32(utf8StringSrc, utf32StringDst, failOnBadChar);
 }
 
 bool CCharsetConverter::utf32ToUtf8(const std::u32string& utf32StringSrc, std::string& utf8StringDst, bool failOnBadChar /*= true*/)
 {
-  return CInnerConverter::stdConvert(Utf32ToUtf8, utf32StringSrc, utf8StringDst, failOnBadChar);
+  return CUtf8Utils::Utf32ToUtf8(utf32StringSrc, utf8StringDst, failOnBadChar);
 }
 
 std::string CCharsetConverter::utf32ToUtf8(const std::u32string& utf32StringSrc, bool failOnBadChar /*= false*/)
@@ -717,15 +761,28 @@ bool CCharsetConverter::utf8ToW(const std::string& utf8StringSrc, std::wstring&
   {
     wStringDst.clear();
     std::u32string utf32str;
-    if (!CInnerConverter::stdConvert(Utf8ToUtf32, utf8StringSrc, utf32str, failOnBadChar))
+    if (!utf8ToUtf32(utf8StringSrc, utf32str, failOnBadChar))
       return false;
 
     std::u32string utf32flipped;
     const bool bidiResult = CInnerConverter::logicalToVisualBiDi(utf32str, utf32flipped, forceLTRReadingOrder ? FRIBIDI_TYPE_LTR : FRIBIDI_TYPE_PDF, failOnBadChar);
 
+    if (sizeof(wchar_t) == sizeof(char32_t))
+    {
+      wStringDst.assign(utf32flipped.begin(), utf32flipped.end());
+      return bidiResult;
+    }
     return CInnerConverter::stdConvert(Utf32ToW, utf32flipped, wStringDst, failOnBadChar) && bidiResult;
   }
-  
+
+  if (isTranscodableUtf8(utf8StringSrc))
+  {
+    if (sizeof(wchar_t) == sizeof(char32_t))
+      return CUtf8Utils::Utf8ToUtf32(utf8StringSrc, wStringDst, failOnBadChar);
+    if (sizeof(wchar_t) == sizeof(char16_t))
+      return CUtf8Utils::Utf8ToUtf16(utf8StringSrc, wStringDst, failOnBadChar);
+  }
+
   return CInnerConverter::stdConvert(Utf8toW, utf8StringSrc, wStringDst, failOnBadChar);
 }
 
@@ -781,6 +838,11 @@ bool CCharsetConverter::utf8To(const std::string& strDestCharset, const std::str
 
 bool CCharsetConverter::utf8To(const std::string& strDestCharset, const std::string& utf8StringSrc, std::u16string& utf16StringDst)
 {
+#ifndef WORDS_BIGENDIAN
+  if (strDestCharset == "UTF-16LE" && isTranscodableUtf8(utf8StringSrc))
+    return CUtf8Utils::Utf8ToUtf16(utf8StringSrc, utf16StringDst, false);
+#endif
+
   return CInnerConverter::customConvert(UTF8_SOURCE, strDestCharset, utf8StringSrc, utf16StringDst);
 }
 
@@ -808,6 +870,11 @@ bool CCharsetConverter::unknownToUTF8(const std::string& stringSrc, std::string&
 
 bool CCharsetConverter::wToUTF8(const std::wstring& wStringSrc, std::string& utf8StringDst, bool failOnBadChar /*= false*/)
 {
+  if (sizeof(wchar_t) == sizeof(char32_t))
+    return CUtf8Utils::Utf32ToUtf8(wStringSrc, utf8StringDst, failOnBadChar);
+  if (sizeof(wchar_t) == sizeof(char16_t))
+    return CUtf8Utils::Utf16ToUtf8(wStringSrc, utf8StringDst, failOnBadChar);
+
   return CInnerConverter::stdConvert(WtoUtf8, wStringSrc, utf8StringDst, failOnBadChar);
 }
 
@@ -819,7 +886,11 @@ bool CCharsetConverter::utf16BEtoUTF8(const std::u16string& utf16StringSrc, std:
 bool CCharsetConverter::utf16LEtoUTF8(const std::u16string& utf16StringSrc,
                                       std::string& utf8StringDst)
 {
+#ifndef WORDS_BIGENDIAN
+  return CUtf8Utils::Utf16ToUtf8(utf16StringSrc, utf8StringDst, false);
+#else
   return CInnerConverter::stdConvert(Utf16LEtoUtf8, utf16StringSrc, utf8StringDst);
+#endif
 }
 
 bool CCharsetConverter::ucs2ToUTF8(const std::u16string& ucs2StringSrc, std::string& utf8StringDst)
@@ -855,7 +926,7 @@ bool CCharsetConverter::utf8logicalToVisualBiDi(const std::string& utf8StringSrc
   if (!utf8ToUtf32Visual(utf8StringSrc, utf32flipped, true, true, failOnBadString))
     return false;
 
-  return CInnerConverter::stdConvert(Utf32ToUtf8, utf32flipped, utf8StringDst, failOnBadString);
+  return utf32ToUtf8(utf32flipped, utf8StringDst, failOnBadString);
 }
 
 void CCharsetConverter::SettingOptionsCharsetsFiller(const CSetting* setting, std::vector< std::pair<std::string, std::string> >& list, std::string& current, void *data)
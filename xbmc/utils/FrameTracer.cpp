@@ -0,0 +1,273 @@
+/*
+ *      Copyright (C) 2017 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kodi; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "FrameTracer.h"
+#include "filesystem/File.h"
+#include "threads/SingleLock.h"
+#include "threads/Thread.h"
+#include "threads/ThreadLocal.h"
+#include "utils/JSONVariantWriter.h"
+#include "utils/log.h"
+#include "utils/StringUtils.h"
+#include "utils/TimeUtils.h"
+#include "utils/Variant.h"
+
+#include <algorithm>
+#include <inttypes.h>
+
+class CFrameTracer::CBuffer
+{
+public:
+  CBuffer() :
+    m_id(0),
+    m_zones(BUFFER_SIZE),
+    m_written(0),
+    m_generation(0),
+    m_owner(ThreadIdentifier()),
+    m_writers(0)
+  {
+  }
+
+  /*! \brief start writing a zone, if the calling thread owns the buffer in the given capture */
+  bool BeginWrite(unsigned int generation)
+  {
+    // announce the write before checking the claim, a claim announces itself before
+    // checking for writers, so one of the two sees the other
+    m_writers++;
+    if (m_generation == generation && m_owner == CThread::GetCurrentThreadId())
+      return true;
+    m_writers--;
+    return false;
+  }
+
+  void EndWrite()
+  {
+    m_writers--;
+  }
+
+  struct Zone
+  {
+    const char *name;
+    int64_t start;
+    int64_t end;
+  };
+
+  unsigned int m_id;                      ///< trace thread id of the owner
+  std::string m_name;
+  std::vector<Zone> m_zones;
+  std::atomic<uint64_t> m_written;        ///< only ever advanced by the owner, reset on claims
+  std::atomic<unsigned int> m_generation; ///< capture the buffer is owned in, 0 while being claimed
+  std::atomic<ThreadIdentifier> m_owner;
+  std::atomic<unsigned int> m_writers;    ///< threads in BeginWrite or writing a zone
+};
+
+std::atomic<bool> CFrameTracer::m_capturing(false);
+XbmcThreads::ThreadLocal<CFrameTracer::CBuffer> CFrameTracer::m_threadBuffer;
+const unsigned int CFrameTracer::BUFFER_SIZE;
+const unsigned int CFrameTracer::MAX_THREADS;
+
+int64_t CTraceZone::Now()
+{
+  return CurrentHostCounter();
+}
+
+CFrameTracer::CFrameTracer() :
+  m_generation(1),
+  m_nextId(1),
+  m_captureStart(0)
+{
+}
+
+CFrameTracer::~CFrameTracer()
+{
+}
+
+CFrameTracer& CFrameTracer::GetInstance()
+{
+  static CFrameTracer sTracer;
+  return sTracer;
+}
+
+void CFrameTracer::Start()
+{
+  m_capturing = false;
+
+  CSingleLock lock(m_critSection);
+  // threads claim their buffers again on their first zone of the new capture, so that
+  // only a buffer's owner writes it
+  m_generation++;
+  m_captureStart = CurrentHostCounter();
+
+  m_capturing = true;
+  CLog::Log(LOGNOTICE, "CFrameTracer: capture started");
+}
+
+void CFrameTracer::Stop()
+{
+  if (m_capturing.exchange(false))
+    CLog::Log(LOGNOTICE, "CFrameTracer: capture stopped, %" PRIu64" zones recorded", GetRecorded());
+}
+
+CFrameTracer::CBuffer* CFrameTracer::ClaimBuffer()
+{
+  CSingleLock lock(m_critSection);
+  unsigned int generation = m_generation;
+
+  auto claim = [generation](CBuffer *buffer)
+  {
+    unsigned int owned = buffer->m_generation;
+    if (owned == generation)
+      return false;
+    // its former owner may still be writing a zone of an earlier capture
+    buffer->m_generation = 0;
+    if (buffer->m_writers == 0)
+      return true;
+    buffer->m_generation = owned;
+    return false;
+  };
+
+  // prefer the buffer the thread had in the previous capture
+  CBuffer *claimed = m_threadBuffer.get();
+  if (claimed && !claim(claimed))
+    claimed = nullptr;
+  for (auto it = m_buffers.begin(); it != m_buffers.end() && !claimed; ++it)
+  {
+    if (claim(it->get()))
+      claimed = it->get();
+  }
+  if (!claimed && m_buffers.size() < MAX_THREADS)
+  {
+    m_buffers.push_back(std::unique_ptr<CBuffer>(new CBuffer));
+    claimed = m_buffers.back().get();
+  }
+  if (!claimed)
+    return nullptr;
+
+  claimed->m_id = m_nextId++;
+  CThread *thread = CThread::GetCurrentThread();
+  if (thread)
+    claimed->m_name = StringUtils::Format("%s (%u)", thread->GetName().c_str(), claimed->m_id);
+  else
+    claimed->m_name = StringUtils::Format("Thread %u", claimed->m_id);
+  claimed->m_written = 0;
+  claimed->m_owner = CThread::GetCurrentThreadId();
+  claimed->m_generation = generation;
+  m_threadBuffer.set(claimed);
+  return claimed;
+}
+
+void CFrameTracer::Record(const char *name, int64_t start, int64_t end)
+{
+  unsigned int generation = m_generation;
+  CBuffer *buffer = m_threadBuffer.get();
+  if (!buffer || !buffer->BeginWrite(generation))
+  {
+    buffer = ClaimBuffer();
+    // drop the zone if a new capture started meanwhile
+    if (!buffer || !buffer->BeginWrite(generation))
+      return;
+  }
+
+  uint64_t written = buffer->m_written.load(std::memory_order_relaxed);
+  CBuffer::Zone &zone = buffer->m_zones[written % BUFFER_SIZE];
+  zone.name = name;
+  zone.start = start;
+  zone.end = end;
+  buffer->m_written.store(written + 1, std::memory_order_release);
+  buffer->EndWrite();
+}
+
+uint64_t CFrameTracer::GetRecorded() const
+{
+  CSingleLock lock(m_critSection);
+  uint64_t recorded = 0;
+  for (const auto& buffer : m_buffers)
+  {
+    if (buffer->m_generation == m_generation)
+      recorded += buffer->m_written;
+  }
+  return recorded;
+}
+
+void CFrameTracer::Export(CVariant &trace) const
+{
+  CSingleLock lock(m_critSection);
+  double usPerTick = 1000000.0 / CurrentHostFrequency();
+  trace["traceEvents"] = CVariant(CVariant::VariantTypeArray);
+  trace["displayTimeUnit"] = "ms";
+  trace["capturing"] = IsCapturing();
+
+  for (const auto& buffer : m_buffers)
+  {
+    if (buffer->m_generation != m_generation)
+      continue;
+
+    CVariant metadata(CVariant::VariantTypeObject);
+    metadata["name"] = "thread_name";
+    metadata["ph"] = "M";
+    metadata["pid"] = 1;
+    metadata["tid"] = buffer->m_id;
+    metadata["args"]["name"] = buffer->m_name;
+    trace["traceEvents"].push_back(metadata);
+
+    // copy the zones out, then drop those the owner may have overwritten meanwhile
+    uint64_t written = buffer->m_written.load(std::memory_order_acquire);
+    uint64_t first = written > BUFFER_SIZE ? written - BUFFER_SIZE : 0;
+    std::vector<CBuffer::Zone> zones;
+    for (uint64_t i = first; i < written; i++)
+      zones.push_back(buffer->m_zones[i % BUFFER_SIZE]);
+    // the owner may also be in the middle of writing the zone after the last one it counted
+    uint64_t rewritten = buffer->m_written.load(std::memory_order_acquire);
+    uint64_t valid = rewritten + 1 > BUFFER_SIZE ? rewritten + 1 - BUFFER_SIZE : 0;
+
+    for (uint64_t i = std::max(first, valid); i < written; i++)
+    {
+      const CBuffer::Zone &zone = zones[i - first];
+      if (zone.start < m_captureStart)
+        continue;
+
+      CVariant event(CVariant::VariantTypeObject);
+      event["name"] = zone.name;
+      event["cat"] = "frame";
+      event["ph"] = "X";
+      event["ts"] = (zone.start - m_captureStart) * usPerTick;
+      event["dur"] = (zone.end - zone.start) * usPerTick;
+      event["pid"] = 1;
+      event["tid"] = buffer->m_id;
+      trace["traceEvents"].push_back(event);
+    }
+  }
+}
+
+bool CFrameTracer::Save(const std::string &path) const
+{
+  CVariant trace;
+  Export(trace);
+  std::string json = CJSONVariantWriter::Write(trace, true);
+
+  XFILE::CFile file;
+  if (!file.OpenForWrite(path, true) || file.Write(json.c_str(), json.size()) != static_cast<ssize_t>(json.size()))
+  {
+    CLog::Log(LOGERROR, "CFrameTracer: unable to write trace to %s", path.c_str());
+    return false;
+  }
+  CLog::Log(LOGNOTICE, "CFrameTracer: trace written to %s", path.c_str());
+  return true;
+}
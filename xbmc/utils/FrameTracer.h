@@ -0,0 +1,142 @@
+/*
+ *      Copyright (C) 2017 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kodi; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include "threads/CriticalSection.h"
+#include "threads/ThreadLocal.h"
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class CVariant;
+
+#define TRACE_CONCAT_INNER(a, b) a ## b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+/*! \brief Trace the enclosing scope as a zone named by the given string literal */
+#define TRACE_ZONE(name) CTraceZone TRACE_CONCAT(traceZone, __LINE__)(name)
+#define TRACE_FUNCTION TRACE_ZONE(__FUNCTION__)
+
+/*!
+ \brief Low overhead tracing of where frame time goes.
+
+ Zones record their start and end into a ring buffer owned by the recording thread, so
+ threads never contend while capturing. A thread claims a buffer on its first zone of a
+ capture, reusing one no other thread claimed in it. When no capture is running a zone
+ costs a single check of a flag. A capture is exported in the Chrome trace event format,
+ which can be loaded into chrome://tracing or similar viewers.
+ */
+class CFrameTracer
+{
+public:
+  static CFrameTracer& GetInstance();
+
+  static inline bool IsCapturing() { return m_capturing.load(std::memory_order_relaxed); }
+
+  /*! \brief Discard any previous capture and start recording zones */
+  void Start();
+
+  /*! \brief Stop recording zones, keeping the capture for export */
+  void Stop();
+
+  /*! \brief Record a finished zone for the calling thread
+   \param name static name of the zone
+   \param start host counter at the start of the zone
+   \param end host counter at the end of the zone
+   */
+  void Record(const char *name, int64_t start, int64_t end);
+
+  /*! \brief Export the current capture in the Chrome trace event format
+   \param trace object to fill with the traceEvents array
+   */
+  void Export(CVariant &trace) const;
+
+  /*! \brief Export the current capture to a JSON file
+   \param path the file to write to
+   \return true if the file was written
+   */
+  bool Save(const std::string &path) const;
+
+  /*! \brief Number of zones recorded since the capture started, including overwritten ones */
+  uint64_t GetRecorded() const;
+
+  static const unsigned int BUFFER_SIZE = 16384; ///< zones kept per thread, one less of them is exported
+  static const unsigned int MAX_THREADS = 64;     ///< threads recorded per capture
+
+private:
+  CFrameTracer();
+  ~CFrameTracer();
+  CFrameTracer(const CFrameTracer&) = delete;
+  CFrameTracer& operator=(const CFrameTracer&) = delete;
+
+  class CBuffer;
+
+  /*! \brief claim a buffer for the calling thread in this capture
+   \return the buffer, nullptr when all are claimed
+   */
+  CBuffer* ClaimBuffer();
+
+  static std::atomic<bool> m_capturing;
+  static XbmcThreads::ThreadLocal<CBuffer> m_threadBuffer; ///< buffer the thread last claimed
+
+  mutable CCriticalSection m_critSection;
+  std::vector<std::unique_ptr<CBuffer>> m_buffers; ///< never freed, threads may still hold them
+  std::atomic<unsigned int> m_generation;
+  unsigned int m_nextId;
+  int64_t m_captureStart;
+};
+
+/*!
+ \brief Records the lifetime of a scope as a zone while a capture is running
+ \sa TRACE_ZONE
+ */
+class CTraceZone
+{
+public:
+  explicit CTraceZone(const char *name) : m_name(nullptr)
+  {
+    // the destructor's check is folded into this one, so a zone that isn't recorded
+    // costs a single branch
+    if (CFrameTracer::IsCapturing())
+    {
+      m_name = name;
+      m_start = Now();
+    }
+  }
+
+  ~CTraceZone()
+  {
+    if (m_name)
+      CFrameTracer::GetInstance().Record(m_name, m_start, Now());
+  }
+
+private:
+  CTraceZone(const CTraceZone&) = delete;
+  CTraceZone& operator=(const CTraceZone&) = delete;
+
+  static int64_t Now();
+
+  const char *m_name;
+  int64_t m_start;
+};
@@ -37,47 +37,75 @@ yajl_callbacks CJSONVariantParser::callbacks = {
 CJSONVariantParser::CJSONVariantParser(IParseCallback *callback)
 {
   m_callback = callback;
+  m_completed = false;
 
   m_handler = yajl_alloc(&callbacks, NULL, this);
 
   yajl_config(m_handler, yajl_allow_comments, 1);
   yajl_config(m_handler, yajl_dont_validate_strings, 0);
-
-  m_status = ParseVariable;
 }
 
 CJSONVariantParser::~CJSONVariantParser()
 {
-  yajl_complete_parse(m_handler);
+  Complete();
   yajl_free(m_handler);
 }
 
-void CJSONVariantParser::push_buffer(const unsigned char *buffer, unsigned int length)
+bool CJSONVariantParser::push_buffer(const unsigned char *buffer, unsigned int length)
+{
+  return yajl_parse(m_handler, buffer, length) == yajl_status_ok;
+}
+
+bool CJSONVariantParser::Complete()
 {
-  yajl_parse(m_handler, buffer, length);
+  if (m_completed)
+    return true;
+
+  m_completed = true;
+  return yajl_complete_parse(m_handler) == yajl_status_ok;
 }
 
 CVariant CJSONVariantParser::Parse(const std::string& json)
 {
-  return Parse(reinterpret_cast<const unsigned char*>(json.c_str()), json.length());
+  CVariant result;
+  Parse(json, result);
+
+  return result;
 }
 
 CVariant CJSONVariantParser::Parse(const unsigned char *json, unsigned int length)
+{
+  CVariant result;
+  Parse(json, length, result);
+
+  return result;
+}
+
+bool CJSONVariantParser::Parse(const std::string& json, CVariant &result)
+{
+  return Parse(reinterpret_cast<const unsigned char*>(json.c_str()), json.length(), result);
+}
+
+bool CJSONVariantParser::Parse(const unsigned char *json, unsigned int length, CVariant &result)
 {
   CSimpleParseCallback callback;
   CJSONVariantParser parser(&callback);
 
-  parser.push_buffer(json, length);
+  if (!parser.push_buffer(json, length) || !parser.Complete())
+  {
+    result = CVariant();
+    return false;
+  }
 
-  return callback.GetOutput();
+  result = std::move(callback.GetOutput());
+  return true;
 }
 
 int CJSONVariantParser::ParseNull(void * ctx)
 {
   CJSONVariantParser *parser = (CJSONVariantParser *)ctx;
 
-  parser->PushObject(CVariant::VariantTypeNull);
-  parser->PopObject();
+  parser->PushValue(CVariant::VariantTypeNull);
 
   return 1;
 }
@@ -86,8 +114,7 @@ int CJSONVariantParser::ParseBoolean(void * ctx, int boolean)
 {
   CJSONVariantParser *parser = (CJSONVariantParser *)ctx;
 
-  parser->PushObject(CVariant(boolean != 0));
-  parser->PopObject();
+  parser->PushValue(CVariant(boolean != 0));
 
   return 1;
 }
@@ -96,8 +123,7 @@ int CJSONVariantParser::ParseInteger(void * ctx, long long integerVal)
 {
   CJSONVariantParser *parser = (CJSONVariantParser *)ctx;
 
-  parser->PushObject(CVariant((int64_t)integerVal));
-  parser->PopObject();
+  parser->PushValue(CVariant((int64_t)integerVal));
 
   return 1;
 }
@@ -106,8 +132,7 @@ int CJSONVariantParser::ParseDouble(void * ctx, double doubleVal)
 {
   CJSONVariantParser *parser = (CJSONVariantParser *)ctx;
 
-  parser->PushObject(CVariant((float)doubleVal));
-  parser->PopObject();
+  parser->PushValue(CVariant((float)doubleVal));
 
   return 1;
 }
@@ -116,8 +141,8 @@ int CJSONVariantParser::ParseString(void * ctx, const unsigned char * stringVal,
 {
   CJSONVariantParser *parser = (CJSONVariantParser *)ctx;
 
-  parser->PushObject(CVariant((const char *)stringVal, stringLen));
-  parser->PopObject();
+  // stringVal points into the parsed text unless the string had to be unescaped
+  parser->PushValue(CVariant((const char *)stringVal, stringLen));
 
   return 1;
 }
@@ -135,7 +160,7 @@ int CJSONVariantParser::ParseMapKey(void * ctx, const unsigned char * stringVal,
 {
   CJSONVariantParser *parser = (CJSONVariantParser *)ctx;
 
-  parser->m_key = std::string((const char *)stringVal, 0, stringLen);
+  parser->m_key.assign((const char *)stringVal, stringLen);
 
   return 1;
 }
@@ -167,53 +192,44 @@ int CJSONVariantParser::ParseArrayEnd(void * ctx)
   return 1;
 }
 
-void CJSONVariantParser::PushObject(CVariant variant)
+CVariant *CJSONVariantParser::InsertObject(CVariant &&variant)
 {
-  if (m_status == ParseObject)
+  if (m_parse.empty())
   {
-    (*m_parse[m_parse.size() - 1])[m_key] = variant;
-    m_parse.push_back(&(*m_parse[m_parse.size() - 1])[m_key]);
+    m_parsedObject = std::move(variant);
+    return &m_parsedObject;
   }
-  else if (m_status == ParseArray)
-  {
-    CVariant *temp = m_parse[m_parse.size() - 1];
-    temp->push_back(variant);
-    m_parse.push_back(&(*temp)[temp->size() - 1]);
-  }
-  else if (m_parse.empty())
+
+  CVariant *parent = m_parse.back();
+  if (parent->isObject())
   {
-    m_parse.push_back(new CVariant(variant));
+    CVariant &member = (*parent)[m_key];
+    member = std::move(variant);
+    return &member;
   }
 
-  if (variant.isObject())
-    m_status = ParseObject;
-  else if (variant.isArray())
-    m_status = ParseArray;
-  else
-    m_status = ParseVariable;
+  parent->push_back(std::move(variant));
+  return &(*parent)[parent->size() - 1];
+}
+
+void CJSONVariantParser::PushValue(CVariant &&variant)
+{
+  m_parse.push_back(InsertObject(std::move(variant)));
+  PopObject();
+}
+
+void CJSONVariantParser::PushObject(CVariant::VariantType type)
+{
+  m_parse.push_back(InsertObject(CVariant(type)));
 }
 
 void CJSONVariantParser::PopObject()
 {
-  CVariant *variant = m_parse[m_parse.size() - 1];
   m_parse.pop_back();
 
-  if (m_parse.size())
-  {
-    variant = m_parse[m_parse.size() - 1];
-    if (variant->isObject())
-      m_status = ParseObject;
-    else if (variant->isArray())
-      m_status = ParseArray;
-    else
-      m_status = ParseVariable;
-  }
-  else if (m_callback)
+  if (m_parse.empty() && m_callback)
   {
-    m_callback->onParsed(variant);
-    delete variant;
-
-    m_parse.clear();
-    m_status = ParseVariable;
+    m_callback->onParsed(&m_parsedObject);
+    m_parsedObject = CVariant();
   }
 }
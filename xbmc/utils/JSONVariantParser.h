@@ -31,31 +31,48 @@ class IParseCallback
 public:
   virtual ~IParseCallback() { }
 
+  /*! \brief Called with each complete top-level value, which the callback may move from */
   virtual void onParsed(CVariant *variant) = 0;
 };
 
 class CSimpleParseCallback : public IParseCallback
 {
 public:
-  virtual void onParsed(CVariant *variant) { m_parsed = *variant; }
+  virtual void onParsed(CVariant *variant) { m_parsed = std::move(*variant); }
   CVariant &GetOutput() { return m_parsed; }
 
 private:
   CVariant m_parsed;
 };
 
+/*!
+ \brief Builds CVariants from JSON text with yajl.
+
+ Values are created in place in the resulting tree, strings and keys without escapes are copied
+ straight out of the buffer yajl was given.
+ */
 class CJSONVariantParser
 {
 public:
   CJSONVariantParser(IParseCallback *callback);
   ~CJSONVariantParser();
 
-  void push_buffer(const unsigned char *buffer, unsigned int length);
+  /*! \brief Parse the next part of the JSON text
+   \return false if the text is not valid JSON
+   */
+  bool push_buffer(const unsigned char *buffer, unsigned int length);
 
   static CVariant Parse(const unsigned char *json, unsigned int length);
 
   static CVariant Parse(const std::string& json);
 
+  /*! \brief Parse a complete JSON document into result
+   \return false if the document is not valid JSON, result is null then
+   */
+  static bool Parse(const unsigned char *json, unsigned int length, CVariant &result);
+
+  static bool Parse(const std::string& json, CVariant &result);
+
 private:
   static int ParseNull(void * ctx);
   static int ParseBoolean(void * ctx, int boolean);
@@ -68,23 +85,19 @@ private:
   static int ParseArrayStart(void * ctx);
   static int ParseArrayEnd(void * ctx);
 
-  void PushObject(CVariant variant);
+  bool Complete();
+  CVariant *InsertObject(CVariant &&variant);
+  void PushValue(CVariant &&variant);
+  void PushObject(CVariant::VariantType type);
   void PopObject();
 
   static yajl_callbacks callbacks;
 
   IParseCallback *m_callback;
   yajl_handle m_handler;
+  bool m_completed;
 
   CVariant m_parsedObject;
   std::vector<CVariant *> m_parse;
   std::string m_key;
-
-  enum PARSE_STATUS
-  {
-    ParseArray = 1,
-    ParseObject = 2,
-    ParseVariable = 0
-  };
-  PARSE_STATUS m_status;
 };
@@ -23,6 +23,9 @@
 #include <functional>
 #include <stdexcept>
 #include "threads/SingleLock.h"
+#include "threads/SystemClock.h"
+#include "threads/ThreadLocal.h"
+#include "utils/CPUInfo.h"
 #include "utils/log.h"
 #ifdef TARGET_POSIX
 #include "linux/XTimeUtils.h"
@@ -30,6 +33,64 @@
 
 #include "system.h"
 
+namespace
+{
+XbmcThreads::ThreadLocal<CJobWorker> currentWorker;
+
+/* Locks a section like CSingleLock, counting the times it's held by another thread */
+class CCountingLock : public CSingleTryLock
+{
+public:
+  CCountingLock(CCriticalSection &section, std::atomic<uint64_t> &contended) : CSingleTryLock(section)
+  {
+    if (!IsOwner())
+    {
+      contended++;
+      Enter();
+    }
+  }
+};
+
+/* Ranges of a CJobManager::ParallelFor(), taken in turn by the threads running them */
+class CParallelRanges
+{
+public:
+  CParallelRanges(size_t count, size_t ranges, const std::function<void(size_t, size_t)> &function)
+    : m_count(count), m_ranges(ranges), m_function(function), m_next(0), m_done(0) { }
+
+  void Run()
+  {
+    size_t range;
+    while ((range = m_next++) < m_ranges)
+    {
+      try
+      {
+        m_function(range * m_count / m_ranges, (range + 1) * m_count / m_ranges);
+      }
+      catch (...)
+      {
+        CSingleLock lock(m_section);
+        if (!m_exception)
+          m_exception = std::current_exception();
+      }
+      if (++m_done == m_ranges)
+        m_finished.Set();
+    }
+  }
+
+  CEvent m_finished;
+  std::exception_ptr m_exception;
+
+private:
+  const size_t m_count;
+  const size_t m_ranges;
+  const std::function<void(size_t, size_t)> &m_function; ///< only used while ranges are left, the caller waits for those
+  std::atomic<size_t> m_next;
+  std::atomic<size_t> m_done;
+  CCriticalSection m_section;
+};
+}
+
 bool CJob::ShouldCancel(unsigned int progress, unsigned int total) const
 {
   if (m_callback)
@@ -37,9 +98,84 @@ bool CJob::ShouldCancel(unsigned int progress, unsigned int total) const
   return false;
 }
 
-CJobWorker::CJobWorker(CJobManager *manager) : CThread("JobWorker")
+bool CJobFutureStateBase::IsReady() const
+{
+  CSingleLock lock(m_section);
+  return m_done;
+}
+
+void CJobFutureStateBase::Wait() const
+{
+  CJobManager::GetInstance().WaitRunningJobs(m_ready, -1);
+}
+
+bool CJobFutureStateBase::Wait(unsigned int milliseconds) const
+{
+  return CJobManager::GetInstance().WaitRunningJobs(m_ready, milliseconds);
+}
+
+void CJobFutureStateBase::OnReady(const std::function<void()> &function)
+{
+  {
+    CSingleLock lock(m_section);
+    if (!m_done)
+    {
+      m_continuations.push_back(function);
+      return;
+    }
+  }
+  function();
+}
+
+void CJobFutureStateBase::SetException(std::exception_ptr exception)
+{
+  {
+    CSingleLock lock(m_section);
+    if (m_done)
+      return;
+    m_exception = exception;
+  }
+  SetReady();
+}
+
+bool CJobFutureStateBase::HasException() const
+{
+  CSingleLock lock(m_section);
+  return m_exception != nullptr;
+}
+
+void CJobFutureStateBase::Abandon()
+{
+  if (!IsReady())
+    SetException(std::make_exception_ptr(std::runtime_error("job was cancelled")));
+}
+
+void CJobFutureStateBase::SetReady()
+{
+  std::vector< std::function<void()> > continuations;
+  {
+    CSingleLock lock(m_section);
+    if (m_done)
+      return;
+    m_done = true;
+    continuations.swap(m_continuations);
+  }
+  m_ready.Set();
+
+  for (std::vector< std::function<void()> >::iterator i = continuations.begin(); i != continuations.end(); ++i)
+    (*i)();
+}
+
+void CJobFutureStateBase::RethrowException() const
+{
+  if (m_exception)
+    std::rethrow_exception(m_exception);
+}
+
+CJobWorker::CJobWorker(CJobManager *manager, bool persistent) : CThread("JobWorker")
 {
   m_jobManager = manager;
+  m_persistent = persistent;
   Create(true); // start work immediately, and kill ourselves when we're done
 }
 
@@ -56,6 +192,7 @@ CJobWorker::~CJobWorker()
 void CJobWorker::Process()
 {
   SetPriority( GetMinPriority() );
+  currentWorker.set(this);
   while (true)
   {
     // request an item from our manager (this call is blocking)
@@ -63,17 +200,23 @@ void CJobWorker::Process()
     if (!job)
       break;
 
-    bool success = false;
-    try
-    {
-      success = job->DoWork();
-    }
-    catch (...)
-    {
-      CLog::Log(LOGERROR, "%s error processing job %s", __FUNCTION__, job->GetType());
-    }
-    m_jobManager->OnJobComplete(success, job);
+    Run(job);
   }
+  currentWorker.set(NULL);
+}
+
+void CJobWorker::Run(CJob *job)
+{
+  bool success = false;
+  try
+  {
+    success = job->DoWork();
+  }
+  catch (...)
+  {
+    CLog::Log(LOGERROR, "%s error processing job %s", __FUNCTION__, job->GetType());
+  }
+  m_jobManager->OnJobComplete(this, success);
 }
 
 void CJobQueue::CJobPointer::CancelJob()
@@ -184,6 +327,17 @@ CJobManager::CJobManager()
   m_jobCounter = 0;
   m_running = true;
   m_pauseJobs = false;
+  for (unsigned int priority = CJob::PRIORITY_LOW_PAUSABLE; priority <= CJob::PRIORITY_DEDICATED; ++priority)
+    m_queued[priority] = 0;
+  m_processing = 0;
+  m_idleWorkers = 0;
+  m_jobsRun = 0;
+  m_localJobs = 0;
+  m_stolenJobs = 0;
+  m_contended = 0;
+  m_contendedLocal = 0;
+  m_waits = 0;
+  m_workersStarted = 0;
 }
 
 void CJobManager::Restart()
@@ -203,12 +357,24 @@ void CJobManager::CancelJobs()
   // clear any pending jobs
   for (unsigned int priority = CJob::PRIORITY_LOW_PAUSABLE; priority <= CJob::PRIORITY_DEDICATED; ++priority)
   {
+    m_queued[priority] -= m_jobQueue[priority].size();
     for_each(m_jobQueue[priority].begin(), m_jobQueue[priority].end(), std::mem_fun_ref(&CWorkItem::FreeJob));
     m_jobQueue[priority].clear();
   }
 
-  // cancel any callbacks on jobs still processing
-  for_each(m_processing.begin(), m_processing.end(), std::mem_fun_ref(&CWorkItem::Cancel));
+  for (Workers::iterator i = m_workers.begin(); i != m_workers.end(); ++i)
+  {
+    CSingleLock workerLock((*i)->m_section);
+    for (unsigned int priority = CJob::PRIORITY_LOW_PAUSABLE; priority < CJob::PRIORITY_DEDICATED; ++priority)
+    {
+      JobQueue &queue = (*i)->m_jobQueue[priority];
+      m_queued[priority] -= queue.size();
+      for_each(queue.begin(), queue.end(), std::mem_fun_ref(&CWorkItem::FreeJob));
+      queue.clear();
+    }
+    // cancel any callbacks on jobs still processing
+    for_each((*i)->m_processing.begin(), (*i)->m_processing.end(), std::mem_fun_ref(&CWorkItem::Cancel));
+  }
 
   // tell our workers to finish
   while (m_workers.size())
@@ -224,21 +390,61 @@ CJobManager::~CJobManager()
 {
 }
 
-unsigned int CJobManager::AddJob(CJob *job, IJobCallback *callback, CJob::PRIORITY priority)
+void CJobManager::ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)> &function)
 {
-  CSingleLock lock(m_section);
+  size_t ranges = count / std::max<size_t>(grainSize, 1);
+  ranges = std::min<size_t>(ranges, std::max(g_cpuInfo.getCPUCount(), 1));
+  ranges = std::min<size_t>(ranges, GetMaxWorkers(CJob::PRIORITY_HIGH) + 1);
+  if (ranges <= 1)
+  {
+    if (count > 0)
+      function(0, count);
+    return;
+  }
+
+  // the jobs share the ranges with this thread, any left over once it's done find nothing to do
+  std::shared_ptr<CParallelRanges> state = std::make_shared<CParallelRanges>(count, ranges, function);
+  for (size_t i = 1; i < ranges; i++)
+    Submit([state]() { state->Run(); }, CJob::PRIORITY_HIGH);
+  state->Run();
 
+  // every range has been taken by now, so there's nothing left to help with. Running other jobs
+  // while waiting would run them inside whatever locks the caller holds.
+  state->m_finished.Wait();
+
+  if (state->m_exception)
+    std::rethrow_exception(state->m_exception);
+}
+
+unsigned int CJobManager::AddJob(CJob *job, IJobCallback *callback, CJob::PRIORITY priority)
+{
   if (!m_running)
     return 0;
 
   // increment the job counter, ensuring 0 (invalid job) is never hit
-  m_jobCounter++;
-  if (m_jobCounter == 0)
-    m_jobCounter++;
+  unsigned int id = ++m_jobCounter;
+  if (id == 0)
+    id = ++m_jobCounter;
 
   // create a work item for this job
-  CWorkItem work(job, m_jobCounter, priority, callback);
-  m_jobQueue[priority].push_back(work);
+  CWorkItem work(job, id, priority, callback);
+
+  // jobs added by a job go on the queue of its worker, so they're likely run with the same data in the cache
+  CJobWorker *worker = currentWorker.get();
+  if (worker && worker->m_persistent && priority != CJob::PRIORITY_DEDICATED)
+  {
+    CCountingLock lock(worker->m_section, m_contendedLocal);
+    worker->m_jobQueue[priority].push_back(work);
+    m_queued[priority]++;
+  }
+  else
+  {
+    CCountingLock lock(m_section, m_contended);
+    if (!m_running)
+      return 0;
+    m_jobQueue[priority].push_back(work);
+    m_queued[priority]++;
+  }
 
   StartWorkers(priority);
   return work.m_id;
@@ -256,68 +462,196 @@ void CJobManager::CancelJob(unsigned int jobID)
     {
       delete i->m_job;
       m_jobQueue[priority].erase(i);
+      m_queued[priority]--;
+      return;
+    }
+  }
+  for (Workers::iterator worker = m_workers.begin(); worker != m_workers.end(); ++worker)
+  {
+    CSingleLock workerLock((*worker)->m_section);
+    for (unsigned int priority = CJob::PRIORITY_LOW_PAUSABLE; priority < CJob::PRIORITY_DEDICATED; ++priority)
+    {
+      JobQueue &queue = (*worker)->m_jobQueue[priority];
+      JobQueue::iterator i = find(queue.begin(), queue.end(), jobID);
+      if (i != queue.end())
+      {
+        delete i->m_job;
+        queue.erase(i);
+        m_queued[priority]--;
+        return;
+      }
+    }
+    // or if we're processing it
+    Processing::iterator it = find((*worker)->m_processing.begin(), (*worker)->m_processing.end(), jobID);
+    if (it != (*worker)->m_processing.end())
+    {
+      it->m_callback = NULL; // job is in progress, so only thing to do is to remove callback
       return;
     }
   }
-  // or if we're processing it
-  Processing::iterator it = find(m_processing.begin(), m_processing.end(), jobID);
-  if (it != m_processing.end())
-    it->m_callback = NULL; // job is in progress, so only thing to do is to remove callback
 }
 
 void CJobManager::StartWorkers(CJob::PRIORITY priority)
 {
-  CSingleLock lock(m_section);
-
-  // check how many free threads we have
-  if (m_processing.size() >= GetMaxWorkers(priority))
+  // check how many free threads we have, a busy worker picks the job up once it's done otherwise
+  if (m_processing >= GetMaxWorkers(priority))
     return;
 
   // do we have any sleeping threads?
-  if (m_processing.size() < m_workers.size())
+  if (m_idleWorkers > 0)
   {
     m_jobEvent.Set();
     return;
   }
 
-  // everyone is busy - we need more workers
-  m_workers.push_back(new CJobWorker(this));
+  CCountingLock lock(m_section, m_contended);
+  if (!m_running)
+    return;
+
+  // everyone is busy - start another persistent worker, until there's one for each job that may run at once
+  unsigned int persistent = 0;
+  for (Workers::const_iterator i = m_workers.begin(); i != m_workers.end(); ++i)
+  {
+    if ((*i)->m_persistent)
+      persistent++;
+  }
+  if (persistent < GetMaxWorkers(CJob::PRIORITY_HIGH))
+    m_workers.push_back(new CJobWorker(this, true));
+  else if (priority == CJob::PRIORITY_DEDICATED)
+    m_workers.push_back(new CJobWorker(this, false));
+  else
+    return;
+  m_workersStarted++;
+}
+
+bool CJobManager::StartExtraWorker(CJob::PRIORITY below)
+{
+  bool queued = false;
+  for (int priority = CJob::PRIORITY_LOW_PAUSABLE; priority < below && !queued; ++priority)
+    queued = m_queued[priority] > 0 && !(priority == CJob::PRIORITY_LOW_PAUSABLE && m_pauseJobs);
+  if (!queued)
+    return false;
+
+  if (m_idleWorkers > 0)
+  {
+    m_jobEvent.Set();
+    return true;
+  }
+
+  // it stops again after being idle for a while, like the workers of dedicated jobs
+  CCountingLock lock(m_section, m_contended);
+  if (m_running)
+  {
+    m_workers.push_back(new CJobWorker(this, false));
+    m_workersStarted++;
+  }
+  return true;
 }
 
-CJob *CJobManager::PopJob()
+bool CJobManager::StartProcessing(CJob::PRIORITY priority)
 {
-  CSingleLock lock(m_section);
-  for (int priority = CJob::PRIORITY_DEDICATED; priority >= CJob::PRIORITY_LOW_PAUSABLE; --priority)
+  unsigned int processing = m_processing;
+  do
+  {
+    if (processing >= GetMaxWorkers(priority))
+      return false;
+  } while (!m_processing.compare_exchange_weak(processing, processing + 1));
+  return true;
+}
+
+bool CJobManager::PopQueuedJob(JobQueue &queue, bool newest, CJobWorker *worker)
+{
+  if (queue.empty())
+    return false;
+
+  CWorkItem job = newest ? queue.back() : queue.front();
+  if (newest)
+    queue.pop_back();
+  else
+    queue.pop_front();
+  m_queued[job.m_priority]--;
+
+  // add to the processing jobs of the worker
+  job.m_job->m_callback = this;
+  CSingleLock lock(worker->m_section);
+  worker->m_processing.push_back(job);
+  return true;
+}
+
+CJob *CJobManager::PopJob(CJobWorker *worker, CJob::PRIORITY minPriority, CJob::PRIORITY maxPriority)
+{
+  for (int priority = maxPriority; priority >= minPriority; --priority)
   {
     // Check whether we're pausing pausable jobs
     if (priority == CJob::PRIORITY_LOW_PAUSABLE && m_pauseJobs)
       continue;
 
-    if (m_jobQueue[priority].size() && m_processing.size() < GetMaxWorkers(CJob::PRIORITY(priority)))
+    if (m_queued[priority] == 0 || !StartProcessing(CJob::PRIORITY(priority)))
+      continue;
+
+    bool found = false;
+    if (worker->m_persistent && priority != CJob::PRIORITY_DEDICATED)
+    {
+      CCountingLock lock(worker->m_section, m_contendedLocal);
+      found = PopQueuedJob(worker->m_jobQueue[priority], true, worker);
+      if (found)
+        m_localJobs++;
+    }
+    if (!found)
+    {
+      CCountingLock lock(m_section, m_contended);
+      found = PopQueuedJob(m_jobQueue[priority], false, worker);
+
+      // steal the oldest job of another worker
+      for (Workers::iterator i = m_workers.begin(); !found && priority != CJob::PRIORITY_DEDICATED && i != m_workers.end(); ++i)
+      {
+        if (*i == worker || !(*i)->m_persistent)
+          continue;
+        CCountingLock victimLock((*i)->m_section, m_contendedLocal);
+        found = PopQueuedJob((*i)->m_jobQueue[priority], false, worker);
+        if (found)
+          m_stolenJobs++;
+      }
+    }
+    if (!found)
+    {
+      m_processing--;
+      continue;
+    }
+
+    // pass any remaining jobs on to the next idle worker
+    if (m_idleWorkers > 0)
     {
-      // pop the job off the queue
-      CWorkItem job = m_jobQueue[priority].front();
-      m_jobQueue[priority].pop_front();
-
-      // add to the processing vector
-      m_processing.push_back(job);
-      job.m_job->m_callback = this;
-      return job.m_job;
+      for (unsigned int i = CJob::PRIORITY_LOW_PAUSABLE; i <= CJob::PRIORITY_DEDICATED; ++i)
+      {
+        if (m_queued[i] > 0)
+        {
+          m_jobEvent.Set();
+          break;
+        }
+      }
     }
+
+    CSingleLock lock(worker->m_section);
+    return worker->m_processing.back().m_job;
   }
   return NULL;
 }
 
 void CJobManager::PauseJobs()
 {
-  CSingleLock lock(m_section);
   m_pauseJobs = true;
 }
 
 void CJobManager::UnPauseJobs()
 {
-  CSingleLock lock(m_section);
   m_pauseJobs = false;
+  m_jobEvent.Set();
+}
+
+bool CJobManager::IsPaused() const
+{
+  return m_pauseJobs;
 }
 
 bool CJobManager::IsProcessing(const CJob::PRIORITY &priority) const
@@ -327,10 +661,14 @@ bool CJobManager::IsProcessing(const CJob::PRIORITY &priority) const
   if (m_pauseJobs)
     return false;
 
-  for(Processing::const_iterator it = m_processing.begin(); it < m_processing.end(); ++it)
+  for (Workers::const_iterator worker = m_workers.begin(); worker != m_workers.end(); ++worker)
   {
-    if (priority == it->m_priority)
-      return true;
+    CSingleLock workerLock((*worker)->m_section);
+    for (Processing::const_iterator it = (*worker)->m_processing.begin(); it != (*worker)->m_processing.end(); ++it)
+    {
+      if (priority == it->m_priority)
+        return true;
+    }
   }
   return false;
 }
@@ -343,33 +681,61 @@ int CJobManager::IsProcessing(const std::string &type) const
   if (m_pauseJobs)
     return 0;
 
-  for(Processing::const_iterator it = m_processing.begin(); it < m_processing.end(); ++it)
+  for (Workers::const_iterator worker = m_workers.begin(); worker != m_workers.end(); ++worker)
   {
-    if (type == std::string(it->m_job->GetType()))
-      jobsMatched++;
+    CSingleLock workerLock((*worker)->m_section);
+    for (Processing::const_iterator it = (*worker)->m_processing.begin(); it != (*worker)->m_processing.end(); ++it)
+    {
+      if (type == std::string(it->m_job->GetType()))
+        jobsMatched++;
+    }
   }
   return jobsMatched;
 }
 
-CJob *CJobManager::GetNextJob(const CJobWorker *worker)
+CJobManager::Stats CJobManager::GetStats() const
+{
+  Stats stats;
+  stats.jobs = m_jobsRun;
+  stats.localJobs = m_localJobs;
+  stats.stolenJobs = m_stolenJobs;
+  stats.contended = m_contended;
+  stats.contendedLocal = m_contendedLocal;
+  stats.waits = m_waits;
+  stats.workers = m_workersStarted;
+  return stats;
+}
+
+CJob *CJobManager::GetNextJob(CJobWorker *worker)
 {
-  CSingleLock lock(m_section);
   while (m_running)
   {
     // grab a job off the queue if we have one
-    CJob *job = PopJob();
+    CJob *job = PopJob(worker);
     if (job)
       return job;
-    // no jobs are left - sleep for 30 seconds to allow new jobs to come in
-    lock.Leave();
-    bool newJob = m_jobEvent.WaitMSec(30000);
-    lock.Enter();
-    if (!newJob)
+
+    // ensure no jobs have come in before we counted as idle, as they won't have woken us
+    m_idleWorkers++;
+    job = PopJob(worker);
+    if (job)
+    {
+      m_idleWorkers--;
+      return job;
+    }
+
+    // no jobs are left - persistent workers sleep until new jobs come in, others for 30 seconds
+    m_waits++;
+    bool newJob = worker->m_persistent ? m_jobEvent.Wait() : m_jobEvent.WaitMSec(30000);
+    m_idleWorkers--;
+    if (!newJob && !worker->m_persistent)
       break;
   }
+
+  CSingleLock lock(m_section);
   // ensure no jobs have come in during the period after
   // timeout and before we held the lock
-  CJob *job = PopJob();
+  CJob *job = m_running ? PopJob(worker) : NULL;
   if (job)
     return job;
   // have no jobs
@@ -377,59 +743,126 @@ CJob *CJobManager::GetNextJob(const CJobWorker *worker)
   return NULL;
 }
 
-bool CJobManager::OnJobProgress(unsigned int progress, unsigned int total, const CJob *job) const
+bool CJobManager::WaitRunningJobs(CEvent &event, int milliseconds)
 {
-  CSingleLock lock(m_section);
-  // find the job in the processing queue, and check whether it's cancelled (no callback)
-  Processing::const_iterator i = find(m_processing.begin(), m_processing.end(), job);
-  if (i != m_processing.end())
+  CJobWorker *worker = currentWorker.get();
+  if (!worker)
+    return milliseconds < 0 ? event.Wait() : event.WaitMSec(milliseconds);
+
+  XbmcThreads::EndTime timeout;
+  if (milliseconds < 0)
+    timeout.SetInfinite();
+  else
+    timeout.Set(milliseconds);
+
+  // the waiting job is the last one the worker started processing
+  CJob::PRIORITY priority = CJob::PRIORITY_LOW_PAUSABLE;
   {
-    CWorkItem item(*i);
-    lock.Leave(); // leave section prior to call
-    if (item.m_callback)
+    CSingleLock lock(worker->m_section);
+    if (!worker->m_processing.empty())
+      priority = worker->m_processing.back().m_priority;
+  }
+
+  // make way for the jobs we're waiting on, and run them ourselves if they're still queued. Lower
+  // priority jobs would hold up a more urgent waiter, and dedicated ones may run for as long as they
+  // like, so those are left to other workers.
+  m_processing--;
+  bool ready = event.WaitMSec(0);
+  bool startedWorker = false;
+  while (!ready && !timeout.IsTimePast())
+  {
+    CJob *job = m_running && priority != CJob::PRIORITY_DEDICATED ? PopJob(worker, priority, CJob::PRIORITY_HIGH) : NULL;
+    if (job)
     {
-      item.m_callback->OnJobProgress(item.m_id, progress, total, job);
-      return false;
+      worker->Run(job);
+      ready = event.WaitMSec(0);
+      continue;
     }
+
+    // every persistent worker may be waiting like us, so make sure the jobs we leave get run
+    if (!startedWorker && m_running)
+      startedWorker = StartExtraWorker(priority);
+    ready = event.WaitMSec(std::min(timeout.MillisLeft(), 5u));
+  }
+  m_processing++;
+  return ready;
+}
+
+bool CJobManager::OnJobProgress(unsigned int progress, unsigned int total, const CJob *job) const
+{
+  // find the job in the processing jobs of a worker, and check whether it's cancelled (no callback)
+  auto findJob = [job](const CJobWorker *worker, CWorkItem &item) {
+    CSingleLock lock(worker->m_section);
+    Processing::const_iterator i = find(worker->m_processing.begin(), worker->m_processing.end(), job);
+    if (i == worker->m_processing.end())
+      return false;
+    item = *i;
+    return true;
+  };
+
+  // jobs report their progress from their own worker, so look there first
+  CWorkItem item(NULL, 0, CJob::PRIORITY_LOW, NULL);
+  CJobWorker *worker = currentWorker.get();
+  bool found = worker && findJob(worker, item);
+  if (!found)
+  {
+    CSingleLock lock(m_section);
+    for (Workers::const_iterator i = m_workers.begin(); !found && i != m_workers.end(); ++i)
+      found = findJob(*i, item);
+  }
+
+  if (found && item.m_callback)
+  {
+    item.m_callback->OnJobProgress(item.m_id, progress, total, job);
+    return false;
   }
   return true; // couldn't find the job, or it's been cancelled
 }
 
-void CJobManager::OnJobComplete(bool success, CJob *job)
+void CJobManager::OnJobComplete(CJobWorker *worker, bool success)
 {
-  CSingleLock lock(m_section);
-  // remove the job from the processing queue
-  Processing::iterator i = find(m_processing.begin(), m_processing.end(), job);
-  if (i != m_processing.end())
+  // the job is the last one the worker started processing
+  CSingleLock lock(worker->m_section);
+  CWorkItem item(worker->m_processing.back());
+  lock.Leave();
+
+  // tell any listeners we're done with the job, then delete it
+  try
   {
-    // tell any listeners we're done with the job, then delete it
-    CWorkItem item(*i);
-    lock.Leave();
-    try
-    {
-      if (item.m_callback)
-        item.m_callback->OnJobComplete(item.m_id, success, item.m_job);
-    }
-    catch (...)
-    {
-      CLog::Log(LOGERROR, "%s error processing job %s", __FUNCTION__, item.m_job->GetType());
-    }
-    lock.Enter();
-    Processing::iterator j = find(m_processing.begin(), m_processing.end(), job);
-    if (j != m_processing.end())
-      m_processing.erase(j);
-    lock.Leave();
-    item.FreeJob();
+    if (item.m_callback)
+      item.m_callback->OnJobComplete(item.m_id, success, item.m_job);
   }
+  catch (...)
+  {
+    CLog::Log(LOGERROR, "%s error processing job %s", __FUNCTION__, item.m_job->GetType());
+  }
+  lock.Enter();
+  worker->m_processing.pop_back();
+  lock.Leave();
+  m_processing--;
+  m_jobsRun++;
+  item.FreeJob();
 }
 
-void CJobManager::RemoveWorker(const CJobWorker *worker)
+void CJobManager::RemoveWorker(CJobWorker *worker)
 {
   CSingleLock lock(m_section);
   // remove our worker
   Workers::iterator i = find(m_workers.begin(), m_workers.end(), worker);
   if (i != m_workers.end())
+  {
     m_workers.erase(i); // workers auto-delete
+
+    // free any jobs queued by the worker after CancelJobs() cleared the queues
+    CSingleLock workerLock(worker->m_section);
+    for (unsigned int priority = CJob::PRIORITY_LOW_PAUSABLE; priority < CJob::PRIORITY_DEDICATED; ++priority)
+    {
+      JobQueue &queue = worker->m_jobQueue[priority];
+      m_queued[priority] -= queue.size();
+      for_each(queue.begin(), queue.end(), std::mem_fun_ref(&CWorkItem::FreeJob));
+      queue.clear();
+    }
+  }
 }
 
 unsigned int CJobManager::GetMaxWorkers(CJob::PRIORITY priority)
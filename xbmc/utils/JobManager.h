@@ -19,24 +19,230 @@
  *
  */
 
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
 #include <queue>
+#include <stdint.h>
+#include <type_traits>
 #include <vector>
 #include <string>
 #include "threads/CriticalSection.h"
+#include "threads/Event.h"
 #include "threads/Thread.h"
 #include "Job.h"
 
 class CJobManager;
+class CJobWorker;
 
-class CJobWorker : public CThread
+/*!
+ \ingroup jobs
+ \brief Shared state of a CJobFuture, completed by the job computing the result.
+ \sa CJobFuture
+ */
+class CJobFutureStateBase
 {
 public:
-  CJobWorker(CJobManager *manager);
-  virtual ~CJobWorker();
+  CJobFutureStateBase() : m_ready(true), m_done(false) { };
+  virtual ~CJobFutureStateBase() { };
 
-  void Process();
+  bool IsReady() const;
+
+  /*!
+   \brief Wait for the state to be completed.
+   When called from a job, other queued jobs are run while waiting so that jobs can wait for the jobs
+   they queue without holding up the workers.
+   */
+  void Wait() const;
+  bool Wait(unsigned int milliseconds) const;
+
+  /*!
+   \brief Call a function once the state is completed.
+   The function is called on the thread completing the state, or straight away if it already is.
+   */
+  void OnReady(const std::function<void()> &function);
+
+  void SetException(std::exception_ptr exception);
+  bool HasException() const;
+
+  /*!
+   \brief Fail the state if nothing completed it, used when the job computing it is deleted.
+   */
+  void Abandon();
+
+protected:
+  void SetReady();
+  void RethrowException() const;
+
+  mutable CCriticalSection m_section;
+  mutable CEvent m_ready;
+  bool m_done;
+  std::exception_ptr m_exception;
+  std::vector< std::function<void()> > m_continuations;
+};
+
+template<typename T>
+class CJobFutureState : public CJobFutureStateBase
+{
+public:
+  void SetValue(T value)
+  {
+    m_value = std::move(value);
+    SetReady();
+  };
+  const T &GetValue() const
+  {
+    Wait();
+    RethrowException();
+    return m_value;
+  };
 private:
-  CJobManager  *m_jobManager;
+  T m_value;
+};
+
+template<>
+class CJobFutureState<void> : public CJobFutureStateBase
+{
+public:
+  void SetValue() { SetReady(); };
+  void GetValue() const
+  {
+    Wait();
+    RethrowException();
+  };
+};
+
+/*!
+ \ingroup jobs
+ \brief Runs a function, completing a future state with what it returns or throws.
+ */
+template<typename R>
+struct CJobInvoker
+{
+  template<typename F>
+  static void Run(CJobFutureState<R> &state, F &function)
+  {
+    try
+    {
+      state.SetValue(function());
+    }
+    catch (...)
+    {
+      state.SetException(std::current_exception());
+    }
+  };
+};
+
+template<>
+struct CJobInvoker<void>
+{
+  template<typename F>
+  static void Run(CJobFutureState<void> &state, F &function)
+  {
+    try
+    {
+      function();
+    }
+    catch (...)
+    {
+      state.SetException(std::current_exception());
+      return;
+    }
+    state.SetValue();
+  };
+};
+
+/*!
+ \ingroup jobs
+ \brief Calls a continuation with the result of the future it was added to.
+ Exceptions of the previous future are rethrown, so they pass on to the continuation's future.
+ \sa CJobFuture::Then()
+ */
+template<typename T, typename F>
+class CJobContinuation
+{
+public:
+  typedef typename std::decay<decltype(std::declval<F&>()(std::declval<const T&>()))>::type result_type;
+
+  CJobContinuation(const std::shared_ptr< CJobFutureState<T> > &previous, const F &function) : m_previous(previous), m_function(function) { };
+  result_type operator()() { return m_function(m_previous->GetValue()); };
+private:
+  std::shared_ptr< CJobFutureState<T> > m_previous;
+  F m_function;
+};
+
+template<typename F>
+class CJobContinuation<void, F>
+{
+public:
+  typedef typename std::decay<decltype(std::declval<F&>()())>::type result_type;
+
+  CJobContinuation(const std::shared_ptr< CJobFutureState<void> > &previous, const F &function) : m_previous(previous), m_function(function) { };
+  result_type operator()()
+  {
+    m_previous->GetValue();
+    return m_function();
+  };
+private:
+  std::shared_ptr< CJobFutureState<void> > m_previous;
+  F m_function;
+};
+
+template<typename T>
+struct CJobResult
+{
+  typedef const T &type;
+};
+
+template<>
+struct CJobResult<void>
+{
+  typedef void type;
+};
+
+/*!
+ \ingroup jobs
+ \brief Result of a function run by the CJobManager.
+
+ Returned by CJobManager::Submit(). The result can be waited for with Get(), or passed on to
+ further jobs with Then(). Exceptions thrown by the function are rethrown by Get().
+ If the job is cancelled before it runs, Get() throws std::runtime_error.
+
+ \sa CJobManager::Submit()
+ */
+template<typename T>
+class CJobFuture
+{
+public:
+  CJobFuture() { };
+  explicit CJobFuture(const std::shared_ptr< CJobFutureState<T> > &state) : m_state(state) { };
+
+  bool IsValid() const { return m_state != nullptr; };
+  bool IsReady() const { return m_state->IsReady(); };
+  void Wait() const { m_state->Wait(); };
+  bool Wait(unsigned int milliseconds) const { return m_state->Wait(milliseconds); };
+
+  /*!
+   \brief Wait for the result and return it.
+   \throws any exception thrown by the job
+   */
+  typename CJobResult<T>::type Get() const
+  {
+    return m_state->GetValue();
+  };
+
+  /*!
+   \brief Queue a job that calls function with the result once it's ready.
+   \param function called with the result (without arguments for CJobFuture<void>). Isn't called if the job threw.
+   \param priority the priority of the continuation job.
+   \return the future result of function
+   */
+  template<typename F>
+  CJobFuture<typename CJobContinuation<T, F>::result_type> Then(F function, CJob::PRIORITY priority = CJob::PRIORITY_LOW) const;
+
+private:
+  std::shared_ptr< CJobFutureState<T> > m_state;
 };
 
 /*!
@@ -170,6 +376,12 @@ private:
  priority levels.  Lower priority jobs are executed only if there are sufficient
  spare worker threads free to allow for higher priority jobs that may arise.
 
+ Jobs run on a pool of persistent workers, one for each job that may run at once. Jobs
+ added by a worker go on that worker's own queue, where it picks them up last in, first out,
+ and idle workers steal from the other end. Jobs added by other threads go on a shared queue.
+ PRIORITY_DEDICATED jobs start an extra worker when no worker is idle, which stops again
+ after being idle for 30 seconds.
+
  \sa CJob and IJobCallback
  */
 class CJobManager
@@ -211,17 +423,40 @@ class CJobManager
   class CLambdaJob : public CJob
   {
   public:
-    CLambdaJob(F&& f) : m_f(std::forward<F>(f)) {};
+    typedef typename std::decay<decltype(std::declval<F&>()())>::type result_type;
+
+    template<typename G>
+    CLambdaJob(G&& f, const std::shared_ptr< CJobFutureState<result_type> > &state) : m_f(std::forward<G>(f)), m_state(state) {};
+    ~CLambdaJob() override
+    {
+      m_state->Abandon();
+    }
     bool DoWork() override
     {
-      m_f();
-      return true;
+      CJobInvoker<result_type>::Run(*m_state, m_f);
+      return !m_state->HasException();
     }
   private:
     F m_f;
+    std::shared_ptr< CJobFutureState<result_type> > m_state;
   };
 
 public:
+  /*!
+   \brief Counters of the work done by the job manager, to look for contention.
+   \sa GetStats()
+   */
+  struct Stats
+  {
+    uint64_t jobs;          ///< jobs run
+    uint64_t localJobs;     ///< jobs run by the worker that queued them
+    uint64_t stolenJobs;    ///< jobs taken from the queue of another worker
+    uint64_t contended;     ///< times the lock of the shared queue was held by another thread
+    uint64_t contendedLocal;///< times the lock of a worker's queue was held by another thread
+    uint64_t waits;         ///< times a worker went to sleep for lack of jobs
+    uint64_t workers;       ///< worker threads started
+  };
+
   /*!
    \brief The only way through which the global instance of the CJobManager should be accessed.
    \return the global instance.
@@ -240,13 +475,30 @@ public:
 
   /*!
    \brief Add a function f to this job manager for asynchronously execution.
+   \return the future result of f
+   \sa CJobFuture
    */
   template<typename F>
-  void Submit(F&& f, CJob::PRIORITY priority = CJob::PRIORITY_LOW)
+  CJobFuture<typename CLambdaJob<typename std::decay<F>::type>::result_type> Submit(F&& f, CJob::PRIORITY priority = CJob::PRIORITY_LOW)
   {
-    AddJob(new CLambdaJob<F>(std::forward<F>(f)), nullptr, priority);
+    typedef typename CLambdaJob<typename std::decay<F>::type>::result_type R;
+    std::shared_ptr< CJobFutureState<R> > state = std::make_shared< CJobFutureState<R> >();
+    Enqueue(std::forward<F>(f), state, priority);
+    return CJobFuture<R>(state);
   }
 
+  /*!
+   \brief Call a function for consecutive ranges of [0, count), on the calling thread and the workers.
+   The calling thread takes ranges as well and only waits for those a worker already started, so it
+   isn't held up by busy workers. It doesn't run other jobs while waiting, so it may be called with
+   locks held. Counts too small to split are run on the calling thread only.
+   \param count the number of elements.
+   \param grainSize the minimum number of elements in a range.
+   \param function called with the begin and end of each range, possibly from several threads at once.
+   \throws any exception thrown by function
+   */
+  void ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)> &function);
+
   /*!
    \brief Cancel a job with the given id.
    \param jobID the id of the job to cancel, retrieved previously from AddJob()
@@ -290,6 +542,12 @@ public:
    */
   void UnPauseJobs();
 
+  /*!
+   \brief Checks whether jobs with priority PRIORITY_LOW_PAUSABLE are currently paused
+   \sa PauseJobs()
+   */
+  bool IsPaused() const;
+
   /*!
    \brief Checks to see if any jobs with specific priority are currently processing.
    \param priority to search for
@@ -297,25 +555,32 @@ public:
    */
   bool IsProcessing(const CJob::PRIORITY &priority) const;
 
+  /*!
+   \brief Get the counters of the work done since the manager was created.
+   */
+  Stats GetStats() const;
+
 protected:
   friend class CJobWorker;
   friend class CJob;
+  friend class CJobFutureStateBase;
+  template<typename T> friend class CJobFuture;
 
   /*!
    \brief Get a new job to process. Blocks until a new job is available, or a timeout has occurred.
    \param worker a pointer to the current CJobWorker instance requesting a job.
    \sa CJob
    */
-  CJob *GetNextJob(const CJobWorker *worker);
+  CJob *GetNextJob(CJobWorker *worker);
 
   /*!
    \brief Callback from CJobWorker after a job has completed.
    Calls IJobCallback::OnJobComplete(), and then destroys job.
-   \param job a pointer to the calling subclassed CJob instance.
+   \param worker the worker that ran the job.
    \param success the result from the DoWork call
    \sa IJobCallback, CJob
    */
-  void  OnJobComplete(bool success, CJob *job);
+  void  OnJobComplete(CJobWorker *worker, bool success);
 
   /*!
    \brief Callback from CJob to report progress and check for cancellation.
@@ -328,6 +593,28 @@ protected:
    */
   bool  OnJobProgress(unsigned int progress, unsigned int total, const CJob *job) const;
 
+  /*!
+   \brief Wait for an event, running queued jobs meanwhile when called from a worker.
+   The waiting job doesn't count towards the number of jobs processing while it waits. Only jobs of
+   at least its own priority are run meanwhile, and no PRIORITY_DEDICATED ones, which may run for
+   long; an extra worker is started for the others.
+   \param event the event to wait for.
+   \param milliseconds how long to wait for, waits until the event is set if negative.
+   \return true if the event was set, false on timeout.
+   */
+  bool WaitRunningJobs(CEvent &event, int milliseconds);
+
+  /*!
+   \brief Queue a function completing the given future state when it runs.
+   */
+  template<typename F, typename R>
+  void Enqueue(F&& f, const std::shared_ptr< CJobFutureState<R> > &state, CJob::PRIORITY priority)
+  {
+    CJob *job = new CLambdaJob<typename std::decay<F>::type>(std::forward<F>(f), state);
+    if (!AddJob(job, nullptr, priority))
+      delete job; // abandons the state
+  }
+
 private:
   // private construction, and no assignements; use the provided singleton methods
   CJobManager();
@@ -335,27 +622,82 @@ private:
   CJobManager const& operator=(CJobManager const&);
   virtual ~CJobManager();
 
-  /*! \brief Pop a job off the job queue and add to the processing queue ready to process
+  typedef std::deque<CWorkItem>    JobQueue;
+  typedef std::vector<CWorkItem>   Processing;
+  typedef std::vector<CJobWorker*> Workers;
+
+  /*! \brief Pop a job off one of the job queues and make it the worker's current job
+   \param minPriority lowest priority of the jobs to consider
+   \param maxPriority highest priority of the jobs to consider
    \return the job to process, NULL if no jobs are available
    */
-  CJob *PopJob();
+  CJob *PopJob(CJobWorker *worker, CJob::PRIORITY minPriority = CJob::PRIORITY_LOW_PAUSABLE,
+               CJob::PRIORITY maxPriority = CJob::PRIORITY_DEDICATED);
+  bool PopQueuedJob(JobQueue &queue, bool newest, CJobWorker *worker);
+  bool StartProcessing(CJob::PRIORITY priority);
 
   void StartWorkers(CJob::PRIORITY priority);
-  void RemoveWorker(const CJobWorker *worker);
+  /*! \brief Start a worker for the jobs below the given priority unless one is idle
+   \return false if no such jobs are queued */
+  bool StartExtraWorker(CJob::PRIORITY below);
+  void RemoveWorker(CJobWorker *worker);
   static unsigned int GetMaxWorkers(CJob::PRIORITY priority);
 
-  unsigned int m_jobCounter;
-
-  typedef std::deque<CWorkItem>    JobQueue;
-  typedef std::vector<CWorkItem>   Processing;
-  typedef std::vector<CJobWorker*> Workers;
+  std::atomic<unsigned int> m_jobCounter;
 
   JobQueue   m_jobQueue[CJob::PRIORITY_DEDICATED + 1];
-  bool       m_pauseJobs;
-  Processing m_processing;
+  std::atomic<bool> m_pauseJobs;
   Workers    m_workers;
 
+  std::atomic<unsigned int> m_queued[CJob::PRIORITY_DEDICATED + 1]; ///< jobs in the shared and worker queues
+  std::atomic<unsigned int> m_processing; ///< jobs processing, not counting those waiting on other jobs
+  std::atomic<unsigned int> m_idleWorkers;
+
+  std::atomic<uint64_t> m_jobsRun;
+  std::atomic<uint64_t> m_localJobs;
+  std::atomic<uint64_t> m_stolenJobs;
+  mutable std::atomic<uint64_t> m_contended;
+  mutable std::atomic<uint64_t> m_contendedLocal;
+  std::atomic<uint64_t> m_waits;
+  std::atomic<uint64_t> m_workersStarted;
+
   CCriticalSection m_section;
   CEvent           m_jobEvent;
-  bool             m_running;
+  std::atomic<bool> m_running;
 };
+
+/*!
+ \ingroup jobs
+ \brief Thread running jobs for the CJobManager
+ */
+class CJobWorker : public CThread
+{
+public:
+  CJobWorker(CJobManager *manager, bool persistent);
+  virtual ~CJobWorker();
+
+  void Process();
+private:
+  friend class CJobManager;
+  void Run(CJob *job);
+
+  CJobManager  *m_jobManager;
+  bool          m_persistent;   ///< persistent workers keep running while idle, and queue the jobs they add themselves
+
+  CCriticalSection        m_section;
+  CJobManager::JobQueue   m_jobQueue[CJob::PRIORITY_DEDICATED]; ///< jobs added by this worker, by priority
+  CJobManager::Processing m_processing; ///< the job being processed, followed by those run while it waits
+};
+
+template<typename T>
+template<typename F>
+CJobFuture<typename CJobContinuation<T, F>::result_type> CJobFuture<T>::Then(F function, CJob::PRIORITY priority) const
+{
+  typedef typename CJobContinuation<T, F>::result_type R;
+  std::shared_ptr< CJobFutureState<T> > previous = m_state;
+  std::shared_ptr< CJobFutureState<R> > next = std::make_shared< CJobFutureState<R> >();
+  m_state->OnReady([previous, next, function, priority]() {
+    CJobManager::GetInstance().Enqueue(CJobContinuation<T, F>(previous, function), next, priority);
+  });
+  return CJobFuture<R>(next);
+}
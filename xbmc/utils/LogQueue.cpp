@@ -0,0 +1,136 @@
+/*
+ *      Copyright (C) 2017 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kodi; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "LogQueue.h"
+
+#include <utility>
+
+CLogQueue::CLogQueue()
+  : m_buffers(new Buffer[BufferCount])
+  , m_order(0)
+{
+  for (size_t i = 0; i < BufferCount; i++)
+  {
+    for (size_t j = 0; j < BufferSize; j++)
+      m_buffers[i].cells[j].sequence.store(j, std::memory_order_relaxed);
+    m_buffers[i].pushPos.store(0, std::memory_order_relaxed);
+    m_buffers[i].popPos.store(0, std::memory_order_relaxed);
+  }
+}
+
+CLogQueue::~CLogQueue()
+{
+  delete[] m_buffers;
+}
+
+bool CLogQueue::Push(Entry &entry, uint64_t threadId, bool &nearlyFull)
+{
+  // thread ids are often aligned addresses, so mix the bits before picking a buffer
+  Buffer &buffer = m_buffers[(threadId * 0x9E3779B97F4A7C15ULL) >> 61 & (BufferCount - 1)];
+
+  size_t pos = buffer.pushPos.load(std::memory_order_relaxed);
+  Cell *cell;
+  for (;;)
+  {
+    cell = &buffer.cells[pos & (BufferSize - 1)];
+    size_t sequence = cell->sequence.load(std::memory_order_acquire);
+    intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+    if (diff == 0)
+    {
+      if (buffer.pushPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        break;
+    }
+    else if (diff < 0)
+      return false;
+    else
+      pos = buffer.pushPos.load(std::memory_order_relaxed);
+  }
+
+  cell->entry.order = m_order++;
+  cell->entry.level = entry.level;
+  cell->entry.prefixLength = entry.prefixLength;
+  cell->entry.line = std::move(entry.line);
+  cell->sequence.store(pos + 1, std::memory_order_release);
+
+  nearlyFull = pos + 1 - buffer.popPos.load(std::memory_order_relaxed) == BufferSize / 2;
+  return true;
+}
+
+bool CLogQueue::Pop(Entry &entry)
+{
+  // merge the buffers by picking the ready head that was pushed first
+  Cell *oldest = NULL;
+  Buffer *oldestBuffer = NULL;
+  for (size_t i = 0; i < BufferCount; i++)
+  {
+    Buffer &buffer = m_buffers[i];
+    size_t pos = buffer.popPos.load(std::memory_order_relaxed);
+    Cell &cell = buffer.cells[pos & (BufferSize - 1)];
+    if (cell.sequence.load(std::memory_order_acquire) != pos + 1)
+      continue;
+    if (!oldest || cell.entry.order < oldest->entry.order)
+    {
+      oldest = &cell;
+      oldestBuffer = &buffer;
+    }
+  }
+  if (!oldest)
+    return false;
+
+  size_t pos = oldestBuffer->popPos.load(std::memory_order_relaxed);
+  entry.order = oldest->entry.order;
+  entry.level = oldest->entry.level;
+  entry.prefixLength = oldest->entry.prefixLength;
+  entry.line = std::move(oldest->entry.line);
+  oldest->entry.line.clear();
+  oldest->sequence.store(pos + BufferSize, std::memory_order_release);
+  oldestBuffer->popPos.store(pos + 1, std::memory_order_relaxed);
+  return true;
+}
+
+void CLogQueue::PeekQueuedLines(LineCallback callback, void *context) const
+{
+  // the same merge as Pop(), from positions of our own
+  size_t positions[BufferCount];
+  for (size_t i = 0; i < BufferCount; i++)
+    positions[i] = m_buffers[i].popPos.load(std::memory_order_relaxed);
+
+  for (;;)
+  {
+    const Cell *oldest = NULL;
+    size_t oldestBuffer = 0;
+    for (size_t i = 0; i < BufferCount; i++)
+    {
+      const Cell &cell = m_buffers[i].cells[positions[i] & (BufferSize - 1)];
+      if (cell.sequence.load(std::memory_order_acquire) != positions[i] + 1)
+        continue;
+      if (!oldest || cell.entry.order < oldest->entry.order)
+      {
+        oldest = &cell;
+        oldestBuffer = i;
+      }
+    }
+    if (!oldest)
+      return;
+
+    callback(oldest->entry.line, context);
+    positions[oldestBuffer]++;
+  }
+}
@@ -0,0 +1,100 @@
+/*
+ *      Copyright (C) 2017 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kodi; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+/*!
+ \brief Lock-free queue of formatted log lines.
+
+ Threads push lines into one of a fixed number of bounded ring buffers, picked by the thread id, so
+ threads logging at the same time rarely touch the same cache lines. A single consumer pops lines
+ back in the order they were pushed across all buffers. Push() never blocks; when the buffer is full
+ the caller is told so and decides whether to wait for the consumer.
+
+ Only one thread may pop at a time, CLog serializes them with its critical section.
+ */
+class CLogQueue
+{
+public:
+  struct Entry
+  {
+    Entry() : order(0), level(0), prefixLength(0) {}
+    uint64_t order;        ///< position in the global log order
+    int level;
+    size_t prefixLength;   ///< length of the time/thread/level prefix at the start of line
+    std::string line;
+  };
+
+  CLogQueue();
+  ~CLogQueue();
+
+  /*! \brief Queue a line logged by the given thread.
+   \param entry the line to queue, its line is moved into the queue on success
+   \param threadId id of the calling thread, used to pick the buffer
+   \param nearlyFull set to true when the buffer the line went into has just become half full
+   \return false if the buffer is full and the line wasn't queued
+   */
+  bool Push(Entry &entry, uint64_t threadId, bool &nearlyFull);
+
+  /*! \brief Pop the oldest queued line.
+   \param entry entry to move the line into
+   \return false if no lines are queued
+   */
+  bool Pop(Entry &entry);
+
+  typedef void (*LineCallback)(const std::string &line, void *context);
+
+  /*! \brief Pass the queued lines to a callback, oldest first, without popping them.
+   Takes no locks and allocates nothing, so it may be called from a signal handler as long as no
+   thread pops meanwhile. Lines that are still being pushed are left out.
+   */
+  void PeekQueuedLines(LineCallback callback, void *context) const;
+
+  static const size_t BufferCount = 8;
+  static const size_t BufferSize = 1024;
+
+private:
+  CLogQueue(const CLogQueue&) = delete;
+  CLogQueue& operator=(const CLogQueue&) = delete;
+
+  struct Cell
+  {
+    std::atomic<size_t> sequence;
+    Entry entry;
+  };
+
+  struct Buffer
+  {
+    Cell cells[BufferSize];
+    // keep producers and the consumer off each others' cache line
+    char pad0[64];
+    std::atomic<size_t> pushPos;
+    char pad1[64];
+    std::atomic<size_t> popPos;
+  };
+
+  Buffer *m_buffers;
+  std::atomic<uint64_t> m_order;
+};
@@ -23,7 +23,9 @@
 #include "URL.h"
 #include "Util.h"
 #include "XBDateTime.h"
+#include "threads/SingleLock.h"
 #include "utils/CharsetConverter.h"
+#include "utils/JobManager.h"
 #include "utils/StringUtils.h"
 #include "utils/Variant.h"
 
@@ -689,6 +691,67 @@ std::map<SortBy, Fields> fillSortingFields()
 std::map<SortBy, SortUtils::SortPreparator> SortUtils::m_preparators = fillPreparators();
 std::map<SortBy, Fields> SortUtils::m_sortingFields = fillSortingFields();
 
+// number of items below which preparing and sorting aren't split between threads
+static const size_t ParallelGrainSize = 4096;
+
+static void PrepareItem(SortUtils::SortPreparator preparator, const Fields &sortingFields, SortAttribute attributes, SortItem &item)
+{
+  // add all fields to the item that are required for sorting if they are currently missing
+  for (Fields::const_iterator field = sortingFields.begin(); field != sortingFields.end(); ++field)
+  {
+    if (item.find(*field) == item.end())
+      item.insert(std::pair<Field, CVariant>(*field, CVariant::ConstNullVariant));
+  }
+
+  // replaces the string of an earlier preparation for another sort method
+  std::wstring sortLabel;
+  g_charsetConverter.utf8ToW(preparator(attributes, item), sortLabel, false);
+  item[FieldSort] = CVariant(std::move(sortLabel));
+}
+
+// stable sort of large lists, splitting the work between threads
+static void MergeSort(SortItems& items, SortUtils::SorterIndirect sorter)
+{
+  // sort runs of the items in parallel, remembering where each one starts
+  std::vector<size_t> runs;
+  CCriticalSection section;
+  CJobManager::GetInstance().ParallelFor(items.size(), ParallelGrainSize, [&](size_t begin, size_t end) {
+    std::stable_sort(items.begin() + begin, items.begin() + end, sorter);
+    CSingleLock lock(section);
+    runs.push_back(begin);
+  });
+  std::sort(runs.begin(), runs.end());
+  runs.push_back(items.size());
+
+  // merge neighbouring runs until one is left, the left run goes first on ties to keep the sort stable
+  SortItems merged(items.size());
+  while (runs.size() > 2)
+  {
+    const size_t pairs = (runs.size() - 1) / 2;
+    CJobManager::GetInstance().ParallelFor(pairs, 1, [&](size_t begin, size_t end) {
+      for (size_t pair = begin; pair < end; pair++)
+      {
+        SortItems::iterator first = items.begin() + runs[2 * pair];
+        SortItems::iterator middle = items.begin() + runs[2 * pair + 1];
+        SortItems::iterator last = items.begin() + runs[2 * pair + 2];
+        std::merge(std::make_move_iterator(first), std::make_move_iterator(middle),
+                   std::make_move_iterator(middle), std::make_move_iterator(last),
+                   merged.begin() + runs[2 * pair], sorter);
+      }
+    });
+
+    // an odd run out is carried over as it is
+    if ((runs.size() - 1) % 2 != 0)
+      std::move(items.begin() + runs[runs.size() - 2], items.end(), merged.begin() + runs[runs.size() - 2]);
+
+    items.swap(merged);
+    for (size_t run = 1; 2 * run < runs.size(); run++)
+      runs[run] = runs[2 * run];
+    runs.resize(pairs + 1 + (runs.size() - 1) % 2);
+    runs.back() = items.size();
+  }
+}
+
 void SortUtils::Sort(SortBy sortBy, SortOrder sortOrder, SortAttribute attributes, DatabaseResults& items, int limitEnd /* = -1 */, int limitStart /* = 0 */)
 {
   if (sortBy != SortByNone)
@@ -736,25 +799,16 @@ void SortUtils::Sort(SortBy sortBy, SortOrder sortOrder, SortAttribute attribute
     SortPreparator preparator = getPreparator(sortBy);
     if (preparator != NULL)
     {
-      Fields sortingFields = GetFieldsForSorting(sortBy);
+      const Fields &sortingFields = GetFieldsForSorting(sortBy);
 
       // Prepare the string used for sorting and store it under FieldSort
-      for (SortItems::iterator item = items.begin(); item != items.end(); ++item)
-      {
-        // add all fields to the item that are required for sorting if they are currently missing
-        for (Fields::const_iterator field = sortingFields.begin(); field != sortingFields.end(); ++field)
-        {
-          if ((*item)->find(*field) == (*item)->end())
-            (*item)->insert(std::pair<Field, CVariant>(*field, CVariant::ConstNullVariant));
-        }
-
-        std::wstring sortLabel;
-        g_charsetConverter.utf8ToW(preparator(attributes, **item), sortLabel, false);
-        (*item)->insert(std::pair<Field, CVariant>(FieldSort, CVariant(sortLabel)));
-      }
+      CJobManager::GetInstance().ParallelFor(items.size(), ParallelGrainSize, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+          PrepareItem(preparator, sortingFields, attributes, *items[i]);
+      });
 
       // Do the sorting
-      std::stable_sort(items.begin(), items.end(), getSorterIndirect(sortOrder, attributes));
+      SortPrepared(sortOrder, attributes, items);
     }
   }
 
@@ -767,6 +821,30 @@ void SortUtils::Sort(SortBy sortBy, SortOrder sortOrder, SortAttribute attribute
     items.erase(items.begin() + limitEnd, items.end());
 }
 
+void SortUtils::Prepare(SortBy sortBy, SortAttribute attributes, SortItem& item)
+{
+  const SortPreparator &preparator = getPreparator(sortBy);
+  if (preparator != NULL)
+    PrepareItem(preparator, GetFieldsForSorting(sortBy), attributes, item);
+}
+
+void SortUtils::SortPrepared(SortOrder sortOrder, SortAttribute attributes, SortItems& items, int limitEnd /* = -1 */, int limitStart /* = 0 */)
+{
+  SorterIndirect sorter = getSorterIndirect(sortOrder, attributes);
+  if (items.size() < 2 * ParallelGrainSize)
+    std::stable_sort(items.begin(), items.end(), sorter);
+  else
+    MergeSort(items, sorter);
+
+  if (limitStart > 0 && (size_t)limitStart < items.size())
+  {
+    items.erase(items.begin(), items.begin() + limitStart);
+    limitEnd -= limitStart;
+  }
+  if (limitEnd > 0 && (size_t)limitEnd < items.size())
+    items.erase(items.begin() + limitEnd, items.end());
+}
+
 void SortUtils::Sort(const SortDescription &sortDescription, DatabaseResults& items)
 {
   Sort(sortDescription.sortBy, sortDescription.sortOrder, sortDescription.sortAttributes, items, sortDescription.limitEnd, sortDescription.limitStart);
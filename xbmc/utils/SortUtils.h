@@ -210,6 +210,16 @@ public:
   static void Sort(SortBy sortBy, SortOrder sortOrder, SortAttribute attributes, SortItems& items, int limitEnd = -1, int limitStart = 0);
   static void Sort(const SortDescription &sortDescription, DatabaseResults& items);
   static void Sort(const SortDescription &sortDescription, SortItems& items);
+
+  /*! \brief Add the fields needed to sort by sortBy that are missing, and store the string to sort on under FieldSort.
+   Items prepared once may be sorted several times with SortPrepared(), e.g. in either order.
+   \sa SortPrepared()
+   */
+  static void Prepare(SortBy sortBy, SortAttribute attributes, SortItem& item);
+  /*! \brief Stable sort of items prepared with Prepare(). Large lists are sorted in parallel.
+   \sa Prepare()
+   */
+  static void SortPrepared(SortOrder sortOrder, SortAttribute attributes, SortItems& items, int limitEnd = -1, int limitStart = 0);
   static bool SortFromDataset(const SortDescription &sortDescription, const MediaType &mediaType, const std::unique_ptr<dbiplus::Dataset> &dataset, DatabaseResults &results);
   
   static const Fields& GetFieldsForSorting(SortBy sortBy);
@@ -19,6 +19,186 @@
  */
 
 #include "Utf8Utils.h"
+#include "utils/uXstrings.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(HAVE_SSE2) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+
+/* Decode the UTF-8 sequence at p into codepoint.
+   Returns the length of the sequence, or 0 if it's invalid or cut off by end */
+inline size_t DecodeUtf8(const uint8_t* p, const uint8_t* end, uint32_t& codepoint)
+{
+  const uint8_t chr = p[0];
+  const size_t avail = end - p;
+
+  if (chr < 0x80)
+  {
+    codepoint = chr;
+    return 1;
+  }
+  if (chr < 0xC2) /* continuation byte or overlong 2 bytes sequence */
+    return 0;
+  if (chr < 0xE0)
+  {
+    if (avail < 2 || (p[1] & 0xC0) != 0x80)
+      return 0;
+    codepoint = ((chr & 0x1F) << 6) | (p[1] & 0x3F);
+    return 2;
+  }
+  if (chr < 0xF0)
+  {
+    if (avail < 3 || (p[1] & 0xC0) != 0x80 || (p[2] & 0xC0) != 0x80)
+      return 0;
+    codepoint = ((chr & 0x0F) << 12) | ((p[1] & 0x3F) << 6) | (p[2] & 0x3F);
+    if (codepoint < 0x800 || (codepoint >= 0xD800 && codepoint <= 0xDFFF))
+      return 0; /* overlong or surrogate */
+    return 3;
+  }
+  if (chr < 0xF5)
+  {
+    if (avail < 4 || (p[1] & 0xC0) != 0x80 || (p[2] & 0xC0) != 0x80 || (p[3] & 0xC0) != 0x80)
+      return 0;
+    codepoint = ((chr & 0x07) << 18) | ((p[1] & 0x3F) << 12) | ((p[2] & 0x3F) << 6) | (p[3] & 0x3F);
+    if (codepoint < 0x10000 || codepoint > 0x10FFFF)
+      return 0; /* overlong or beyond Unicode */
+    return 4;
+  }
+  return 0;
+}
+
+/* Encode a valid non-ASCII code point as UTF-8 at out, returns the end of the sequence */
+inline char* EncodeUtf8(uint32_t codepoint, char* out)
+{
+  if (codepoint < 0x800)
+  {
+    *out++ = (char)(0xC0 | (codepoint >> 6));
+  }
+  else if (codepoint < 0x10000)
+  {
+    *out++ = (char)(0xE0 | (codepoint >> 12));
+    *out++ = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+  }
+  else
+  {
+    *out++ = (char)(0xF0 | (codepoint >> 18));
+    *out++ = (char)(0x80 | ((codepoint >> 12) & 0x3F));
+    *out++ = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+  }
+  *out++ = (char)(0x80 | (codepoint & 0x3F));
+  return out;
+}
+
+inline bool IsValidCodepoint(uint32_t codepoint)
+{
+  return codepoint <= 0x10FFFF && (codepoint < 0xD800 || codepoint > 0xDFFF);
+}
+
+/* Widen the run of ASCII characters at the start of [p, end) into out.
+   Returns the number of characters copied */
+template<class CHAR>
+inline size_t WidenAscii(const uint8_t* p, const uint8_t* end, CHAR* out)
+{
+  const size_t len = end - p;
+  size_t pos = 0;
+#if defined(HAVE_SSE2) && defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  while (len - pos >= 16)
+  {
+    const __m128i bytes = _mm_loadu_si128((const __m128i*)(p + pos));
+    if (_mm_movemask_epi8(bytes) != 0)
+      break;
+    const __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+    const __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+    if (sizeof(CHAR) == 2)
+    {
+      _mm_storeu_si128((__m128i*)(out + pos), lo);
+      _mm_storeu_si128((__m128i*)(out + pos + 8), hi);
+    }
+    else
+    {
+      _mm_storeu_si128((__m128i*)(out + pos), _mm_unpacklo_epi16(lo, zero));
+      _mm_storeu_si128((__m128i*)(out + pos + 4), _mm_unpackhi_epi16(lo, zero));
+      _mm_storeu_si128((__m128i*)(out + pos + 8), _mm_unpacklo_epi16(hi, zero));
+      _mm_storeu_si128((__m128i*)(out + pos + 12), _mm_unpackhi_epi16(hi, zero));
+    }
+    pos += 16;
+  }
+#else
+  while (len - pos >= 8)
+  {
+    uint64_t word;
+    memcpy(&word, p + pos, sizeof(word));
+    if (word & 0x8080808080808080ULL)
+      break;
+    for (size_t i = 0; i < 8; i++)
+      out[pos + i] = p[pos + i];
+    pos += 8;
+  }
+#endif
+  while (pos < len && p[pos] < 0x80)
+  {
+    out[pos] = p[pos];
+    pos++;
+  }
+  return pos;
+}
+
+/* Narrow the run of ASCII characters at the start of [p, end) into out.
+   Returns the number of characters copied */
+template<class CHAR>
+inline size_t NarrowAscii(const CHAR* p, const CHAR* end, char* out)
+{
+  const size_t len = end - p;
+  size_t pos = 0;
+#if defined(HAVE_SSE2) && defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  if (sizeof(CHAR) == 2)
+  {
+    const __m128i nonAscii = _mm_set1_epi16((short)0xFF80);
+    while (len - pos >= 16)
+    {
+      const __m128i a = _mm_loadu_si128((const __m128i*)(p + pos));
+      const __m128i b = _mm_loadu_si128((const __m128i*)(p + pos + 8));
+      const __m128i high = _mm_and_si128(_mm_or_si128(a, b), nonAscii);
+      if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, zero)) != 0xFFFF)
+        break;
+      _mm_storeu_si128((__m128i*)(out + pos), _mm_packus_epi16(a, b));
+      pos += 16;
+    }
+  }
+  else
+  {
+    const __m128i nonAscii = _mm_set1_epi32((int)0xFFFFFF80);
+    while (len - pos >= 16)
+    {
+      const __m128i a = _mm_loadu_si128((const __m128i*)(p + pos));
+      const __m128i b = _mm_loadu_si128((const __m128i*)(p + pos + 4));
+      const __m128i c = _mm_loadu_si128((const __m128i*)(p + pos + 8));
+      const __m128i d = _mm_loadu_si128((const __m128i*)(p + pos + 12));
+      const __m128i high = _mm_and_si128(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d)), nonAscii);
+      if (_mm_movemask_epi8(_mm_cmpeq_epi32(high, zero)) != 0xFFFF)
+        break;
+      _mm_storeu_si128((__m128i*)(out + pos), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+      pos += 16;
+    }
+  }
+#endif
+  while (pos < len && (uint32_t)p[pos] < 0x80)
+  {
+    out[pos] = (char)p[pos];
+    pos++;
+  }
+  return pos;
+}
+
+} // unnamed namespace
 
 
 CUtf8Utils::utf8CheckResult CUtf8Utils::checkStrForUtf8(const std::string& str)
@@ -158,3 +338,201 @@ inline size_t CUtf8Utils::SizeOfUtf8Char(const char* const str)
 
   return 0; // invalid UTF-8 char sequence
 }
+
+template<class UTF32STRING>
+bool CUtf8Utils::Utf8ToUtf32(const std::string& utf8StringSrc, UTF32STRING& utf32StringDst, bool failOnBadChar)
+{
+  typedef typename UTF32STRING::value_type CHAR;
+
+  utf32StringDst.clear();
+  if (utf8StringSrc.empty())
+    return true;
+
+  /* every byte decodes to at most one character */
+  utf32StringDst.resize(utf8StringSrc.length());
+  const uint8_t* p = (const uint8_t*)utf8StringSrc.data();
+  const uint8_t* const end = p + utf8StringSrc.length();
+  CHAR* const start = &utf32StringDst[0];
+  CHAR* out = start;
+
+  while (p < end)
+  {
+    const size_t ascii = WidenAscii(p, end, out);
+    p += ascii;
+    out += ascii;
+    if (p == end)
+      break;
+
+    uint32_t codepoint;
+    const size_t chrLen = DecodeUtf8(p, end, codepoint);
+    if (chrLen == 0)
+    {
+      if (failOnBadChar)
+      {
+        utf32StringDst.clear();
+        return false;
+      }
+      p++; // skip invalid byte
+      continue;
+    }
+    *out++ = (CHAR)codepoint;
+    p += chrLen;
+  }
+
+  utf32StringDst.resize(out - start);
+  return true;
+}
+
+template<class UTF32STRING>
+bool CUtf8Utils::Utf32ToUtf8(const UTF32STRING& utf32StringSrc, std::string& utf8StringDst, bool failOnBadChar)
+{
+  typedef typename UTF32STRING::value_type CHAR;
+
+  utf8StringDst.clear();
+  if (utf32StringSrc.empty())
+    return true;
+
+  // size the output exactly, clearing a worst case of four bytes per character costs more
+  const CHAR* p = utf32StringSrc.data();
+  const CHAR* const end = p + utf32StringSrc.length();
+  size_t length = 0;
+  for (const CHAR* c = p; c < end; ++c)
+  {
+    const uint32_t codepoint = (uint32_t)*c;
+    length += codepoint < 0x80 ? 1 : codepoint < 0x800 ? 2 : codepoint < 0x10000 ? 3 : 4;
+  }
+  utf8StringDst.resize(length);
+  char* const start = &utf8StringDst[0];
+  char* out = start;
+
+  while (p < end)
+  {
+    const size_t ascii = NarrowAscii(p, end, out);
+    p += ascii;
+    out += ascii;
+    if (p == end)
+      break;
+
+    const uint32_t codepoint = (uint32_t)*p++;
+    if (!IsValidCodepoint(codepoint))
+    {
+      if (failOnBadChar)
+      {
+        utf8StringDst.clear();
+        return false;
+      }
+      continue; // skip invalid character
+    }
+    out = EncodeUtf8(codepoint, out);
+  }
+
+  utf8StringDst.resize(out - start);
+  return true;
+}
+
+template<class UTF16STRING>
+bool CUtf8Utils::Utf8ToUtf16(const std::string& utf8StringSrc, UTF16STRING& utf16StringDst, bool failOnBadChar)
+{
+  typedef typename UTF16STRING::value_type CHAR;
+
+  utf16StringDst.clear();
+  if (utf8StringSrc.empty())
+    return true;
+
+  /* every byte decodes to at most one code unit, 4 bytes sequences to a surrogate pair */
+  utf16StringDst.resize(utf8StringSrc.length());
+  const uint8_t* p = (const uint8_t*)utf8StringSrc.data();
+  const uint8_t* const end = p + utf8StringSrc.length();
+  CHAR* const start = &utf16StringDst[0];
+  CHAR* out = start;
+
+  while (p < end)
+  {
+    const size_t ascii = WidenAscii(p, end, out);
+    p += ascii;
+    out += ascii;
+    if (p == end)
+      break;
+
+    uint32_t codepoint;
+    const size_t chrLen = DecodeUtf8(p, end, codepoint);
+    if (chrLen == 0)
+    {
+      if (failOnBadChar)
+      {
+        utf16StringDst.clear();
+        return false;
+      }
+      p++; // skip invalid byte
+      continue;
+    }
+    if (codepoint >= 0x10000)
+    {
+      codepoint -= 0x10000;
+      *out++ = (CHAR)(0xD800 + (codepoint >> 10));
+      *out++ = (CHAR)(0xDC00 + (codepoint & 0x3FF));
+    }
+    else
+      *out++ = (CHAR)codepoint;
+    p += chrLen;
+  }
+
+  utf16StringDst.resize(out - start);
+  return true;
+}
+
+template<class UTF16STRING>
+bool CUtf8Utils::Utf16ToUtf8(const UTF16STRING& utf16StringSrc, std::string& utf8StringDst, bool failOnBadChar)
+{
+  typedef typename UTF16STRING::value_type CHAR;
+
+  utf8StringDst.clear();
+  if (utf16StringSrc.empty())
+    return true;
+
+  utf8StringDst.resize(utf16StringSrc.length() * 3);
+  const CHAR* p = utf16StringSrc.data();
+  const CHAR* const end = p + utf16StringSrc.length();
+  char* const start = &utf8StringDst[0];
+  char* out = start;
+
+  while (p < end)
+  {
+    const size_t ascii = NarrowAscii(p, end, out);
+    p += ascii;
+    out += ascii;
+    if (p == end)
+      break;
+
+    uint32_t codepoint = (uint16_t)*p++;
+    if (codepoint >= 0xD800 && codepoint <= 0xDFFF)
+    {
+      const uint32_t low = p < end ? (uint16_t)*p : 0;
+      if (codepoint <= 0xDBFF && low >= 0xDC00 && low <= 0xDFFF)
+      {
+        codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+        p++;
+      }
+      else if (failOnBadChar)
+      {
+        utf8StringDst.clear();
+        return false;
+      }
+      else
+        continue; // skip unpaired surrogate
+    }
+    out = EncodeUtf8(codepoint, out);
+  }
+
+  utf8StringDst.resize(out - start);
+  return true;
+}
+
+template bool CUtf8Utils::Utf8ToUtf32(const std::string& utf8StringSrc, std::u32string& utf32StringDst, bool failOnBadChar);
+template bool CUtf8Utils::Utf8ToUtf32(const std::string& utf8StringSrc, std::wstring& utf32StringDst, bool failOnBadChar);
+template bool CUtf8Utils::Utf32ToUtf8(const std::u32string& utf32StringSrc, std::string& utf8StringDst, bool failOnBadChar);
+template bool CUtf8Utils::Utf32ToUtf8(const std::wstring& utf32StringSrc, std::string& utf8StringDst, bool failOnBadChar);
+template bool CUtf8Utils::Utf8ToUtf16(const std::string& utf8StringSrc, std::u16string& utf16StringDst, bool failOnBadChar);
+template bool CUtf8Utils::Utf8ToUtf16(const std::string& utf8StringSrc, std::wstring& utf16StringDst, bool failOnBadChar);
+template bool CUtf8Utils::Utf16ToUtf8(const std::u16string& utf16StringSrc, std::string& utf8StringDst, bool failOnBadChar);
+template bool CUtf8Utils::Utf16ToUtf8(const std::wstring& utf16StringSrc, std::string& utf8StringDst, bool failOnBadChar);
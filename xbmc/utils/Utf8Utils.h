@@ -50,6 +50,37 @@ public:
   static size_t RFindValidUtf8Char(const std::string& str, const size_t startPos);
   
   static size_t SizeOfUtf8Char(const std::string& str, const size_t charStart = 0);
+
+  /**
+   * Convert UTF-8 to UTF-32 without iconv.
+   * Overlong sequences, surrogates and code points above U+10FFFF are invalid. Like iconv, invalid
+   * input is skipped byte by byte unless failOnBadChar is set. Runs of ASCII are converted with SSE2
+   * where available.
+   * @param utf8StringSrc       is source UTF-8 string to convert
+   * @param utf32StringDst      is output UTF-32 string (std::u32string, or std::wstring with 4 byte wchar_t)
+   * @param failOnBadChar       if set to true function will fail on invalid character,
+   *                            otherwise invalid character will be skipped
+   * @return true on successful conversion, false on any error
+   */
+  template<class UTF32STRING>
+  static bool Utf8ToUtf32(const std::string& utf8StringSrc, UTF32STRING& utf32StringDst, bool failOnBadChar);
+  /**
+   * Convert UTF-32 to UTF-8 without iconv, see Utf8ToUtf32().
+   */
+  template<class UTF32STRING>
+  static bool Utf32ToUtf8(const UTF32STRING& utf32StringSrc, std::string& utf8StringDst, bool failOnBadChar);
+  /**
+   * Convert UTF-8 to native endian UTF-16 without iconv, see Utf8ToUtf32().
+   * @param utf16StringDst      is output UTF-16 string (std::u16string, or std::wstring with 2 byte wchar_t)
+   */
+  template<class UTF16STRING>
+  static bool Utf8ToUtf16(const std::string& utf8StringSrc, UTF16STRING& utf16StringDst, bool failOnBadChar);
+  /**
+   * Convert native endian UTF-16 to UTF-8 without iconv, see Utf8ToUtf32(). Unpaired surrogates are invalid.
+   */
+  template<class UTF16STRING>
+  static bool Utf16ToUtf8(const UTF16STRING& utf16StringSrc, std::string& utf8StringDst, bool failOnBadChar);
+
 private:
   static size_t SizeOfUtf8Char(const char* const str);
 };
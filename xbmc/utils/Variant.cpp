@@ -20,6 +20,7 @@
 
 #include "Variant.h"
 
+#include <atomic>
 #include <stdlib.h>
 #include <string.h>
 #include <sstream>
@@ -129,6 +130,47 @@ double str2double(const std::wstring &str, double fallback /* = 0.0 */)
   return fallback;
 }
 
+template<class T>
+struct CVariant::Payload
+{
+  Payload() : references(1) { }
+  explicit Payload(const T &other) : references(1), value(other) { }
+  explicit Payload(T &&other) : references(1), value(std::move(other)) { }
+
+  std::atomic<unsigned int> references;
+  T value;
+};
+
+namespace
+{
+template<class PAYLOAD>
+PAYLOAD *sharePayload(PAYLOAD *payload)
+{
+  payload->references++;
+  return payload;
+}
+
+template<class PAYLOAD>
+void releasePayload(PAYLOAD *payload)
+{
+  if (--payload->references == 0)
+    delete payload;
+}
+
+// make sure the payload isn't shared before it is changed
+template<class PAYLOAD>
+PAYLOAD *unsharePayload(PAYLOAD *&payload)
+{
+  if (payload->references != 1)
+  {
+    PAYLOAD *copy = new PAYLOAD(payload->value);
+    releasePayload(payload);
+    payload = copy;
+  }
+  return payload;
+}
+}
+
 CVariant::CVariant()
   : CVariant(VariantTypeNull)
 {
@@ -155,10 +197,10 @@ CVariant::CVariant(VariantType type)
       m_data.dvalue = 0.0;
       break;
     case VariantTypeString:
-      m_data.string = new std::string();
+      setString("", 0);
       break;
     case VariantTypeWideString:
-      m_data.wstring = new std::wstring();
+      m_data.wstring = new Payload<std::wstring>();
       break;
     case VariantTypeArray:
       m_data.array = new VariantArray();
@@ -216,50 +258,47 @@ CVariant::CVariant(bool boolean)
 
 CVariant::CVariant(const char *str)
 {
-  m_type = VariantTypeString;
-  m_data.string = new std::string(str);
+  setString(str, strlen(str));
 }
 
 CVariant::CVariant(const char *str, unsigned int length)
 {
-  m_type = VariantTypeString;
-  m_data.string = new std::string(str, length);
+  setString(str, length);
 }
 
 CVariant::CVariant(const std::string &str)
 {
-  m_type = VariantTypeString;
-  m_data.string = new std::string(str);
+  setString(str.c_str(), str.length());
 }
 
 CVariant::CVariant(std::string &&str)
 {
   m_type = VariantTypeString;
-  m_data.string = new std::string(std::move(str));
+  m_data.string = new Payload<std::string>(std::move(str));
 }
 
 CVariant::CVariant(const wchar_t *str)
 {
   m_type = VariantTypeWideString;
-  m_data.wstring = new std::wstring(str);
+  m_data.wstring = new Payload<std::wstring>(std::wstring(str));
 }
 
 CVariant::CVariant(const wchar_t *str, unsigned int length)
 {
   m_type = VariantTypeWideString;
-  m_data.wstring = new std::wstring(str, length);
+  m_data.wstring = new Payload<std::wstring>(std::wstring(str, length));
 }
 
 CVariant::CVariant(const std::wstring &str)
 {
   m_type = VariantTypeWideString;
-  m_data.wstring = new std::wstring(str);
+  m_data.wstring = new Payload<std::wstring>(str);
 }
 
 CVariant::CVariant(std::wstring &&str)
 {
   m_type = VariantTypeWideString;
-  m_data.wstring = new std::wstring(std::move(str));
+  m_data.wstring = new Payload<std::wstring>(std::move(str));
 }
 
 CVariant::CVariant(const std::vector<std::string> &strArray)
@@ -287,11 +326,29 @@ CVariant::CVariant(const std::map<std::string, CVariant> &variantMap)
 
 CVariant::CVariant(const CVariant &variant)
 {
-  m_type = VariantTypeNull;
-  *this = variant;
+  m_type = variant.m_type;
+  m_data = variant.m_data;
+
+  switch (m_type)
+  {
+  case VariantTypeString:
+    m_data.string = sharePayload(variant.m_data.string);
+    break;
+  case VariantTypeWideString:
+    m_data.wstring = sharePayload(variant.m_data.wstring);
+    break;
+  case VariantTypeArray:
+    m_data.array = new VariantArray(*variant.m_data.array);
+    break;
+  case VariantTypeObject:
+    m_data.map = new VariantMap(*variant.m_data.map);
+    break;
+  default:
+    break;
+  }
 }
 
-CVariant::CVariant(CVariant&& rhs)
+CVariant::CVariant(CVariant&& rhs) noexcept
 {
   //Set this so that operator= don't try and run cleanup
   //when we're not initialized.
@@ -310,23 +367,19 @@ void CVariant::cleanup()
   switch (m_type)
   {
   case VariantTypeString:
-    delete m_data.string;
-    m_data.string = nullptr;
+    releasePayload(m_data.string);
     break;
 
   case VariantTypeWideString:
-    delete m_data.wstring;
-    m_data.wstring = nullptr;
+    releasePayload(m_data.wstring);
     break;
 
   case VariantTypeArray:
     delete m_data.array;
-    m_data.array = nullptr;
     break;
 
   case VariantTypeObject:
     delete m_data.map;
-    m_data.map = nullptr;
     break;
   default:
     break;
@@ -334,6 +387,12 @@ void CVariant::cleanup()
   m_type = VariantTypeNull;
 }
 
+void CVariant::setString(const char *str, size_t length)
+{
+  m_type = VariantTypeString;
+  m_data.string = new Payload<std::string>(std::string(str, length));
+}
+
 bool CVariant::isInteger() const
 {
   return m_type == VariantTypeInteger;
@@ -395,9 +454,9 @@ int64_t CVariant::asInteger(int64_t fallback) const
     case VariantTypeDouble:
       return (int64_t)m_data.dvalue;
     case VariantTypeString:
-      return str2int64(*m_data.string, fallback);
+      return str2int64(m_data.string->value, fallback);
     case VariantTypeWideString:
-      return str2int64(*m_data.wstring, fallback);
+      return str2int64(m_data.wstring->value, fallback);
     default:
       return fallback;
   }
@@ -416,9 +475,9 @@ uint64_t CVariant::asUnsignedInteger(uint64_t fallback) const
     case VariantTypeDouble:
       return (uint64_t)m_data.dvalue;
     case VariantTypeString:
-      return str2uint64(*m_data.string, fallback);
+      return str2uint64(m_data.string->value, fallback);
     case VariantTypeWideString:
-      return str2uint64(*m_data.wstring, fallback);
+      return str2uint64(m_data.wstring->value, fallback);
     default:
       return fallback;
   }
@@ -437,9 +496,9 @@ double CVariant::asDouble(double fallback) const
     case VariantTypeUnsignedInteger:
       return (double)m_data.unsignedinteger;
     case VariantTypeString:
-      return str2double(*m_data.string, fallback);
+      return str2double(m_data.string->value, fallback);
     case VariantTypeWideString:
-      return str2double(*m_data.wstring, fallback);
+      return str2double(m_data.wstring->value, fallback);
     default:
       return fallback;
   }
@@ -458,9 +517,9 @@ float CVariant::asFloat(float fallback) const
     case VariantTypeUnsignedInteger:
       return (float)m_data.unsignedinteger;
     case VariantTypeString:
-      return (float)str2double(*m_data.string, fallback);
+      return (float)str2double(m_data.string->value, fallback);
     case VariantTypeWideString:
-      return (float)str2double(*m_data.wstring, fallback);
+      return (float)str2double(m_data.wstring->value, fallback);
     default:
       return fallback;
   }
@@ -481,11 +540,11 @@ bool CVariant::asBoolean(bool fallback) const
     case VariantTypeDouble:
       return (m_data.dvalue != 0);
     case VariantTypeString:
-      if (m_data.string->empty() || m_data.string->compare("0") == 0 || m_data.string->compare("false") == 0)
+      if (m_data.string->value.empty() || m_data.string->value.compare("0") == 0 || m_data.string->value.compare("false") == 0)
         return false;
       return true;
     case VariantTypeWideString:
-      if (m_data.wstring->empty() || m_data.wstring->compare(L"0") == 0 || m_data.wstring->compare(L"false") == 0)
+      if (m_data.wstring->value.empty() || m_data.wstring->value.compare(L"0") == 0 || m_data.wstring->value.compare(L"false") == 0)
         return false;
       return true;
     default:
@@ -500,7 +559,7 @@ std::string CVariant::asString(const std::string &fallback /* = "" */) const
   switch (m_type)
   {
     case VariantTypeString:
-      return *m_data.string;
+      return m_data.string->value;
     case VariantTypeBoolean:
       return m_data.boolean ? "true" : "false";
     case VariantTypeInteger:
@@ -528,7 +587,7 @@ std::wstring CVariant::asWideString(const std::wstring &fallback /* = L"" */) co
   switch (m_type)
   {
     case VariantTypeWideString:
-      return *m_data.wstring;
+      return m_data.wstring->value;
     case VariantTypeBoolean:
       return m_data.boolean ? L"true" : L"false";
     case VariantTypeInteger:
@@ -565,6 +624,20 @@ CVariant &CVariant::operator[](const std::string &key)
     return ConstNullVariant;
 }
 
+CVariant &CVariant::operator[](std::string &&key)
+{
+  if (m_type == VariantTypeNull)
+  {
+    m_type = VariantTypeObject;
+    m_data.map = new VariantMap;
+  }
+
+  if (m_type == VariantTypeObject)
+    return (*m_data.map)[std::move(key)];
+  else
+    return ConstNullVariant;
+}
+
 const CVariant &CVariant::operator[](const std::string &key) const
 {
   VariantMap::const_iterator it;
@@ -595,67 +668,27 @@ CVariant &CVariant::operator=(const CVariant &rhs)
   if (m_type == VariantTypeConstNull || this == &rhs)
     return *this;
 
-  cleanup();
-
-  m_type = rhs.m_type;
-
-  switch (m_type)
-  {
-  case VariantTypeInteger:
-    m_data.integer = rhs.m_data.integer;
-    break;
-  case VariantTypeUnsignedInteger:
-    m_data.unsignedinteger = rhs.m_data.unsignedinteger;
-    break;
-  case VariantTypeBoolean:
-    m_data.boolean = rhs.m_data.boolean;
-    break;
-  case VariantTypeDouble:
-    m_data.dvalue = rhs.m_data.dvalue;
-    break;
-  case VariantTypeString:
-    m_data.string = new std::string(*rhs.m_data.string);
-    break;
-  case VariantTypeWideString:
-    m_data.wstring = new std::wstring(*rhs.m_data.wstring);
-    break;
-  case VariantTypeArray:
-    m_data.array = new VariantArray(rhs.m_data.array->begin(), rhs.m_data.array->end());
-    break;
-  case VariantTypeObject:
-    m_data.map = new VariantMap(rhs.m_data.map->begin(), rhs.m_data.map->end());
-    break;
-  default:
-    break;
-  }
-
-  return *this;
+  // copy first, rhs may be part of this variant
+  CVariant copy(rhs);
+  return *this = std::move(copy);
 }
 
-CVariant& CVariant::operator=(CVariant&& rhs)
+CVariant& CVariant::operator=(CVariant&& rhs) noexcept
 {
   if (m_type == VariantTypeConstNull || this == &rhs)
     return *this;
 
+  // take over rhs before cleaning up, rhs may be part of this variant
+  const VariantType type = rhs.m_type;
+  const VariantUnion data = rhs.m_data;
+  rhs.m_type = VariantTypeNull;
+
   //Make sure that if we're moved into we don't leak any pointers
   if (m_type != VariantTypeNull)
     cleanup();
 
-  m_type = rhs.m_type;
-  m_data = std::move(rhs.m_data);
-
-  //Should be enough to just set m_type here
-  //but better safe than sorry, could probably lead to coverity warnings
-  if (rhs.m_type == VariantTypeString)
-    rhs.m_data.string = nullptr;
-  else if (rhs.m_type == VariantTypeWideString)
-    rhs.m_data.wstring = nullptr;
-  else if (rhs.m_type == VariantTypeArray)
-    rhs.m_data.array = nullptr;
-  else if (rhs.m_type == VariantTypeObject)
-    rhs.m_data.map = nullptr;
-
-  rhs.m_type = VariantTypeNull;
+  m_type = type;
+  m_data = data;
 
   return *this;
 }
@@ -675,9 +708,9 @@ bool CVariant::operator==(const CVariant &rhs) const
     case VariantTypeDouble:
       return m_data.dvalue == rhs.m_data.dvalue;
     case VariantTypeString:
-      return *m_data.string == *rhs.m_data.string;
+      return m_data.string == rhs.m_data.string || m_data.string->value == rhs.m_data.string->value;
     case VariantTypeWideString:
-      return *m_data.wstring == *rhs.m_data.wstring;
+      return m_data.wstring == rhs.m_data.wstring || m_data.wstring->value == rhs.m_data.wstring->value;
     case VariantTypeArray:
       return *m_data.array == *rhs.m_data.array;
     case VariantTypeObject:
@@ -692,14 +725,7 @@ bool CVariant::operator==(const CVariant &rhs) const
 
 void CVariant::push_back(const CVariant &variant)
 {
-  if (m_type == VariantTypeNull)
-  {
-    m_type = VariantTypeArray;
-    m_data.array = new VariantArray;
-  }
-
-  if (m_type == VariantTypeArray)
-    m_data.array->push_back(variant);
+  push_back(CVariant(variant));
 }
 
 void CVariant::push_back(CVariant &&variant)
@@ -727,15 +753,15 @@ void CVariant::append(CVariant&& variant)
 const char *CVariant::c_str() const
 {
   if (m_type == VariantTypeString)
-    return m_data.string->c_str();
+    return m_data.string->value.c_str();
   else
     return NULL;
 }
 
 void CVariant::swap(CVariant &rhs)
 {
-  VariantType  temp_type = m_type;
-  VariantUnion temp_data = m_data;
+  VariantType   temp_type = m_type;
+  VariantUnion  temp_data = m_data;
 
   m_type = rhs.m_type;
   m_data = rhs.m_data;
@@ -815,9 +841,9 @@ unsigned int CVariant::size() const
   else if (m_type == VariantTypeArray)
     return m_data.array->size();
   else if (m_type == VariantTypeString)
-    return m_data.string->size();
+    return m_data.string->value.size();
   else if (m_type == VariantTypeWideString)
-    return m_data.wstring->size();
+    return m_data.wstring->value.size();
   else
     return 0;
 }
@@ -829,9 +855,9 @@ bool CVariant::empty() const
   else if (m_type == VariantTypeArray)
     return m_data.array->empty();
   else if (m_type == VariantTypeString)
-    return m_data.string->empty();
+    return m_data.string->value.empty();
   else if (m_type == VariantTypeWideString)
-    return m_data.wstring->empty();
+    return m_data.wstring->value.empty();
   else if (m_type == VariantTypeNull)
     return true;
 
@@ -845,9 +871,9 @@ void CVariant::clear()
   else if (m_type == VariantTypeArray)
     m_data.array->clear();
   else if (m_type == VariantTypeString)
-    m_data.string->clear();
+    unsharePayload(m_data.string)->value.clear();
   else if (m_type == VariantTypeWideString)
-    m_data.wstring->clear();
+    unsharePayload(m_data.wstring)->value.clear();
 }
 
 void CVariant::erase(const std::string &key)
@@ -870,7 +896,9 @@ void CVariant::erase(unsigned int position)
   }
 
   if (m_type == VariantTypeArray && position < size())
+  {
     m_data.array->erase(m_data.array->begin() + position);
+  }
 }
 
 bool CVariant::isMember(const std::string &key) const
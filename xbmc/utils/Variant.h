@@ -69,7 +69,7 @@ public:
   CVariant(const std::map<std::string, std::string> &strMap);
   CVariant(const std::map<std::string, CVariant> &variantMap);
   CVariant(const CVariant &variant);
-  CVariant(CVariant &&rhs);
+  CVariant(CVariant &&rhs) noexcept;
   ~CVariant();
 
 
@@ -95,12 +95,13 @@ public:
   float asFloat(float fallback = 0.0f) const;
 
   CVariant &operator[](const std::string &key);
+  CVariant &operator[](std::string &&key);
   const CVariant &operator[](const std::string &key) const;
   CVariant &operator[](unsigned int position);
   const CVariant &operator[](unsigned int position) const;
 
   CVariant &operator=(const CVariant &rhs);
-  CVariant &operator=(CVariant &&rhs);
+  CVariant &operator=(CVariant &&rhs) noexcept;
   bool operator==(const CVariant &rhs) const;
   bool operator!=(const CVariant &rhs) const { return !(*this == rhs); }
 
@@ -145,15 +146,21 @@ public:
   static CVariant ConstNullVariant;
 
 private:
+  /* Strings are shared between copies until one of them is changed. Nothing hands out a
+     reference into a string that allows changes, so a changed string is never seen by copies. */
+  template<class T> struct Payload;
+
   void cleanup();
+  void setString(const char *str, size_t length);
+
   union VariantUnion
   {
     int64_t integer;
     uint64_t unsignedinteger;
     bool boolean;
     double dvalue;
-    std::string *string;
-    std::wstring *wstring;
+    Payload<std::string> *string;
+    Payload<std::wstring> *wstring;
     VariantArray *array;
     VariantMap *map;
   };
@@ -25,6 +25,14 @@
 #include "utils/StringUtils.h"
 #include "CompileInfo.h"
 
+#if defined(TARGET_POSIX)
+#include <algorithm>
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#endif
+
 static const char* const levelNames[] =
 {"DEBUG", "INFO", "NOTICE", "WARNING", "ERROR", "SEVERE", "FATAL", "NONE"};
 
@@ -35,6 +43,103 @@ static const char* const logLevelNames[] =
 // s_globals is used as static global with CLog global variables
 #define s_globals XBMC_GLOBAL_USE(CLog).m_globalInstance
 
+// how long the writer waits for more lines before writing out the ones it has
+#define LOG_WRITE_INTERVAL 100
+
+class CLogWriter : public CThread
+{
+public:
+  CLogWriter() : CThread("LogWriter") {}
+
+#if defined(TARGET_POSIX)
+  /*! Writes the queued lines out with write(2) from a static buffer, as only async-signal-safe calls
+   may be made here. Lines are read in place, so a thread popping them mustn't move them meanwhile.
+   */
+  static void OnCrash(int signum);
+  static void AppendCrashLine(const std::string& line, void *context);
+  static void WriteCrashBuffer(int fd);
+#endif
+
+protected:
+  virtual void Process()
+  {
+    while (!m_bStop)
+    {
+      CLog::WriteQueuedLines();
+      s_globals.m_wake.WaitMSec(LOG_WRITE_INTERVAL);
+    }
+    CLog::WriteQueuedLines();
+  }
+};
+
+#if defined(TARGET_POSIX)
+static const int crashSignals[] = { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT };
+static struct sigaction previousHandlers[sizeof(crashSignals) / sizeof(crashSignals[0])];
+static bool crashHandlerInstalled = false;
+static char crashBuffer[16384];
+static size_t crashBufferUsed = 0;
+
+void CLogWriter::OnCrash(int signum)
+{
+  // only the first thread to crash writes the lines out, the writer stops popping once it sees this
+  if (!s_globals.m_crashed.exchange(true) && !s_globals.m_popping)
+  {
+    int fd = s_globals.m_crashFd;
+    if (fd >= 0)
+    {
+      crashBufferUsed = 0;
+      s_globals.m_queue.PeekQueuedLines(AppendCrashLine, &fd);
+      WriteCrashBuffer(fd);
+    }
+  }
+
+  // hand the signal on to whoever handled it before us, it's delivered once we return
+  for (size_t i = 0; i < sizeof(crashSignals) / sizeof(crashSignals[0]); i++)
+  {
+    if (crashSignals[i] == signum)
+      sigaction(signum, &previousHandlers[i], NULL);
+  }
+  raise(signum);
+}
+
+void CLogWriter::AppendCrashLine(const std::string& line, void *context)
+{
+  const int fd = *static_cast<int*>(context);
+  const char *data = line.data();
+  size_t size = line.size();
+  while (size > 0)
+  {
+    if (crashBufferUsed == sizeof(crashBuffer))
+      WriteCrashBuffer(fd);
+    const size_t chunk = std::min(size, sizeof(crashBuffer) - crashBufferUsed);
+    memcpy(crashBuffer + crashBufferUsed, data, chunk);
+    crashBufferUsed += chunk;
+    data += chunk;
+    size -= chunk;
+  }
+
+  if (crashBufferUsed == sizeof(crashBuffer))
+    WriteCrashBuffer(fd);
+  crashBuffer[crashBufferUsed++] = '\n';
+}
+
+void CLogWriter::WriteCrashBuffer(int fd)
+{
+  const char *data = crashBuffer;
+  while (crashBufferUsed > 0)
+  {
+    ssize_t written = write(fd, data, crashBufferUsed);
+    if (written < 0 && errno == EINTR)
+      continue;
+    if (written <= 0)
+      break;
+    data += written;
+    crashBufferUsed -= written;
+  }
+  crashBufferUsed = 0;
+}
+#endif
+
 CLog::CLog()
 {}
 
@@ -43,8 +148,32 @@ CLog::~CLog()
 
 void CLog::Close()
 {
+  CLogWriter *writer;
+  {
+    CSingleLock waitLock(s_globals.critSec);
+    s_globals.m_async = false;
+    writer = s_globals.m_writer;
+    s_globals.m_writer = NULL;
+  }
+
+  // the writer logs its exit, so it can't be stopped while holding the lock
+  if (writer)
+  {
+    writer->StopThread(false);
+    s_globals.m_wake.Set();
+    writer->StopThread();
+    delete writer;
+  }
+
+  // a thread that saw m_async set may still be queueing its line
+  while (s_globals.m_pushers > 0)
+    XbmcThreads::ThreadSleep(1);
+
   CSingleLock waitLock(s_globals.critSec);
+  InstallCrashHandler(false);
+  WriteQueuedLines();
   s_globals.m_platform.CloseLogFile();
+  UpdateCrashLogFile();
   s_globals.m_repeatLine.clear();
 }
 
@@ -75,32 +204,106 @@ void CLog::LogFunction(int loglevel, const char* functionName, const char* forma
 
 void CLog::LogString(int logLevel, const std::string& logString)
 {
-  CSingleLock waitLock(s_globals.critSec);
   std::string strData(logString);
   StringUtils::TrimRight(strData);
-  if (!strData.empty())
+  if (strData.empty())
+    return;
+
+  CLogQueue::Entry entry;
+  FormatLine(logLevel, strData, entry);
+
+  s_globals.m_pushers++;
+  if (s_globals.m_async)
   {
-    if (s_globals.m_repeatLogLevel == logLevel && s_globals.m_repeatLine == strData)
-    {
-      s_globals.m_repeatCount++;
+    QueueLine(entry);
+    // the reason for a crash or an exit has to be on disk before we carry on
+    if ((logLevel & LOGMASK) >= LOGSEVERE)
+      Flush();
+    s_globals.m_pushers--;
+    return;
+  }
+  s_globals.m_pushers--;
+
+  CSingleLock waitLock(s_globals.critSec);
+  std::string batch;
+  AppendLogLine(entry, batch);
+  if (!batch.empty())
+    WriteLogBatch(batch);
+}
+
+void CLog::QueueLine(CLogQueue::Entry& entry)
+{
+  const uint64_t threadId = (uint64_t)CThread::GetCurrentThreadId();
+  bool nearlyFull = false;
+  while (!s_globals.m_queue.Push(entry, threadId, nearlyFull))
+  {
+    // nothing is popped once the crash handler ran, the process is going down anyway
+    if (s_globals.m_crashed)
       return;
-    }
-    else if (s_globals.m_repeatCount)
-    {
-      std::string strData2 = StringUtils::Format("Previous line repeats %d times.",
-                                                s_globals.m_repeatCount);
-      PrintDebugString(strData2);
-      WriteLogString(s_globals.m_repeatLogLevel, strData2);
-      s_globals.m_repeatCount = 0;
-    }
+    // the writer has fallen behind, write the queued lines out ourselves rather than drop any
+    WriteQueuedLines();
+  }
+  if (nearlyFull)
+    s_globals.m_wake.Set();
+}
+
+void CLog::Flush()
+{
+  WriteQueuedLines();
+}
+
+bool CLog::WriteQueuedLines()
+{
+  CSingleLock waitLock(s_globals.critSec);
 
-    s_globals.m_repeatLine = strData;
-    s_globals.m_repeatLogLevel = logLevel;
+  // the crash handler reads the queued lines in place, leave them to it once it ran
+  s_globals.m_popping = true;
+  if (s_globals.m_crashed)
+  {
+    s_globals.m_popping = false;
+    return false;
+  }
 
-    PrintDebugString(strData);
+  // limit the batch to what was queued when we started, so busy loggers can't keep us here
+  CLogQueue::Entry entry;
+  std::string batch;
+  for (size_t i = 0; i < CLogQueue::BufferCount * CLogQueue::BufferSize && s_globals.m_queue.Pop(entry); i++)
+    AppendLogLine(entry, batch);
+  s_globals.m_popping = false;
+
+  if (batch.empty())
+    return false;
+  return WriteLogBatch(batch);
+}
 
-    WriteLogString(logLevel, strData);
+void CLog::AppendLogLine(const CLogQueue::Entry& entry, std::string& batch)
+{
+  if (s_globals.m_repeatLogLevel == entry.level &&
+      entry.line.compare(entry.prefixLength, std::string::npos, s_globals.m_repeatLine) == 0)
+  {
+    s_globals.m_repeatCount++;
+    return;
+  }
+  else if (s_globals.m_repeatCount)
+  {
+    CLogQueue::Entry repeat;
+    FormatLine(s_globals.m_repeatLogLevel, StringUtils::Format("Previous line repeats %d times.",
+                                                               s_globals.m_repeatCount), repeat);
+    PrintDebugString(repeat.line.substr(repeat.prefixLength));
+    if (!batch.empty())
+      batch += '\n';
+    batch += repeat.line;
+    s_globals.m_repeatCount = 0;
   }
+
+  s_globals.m_repeatLine.assign(entry.line, entry.prefixLength, std::string::npos);
+  s_globals.m_repeatLogLevel = entry.level;
+
+  PrintDebugString(s_globals.m_repeatLine);
+
+  if (!batch.empty())
+    batch += '\n';
+  batch += entry.line;
 }
 
 bool CLog::Init(const std::string& path)
@@ -112,7 +315,21 @@ bool CLog::Init(const std::string& path)
 
   std::string appName = CCompileInfo::GetAppName();
   StringUtils::ToLower(appName);
-  return s_globals.m_platform.OpenLogFile(path + appName + ".log", path + appName + ".old.log");
+  s_globals.m_logFile = path + appName + ".log";
+  s_globals.m_oldLogFile = path + appName + ".old.log";
+  if (!s_globals.m_platform.OpenLogFile(s_globals.m_logFile, s_globals.m_oldLogFile))
+    return false;
+  s_globals.m_logSize = 3; // BOM
+  UpdateCrashLogFile();
+
+  if (!s_globals.m_writer)
+  {
+    s_globals.m_writer = new CLogWriter();
+    s_globals.m_writer->Create();
+    InstallCrashHandler(true);
+    s_globals.m_async = true;
+  }
+  return true;
 }
 
 void CLog::MemDump(char *pData, int length)
@@ -169,6 +386,12 @@ void CLog::SetExtraLogLevels(int level)
   s_globals.m_extraLogLevels = level;
 }
 
+void CLog::SetMaxLogSize(uint64_t bytes)
+{
+  CSingleLock waitLock(s_globals.critSec);
+  s_globals.m_maxLogSize = bytes;
+}
+
 bool CLog::IsLogLevelLogged(int loglevel)
 {
   const int extras = (loglevel & ~LOGMASK);
@@ -196,25 +419,77 @@ void CLog::PrintDebugString(const std::string& line)
 #endif // defined(_DEBUG) || defined(PROFILE)
 }
 
-bool CLog::WriteLogString(int logLevel, const std::string& logString)
+void CLog::FormatLine(int logLevel, const std::string& logString, CLogQueue::Entry& entry)
 {
   static const char* prefixFormat = "%02d:%02d:%02d.%03d T:%" PRIu64" %7s: ";
 
-  std::string strData(logString);
+  int hour, minute, second;
+  double millisecond;
+  PlatformInterfaceForCLog::GetCurrentLocalTime(hour, minute, second, millisecond);
+
+  entry.level = logLevel;
+  entry.line = StringUtils::Format(prefixFormat,
+                                   hour,
+                                   minute,
+                                   second,
+                                   static_cast<int>(millisecond),
+                                   (uint64_t)CThread::GetCurrentThreadId(),
+                                   levelNames[logLevel & LOGMASK]);
+  entry.prefixLength = entry.line.size();
+
   /* fixup newline alignment, number of spaces should equal prefix length */
+  std::string strData(logString);
   StringUtils::Replace(strData, "\n", "\n                                            ");
+  entry.line += strData;
+}
 
-  int hour, minute, second;
-  double millisecond;
-  s_globals.m_platform.GetCurrentLocalTime(hour, minute, second, millisecond);
+bool CLog::WriteLogBatch(const std::string& batch)
+{
+  // start a new file rather than let this batch take the log past the limit
+  if (s_globals.m_maxLogSize > 0 && s_globals.m_logSize > 3 &&
+      s_globals.m_logSize + batch.size() + 1 > s_globals.m_maxLogSize)
+  {
+    s_globals.m_crashFd = -1;
+    s_globals.m_platform.CloseLogFile();
+    if (!s_globals.m_platform.OpenLogFile(s_globals.m_logFile, s_globals.m_oldLogFile))
+      return false;
+    s_globals.m_logSize = 3; // BOM
+    UpdateCrashLogFile();
+  }
 
-  strData = StringUtils::Format(prefixFormat,
-                                  hour,
-                                  minute,
-                                  second,
-                                  static_cast<int>(millisecond),
-                                  (uint64_t)CThread::GetCurrentThreadId(),
-                                  levelNames[logLevel]) + strData;
+  // lines in the batch are separated by newlines, the platform adds the last one
+  if (!s_globals.m_platform.WriteStringToLog(batch))
+    return false;
+  s_globals.m_logSize += batch.size() + 1;
+  return true;
+}
+
+void CLog::UpdateCrashLogFile()
+{
+#if defined(TARGET_POSIX)
+  s_globals.m_crashFd = s_globals.m_platform.GetLogFileDescriptor();
+#endif
+}
 
-  return s_globals.m_platform.WriteStringToLog(strData);
+void CLog::InstallCrashHandler(bool install)
+{
+#if defined(TARGET_POSIX)
+  if (install == crashHandlerInstalled)
+    return;
+
+  for (size_t i = 0; i < sizeof(crashSignals) / sizeof(crashSignals[0]); i++)
+  {
+    if (install)
+    {
+      struct sigaction action = {};
+      action.sa_handler = CLogWriter::OnCrash;
+      action.sa_flags = SA_ONSTACK;
+      sigemptyset(&action.sa_mask);
+      sigaction(crashSignals[i], &action, &previousHandlers[i]);
+    }
+    else
+      sigaction(crashSignals[i], &previousHandlers[i], NULL);
+  }
+  crashHandlerInstalled = install;
+#endif
 }
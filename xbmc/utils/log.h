@@ -30,12 +30,28 @@ typedef class CPosixInterfaceForCLog PlatformInterfaceForCLog;
 typedef class CWin32InterfaceForCLog PlatformInterfaceForCLog;
 #endif
 
+#include <atomic>
+#include <stdint.h>
+
 #include "commons/ilog.h"
 #include "threads/CriticalSection.h"
+#include "threads/Event.h"
 #include "utils/GlobalsHandling.h"
+#include "utils/LogQueue.h"
 
 #include "utils/params_check_macros.h"
 
+class CLogWriter;
+
+/*!
+ \brief Application log.
+
+ Lines are formatted on the logging thread. Once the log file is open they are queued in a lock-free
+ CLogQueue and a background writer thread writes them out in batches, suppresses repeated lines and
+ rotates the file when it gets too large. SEVERE and FATAL lines are written out with the lines queued
+ before them before Log() returns, and on POSIX the queued lines are written out when the application
+ crashes. Before Init() and after Close() lines are written directly.
+ */
 class CLog
 {
 public:
@@ -52,12 +68,21 @@ public:
   static int  GetLogLevel();
   static void SetExtraLogLevels(int level);
   static bool IsLogLevelLogged(int loglevel);
+  /*! \brief Write all queued lines to the log file before returning.
+   */
+  static void Flush();
+  /*! \brief Rotate the log file to the .old.log file once it grows past the given size.
+   \param bytes maximum size of the log file, 0 for no limit
+   */
+  static void SetMaxLogSize(uint64_t bytes);
 
 protected:
   class CLogGlobals
   {
   public:
-    CLogGlobals(void) : m_repeatCount(0), m_repeatLogLevel(-1), m_logLevel(LOG_LEVEL_DEBUG), m_extraLogLevels(0) {}
+    CLogGlobals(void) : m_repeatCount(0), m_repeatLogLevel(-1), m_logLevel(LOG_LEVEL_DEBUG), m_extraLogLevels(0),
+                        m_logSize(0), m_maxLogSize(0), m_async(false), m_pushers(0), m_popping(false),
+                        m_crashed(false), m_crashFd(-1), m_writer(NULL) {}
     ~CLogGlobals() {}
     PlatformInterfaceForCLog m_platform;
     int         m_repeatCount;
@@ -65,11 +90,30 @@ protected:
     std::string m_repeatLine;
     int         m_logLevel;
     int         m_extraLogLevels;
+    std::string m_logFile;
+    std::string m_oldLogFile;
+    uint64_t    m_logSize;
+    uint64_t    m_maxLogSize;
+    CLogQueue   m_queue;
+    std::atomic<bool> m_async;  ///< true while lines are queued for m_writer
+    std::atomic<int>  m_pushers;  ///< threads queueing a line, Close() waits for them
+    std::atomic<bool> m_popping;  ///< a thread is popping queued lines
+    std::atomic<bool> m_crashed;  ///< a fatal signal was caught, the queued lines are left to the crash handler
+    std::atomic<int>  m_crashFd;  ///< log file descriptor for the crash handler, -1 if there's none
+    CEvent      m_wake;         ///< wakes m_writer early when the queue fills up
+    CLogWriter *m_writer;
     CCriticalSection critSec;
   };
+  friend class CLogWriter;
   class CLogGlobals m_globalInstance; // used as static global variable
   static void LogString(int logLevel, const std::string& logString);
-  static bool WriteLogString(int logLevel, const std::string& logString);
+  static void FormatLine(int logLevel, const std::string& logString, CLogQueue::Entry& entry);
+  static void QueueLine(CLogQueue::Entry& entry);
+  static void AppendLogLine(const CLogQueue::Entry& entry, std::string& batch);
+  static bool WriteLogBatch(const std::string& batch);
+  static bool WriteQueuedLines();
+  static void UpdateCrashLogFile();
+  static void InstallCrashHandler(bool install);
 };
 
 
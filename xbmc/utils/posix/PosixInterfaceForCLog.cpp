@@ -83,6 +83,11 @@ bool CPosixInterfaceForCLog::WriteStringToLog(const std::string &logString)
   return ret;
 }
 
+int CPosixInterfaceForCLog::GetLogFileDescriptor() const
+{
+  return m_file ? fileno(m_file) : -1;
+}
+
 void CPosixInterfaceForCLog::PrintDebugString(const std::string &debugString)
 {
 #ifdef _DEBUG
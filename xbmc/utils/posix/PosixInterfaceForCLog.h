@@ -32,6 +32,7 @@ public:
   void CloseLogFile(void);
   bool WriteStringToLog(const std::string& logString);
   void PrintDebugString(const std::string& debugString);
+  int GetLogFileDescriptor() const; // -1 if the log file isn't open
   static void GetCurrentLocalTime(int& hour, int& minute, int& second, double& millisecond);
 private:
   FILEWRAP* m_file;
@@ -0,0 +1,261 @@
+/*
+ *      Copyright (C) 2017 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kodi; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "threads/Event.h"
+#include "threads/Thread.h"
+#include "utils/ActorProtocol.h"
+#include "utils/TimeUtils.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "gtest/gtest.h"
+
+using namespace Actor;
+
+namespace
+{
+enum Signals
+{
+  PING = 1,
+  PONG,
+  OTHER,
+  STOP,
+};
+
+struct Payload
+{
+  uint8_t bytes[64];
+};
+
+/* Answers every PING on the out queue with a PONG carrying the same payload. */
+class CEchoActor : public CThread
+{
+public:
+  CEchoActor(Protocol &port, CEvent &outEvent)
+    : CThread("EchoActor"), m_port(port), m_outEvent(outEvent) {}
+
+protected:
+  void Process() override
+  {
+    while (!m_bStop)
+    {
+      Message *msg;
+      if (!m_port.ReceiveOutMessage(&msg))
+      {
+        m_outEvent.Wait();
+        continue;
+      }
+
+      if (msg->signal == PING)
+        msg->Reply(PONG, msg->data, msg->payloadSize);
+      else if (msg->signal == STOP)
+        m_bStop = true;
+      msg->Release();
+    }
+  }
+
+  Protocol &m_port;
+  CEvent &m_outEvent;
+};
+}
+
+class TestActorProtocol : public testing::Test
+{
+protected:
+  TestActorProtocol() : m_port("test", &m_inEvent, &m_outEvent) {}
+
+  Message *Receive()
+  {
+    Message *msg;
+    while (!m_port.ReceiveInMessage(&msg))
+      m_inEvent.Wait();
+    return msg;
+  }
+
+  /* Sends PINGs to an echo actor on another thread, first one at a time to
+   * check the replies, then in bursts. The timings are printed when report
+   * is set. */
+  void PingPong(int roundTrips, int burst, bool report)
+  {
+    CEchoActor actor(m_port, m_outEvent);
+    actor.Create();
+
+    Payload payload = {};
+
+    // latency: one message in flight at a time
+    int64_t start = CurrentHostCounter();
+    for (int i = 0; i < roundTrips; i++)
+    {
+      memcpy(payload.bytes, &i, sizeof(i));
+      m_port.SendOutMessage(PING, payload.bytes, sizeof(payload.bytes));
+      Message *msg = Receive();
+      EXPECT_EQ(PONG, msg->signal);
+      EXPECT_EQ(0, memcmp(&i, msg->data, sizeof(i)));
+      msg->Release();
+    }
+    double latency = (double)(CurrentHostCounter() - start) / CurrentHostFrequency();
+
+    // throughput: bursts of messages filled in place
+    start = CurrentHostCounter();
+    for (int i = 0; i < roundTrips; i += burst)
+    {
+      for (int j = 0; j < burst; j++)
+      {
+        Message *msg = m_port.GetMessage();
+        memcpy(msg->AllocatePayload(sizeof(Payload)), payload.bytes, sizeof(Payload));
+        m_port.SendOutMessage(PING, msg);
+      }
+      for (int j = 0; j < burst; j++)
+        Receive()->Release();
+    }
+    double throughput = (double)(CurrentHostCounter() - start) / CurrentHostFrequency();
+
+    if (report)
+      printf("%d round trips: %.2f us each, %.0f messages/s in bursts of %d\n",
+             roundTrips, latency * 1e6 / roundTrips, 2 * roundTrips / throughput, burst);
+
+    m_port.SendOutMessage(STOP);
+    actor.StopThread();
+  }
+
+  CEvent m_inEvent;
+  CEvent m_outEvent;
+  Protocol m_port;
+};
+
+TEST_F(TestActorProtocol, SendAndReceive)
+{
+  Payload small = {};
+  strcpy((char*)small.bytes, "small");
+  Payload large;
+  for (size_t i = 0; i < sizeof(large.bytes); i++)
+    large.bytes[i] = (uint8_t)i;
+
+  m_port.SendOutMessage(PING, small.bytes, 8);
+  m_port.SendOutMessage(PING, large.bytes, sizeof(large.bytes));
+  m_port.SendOutMessage(OTHER);
+
+  Message *msg;
+  ASSERT_TRUE(m_port.ReceiveOutMessage(&msg));
+  EXPECT_EQ(PING, msg->signal);
+  EXPECT_EQ(8, msg->payloadSize);
+  EXPECT_STREQ("small", (char*)msg->data);
+  msg->Release();
+
+  ASSERT_TRUE(m_port.ReceiveOutMessage(&msg));
+  EXPECT_EQ((int)sizeof(large.bytes), msg->payloadSize);
+  EXPECT_EQ(0, memcmp(large.bytes, msg->data, sizeof(large.bytes)));
+  msg->Release();
+
+  ASSERT_TRUE(m_port.ReceiveOutMessage(&msg));
+  EXPECT_EQ(OTHER, msg->signal);
+  EXPECT_TRUE(msg->data == NULL);
+  msg->Release();
+
+  EXPECT_FALSE(m_port.ReceiveOutMessage(&msg));
+}
+
+TEST_F(TestActorProtocol, ZeroCopySend)
+{
+  Message *msg = m_port.GetMessage();
+  Payload *payload = (Payload*)msg->AllocatePayload(sizeof(Payload));
+  for (size_t i = 0; i < sizeof(payload->bytes); i++)
+    payload->bytes[i] = (uint8_t)(255 - i);
+  m_port.SendInMessage(PONG, msg);
+
+  ASSERT_TRUE(m_port.ReceiveInMessage(&msg));
+  EXPECT_EQ(PONG, msg->signal);
+  EXPECT_FALSE(msg->isOut);
+  EXPECT_EQ((uint8_t*)payload, msg->data);
+  EXPECT_EQ(200, msg->data[55]);
+  msg->Release();
+}
+
+TEST_F(TestActorProtocol, DeferAndPurge)
+{
+  m_port.SendOutMessage(PING);
+  m_port.SendOutMessage(OTHER);
+  m_port.SendOutMessage(PING);
+  m_port.SendOutMessage(PONG);
+
+  Message *msg;
+  m_port.DeferOut(true);
+  EXPECT_FALSE(m_port.ReceiveOutMessage(&msg));
+  m_port.DeferOut(false);
+
+  m_port.PurgeOut(PING);
+  m_port.SendOutMessage(STOP);
+
+  int expected[] = { OTHER, PONG, STOP };
+  for (int signal : expected)
+  {
+    ASSERT_TRUE(m_port.ReceiveOutMessage(&msg));
+    EXPECT_EQ(signal, msg->signal);
+    msg->Release();
+  }
+  EXPECT_FALSE(m_port.ReceiveOutMessage(&msg));
+}
+
+TEST_F(TestActorProtocol, PurgeLeavesDeferred)
+{
+  m_port.SendOutMessage(PING);
+  m_port.SendInMessage(PONG);
+
+  // deferred messages are kept for when the port takes them again
+  Message *msg;
+  m_port.DeferOut(true);
+  m_port.Purge();
+  EXPECT_FALSE(m_port.ReceiveInMessage(&msg));
+  m_port.DeferOut(false);
+
+  ASSERT_TRUE(m_port.ReceiveOutMessage(&msg));
+  EXPECT_EQ(PING, msg->signal);
+  msg->Release();
+}
+
+TEST_F(TestActorProtocol, SyncMessage)
+{
+  CEchoActor actor(m_port, m_outEvent);
+  actor.Create();
+
+  Payload payload = {};
+  strcpy((char*)payload.bytes, "sync");
+  Message *reply;
+  ASSERT_TRUE(m_port.SendOutMessageSync(PING, &reply, 5000, payload.bytes, sizeof(payload.bytes)));
+  EXPECT_EQ(PONG, reply->signal);
+  EXPECT_STREQ("sync", (char*)reply->data);
+  reply->Release();
+
+  m_port.SendOutMessage(STOP);
+  actor.StopThread();
+}
+
+TEST_F(TestActorProtocol, PingPong)
+{
+  PingPong(1000, 100, false);
+}
+
+// Timing run, not part of the unit tests. Run it with
+// --gtest_also_run_disabled_tests --gtest_filter=TestActorProtocol.DISABLED_PingPongBenchmark
+TEST_F(TestActorProtocol, DISABLED_PingPongBenchmark)
+{
+  PingPong(100000, 1000, true);
+}
@@ -18,9 +18,14 @@
  *
  */
 
+#include <stdio.h>
+#include <vector>
+
 #include "ServiceBroker.h"
 #include "settings/Settings.h"
+#include "threads/Thread.h"
 #include "utils/CharsetConverter.h"
+#include "utils/TimeUtils.h"
 #include "utils/Utf8Utils.h"
 #include "system.h"
 
@@ -408,3 +413,150 @@ TEST_F(TestCharsetConverter, fromW)
   g_charsetConverter.fromW(refstrw1, varstra1, "UTF-16LE");
   EXPECT_STREQ(refstra1.c_str(), varstra1.c_str());
 }
+
+/* ASCII, Latin-1, Cyrillic, CJK and characters outside the BMP */
+static const char refutf8Mixed[] = "Kodi \xc3\xa9t\xc3\xa9 \xd0\x9a\xd0\xbe\xd0\xb4\xd0\xb8 "
+                                   "\xe3\x82\xb3\xe3\x83\x87\xe3\x82\xa3 \xf0\x9f\x90\xad\xf0\x9f\x90\xae";
+
+TEST_F(TestCharsetConverter, utf8ToUtf32MatchesIconv)
+{
+  std::string text;
+  for (int i = 0; i < 50; i++)
+    text += refutf8Mixed;
+
+  std::u32string converted, reference;
+  EXPECT_TRUE(g_charsetConverter.utf8ToUtf32(text, converted));
+  EXPECT_TRUE(g_charsetConverter.utf8To("UTF-32LE", text, reference));
+  EXPECT_TRUE(converted == reference);
+
+  std::string utf8;
+  EXPECT_TRUE(g_charsetConverter.utf32ToUtf8(converted, utf8));
+  EXPECT_STREQ(text.c_str(), utf8.c_str());
+}
+
+TEST_F(TestCharsetConverter, utf8ToUtf16Surrogates)
+{
+  std::u16string utf16;
+  EXPECT_TRUE(CUtf8Utils::Utf8ToUtf16(std::string("a\xf0\x9f\x90\xad"), utf16, true));
+  ASSERT_EQ(3U, utf16.size());
+  EXPECT_EQ(u'a', utf16[0]);
+  EXPECT_EQ(0xd83d, utf16[1]);
+  EXPECT_EQ(0xdc2d, utf16[2]);
+
+  std::string utf8;
+  EXPECT_TRUE(g_charsetConverter.utf16LEtoUTF8(utf16, utf8));
+  EXPECT_STREQ("a\xf0\x9f\x90\xad", utf8.c_str());
+
+  // unpaired surrogate
+  utf16.resize(2);
+  EXPECT_FALSE(CUtf8Utils::Utf16ToUtf8(utf16, utf8, true));
+  EXPECT_TRUE(CUtf8Utils::Utf16ToUtf8(utf16, utf8, false));
+  EXPECT_STREQ("a", utf8.c_str());
+}
+
+TEST_F(TestCharsetConverter, utf8ToUtf32InvalidChars)
+{
+  // invalid byte, overlong '/', encoded surrogate and truncated sequence
+  const std::string invalid("a\xff" "b\xc0\xaf" "c\xed\xa0\x80" "d\xe3\x82");
+
+  std::u32string utf32;
+  EXPECT_FALSE(g_charsetConverter.utf8ToUtf32(invalid, utf32, true));
+  EXPECT_TRUE(utf32.empty());
+
+  EXPECT_TRUE(g_charsetConverter.utf8ToUtf32(invalid, utf32, false));
+  EXPECT_TRUE(utf32 == U"abcd");
+
+  std::wstring w;
+  g_charsetConverter.utf8ToW(invalid, w, false, false, false);
+  EXPECT_STREQ(L"abcd", w.c_str());
+}
+
+class CharsetConverterThread : public CThread
+{
+public:
+  CharsetConverterThread(const std::u16string& source, unsigned int count) :
+    CThread("CharsetConverterThread"), m_failed(0), m_source(source), m_count(count) {}
+
+  unsigned int m_failed;
+
+protected:
+  virtual void Process()
+  {
+    std::string expected, utf8;
+    g_charsetConverter.utf16BEtoUTF8(m_source, expected);
+    for (unsigned int i = 0; i < m_count; i++)
+    {
+      if (!g_charsetConverter.utf16BEtoUTF8(m_source, utf8) || utf8 != expected)
+        m_failed++;
+    }
+  }
+
+  std::u16string m_source;
+  unsigned int m_count;
+};
+
+TEST_F(TestCharsetConverter, ConcurrentConversion)
+{
+  std::u16string source;
+  for (int i = 0; refutf16BE[i]; i++)
+    source.push_back(refutf16BE[i]);
+
+  std::vector<CharsetConverterThread*> threads;
+  for (int i = 0; i < 4; i++)
+  {
+    threads.push_back(new CharsetConverterThread(source, 5000));
+    threads.back()->Create();
+  }
+  for (std::vector<CharsetConverterThread*>::iterator i = threads.begin(); i != threads.end(); ++i)
+  {
+    (*i)->StopThread();
+    EXPECT_EQ(0U, (*i)->m_failed);
+    delete *i;
+  }
+}
+
+// Timing run, not part of the unit tests. Run it with
+// --gtest_also_run_disabled_tests --gtest_filter=TestCharsetConverter.DISABLED_Benchmark
+TEST_F(TestCharsetConverter, DISABLED_Benchmark)
+{
+  std::string ascii, mixed;
+  while (ascii.size() < 4 * 1024 * 1024)
+    ascii += "The quick brown fox jumps over the lazy dog. ";
+  while (mixed.size() < 4 * 1024 * 1024)
+    mixed += refutf8Mixed;
+
+  const double frequency = (double)CurrentHostFrequency();
+  const char* names[] = { "ascii", "mixed" };
+  const std::string* texts[] = { &ascii, &mixed };
+  for (int t = 0; t < 2; t++)
+  {
+    const std::string& text = *texts[t];
+    const double megabytes = text.size() / (1024.0 * 1024.0);
+    std::u32string utf32, reference;
+    std::wstring w;
+    std::string utf8;
+
+    int64_t start = CurrentHostCounter();
+    EXPECT_TRUE(g_charsetConverter.utf8To("UTF-32LE", text, reference));
+    int64_t iconvTime = CurrentHostCounter() - start;
+
+    start = CurrentHostCounter();
+    EXPECT_TRUE(g_charsetConverter.utf8ToUtf32(text, utf32));
+    int64_t toUtf32Time = CurrentHostCounter() - start;
+
+    start = CurrentHostCounter();
+    EXPECT_TRUE(g_charsetConverter.utf32ToUtf8(utf32, utf8));
+    int64_t toUtf8Time = CurrentHostCounter() - start;
+
+    start = CurrentHostCounter();
+    EXPECT_TRUE(g_charsetConverter.utf8ToW(text, w, false));
+    int64_t toWTime = CurrentHostCounter() - start;
+
+    EXPECT_TRUE(utf32 == reference);
+    EXPECT_TRUE(utf8 == text);
+
+    printf("%s %.1f MB: iconv UTF-8 -> UTF-32 %.0f MB/s, utf8ToUtf32 %.0f MB/s, utf32ToUtf8 %.0f MB/s, utf8ToW %.0f MB/s\n",
+           names[t], megabytes, megabytes / (iconvTime / frequency), megabytes / (toUtf32Time / frequency),
+           megabytes / (toUtf8Time / frequency), megabytes / (toWTime / frequency));
+  }
+}
@@ -0,0 +1,240 @@
+/*
+ *      Copyright (C) 2017 Team Kodi
+ *      http://kodi.tv
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kodi; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "threads/Thread.h"
+#include "utils/FrameTracer.h"
+#include "utils/Stopwatch.h"
+#include "utils/Variant.h"
+
+#include <iostream>
+#include <set>
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace
+{
+class CTracingThread : public CThread
+{
+public:
+  CTracingThread() : CThread("TestFrameTracer") {}
+
+protected:
+  void Process() override
+  {
+    for (unsigned int i = 0; i < 10; i++)
+      TRACE_ZONE("worker");
+  }
+};
+
+unsigned int CountZones(const CVariant &trace, const std::string &name)
+{
+  unsigned int count = 0;
+  for (auto it = trace["traceEvents"].begin_array(); it != trace["traceEvents"].end_array(); ++it)
+  {
+    if ((*it)["ph"].asString() == "X" && (*it)["name"].asString() == name)
+      count++;
+  }
+  return count;
+}
+}
+
+TEST(TestFrameTracer, NothingRecordedWhenStopped)
+{
+  CFrameTracer::GetInstance().Start();
+  CFrameTracer::GetInstance().Stop();
+  {
+    TRACE_ZONE("ignored");
+  }
+  CVariant trace;
+  CFrameTracer::GetInstance().Export(trace);
+  EXPECT_EQ(0U, CountZones(trace, "ignored"));
+  EXPECT_FALSE(trace["capturing"].asBoolean());
+}
+
+TEST(TestFrameTracer, ExportsNestedZones)
+{
+  CFrameTracer::GetInstance().Start();
+  {
+    TRACE_ZONE("outer");
+    for (unsigned int i = 0; i < 3; i++)
+      TRACE_ZONE("inner");
+  }
+  CFrameTracer::GetInstance().Stop();
+
+  CVariant trace;
+  CFrameTracer::GetInstance().Export(trace);
+  ASSERT_EQ(1U, CountZones(trace, "outer"));
+  EXPECT_EQ(3U, CountZones(trace, "inner"));
+
+  // inner zones lie within the outer one
+  double outerStart = 0, outerEnd = 0;
+  for (auto it = trace["traceEvents"].begin_array(); it != trace["traceEvents"].end_array(); ++it)
+  {
+    if ((*it)["name"].asString() == "outer")
+    {
+      outerStart = (*it)["ts"].asDouble();
+      outerEnd = outerStart + (*it)["dur"].asDouble();
+    }
+  }
+  for (auto it = trace["traceEvents"].begin_array(); it != trace["traceEvents"].end_array(); ++it)
+  {
+    if ((*it)["name"].asString() == "inner")
+    {
+      EXPECT_GE((*it)["ts"].asDouble(), outerStart);
+      EXPECT_LE((*it)["ts"].asDouble() + (*it)["dur"].asDouble(), outerEnd);
+    }
+  }
+}
+
+TEST(TestFrameTracer, ZonesPerThread)
+{
+  CFrameTracer::GetInstance().Start();
+  {
+    TRACE_ZONE("main");
+  }
+  CTracingThread thread;
+  thread.Create();
+  thread.StopThread(true);
+  CFrameTracer::GetInstance().Stop();
+
+  CVariant trace;
+  CFrameTracer::GetInstance().Export(trace);
+  EXPECT_EQ(10U, CountZones(trace, "worker"));
+
+  std::set<int64_t> mainThreads, workerThreads;
+  bool named = false;
+  for (auto it = trace["traceEvents"].begin_array(); it != trace["traceEvents"].end_array(); ++it)
+  {
+    if ((*it)["name"].asString() == "main")
+      mainThreads.insert((*it)["tid"].asInteger());
+    else if ((*it)["name"].asString() == "worker")
+      workerThreads.insert((*it)["tid"].asInteger());
+    else if ((*it)["ph"].asString() == "M" && (*it)["args"]["name"].asString().find("TestFrameTracer") == 0)
+      named = true;
+  }
+  ASSERT_EQ(1U, mainThreads.size());
+  ASSERT_EQ(1U, workerThreads.size());
+  EXPECT_NE(*mainThreads.begin(), *workerThreads.begin());
+  EXPECT_TRUE(named);
+}
+
+TEST(TestFrameTracer, BuffersOfFinishedThreadsAreReused)
+{
+  // more threads than buffers, one per capture
+  for (unsigned int i = 0; i < CFrameTracer::MAX_THREADS + 10; i++)
+  {
+    CFrameTracer::GetInstance().Start();
+    CTracingThread thread;
+    thread.Create();
+    thread.StopThread(true);
+    CFrameTracer::GetInstance().Stop();
+
+    CVariant trace;
+    CFrameTracer::GetInstance().Export(trace);
+    ASSERT_EQ(10U, CountZones(trace, "worker"));
+  }
+}
+
+TEST(TestFrameTracer, RestartWhileRecording)
+{
+  class CBusyThread : public CThread
+  {
+  public:
+    CBusyThread() : CThread("TestFrameTracer") {}
+
+  protected:
+    void Process() override
+    {
+      while (!m_bStop)
+        TRACE_ZONE("busy");
+    }
+  };
+
+  CBusyThread threads[4];
+  for (auto& thread : threads)
+    thread.Create();
+  for (unsigned int i = 0; i < 200; i++)
+  {
+    CFrameTracer::GetInstance().Start();
+    {
+      TRACE_ZONE("main");
+    }
+  }
+  CFrameTracer::GetInstance().Stop();
+  for (auto& thread : threads)
+    thread.StopThread(true);
+
+  // every thread recorded into its own buffer only
+  CVariant trace;
+  CFrameTracer::GetInstance().Export(trace);
+  std::set<int64_t> mainThreads, busyThreads;
+  for (auto it = trace["traceEvents"].begin_array(); it != trace["traceEvents"].end_array(); ++it)
+  {
+    if ((*it)["name"].asString() == "main")
+      mainThreads.insert((*it)["tid"].asInteger());
+    else if ((*it)["name"].asString() == "busy")
+      busyThreads.insert((*it)["tid"].asInteger());
+    if ((*it)["ph"].asString() == "X")
+    {
+      EXPECT_GE((*it)["dur"].asDouble(), 0.0);
+    }
+  }
+  EXPECT_EQ(1U, CountZones(trace, "main"));
+  ASSERT_EQ(1U, mainThreads.size());
+  EXPECT_EQ(0U, busyThreads.count(*mainThreads.begin()));
+  EXPECT_LE(busyThreads.size(), 4U);
+}
+
+TEST(TestFrameTracer, RingBufferKeepsLatest)
+{
+  CFrameTracer::GetInstance().Start();
+  for (unsigned int i = 0; i < CFrameTracer::BUFFER_SIZE + 100; i++)
+    TRACE_ZONE("zone");
+  CFrameTracer::GetInstance().Stop();
+
+  CVariant trace;
+  CFrameTracer::GetInstance().Export(trace);
+  EXPECT_EQ(CFrameTracer::BUFFER_SIZE + 100, CFrameTracer::GetInstance().GetRecorded());
+  // the oldest zone shares its slot with the next one to be written, so it's left out
+  EXPECT_EQ(CFrameTracer::BUFFER_SIZE - 1, CountZones(trace, "zone"));
+}
+
+TEST(TestFrameTracer, Overhead)
+{
+  const unsigned int zones = 1000000;
+  CStopWatch watch;
+
+  CFrameTracer::GetInstance().Stop();
+  watch.StartZero();
+  for (unsigned int i = 0; i < zones; i++)
+    TRACE_ZONE("disabled");
+  float disabled = watch.GetElapsedMilliseconds();
+
+  CFrameTracer::GetInstance().Start();
+  watch.StartZero();
+  for (unsigned int i = 0; i < zones; i++)
+    TRACE_ZONE("enabled");
+  float enabled = watch.GetElapsedMilliseconds();
+  CFrameTracer::GetInstance().Stop();
+
+  std::cout << zones << " zones: " << disabled * 1000000 / zones << " ns per zone when not capturing, "
+            << enabled * 1000000 / zones << " ns when capturing" << std::endl;
+}
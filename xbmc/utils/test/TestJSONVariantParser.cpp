@@ -18,11 +18,42 @@
  *
  */
 
+#include <stdio.h>
+#include <string.h>
+
 #include "utils/JSONVariantParser.h"
+#include "utils/StringUtils.h"
+#include "utils/TimeUtils.h"
 #include "utils/Variant.h"
 
 #include "gtest/gtest.h"
 
+namespace
+{
+std::string PlaylistAdd(int items)
+{
+  std::string json = "{\"jsonrpc\": \"2.0\", \"method\": \"Playlist.Add\", \"id\": 1, "
+                     "\"params\": {\"playlistid\": 0, \"item\": [";
+  for (int i = 0; i < items; i++)
+    json += StringUtils::Format("%s{\"file\": \"/storage/music/Artist %d/Album/%02d - Title.flac\"}",
+                                i ? ", " : "", i / 12, i % 12);
+  return json + "]}}";
+}
+
+std::string MovieList(int movies)
+{
+  std::string json = StringUtils::Format("{\"id\": 1, \"jsonrpc\": \"2.0\", \"result\": {\"limits\": {\"start\": 0, "
+                                         "\"end\": %d, \"total\": %d}, \"movies\": [", movies, movies);
+  for (int i = 0; i < movies; i++)
+    json += StringUtils::Format("%s{\"movieid\": %d, \"label\": \"Movie %d\", \"year\": %d, \"rating\": %d.5, "
+                                "\"genre\": [\"Drama\", \"Thriller\"], \"playcount\": 0, "
+                                "\"file\": \"smb://server/movies/Movie %d (%d).mkv\", \"plot\": \"A \\\"quoted\\\" plot\", "
+                                "\"art\": {\"poster\": \"image://poster%d.jpg/\", \"fanart\": \"image://fanart%d.jpg/\"}}",
+                                i ? ", " : "", i, i, 1950 + i % 70, i % 10, i, 1950 + i % 70, i, i);
+  return json + "]}}";
+}
+}
+
 TEST(TestJSONVariantParser, Parse)
 {
   CVariant variant;
@@ -32,3 +63,111 @@ TEST(TestJSONVariantParser, Parse)
   variant = CJSONVariantParser::Parse(buf, sizeof(buf));
   EXPECT_TRUE(variant.isNull());
 }
+
+TEST(TestJSONVariantParser, ParseNested)
+{
+  CVariant variant;
+  EXPECT_TRUE(CJSONVariantParser::Parse("{\"jsonrpc\": \"2.0\", \"method\": \"Playlist.Add\", \"id\": 1,"
+                                        " \"params\": {\"playlistid\": 0, \"item\": [{\"file\": \"a\\\"b\"},"
+                                        " {\"file\": \"c\"}, null, true, 2.5, [], {}]}}", variant));
+
+  ASSERT_TRUE(variant.isObject());
+  EXPECT_STREQ("2.0", variant["jsonrpc"].asString().c_str());
+  EXPECT_EQ(1, variant["id"].asInteger());
+
+  const CVariant &items = variant["params"]["item"];
+  ASSERT_TRUE(items.isArray());
+  ASSERT_EQ(7U, items.size());
+  EXPECT_STREQ("a\"b", items[0]["file"].asString().c_str());
+  EXPECT_STREQ("c", items[1]["file"].asString().c_str());
+  EXPECT_TRUE(items[2].isNull());
+  EXPECT_TRUE(items[3].asBoolean());
+  EXPECT_EQ(2.5, items[4].asDouble());
+  EXPECT_TRUE(items[5].isArray());
+  EXPECT_TRUE(items[5].empty());
+  EXPECT_TRUE(items[6].isObject());
+  EXPECT_TRUE(items[6].empty());
+}
+
+TEST(TestJSONVariantParser, ParseInvalid)
+{
+  CVariant variant("previous");
+  EXPECT_FALSE(CJSONVariantParser::Parse("{\"method\": [1, 2", variant));
+  EXPECT_TRUE(variant.isNull());
+  EXPECT_FALSE(CJSONVariantParser::Parse("{\"method\" 1}", variant));
+  EXPECT_TRUE(variant.isNull());
+}
+
+class CCountingParseCallback : public IParseCallback
+{
+public:
+  virtual void onParsed(CVariant *variant) { m_parsed.push_back(std::move(*variant)); }
+
+  std::vector<CVariant> m_parsed;
+};
+
+TEST(TestJSONVariantParser, PushBuffer)
+{
+  const std::string json = "{\"id\": 1, \"params\": [\"one\", \"two\"]}";
+
+  CCountingParseCallback callback;
+  {
+    CJSONVariantParser parser(&callback);
+    for (size_t pos = 0; pos < json.size(); pos += 5)
+    {
+      const std::string part = json.substr(pos, 5);
+      EXPECT_TRUE(parser.push_buffer((const unsigned char *)part.c_str(), part.size()));
+    }
+  }
+
+  ASSERT_EQ(1U, callback.m_parsed.size());
+  EXPECT_EQ(1, callback.m_parsed[0]["id"].asInteger());
+  EXPECT_STREQ("two", callback.m_parsed[0]["params"][1].asString().c_str());
+}
+
+TEST(TestJSONVariantParser, ParseLarge)
+{
+  CVariant variant;
+  ASSERT_TRUE(CJSONVariantParser::Parse(PlaylistAdd(5000), variant));
+  ASSERT_EQ(5000U, variant["params"]["item"].size());
+  EXPECT_STREQ("/storage/music/Artist 416/Album/07 - Title.flac",
+               variant["params"]["item"][4999]["file"].asString().c_str());
+
+  ASSERT_TRUE(CJSONVariantParser::Parse(MovieList(2000), variant));
+  const CVariant &movies = variant["result"]["movies"];
+  ASSERT_EQ(2000U, movies.size());
+  EXPECT_EQ(1999, movies[1999]["movieid"].asInteger());
+  EXPECT_STREQ("Movie 1234", movies[1234]["label"].asString().c_str());
+  EXPECT_EQ(9.5, movies[1999]["rating"].asDouble());
+  EXPECT_STREQ("A \"quoted\" plot", movies[1999]["plot"].asString().c_str());
+  EXPECT_STREQ("image://fanart1999.jpg/", movies[1999]["art"]["fanart"].asString().c_str());
+}
+
+// Timing run, not part of the unit tests. Run it with
+// --gtest_also_run_disabled_tests --gtest_filter=TestJSONVariantParser.DISABLED_Benchmark
+TEST(TestJSONVariantParser, DISABLED_Benchmark)
+{
+  const std::string playlistAdd = PlaylistAdd(5000);
+  const std::string movies = MovieList(2000);
+
+  const std::string request = "{\"jsonrpc\": \"2.0\", \"method\": \"Player.GetProperties\", "
+                              "\"params\": {\"playerid\": 1, \"properties\": [\"time\", \"percentage\", \"speed\"]}, \"id\": 1}";
+
+  const double frequency = (double)CurrentHostFrequency();
+  const char* names[] = { "Playlist.Add of 5000 items", "2000 movies", "Player.GetProperties" };
+  const std::string* payloads[] = { &playlistAdd, &movies, &request };
+  const int repeats[] = { 20, 10, 20000 };
+  for (int p = 0; p < 3; p++)
+  {
+    CVariant variant;
+    int64_t start = CurrentHostCounter();
+    for (int i = 0; i < repeats[p]; i++)
+      EXPECT_TRUE(CJSONVariantParser::Parse(*payloads[p], variant));
+    int64_t elapsed = CurrentHostCounter() - start;
+
+    EXPECT_TRUE(variant.isObject());
+    printf("%s (%u bytes): %.1f us per parse, %.0f MB/s\n", names[p], (unsigned int)payloads[p]->size(),
+           elapsed / frequency * 1e6 / repeats[p],
+           payloads[p]->size() * repeats[p] / (elapsed / frequency) / (1024 * 1024));
+  }
+}
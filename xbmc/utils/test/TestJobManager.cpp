@@ -21,7 +21,15 @@
 #include "ServiceBroker.h"
 #include "utils/JobManager.h"
 #include "settings/Settings.h"
+#include "threads/Thread.h"
 #include "utils/SystemInfo.h"
+#include "utils/TimeUtils.h"
+
+#include <atomic>
+#include <inttypes.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -179,3 +187,211 @@ TEST_F(TestJobManager, IsProcessing)
 
   job->FinishAndStopBlocking();
 }
+
+TEST_F(TestJobManager, SubmitReturnsResult)
+{
+  CJobFuture<int> future = CJobManager::GetInstance().Submit([]() { return 42; });
+  EXPECT_EQ(42, future.Get());
+  EXPECT_TRUE(future.IsReady());
+
+  std::atomic<bool> ran(false);
+  CJobManager::GetInstance().Submit([&ran]() { ran = true; }, CJob::PRIORITY_HIGH).Get();
+  EXPECT_TRUE(ran);
+}
+
+TEST_F(TestJobManager, Continuations)
+{
+  CJobFuture<std::string> future = CJobManager::GetInstance().Submit([]() { return 20; })
+    .Then([](int value) { return value + 1; })
+    .Then([](int value) { return std::to_string(value * 2); }, CJob::PRIORITY_NORMAL);
+  EXPECT_EQ("42", future.Get());
+
+  std::atomic<int> calls(0);
+  CJobFuture<void> done = CJobManager::GetInstance().Submit([&calls]() { calls++; })
+    .Then([&calls]() { calls++; });
+  done.Get();
+  EXPECT_EQ(2, calls);
+
+  // continuations added to a completed future still run
+  EXPECT_EQ(43, future.Then([](const std::string &value) { return std::stoi(value) + 1; }).Get());
+}
+
+TEST_F(TestJobManager, ExceptionsPassOnToContinuations)
+{
+  std::atomic<bool> ran(false);
+  CJobFuture<int> future = CJobManager::GetInstance().Submit([]() -> int { throw std::logic_error("failed"); })
+    .Then([&ran](int value) { ran = true; return value; });
+  EXPECT_THROW(future.Get(), std::logic_error);
+  EXPECT_FALSE(ran);
+}
+
+TEST_F(TestJobManager, SubmitAfterCancel)
+{
+  CJobManager::GetInstance().CancelJobs();
+  CJobFuture<int> future = CJobManager::GetInstance().Submit([]() { return 1; });
+  EXPECT_TRUE(future.IsReady());
+  EXPECT_THROW(future.Get(), std::runtime_error);
+}
+
+TEST_F(TestJobManager, ParallelFor)
+{
+  std::vector<int> visits(100000);
+  CJobManager::GetInstance().ParallelFor(visits.size(), 1000, [&visits](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+      visits[i]++;
+  });
+  for (size_t i = 0; i < visits.size(); i++)
+    ASSERT_EQ(1, visits[i]);
+
+  EXPECT_THROW(CJobManager::GetInstance().ParallelFor(100000, 1000, [](size_t begin, size_t end) {
+    if (begin == 0)
+      throw std::logic_error("failed");
+  }), std::logic_error);
+}
+
+/* Jobs waiting for the jobs they queue must not use up the workers, even at a priority that only
+   allows fewer jobs at once than there are waiting. */
+TEST_F(TestJobManager, JobsWaitForJobs)
+{
+  std::vector< CJobFuture<int> > outer;
+  for (int i = 0; i < 8; i++)
+  {
+    outer.push_back(CJobManager::GetInstance().Submit([]() {
+      std::vector< CJobFuture<int> > inner;
+      for (int j = 0; j < 50; j++)
+        inner.push_back(CJobManager::GetInstance().Submit([j]() { return j; }, CJob::PRIORITY_LOW_PAUSABLE));
+      int sum = 0;
+      for (std::vector< CJobFuture<int> >::iterator j = inner.begin(); j != inner.end(); ++j)
+        sum += j->Get();
+      return sum;
+    }, CJob::PRIORITY_LOW_PAUSABLE));
+  }
+  for (std::vector< CJobFuture<int> >::iterator i = outer.begin(); i != outer.end(); ++i)
+    EXPECT_EQ(50 * 49 / 2, i->Get());
+}
+
+/* Waiting jobs only run queued jobs of at least their own priority meanwhile, and no dedicated ones,
+   which may run for long. The others still run on other workers. */
+TEST_F(TestJobManager, WaitingJobsLeaveOtherJobs)
+{
+  CJobFuture<int> waiter = CJobManager::GetInstance().Submit([]() {
+    const ThreadIdentifier self = CThread::GetCurrentThreadId();
+    auto ranHere = [self]() {
+      XbmcThreads::ThreadSleep(1);
+      return CThread::IsCurrentThread(self);
+    };
+    std::vector< CJobFuture<bool> > jobs;
+    for (int i = 0; i < 100; i++)
+    {
+      jobs.push_back(CJobManager::GetInstance().Submit(ranHere, CJob::PRIORITY_LOW));
+      jobs.push_back(CJobManager::GetInstance().Submit(ranHere, CJob::PRIORITY_DEDICATED));
+    }
+    int count = 0;
+    for (std::vector< CJobFuture<bool> >::iterator i = jobs.begin(); i != jobs.end(); ++i)
+    {
+      if (i->Get())
+        count++;
+    }
+    return count;
+  }, CJob::PRIORITY_HIGH);
+  EXPECT_EQ(0, waiter.Get());
+}
+
+namespace
+{
+class CountingJob : public CJob
+{
+public:
+  CountingJob(std::atomic<unsigned int> &count) : m_count(count) {}
+  bool DoWork() override
+  {
+    m_count++;
+    return true;
+  }
+private:
+  std::atomic<unsigned int> &m_count;
+};
+
+/* Adds jobs from its own thread, like the texture cache or JSON-RPC do for bursts of work */
+class JobProducer : public CThread
+{
+public:
+  JobProducer(unsigned int jobs, std::atomic<unsigned int> &count) : CThread("JobProducer"), m_jobs(jobs), m_count(count) {}
+  void Process() override
+  {
+    for (unsigned int i = 0; i < m_jobs; i++)
+      CJobManager::GetInstance().AddJob(new CountingJob(m_count), NULL, CJob::PRIORITY(i % (CJob::PRIORITY_HIGH + 1)));
+  }
+private:
+  unsigned int m_jobs;
+  std::atomic<unsigned int> &m_count;
+};
+
+/* Floods the job manager with small jobs from several threads, and with jobs fanning out into
+   more jobs, returns the seconds until all of them ran. */
+double Flood(unsigned int producers, unsigned int jobsPerProducer, unsigned int fanOut)
+{
+  int64_t start = CurrentHostCounter();
+
+  std::atomic<unsigned int> count(0);
+  std::vector<JobProducer*> threads;
+  for (unsigned int i = 0; i < producers; i++)
+  {
+    threads.push_back(new JobProducer(jobsPerProducer, count));
+    threads.back()->Create();
+  }
+
+  std::vector< CJobFuture<void> > fanOuts;
+  for (unsigned int i = 0; i < fanOut; i++)
+  {
+    fanOuts.push_back(CJobManager::GetInstance().Submit([&count, fanOut]() {
+      std::vector< CJobFuture<void> > jobs;
+      for (unsigned int j = 0; j < fanOut; j++)
+        jobs.push_back(CJobManager::GetInstance().Submit([&count]() { count++; }));
+      for (std::vector< CJobFuture<void> >::iterator j = jobs.begin(); j != jobs.end(); ++j)
+        j->Get();
+    }, CJob::PRIORITY_NORMAL));
+  }
+
+  for (std::vector<JobProducer*>::iterator i = threads.begin(); i != threads.end(); ++i)
+  {
+    (*i)->StopThread();
+    delete *i;
+  }
+  for (std::vector< CJobFuture<void> >::iterator i = fanOuts.begin(); i != fanOuts.end(); ++i)
+    i->Get();
+
+  const unsigned int total = producers * jobsPerProducer + fanOut * fanOut;
+  XbmcThreads::EndTime timeout(30000);
+  while (count < total && !timeout.IsTimePast())
+    XbmcThreads::ThreadSleep(1);
+  EXPECT_EQ(total, count);
+
+  return (double)(CurrentHostCounter() - start) / CurrentHostFrequency();
+}
+}
+
+TEST_F(TestJobManager, ManyProducersAndNestedJobs)
+{
+  Flood(4, 1000, 20);
+}
+
+/* Prints the throughput of a larger flood along with the contention counters. */
+TEST_F(TestJobManager, DISABLED_StressBenchmark)
+{
+  const unsigned int producers = 4;
+  const unsigned int jobsPerProducer = 20000;
+  const unsigned int fanOut = 200;
+  CJobManager::Stats before = CJobManager::GetInstance().GetStats();
+  double seconds = Flood(producers, jobsPerProducer, fanOut);
+  const unsigned int total = producers * jobsPerProducer + fanOut * fanOut;
+
+  CJobManager::Stats after = CJobManager::GetInstance().GetStats();
+  printf("%u jobs in %.3f s (%.0f jobs/s): %" PRIu64 " run locally, %" PRIu64 " stolen, "
+         "shared queue contended %" PRIu64 " times, worker queues %" PRIu64 " times, "
+         "%" PRIu64 " worker waits, %" PRIu64 " workers started\n",
+         total, seconds, total / seconds,
+         after.localJobs - before.localJobs, after.stolenJobs - before.stolenJobs,
+         after.contended - before.contended, after.contendedLocal - before.contendedLocal,
+         after.waits - before.waits, after.workers - before.workers);
+}
@@ -131,3 +131,34 @@ TEST(TestSortUtils, GetFieldsForSorting)
   EXPECT_EQ(FieldTrackNumber, *it);
   EXPECT_EQ((unsigned int)4, fields.size());
 }
+
+TEST(TestSortUtils, SortPrepared)
+{
+  SortItems items;
+  for (int i = 0; i < 20000; i++)
+  {
+    SortItemPtr item(new SortItem());
+    (*item)[FieldSize] = (i * 7919) % 100;
+    (*item)[FieldId] = i;
+    SortUtils::Prepare(SortBySize, SortAttributeNone, *item);
+    items.push_back(item);
+  }
+
+  // large lists are merged from runs sorted apart, equal items have to stay in order
+  SortUtils::SortPrepared(SortOrderAscending, SortAttributeNone, items);
+  ASSERT_EQ(20000U, items.size());
+  for (size_t i = 1; i < items.size(); i++)
+  {
+    const SortItem &previous = *items[i - 1];
+    const SortItem &current = *items[i];
+    ASSERT_LE(previous.at(FieldSize).asInteger(), current.at(FieldSize).asInteger());
+    if (previous.at(FieldSize).asInteger() == current.at(FieldSize).asInteger())
+    {
+      ASSERT_LT(previous.at(FieldId).asInteger(), current.at(FieldId).asInteger());
+    }
+  }
+
+  SortUtils::SortPrepared(SortOrderDescending, SortAttributeNone, items, 10);
+  ASSERT_EQ(10U, items.size());
+  EXPECT_EQ(99, items[0]->at(FieldSize).asInteger());
+}
@@ -18,6 +18,10 @@
  *
  */
 
+#include <stdio.h>
+
+#include "utils/StringUtils.h"
+#include "utils/TimeUtils.h"
 #include "utils/Variant.h"
 
 #include "gtest/gtest.h"
@@ -348,3 +352,181 @@ TEST(TestVariant, isMember)
   EXPECT_TRUE(a.isMember("key1"));
   EXPECT_FALSE(a.isMember("key2"));
 }
+
+TEST(TestVariant, copyOnWrite)
+{
+  CVariant a;
+  a["title"] = "A title";
+  a["genre"].push_back("Drama");
+  a["genre"].push_back("Thriller");
+
+  CVariant b = a;
+  EXPECT_TRUE(a == b);
+
+  b["title"] = "Another title";
+  b["genre"].push_back("Comedy");
+  b["genre"].erase(0);
+
+  EXPECT_STREQ("A title", a["title"].asString().c_str());
+  EXPECT_EQ(2U, a["genre"].size());
+  EXPECT_STREQ("Drama", a["genre"][0].asString().c_str());
+  EXPECT_STREQ("Another title", b["title"].asString().c_str());
+  EXPECT_EQ(2U, b["genre"].size());
+  EXPECT_STREQ("Thriller", b["genre"][0].asString().c_str());
+
+  CVariant c = a;
+  c.clear();
+  EXPECT_TRUE(c.empty());
+  EXPECT_EQ(2U, a.size());
+}
+
+TEST(TestVariant, copyAfterReference)
+{
+  CVariant a;
+  a["item"]["label"] = "label";
+
+  // changes through a reference taken before the copy must not show in the copy
+  CVariant &item = a["item"];
+  CVariant b = a;
+  item["label"] = "changed";
+  CVariant::iterator_map it = a.begin_map();
+  CVariant c = a;
+  it->second["label"] = "changed again";
+
+  EXPECT_STREQ("changed again", a["item"]["label"].asString().c_str());
+  EXPECT_STREQ("label", b["item"]["label"].asString().c_str());
+  EXPECT_STREQ("changed", c["item"]["label"].asString().c_str());
+}
+
+TEST(TestVariant, assignFromMember)
+{
+  CVariant a;
+  a["item"]["label"] = "label";
+  a = a["item"];
+  EXPECT_STREQ("label", a["label"].asString().c_str());
+
+  CVariant b;
+  b.push_back(CVariant("a string"));
+  b = std::move(b[0]);
+  EXPECT_STREQ("a string", b.asString().c_str());
+}
+
+TEST(TestVariant, stringData)
+{
+  const std::string embedded("a\0b", 3);
+  CVariant a(embedded);
+  EXPECT_EQ(3U, a.size());
+  EXPECT_TRUE(a.asString() == embedded);
+  EXPECT_FALSE(a == CVariant("a"));
+
+  // the string data stays put when the variant holding it is moved
+  CVariant list(CVariant::VariantTypeArray);
+  list.push_back("label");
+  const char *label = list[0].c_str();
+  for (int i = 0; i < 100; i++)
+    list.push_back(i);
+  EXPECT_EQ(label, static_cast<const CVariant&>(list)[0].c_str());
+  CVariant moved(std::move(list));
+  EXPECT_EQ(label, static_cast<const CVariant&>(moved)[0].c_str());
+
+  EXPECT_FALSE(CVariant("false").asBoolean());
+  EXPECT_FALSE(CVariant("0").asBoolean());
+  EXPECT_TRUE(CVariant("1").asBoolean());
+  EXPECT_EQ(42, CVariant("42").asInteger());
+}
+
+TEST(TestVariant, referenceOutlivesCopy)
+{
+  CVariant a;
+  a["item"]["label"] = "label";
+  const CVariant &constA = a;
+  const CVariant &item = constA["item"];
+  {
+    CVariant b = a;
+    a["other"] = 1;
+  }
+  // the reference still refers to the item of a after the copy is gone
+  EXPECT_EQ(&item, &constA["item"]);
+  EXPECT_STREQ("label", item["label"].c_str());
+}
+
+TEST(TestVariant, copySharesStrings)
+{
+  CVariant list(CVariant::VariantTypeArray);
+  for (int i = 0; i < 10; i++)
+  {
+    CVariant item;
+    item["plot"] = "A plot outline";
+    list.push_back(item);
+  }
+  const CVariant &original = list;
+
+  // a copy reads the strings of the original
+  const CVariant copy(list);
+  EXPECT_EQ(original[0]["plot"].c_str(), copy[0]["plot"].c_str());
+
+  // changing an item of a copy leaves the strings shared
+  CVariant changed(list);
+  changed[0]["playcount"] = 1;
+  const CVariant &constChanged = changed;
+  EXPECT_EQ(original[0]["plot"].c_str(), constChanged[0]["plot"].c_str());
+  EXPECT_EQ(original[1]["plot"].c_str(), constChanged[1]["plot"].c_str());
+  EXPECT_FALSE(original[0].isMember("playcount"));
+
+  changed[1]["plot"] = "Another plot outline";
+  EXPECT_NE(original[1]["plot"].c_str(), constChanged[1]["plot"].c_str());
+  EXPECT_STREQ("A plot outline", original[1]["plot"].c_str());
+}
+
+// Timing run, not part of the unit tests. Run it with
+// --gtest_also_run_disabled_tests --gtest_filter=TestVariant.DISABLED_Benchmark
+TEST(TestVariant, DISABLED_Benchmark)
+{
+  // roughly the properties of a movie list item
+  CVariant item;
+  item["label"] = "Movie title";
+  item["title"] = "Movie title (original title)";
+  item["file"] = "smb://server/share/movies/Movie title (2017)/Movie title (2017).mkv";
+  item["year"] = 2017;
+  item["rating"] = 7.5;
+  item["playcount"] = 0;
+  item["mpaa"] = "Rated PG-13";
+  item["plot"] = "A long plot outline that goes on for a while, as plots tend to do.";
+  for (const char *genre : { "Drama", "Thriller", "Science Fiction" })
+    item["genre"].push_back(genre);
+  item["art"]["poster"] = "image://smb%3a%2f%2fserver%2fposter.jpg/";
+  item["art"]["fanart"] = "image://smb%3a%2f%2fserver%2ffanart.jpg/";
+
+  CVariant list(CVariant::VariantTypeArray);
+  for (int i = 0; i < 1000; i++)
+    list.push_back(item);
+
+  const double frequency = (double)CurrentHostFrequency();
+  const unsigned int copies = 1000;
+
+  int64_t start = CurrentHostCounter();
+  for (unsigned int i = 0; i < copies; i++)
+  {
+    CVariant copy(list);
+    EXPECT_EQ(1000U, copy.size());
+  }
+  int64_t elapsed = CurrentHostCounter() - start;
+  printf("copy of 1000 items: %.2f us\n", elapsed / frequency * 1e6 / copies);
+
+  start = CurrentHostCounter();
+  for (unsigned int i = 0; i < copies; i++)
+  {
+    CVariant copy(list);
+    copy[i % 1000]["playcount"] = 1;
+  }
+  elapsed = CurrentHostCounter() - start;
+  printf("copy of 1000 items with one item changed: %.2f us\n", elapsed / frequency * 1e6 / copies);
+
+  const unsigned int strings = 100000;
+  start = CurrentHostCounter();
+  CVariant labels(CVariant::VariantTypeArray);
+  for (unsigned int i = 0; i < strings; i++)
+    labels.push_back(StringUtils::Format("item %u", i));
+  elapsed = CurrentHostCounter() - start;
+  printf("%u strings: %.3f us each\n", strings, elapsed / frequency * 1e6 / strings);
+}
@@ -18,18 +18,126 @@
  *
  */
 
+#include <algorithm>
+#include <signal.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <vector>
 #include "utils/log.h"
 #include "utils/RegExp.h"
 #include "filesystem/File.h"
 #include "filesystem/SpecialProtocol.h"
+#include "threads/Thread.h"
 #include "utils/StringUtils.h"
+#include "utils/TimeUtils.h"
 #include "CompileInfo.h"
 
 #include "test/TestUtils.h"
 
 #include "gtest/gtest.h"
 
+namespace
+{
+std::string ReadLog(const std::string &logfile)
+{
+  std::string logstring;
+  char buf[4096];
+  unsigned int bytesread;
+  XFILE::CFile file;
+  if (file.Open(logfile))
+  {
+    while ((bytesread = file.Read(buf, sizeof(buf))) > 0)
+      logstring.append(buf, bytesread);
+    file.Close();
+  }
+  return logstring;
+}
+
+class LogProducer : public CThread
+{
+public:
+  LogProducer(unsigned int id, unsigned int lines)
+    : CThread("LogProducer"), m_id(id), m_lines(lines), m_totalTime(0), m_maxTime(0)
+  {
+  }
+
+  void Process() override
+  {
+    for (unsigned int i = 0; i < m_lines; i++)
+    {
+      int64_t start = CurrentHostCounter();
+      CLog::Log(LOGDEBUG, "benchmark thread %u line %u", m_id, i);
+      int64_t elapsed = CurrentHostCounter() - start;
+      m_totalTime += elapsed;
+      m_maxTime = std::max(m_maxTime, elapsed);
+    }
+  }
+
+  unsigned int m_id;
+  unsigned int m_lines;
+  int64_t m_totalTime;
+  int64_t m_maxTime;
+};
+
+// Logs lines from several threads at once and checks that every line is
+// written, in the order each thread logged them. The timings are printed
+// when report is set.
+void LogFromThreads(unsigned int threads, unsigned int lines, bool report)
+{
+  std::string appName = CCompileInfo::GetAppName();
+  StringUtils::ToLower(appName);
+  std::string logfile = CSpecialProtocol::TranslatePath("special://temp/") + appName + ".log";
+  EXPECT_TRUE(CLog::Init(CSpecialProtocol::TranslatePath("special://temp/").c_str()));
+
+  std::vector<LogProducer*> producers;
+  int64_t start = CurrentHostCounter();
+  for (unsigned int i = 0; i < threads; i++)
+  {
+    producers.push_back(new LogProducer(i, lines));
+    producers.back()->Create();
+  }
+  int64_t totalTime = 0, maxTime = 0;
+  for (std::vector<LogProducer*>::iterator i = producers.begin(); i != producers.end(); ++i)
+  {
+    (*i)->StopThread();
+    totalTime += (*i)->m_totalTime;
+    maxTime = std::max(maxTime, (*i)->m_maxTime);
+    delete *i;
+  }
+  int64_t logged = CurrentHostCounter() - start;
+  CLog::Close();
+  int64_t written = CurrentHostCounter() - start;
+
+  if (report)
+  {
+    double frequency = (double)CurrentHostFrequency();
+    printf("%u lines from %u threads: logged in %.3f s, written in %.3f s (%.0f lines/s), "
+           "Log() took %.2f us on average, %.2f us at most\n",
+           threads * lines, threads, logged / frequency, written / frequency,
+           threads * lines / (written / frequency), totalTime / frequency * 1e6 / (threads * lines),
+           maxTime / frequency * 1e6);
+  }
+
+  std::string logstring = ReadLog(logfile);
+  std::vector<int> next(threads, 0);
+  unsigned int found = 0;
+  for (size_t pos = logstring.find("benchmark thread "); pos != std::string::npos;
+       pos = logstring.find("benchmark thread ", pos + 1))
+  {
+    unsigned int thread, line;
+    ASSERT_EQ(2, sscanf(logstring.substr(pos, 64).c_str(), "benchmark thread %u line %u", &thread, &line));
+    ASSERT_LT(thread, threads);
+    EXPECT_EQ(next[thread], (int)line);
+    next[thread] = line + 1;
+    found++;
+  }
+  EXPECT_EQ(threads * lines, found);
+
+  EXPECT_TRUE(XFILE::CFile::Delete(logfile));
+}
+}
+
 class Testlog : public testing::Test
 {
 protected:
@@ -151,3 +259,94 @@ TEST_F(Testlog, SetLogLevel)
   CLog::Close();
   EXPECT_TRUE(XFILE::CFile::Delete(logfile));
 }
+
+TEST_F(Testlog, RepeatedLines)
+{
+  std::string logfile, logstring;
+  CRegExp regex;
+
+  std::string appName = CCompileInfo::GetAppName();
+  StringUtils::ToLower(appName);
+  logfile = CSpecialProtocol::TranslatePath("special://temp/") + appName + ".log";
+  EXPECT_TRUE(CLog::Init(CSpecialProtocol::TranslatePath("special://temp/").c_str()));
+
+  for (int i = 0; i < 3; i++)
+    CLog::Log(LOGDEBUG, "repeated log message");
+  CLog::Log(LOGDEBUG, "next log message");
+  CLog::Close();
+
+  logstring = ReadLog(logfile);
+  EXPECT_TRUE(regex.RegComp(".*DEBUG: repeated log message.*"));
+  EXPECT_GE(regex.RegFind(logstring), 0);
+  EXPECT_TRUE(regex.RegComp(".*DEBUG: Previous line repeats 2 times\\..*"));
+  EXPECT_GE(regex.RegFind(logstring), 0);
+  EXPECT_TRUE(regex.RegComp(".*DEBUG: next log message.*"));
+  EXPECT_GE(regex.RegFind(logstring), 0);
+
+  EXPECT_TRUE(XFILE::CFile::Delete(logfile));
+}
+
+TEST_F(Testlog, Rotation)
+{
+  std::string logfile, oldlogfile;
+
+  std::string appName = CCompileInfo::GetAppName();
+  StringUtils::ToLower(appName);
+  logfile = CSpecialProtocol::TranslatePath("special://temp/") + appName + ".log";
+  oldlogfile = CSpecialProtocol::TranslatePath("special://temp/") + appName + ".old.log";
+  XFILE::CFile::Delete(oldlogfile);
+  EXPECT_TRUE(CLog::Init(CSpecialProtocol::TranslatePath("special://temp/").c_str()));
+
+  CLog::SetMaxLogSize(4096);
+  for (int i = 0; i < 200; i++)
+  {
+    CLog::Log(LOGDEBUG, "rotated log message %d", i);
+    if (i % 10 == 0)
+      CLog::Flush();
+  }
+  CLog::Close();
+  CLog::SetMaxLogSize(0);
+
+  EXPECT_TRUE(XFILE::CFile::Exists(oldlogfile));
+  EXPECT_GE(4096U, ReadLog(logfile).size());
+  EXPECT_NE(std::string::npos, ReadLog(logfile).find("rotated log message 199"));
+
+  EXPECT_TRUE(XFILE::CFile::Delete(logfile));
+  EXPECT_TRUE(XFILE::CFile::Delete(oldlogfile));
+}
+
+#if defined(TARGET_POSIX)
+TEST_F(Testlog, QueuedLinesWrittenOnCrash)
+{
+  std::string appName = CCompileInfo::GetAppName();
+  StringUtils::ToLower(appName);
+  std::string logfile = CSpecialProtocol::TranslatePath("special://temp/") + appName + ".log";
+
+  // the lines are still queued for the writer when the child aborts
+  ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+  EXPECT_EXIT({
+    CLog::Init(CSpecialProtocol::TranslatePath("special://temp/").c_str());
+    for (int i = 0; i < 100; i++)
+      CLog::Log(LOGDEBUG, "queued before the crash %d", i);
+    abort();
+  }, ::testing::KilledBySignal(SIGABRT), "");
+
+  std::string logstring = ReadLog(logfile);
+  EXPECT_NE(std::string::npos, logstring.find("queued before the crash 0\n"));
+  EXPECT_NE(std::string::npos, logstring.find("queued before the crash 99\n"));
+
+  EXPECT_TRUE(XFILE::CFile::Delete(logfile));
+}
+#endif
+
+TEST_F(Testlog, ConcurrentLogging)
+{
+  LogFromThreads(4, 500, false);
+}
+
+// Timing run, not part of the unit tests. Run it with
+// --gtest_also_run_disabled_tests --gtest_filter=Testlog.DISABLED_Benchmark
+TEST_F(Testlog, DISABLED_Benchmark)
+{
+  LogFromThreads(8, 20000, true);
+}
@@ -403,6 +403,7 @@ void CGUIWindowFullScreen::Process(unsigned int currentTime, CDirtyRegionList &d
 
 void CGUIWindowFullScreen::Render()
 {
+  g_Windowing.FlushBatchedRendering();
   g_graphicsContext.SetRenderingResolution(g_graphicsContext.GetVideoResolution(), false);
   g_application.m_pPlayer->Render(true, 255);
   g_graphicsContext.SetRenderingResolution(m_coordsRes, m_needsScaling);
@@ -412,6 +413,7 @@ void CGUIWindowFullScreen::Render()
 void CGUIWindowFullScreen::RenderEx()
 {
   CGUIWindow::RenderEx();
+  g_Windowing.FlushBatchedRendering();
   g_graphicsContext.SetRenderingResolution(g_graphicsContext.GetVideoResolution(), false);
   g_application.m_pPlayer->Render(false, 255, false);
 }
@@ -27,14 +27,20 @@
 #include "filesystem/SpecialProtocol.h"
 #include "input/ButtonTranslator.h"
 #include "guilib/GUIControlFactory.h"
+#include "guilib/GUIFontGlyphAtlas.h"
 #include "guilib/GUIFontManager.h"
+#include "guilib/GUIQuadBatch.h"
 #include "guilib/GUITextLayout.h"
 #include "guilib/GUIWindowManager.h"
 #include "guilib/GUIControlProfiler.h"
 #include "GUIInfoManager.h"
+#include "GUILargeTextureManager.h"
+#include "messaging/ApplicationMessenger.h"
 #include "utils/Variant.h"
 #include "utils/StringUtils.h"
 
+#include <inttypes.h>
+
 #ifdef TARGET_POSIX
 #include "linux/XMemUtils.h"
 #endif
@@ -122,6 +128,22 @@ void CGUIWindowDebugInfo::Process(unsigned int currentTime, CDirtyRegionList &di
                                 stat.ullAvailPhys/1024, stat.ullTotalPhys/1024, g_infoManager.GetFPS(),
                                 strCores.c_str(), ucAppName.c_str(), dCPU, profiling.c_str());
 #endif
+    info += StringUtils::Format("\nINFO: %u bools evaluated, %u labels rebuilt per frame",
+                                g_infoManager.GetFrameBoolEvaluations(), g_infoManager.GetFrameLabelRebuilds());
+    CGUIQuadBatch::FrameStats frame = CGUIQuadBatch::GetFrameStats();
+    info += StringUtils::Format("\nGUI: %u quads in %u draws, %.2f ms render", frame.quads, frame.drawCalls, frame.renderTime);
+    const CGUIFontGlyphAtlas::Stats &glyphs = CGUIFontGlyphAtlas::GetTotals();
+    uint64_t lookups = glyphs.hits + glyphs.misses;
+    info += StringUtils::Format("\nFONT: %" PRIu64 " kB glyph textures, %.1f%% glyph hits, %" PRIu64 " slots reused",
+                                glyphs.bytes / 1024, lookups ? 100.0 * glyphs.hits / lookups : 0.0, glyphs.evictions);
+    CGUILargeTextureManager::UploadStats uploads = g_largeTextureManager.GetUploadStats();
+    info += StringUtils::Format("\nUPLOAD: %u textures, %" PRIu64 " MB, %u pending, %u of %u frames hitched (max %.1f ms)",
+                                uploads.textures, uploads.bytes / (1024 * 1024), uploads.pending,
+                                uploads.hitches, uploads.frames, uploads.maxFrameTime);
+    KODI::MESSAGING::CApplicationMessenger::Stats messages = KODI::MESSAGING::CApplicationMessenger::GetInstance().GetStats();
+    info += StringUtils::Format("\nMSG: %u queued (max %u), %" PRIu64 " processed, %u frames over budget, waited <1/4/16/64/256/+ ms: %u/%u/%u/%u/%u/%u",
+                                messages.queued, messages.maxQueued, messages.processed, messages.deferred,
+                                messages.waits[0], messages.waits[1], messages.waits[2], messages.waits[3], messages.waits[4], messages.waits[5]);
   }
 
   // render the skin debug info